@@ -0,0 +1,189 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This is a microbenchmark of the thread-safe caching allocators used internally by Theron
+// to cache message memory and other small allocations. A number of threads (32 by default)
+// each repeatedly free one of a small window of blocks it holds and allocate a replacement,
+// cycling through a handful of sizes typical of messages, so all the threads hammer the same
+// cache at once. The benchmark is run once for each cache: the CachingAllocator previously used,
+// which keeps its pools behind a single TicketLock, and the LockFreeCachingAllocator, which
+// keeps the blocks of each size class in lock-free stacks of their own.
+//
+// For each cache it reports the total number of allocate/free pairs per second, and the average
+// time each thread took per pair. Both caches wrap the default allocator, which is only called
+// when a cache misses.
+//
+// Note that with the POSIX build (the default on Linux) the TicketLock falls back to a plain
+// pthreads spinlock, and the results are only meaningful with at least as many cores as threads.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Allocators/CachingAllocator.h>
+#include <Theron/Detail/Allocators/LockFreeCachingAllocator.h>
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Clock.h>
+#include <Theron/Detail/Threading/Thread.h>
+#include <Theron/Detail/Threading/TicketLock.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+#include "../Common/Timer.h"
+
+
+static const int MAX_THREADS = 64;
+static const int WINDOW_SIZE = 8;
+static const int NUM_SIZES = 6;
+static const Theron::uint32_t SIZES[NUM_SIZES] = { 24, 40, 64, 96, 160, 256 };
+
+
+// Traits of the locked cache, as previously used by the framework message caches.
+struct LockedCacheTraits
+{
+    typedef Theron::Detail::TicketLock LockType;
+
+    struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) AlignType
+    {
+    } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+    static const Theron::uint32_t MAX_POOLS = 8;
+    static const Theron::uint32_t MAX_BLOCKS = 16;
+};
+
+
+// Traits of the lock-free cache, as used by the global cache from which messages are allocated.
+struct LockFreeCacheTraits
+{
+    struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) AlignType
+    {
+    } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+    static const Theron::uint32_t SLAB_SIZE = 16384;
+};
+
+
+typedef Theron::Detail::CachingAllocator<LockedCacheTraits> LockedCache;
+typedef Theron::Detail::LockFreeCachingAllocator<LockFreeCacheTraits> LockFreeCache;
+
+
+// Per-thread state, padded to avoid false sharing between the threads.
+struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) WorkerState
+{
+    Theron::IAllocator *mCache;
+    Theron::Detail::Atomic::UInt32 *mStarted;
+    int mNumPairs;
+    Theron::uint64_t mTicks;
+
+} THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+
+static void WorkerEntryPoint(void *const context)
+{
+    WorkerState *const state(reinterpret_cast<WorkerState *>(context));
+    Theron::IAllocator *const cache(state->mCache);
+
+    void *blocks[WINDOW_SIZE];
+    Theron::uint32_t sizes[WINDOW_SIZE];
+
+    for (int index = 0; index < WINDOW_SIZE; ++index)
+    {
+        sizes[index] = SIZES[index % NUM_SIZES];
+        blocks[index] = cache->AllocateAligned(sizes[index], 8);
+    }
+
+    // Wait for the starting signal so that all threads start contending together.
+    while (state->mStarted->Load() == 0)
+    {
+        Theron::Detail::Utils::YieldToAnyThread();
+    }
+
+    const Theron::uint64_t start(Theron::Detail::Clock::GetTicks());
+
+    for (int pair = 0; pair < state->mNumPairs; ++pair)
+    {
+        const int slot(pair % WINDOW_SIZE);
+        cache->Free(blocks[slot], sizes[slot]);
+
+        // Touch the new block, as a real user would.
+        sizes[slot] = SIZES[pair % NUM_SIZES];
+        blocks[slot] = cache->AllocateAligned(sizes[slot], 8);
+        *static_cast<int *>(blocks[slot]) = pair;
+    }
+
+    state->mTicks = Theron::Detail::Clock::GetTicks() - start;
+
+    for (int index = 0; index < WINDOW_SIZE; ++index)
+    {
+        cache->Free(blocks[index], sizes[index]);
+    }
+}
+
+
+template <class CacheType>
+static void RunBenchmark(const char *const name, const int numThreads, const int numPairs)
+{
+    CacheType cache(Theron::AllocatorManager::GetAllocator());
+    Theron::Detail::Atomic::UInt32 started(0);
+
+    WorkerState states[MAX_THREADS];
+    Theron::Detail::Thread threads[MAX_THREADS];
+
+    for (int index = 0; index < numThreads; ++index)
+    {
+        states[index].mCache = &cache;
+        states[index].mStarted = &started;
+        states[index].mNumPairs = numPairs;
+        states[index].mTicks = 0;
+        threads[index].Start(WorkerEntryPoint, &states[index]);
+    }
+
+    Timer timer;
+    timer.Start();
+
+    started.Store(1);
+
+    for (int index = 0; index < numThreads; ++index)
+    {
+        threads[index].Join();
+    }
+
+    timer.Stop();
+
+    Theron::uint64_t totalTicks(0);
+    for (int index = 0; index < numThreads; ++index)
+    {
+        totalTicks += states[index].mTicks;
+    }
+
+    const double totalPairs(static_cast<double>(numThreads) * numPairs);
+    const double threadSeconds(static_cast<double>(totalTicks) / static_cast<double>(Theron::Detail::Clock::GetFrequency()));
+
+    printf("%-10s %12.0f pairs/s   %8.1f nanoseconds per pair per thread\n",
+        name,
+        totalPairs / timer.Seconds(),
+        threadSeconds * 1.0e9 / totalPairs);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int numThreads = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 32;
+    const int numPairs = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 200000;
+
+    if (numThreads > MAX_THREADS)
+    {
+        numThreads = MAX_THREADS;
+    }
+
+    printf("Using numThreads = %d (use first command line argument to change)\n", numThreads);
+    printf("Using numPairs = %d per thread (use second command line argument to change)\n", numPairs);
+
+    RunBenchmark<LockedCache>("locked", numThreads, numPairs);
+    RunBenchmark<LockFreeCache>("lock-free", numThreads, numPairs);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures how actors with blocking message handlers affect other actors
+// in the same framework. A number of 'sleeper' actors simulate blocking I/O by sleeping
+// in their handlers, while the main thread measures the round-trip latency of requests
+// to an ordinary 'echo' actor, whose handler does no blocking work at all. The sleeper
+// requests are sent first, so they occupy the worker threads while the echo requests
+// are made.
+//
+// The benchmark is run three times:
+// - with the sleepers unmarked and compensation disabled, so the echo requests queue up
+//   behind the sleepers on the blocked worker threads;
+// - with the sleepers unmarked but compensation enabled, so the framework starts extra
+//   worker threads when it sees that all of its threads are blocked;
+// - with the sleepers marked as blocking, so they are executed by the separate pool of
+//   blocking worker threads and the echo actor has the main worker threads to itself.
+//
+// For each run it reports the average and worst round-trip latencies of the echo requests
+// made while the sleepers were busy, and the time taken to complete all of the sleeper requests.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Threading/Utils.h>
+
+#include "../Common/Timer.h"
+
+
+static const int MAX_SLEEPERS = 64;
+
+
+class Echo : public Theron::Actor
+{
+public:
+
+    inline Echo(Theron::Framework &framework) : Theron::Actor(framework)
+    {
+        RegisterHandler(this, &Echo::Handler);
+    }
+
+private:
+
+    inline void Handler(const int &message, const Theron::Address from)
+    {
+        Send(message, from);
+    }
+};
+
+
+struct SleepRequest
+{
+    inline explicit SleepRequest(const Theron::uint32_t milliseconds) : mMilliseconds(milliseconds)
+    {
+    }
+
+    Theron::uint32_t mMilliseconds;
+};
+
+
+class Sleeper : public Theron::Actor
+{
+public:
+
+    inline Sleeper(Theron::Framework &framework, const bool blocking) : Theron::Actor(framework)
+    {
+        if (blocking)
+        {
+            SetBlocking();
+        }
+
+        RegisterHandler(this, &Sleeper::Sleep);
+    }
+
+private:
+
+    inline void Sleep(const SleepRequest &request, const Theron::Address from)
+    {
+        // Stands in for a blocking call such as a file read or a database query.
+        Theron::Detail::Utils::SleepThread(request.mMilliseconds);
+        Send(request, from);
+    }
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(int);
+THERON_DECLARE_REGISTERED_MESSAGE(SleepRequest);
+
+THERON_DEFINE_REGISTERED_MESSAGE(int);
+THERON_DEFINE_REGISTERED_MESSAGE(SleepRequest);
+
+
+static void RunBenchmark(
+    const char *const name,
+    const bool blocking,
+    const Theron::uint32_t maxCompensationThreads,
+    const int numThreads,
+    const int numSleepers,
+    const int numRequests)
+{
+    Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+    params.mMaxCompensationThreads = maxCompensationThreads;
+
+    Theron::Framework framework(params);
+    Theron::Receiver echoReceiver;
+    Theron::Receiver sleepReceiver;
+
+    Echo echo(framework);
+
+    Sleeper *sleepers[MAX_SLEEPERS];
+    for (int index = 0; index < numSleepers; ++index)
+    {
+        sleepers[index] = new Sleeper(framework, blocking);
+    }
+
+    Timer sleepTimer;
+    sleepTimer.Start();
+
+    // Occupy the worker threads with sleeper requests before making the echo requests.
+    for (int request = 0; request < numRequests; ++request)
+    {
+        for (int index = 0; index < numSleepers; ++index)
+        {
+            framework.Send(SleepRequest(10), sleepReceiver.GetAddress(), sleepers[index]->GetAddress());
+        }
+    }
+
+    // Make echo requests one at a time until all the sleeper requests have completed.
+    const Theron::uint32_t numSleeps(static_cast<Theron::uint32_t>(numSleepers * numRequests));
+    int numEchoes(0);
+    double totalLatency(0.0);
+    double maxLatency(0.0);
+
+    while (sleepReceiver.Count() < numSleeps)
+    {
+        Timer echoTimer;
+        echoTimer.Start();
+
+        framework.Send(numEchoes, echoReceiver.GetAddress(), echo.GetAddress());
+        echoReceiver.Wait();
+
+        echoTimer.Stop();
+
+        const double latency(echoTimer.Seconds() * 1000.0);
+        totalLatency += latency;
+        maxLatency = latency > maxLatency ? latency : maxLatency;
+        ++numEchoes;
+    }
+
+    sleepTimer.Stop();
+
+    printf("%-12s echo latency avg %8.3f ms   max %8.3f ms   sleepers %6.3f seconds\n",
+        name,
+        numEchoes ? totalLatency / numEchoes : 0.0,
+        maxLatency,
+        sleepTimer.Seconds());
+
+    for (int index = 0; index < numSleepers; ++index)
+    {
+        delete sleepers[index];
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numThreads = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 4;
+    int numSleepers = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 8;
+    const int numRequests = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 20;
+
+    if (numSleepers > MAX_SLEEPERS)
+    {
+        numSleepers = MAX_SLEEPERS;
+    }
+
+    printf("Using numThreads = %d (use first command line argument to change)\n", numThreads);
+    printf("Using numSleepers = %d (use second command line argument to change)\n", numSleepers);
+    printf("Using numRequests = %d (use third command line argument to change)\n", numRequests);
+    printf("Each sleeper request blocks for 10ms\n");
+
+    RunBenchmark("unmarked", false, 0, numThreads, numSleepers, numRequests);
+    RunBenchmark("compensated", false, 4, numThreads, numSleepers, numRequests);
+    RunBenchmark("marked", true, 0, numThreads, numSleepers, numRequests);
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the effect of co-locating actors that mostly message each other.
+// A number of independent pairs of 'player' actors volley messages back and forth, with several
+// balls in play per pair so that the pairs' mailboxes are usually pushed to the shared work queue,
+// from which any worker thread may take them. Each player touches some state of its own as it
+// handles a volley, and the volleys carry a small payload written by one player and read by the other.
+//
+// The benchmark is run twice: once with the framework scheduling mailboxes freely, and once with
+// mColocateActors set, so that the framework learns which players talk to each other and gives
+// each pair a home worker thread. For each run it reports the time taken for all the volleys to
+// finish, and the number of messages handled per second. The benefit depends on the number of
+// processors, and on whether they share caches; on a single processor there's nothing to gain.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+struct Volley
+{
+    Theron::uint32_t mCount;
+    Theron::uint32_t mPayload[15];
+};
+
+
+class Player : public Theron::Actor
+{
+public:
+
+    inline Player(Theron::Framework &framework, const Theron::Address client) :
+      Theron::Actor(framework),
+      mClient(client),
+      mPartner()
+    {
+        for (Theron::uint32_t index = 0; index < STATE_SIZE; ++index)
+        {
+            mState[index] = index;
+        }
+
+        RegisterHandler(this, &Player::Handle);
+    }
+
+    inline void SetPartner(const Theron::Address partner)
+    {
+        mPartner = partner;
+    }
+
+private:
+
+    static const Theron::uint32_t STATE_SIZE = 256;
+
+    inline void Handle(const Volley &volley, const Theron::Address /*from*/)
+    {
+        // Fold the payload into the player's state and write a fresh payload for the partner.
+        Volley reply;
+        reply.mCount = volley.mCount - 1;
+
+        for (Theron::uint32_t index = 0; index < STATE_SIZE; ++index)
+        {
+            mState[index] += volley.mPayload[index % 15];
+        }
+
+        for (Theron::uint32_t index = 0; index < 15; ++index)
+        {
+            reply.mPayload[index] = mState[index * 16];
+        }
+
+        if (volley.mCount > 0)
+        {
+            Send(reply, mPartner);
+        }
+        else
+        {
+            Send(volley.mCount, mClient);
+        }
+    }
+
+    const Theron::Address mClient;
+    Theron::Address mPartner;
+    Theron::uint32_t mState[STATE_SIZE];
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(Volley);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::uint32_t);
+
+THERON_DEFINE_REGISTERED_MESSAGE(Volley);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::uint32_t);
+
+
+static void RunBenchmark(
+    const char *const name,
+    const bool colocate,
+    const Theron::uint32_t numThreads,
+    const Theron::uint32_t numPairs,
+    const Theron::uint32_t numBalls,
+    const Theron::uint32_t numVolleys)
+{
+    Theron::Framework::Parameters params(numThreads);
+    params.mColocateActors = colocate;
+
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+
+    Player **const players(new Player *[numPairs * 2]);
+    for (Theron::uint32_t index = 0; index < numPairs * 2; ++index)
+    {
+        players[index] = new Player(framework, receiver.GetAddress());
+    }
+
+    for (Theron::uint32_t index = 0; index < numPairs * 2; index += 2)
+    {
+        players[index]->SetPartner(players[index + 1]->GetAddress());
+        players[index + 1]->SetPartner(players[index]->GetAddress());
+    }
+
+    Timer timer;
+    timer.Start();
+
+    Volley volley;
+    volley.mCount = numVolleys;
+
+    for (Theron::uint32_t index = 0; index < 15; ++index)
+    {
+        volley.mPayload[index] = index;
+    }
+
+    for (Theron::uint32_t ball = 0; ball < numBalls; ++ball)
+    {
+        for (Theron::uint32_t index = 0; index < numPairs * 2; index += 2)
+        {
+            framework.Send(volley, receiver.GetAddress(), players[index]->GetAddress());
+        }
+    }
+
+    const Theron::uint32_t numResults(numPairs * numBalls);
+    Theron::uint32_t received(0);
+
+    while (received < numResults)
+    {
+        received += receiver.Wait(numResults - received);
+    }
+
+    timer.Stop();
+
+    const double messages(static_cast<double>(numPairs) * numBalls * (numVolleys + 1));
+    printf("%-10s %8.3f seconds   %12.0f messages per second\n",
+        name,
+        timer.Seconds(),
+        messages / timer.Seconds());
+
+    for (Theron::uint32_t index = 0; index < numPairs * 2; ++index)
+    {
+        delete players[index];
+    }
+
+    delete [] players;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numThreads = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 4;
+    const int numPairs = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 64;
+    const int numBalls = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 4;
+    const int numVolleys = (argc > 4 && atoi(argv[4]) > 0) ? atoi(argv[4]) : 2000;
+
+    printf("Using numThreads = %d (use first command line argument to change)\n", numThreads);
+    printf("Using numPairs = %d (use second command line argument to change)\n", numPairs);
+    printf("Using numBalls = %d (use third command line argument to change)\n", numBalls);
+    printf("Using numVolleys = %d (use fourth command line argument to change)\n", numVolleys);
+
+    RunBenchmark("free", false, numThreads, numPairs, numBalls, numVolleys);
+    RunBenchmark("colocated", true, numThreads, numPairs, numBalls, numVolleys);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_BENCHMARKS_COMMON_EVENTCOUNTER_H
+#define THERON_BENCHMARKS_COMMON_EVENTCOUNTER_H
+
+
+#include <string.h>
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+// Counts a hardware event in the calling thread and the threads it creates afterwards.
+// Events are counted with Linux perf events, where the kernel allows it, and are unavailable elsewhere.
+class EventCounter
+{
+public:
+
+    enum Event
+    {
+        CPU_CYCLES = 0,
+        DTLB_LOAD_MISSES
+    };
+
+    explicit EventCounter(const Event event) : mDescriptor(-1)
+    {
+#if defined(__linux__)
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+
+        if (event == CPU_CYCLES)
+        {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        }
+        else
+        {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+
+        attr.size = sizeof(attr);
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        mDescriptor = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+
+#else
+        (void) event;
+#endif
+    }
+
+    ~EventCounter()
+    {
+#if defined(__linux__)
+        if (mDescriptor != -1)
+        {
+            close(mDescriptor);
+        }
+#endif
+    }
+
+    // Events in threads created since construction are only included once the threads have exited.
+    bool Read(Theron::uint64_t &count) const
+    {
+#if defined(__linux__)
+        return (mDescriptor != -1 && read(mDescriptor, &count, sizeof(count)) == sizeof(count));
+#else
+        (void) count;
+        return false;
+#endif
+    }
+
+private:
+
+    EventCounter(const EventCounter &other);
+    EventCounter &operator=(const EventCounter &other);
+
+    int mDescriptor;
+
+};
+
+
+#endif // THERON_BENCHMARKS_COMMON_EVENTCOUNTER_H
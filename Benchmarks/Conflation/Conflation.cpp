@@ -0,0 +1,175 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the effect of conflating messages on a slow consumer of a fast
+// stream of updates, such as market data, where only the latest value of each key matters.
+// The main thread sends a burst of updates, cycling through a number of keys, as fast as it
+// can to a 'consumer' actor, which burns a fixed amount of processor time handling each one.
+// The consumer is finished once it has seen the final value of every key.
+//
+// The benchmark is run twice: once with every update queued, and once with the consumer
+// conflating updates by key, so that each update replaces any pending update with the same
+// key. For each run it reports the time taken for the consumer to see the final values, the
+// number of updates it actually handled and the processor time spent handling them, and the
+// peak length of its mailbox and peak memory used by waiting messages.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Threading/Clock.h>
+
+#include "../Common/Timer.h"
+
+
+struct Update
+{
+    Theron::uint32_t mKey;
+    Theron::uint32_t mValue;
+};
+
+
+class Consumer : public Theron::Actor
+{
+public:
+
+    inline Consumer(
+        Theron::Framework &framework,
+        const bool conflate,
+        const Theron::uint32_t numKeys,
+        const Theron::uint32_t numUpdates,
+        const Theron::uint32_t workMicroseconds) :
+      Theron::Actor(framework),
+      mNumKeys(numKeys),
+      mNumUpdates(numUpdates),
+      mWorkTicks(Theron::Detail::Clock::GetFrequency() * workMicroseconds / 1000000),
+      mNumFinal(0),
+      mNumHandled(0),
+      mPeakQueued(0),
+      mBusyTicks(0)
+    {
+        if (conflate)
+        {
+            ConflateMessages(&Update::mKey);
+        }
+
+        RegisterHandler(this, &Consumer::Handle);
+    }
+
+    inline Theron::uint32_t NumHandled() const
+    {
+        return mNumHandled;
+    }
+
+    inline Theron::uint32_t PeakQueued() const
+    {
+        return mPeakQueued;
+    }
+
+    inline double BusySeconds() const
+    {
+        return static_cast<double>(mBusyTicks) / static_cast<double>(Theron::Detail::Clock::GetFrequency());
+    }
+
+private:
+
+    inline void Handle(const Update &update, const Theron::Address from)
+    {
+        const Theron::uint64_t start(Theron::Detail::Clock::GetTicks());
+
+        const Theron::uint32_t queued(GetNumQueuedMessages());
+        mPeakQueued = queued > mPeakQueued ? queued : mPeakQueued;
+        ++mNumHandled;
+
+        // Burn processor time, standing in for the work of handling the update.
+        while (Theron::Detail::Clock::GetTicks() - start < mWorkTicks)
+        {
+        }
+
+        // The final value of each key is one of the last updates sent.
+        if (update.mValue + mNumKeys >= mNumUpdates && ++mNumFinal == mNumKeys)
+        {
+            Send(mNumHandled, from);
+        }
+
+        mBusyTicks += Theron::Detail::Clock::GetTicks() - start;
+    }
+
+    const Theron::uint32_t mNumKeys;
+    const Theron::uint32_t mNumUpdates;
+    const Theron::uint64_t mWorkTicks;
+    Theron::uint32_t mNumFinal;
+    Theron::uint32_t mNumHandled;
+    Theron::uint32_t mPeakQueued;
+    Theron::uint64_t mBusyTicks;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(Update);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::uint32_t);
+
+THERON_DEFINE_REGISTERED_MESSAGE(Update);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::uint32_t);
+
+
+static void RunBenchmark(
+    const char *const name,
+    const bool conflate,
+    const Theron::uint32_t numKeys,
+    const Theron::uint32_t numUpdates,
+    const Theron::uint32_t workMicroseconds)
+{
+    // A budget much larger than the messages can use enables accounting for their memory.
+    Theron::Framework::Parameters params(1);
+    params.mMessageBudget = 0x7FFFFFFF;
+
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+
+    Consumer consumer(framework, conflate, numKeys, numUpdates, workMicroseconds);
+
+    Timer timer;
+    timer.Start();
+
+    for (Theron::uint32_t index = 0; index < numUpdates; ++index)
+    {
+        Update update;
+        update.mKey = index % numKeys;
+        update.mValue = index;
+
+        framework.Send(update, receiver.GetAddress(), consumer.GetAddress());
+    }
+
+    receiver.Wait();
+    timer.Stop();
+
+    printf("%-10s %8.3f seconds   handled %8u   busy %8.3f seconds   peak queued %8u   peak memory %10u bytes\n",
+        name,
+        timer.Seconds(),
+        consumer.NumHandled(),
+        consumer.BusySeconds(),
+        consumer.PeakQueued(),
+        framework.GetPeakMessageMemory());
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numKeys = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 100;
+    const int numUpdates = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 50000;
+    const int workMicroseconds = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 20;
+
+    printf("Using numKeys = %d (use first command line argument to change)\n", numKeys);
+    printf("Using numUpdates = %d (use second command line argument to change)\n", numUpdates);
+    printf("Using workMicroseconds = %d (use third command line argument to change)\n", workMicroseconds);
+
+    RunBenchmark("queued", false, numKeys, numUpdates, workMicroseconds);
+    RunBenchmark("conflated", true, numKeys, numUpdates, workMicroseconds);
+
+    return 0;
+}
@@ -0,0 +1,394 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the throughput of an echo server over loopback TCP, with many
+// concurrent connections each handled by its own actor.
+//
+// The server is a framework in which an acceptor actor watches a listening socket, accepting
+// new connections as it becomes readable and creating a connection actor for each one.
+// Each connection actor watches its socket (see Framework::WatchDescriptor), echoes back
+// whatever it reads when notified that the socket is readable, and then watches it again.
+// No thread is dedicated to any connection: a single reactor thread waits for readiness of all
+// the sockets, and delivers each batch of events to the connection actors as messages.
+//
+// The client runs in a separate process, forked before the server framework is created, so
+// that the client's and server's sockets count against separate per-process descriptor
+// limits. The client opens all the connections, then drives them with a plain epoll loop,
+// sending a small message on each connection and sending the next as soon as the echo of
+// the last is received, for a fixed number of rounds per connection.
+//
+// The client reports the number of round trips per second across all connections.
+// The number of connections is limited by the descriptor limit of the process (see ulimit -n).
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+#if THERON_EPOLL
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+
+static const int MESSAGE_SIZE = 64;
+static const int MAX_EVENTS = 256;
+
+
+// Sent to the main thread by a connection actor when its client closes the connection.
+struct Closed
+{
+};
+
+
+static void SetNonBlocking(const int descriptor)
+{
+    const int flags(fcntl(descriptor, F_GETFL, 0));
+    fcntl(descriptor, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+static void SetNoDelay(const int descriptor)
+{
+    const int enable(1);
+    setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+
+// Raises the descriptor limit of the calling process as far as it's allowed to go.
+static int RaiseDescriptorLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+    {
+        return 1024;
+    }
+
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return static_cast<int>(limit.rlim_cur);
+}
+
+
+// Actor that echoes back everything received on one connection.
+class Connection : public Theron::Actor
+{
+public:
+
+    inline Connection(Theron::Framework &framework, const int socket, const Theron::Address owner) :
+      Theron::Actor(framework),
+      mSocket(socket),
+      mOwner(owner)
+    {
+        RegisterHandler(this, &Connection::Handler);
+    }
+
+private:
+
+    inline void Handler(const Theron::DescriptorReady &/*ready*/, const Theron::Address /*from*/)
+    {
+        char buffer[MESSAGE_SIZE * 4];
+
+        while (true)
+        {
+            const ssize_t received(recv(mSocket, buffer, sizeof(buffer), 0));
+            if (received > 0)
+            {
+                // Loopback sends of small messages don't fill the socket buffer, so this doesn't block.
+                ssize_t sent(0);
+                while (sent < received)
+                {
+                    const ssize_t result(send(mSocket, buffer + sent, static_cast<size_t>(received - sent), MSG_NOSIGNAL));
+                    if (result < 0 && errno != EAGAIN && errno != EINTR)
+                    {
+                        break;
+                    }
+
+                    sent += (result > 0) ? result : 0;
+                }
+
+                continue;
+            }
+
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                // Drained the socket, so wait for it to become readable again.
+                GetFramework().WatchDescriptor(GetAddress(), mSocket, Theron::DescriptorReady::READABLE);
+                return;
+            }
+
+            if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            // The client closed the connection, or it failed.
+            GetFramework().UnwatchDescriptor(mSocket);
+            close(mSocket);
+            Send(Closed(), mOwner);
+            return;
+        }
+    }
+
+    const int mSocket;
+    const Theron::Address mOwner;
+};
+
+
+// Actor that accepts new connections on a listening socket, creating an actor for each.
+class Acceptor : public Theron::Actor
+{
+public:
+
+    inline Acceptor(Theron::Framework &framework, const int socket, const Theron::Address owner) :
+      Theron::Actor(framework),
+      mSocket(socket),
+      mOwner(owner),
+      mConnections()
+    {
+        RegisterHandler(this, &Acceptor::Handler);
+    }
+
+    inline ~Acceptor()
+    {
+        for (size_t index = 0; index < mConnections.size(); ++index)
+        {
+            delete mConnections[index];
+        }
+    }
+
+private:
+
+    inline void Handler(const Theron::DescriptorReady &/*ready*/, const Theron::Address /*from*/)
+    {
+        while (true)
+        {
+            const int socket(accept(mSocket, 0, 0));
+            if (socket < 0)
+            {
+                break;
+            }
+
+            SetNonBlocking(socket);
+            SetNoDelay(socket);
+
+            Connection *const connection(new Connection(GetFramework(), socket, mOwner));
+            mConnections.push_back(connection);
+
+            GetFramework().WatchDescriptor(connection->GetAddress(), socket, Theron::DescriptorReady::READABLE);
+        }
+
+        GetFramework().WatchDescriptor(GetAddress(), mSocket, Theron::DescriptorReady::READABLE);
+    }
+
+    const int mSocket;
+    const Theron::Address mOwner;
+    std::vector<Connection *> mConnections;
+};
+
+
+// Opens the connections and drives them in rounds of echoes, in the client process.
+static void RunClient(const unsigned short port, const int numConnections, const int numRounds)
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<int> sockets(static_cast<size_t>(numConnections), -1);
+    std::vector<int> received(static_cast<size_t>(numConnections), 0);
+    std::vector<int> rounds(static_cast<size_t>(numConnections), 0);
+
+    const int epollDescriptor(epoll_create1(0));
+
+    for (int index = 0; index < numConnections; ++index)
+    {
+        const int socket(::socket(AF_INET, SOCK_STREAM, 0));
+        if (socket < 0 || connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            printf("Failed to open connection %d\n", index);
+            exit(1);
+        }
+
+        SetNonBlocking(socket);
+        SetNoDelay(socket);
+        sockets[static_cast<size_t>(index)] = socket;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(index);
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, socket, &event);
+    }
+
+    char message[MESSAGE_SIZE];
+    memset(message, 'x', sizeof(message));
+
+    Timer timer;
+    timer.Start();
+
+    // Start the first round on every connection.
+    for (int index = 0; index < numConnections; ++index)
+    {
+        send(sockets[static_cast<size_t>(index)], message, MESSAGE_SIZE, MSG_NOSIGNAL);
+    }
+
+    int finished(0);
+    epoll_event events[MAX_EVENTS];
+    char buffer[MESSAGE_SIZE];
+
+    while (finished < numConnections)
+    {
+        const int eventCount(epoll_wait(epollDescriptor, events, MAX_EVENTS, -1));
+        for (int eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+        {
+            const size_t index(events[eventIndex].data.u32);
+            const int socket(sockets[index]);
+
+            const ssize_t size(recv(socket, buffer, sizeof(buffer), 0));
+            if (size <= 0)
+            {
+                continue;
+            }
+
+            received[index] += static_cast<int>(size);
+            if (received[index] < MESSAGE_SIZE)
+            {
+                continue;
+            }
+
+            // Received the whole echo, so start the next round, if any.
+            received[index] -= MESSAGE_SIZE;
+            if (++rounds[index] < numRounds)
+            {
+                send(socket, message, MESSAGE_SIZE, MSG_NOSIGNAL);
+            }
+            else
+            {
+                ++finished;
+            }
+        }
+    }
+
+    timer.Stop();
+
+    const double seconds(timer.Seconds());
+    const double roundTrips(static_cast<double>(numConnections) * static_cast<double>(numRounds));
+
+    printf("Completed %.0f round trips on %d connections in %.2f seconds\n", roundTrips, numConnections, seconds);
+    printf("Round trips per second = %.0f\n", roundTrips / seconds);
+
+    for (int index = 0; index < numConnections; ++index)
+    {
+        close(sockets[static_cast<size_t>(index)]);
+    }
+
+    close(epollDescriptor);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int numConnections = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 10000;
+    const int numRounds = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 10;
+    const int numThreads = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 4;
+
+    // Each process needs a descriptor per connection, plus a few spare.
+    const int descriptorLimit(RaiseDescriptorLimit() - 32);
+    if (numConnections > descriptorLimit)
+    {
+        numConnections = descriptorLimit;
+    }
+
+    printf("Using numConnections = %d (use first command line argument to change)\n", numConnections);
+    printf("Using numRounds = %d (use second command line argument to change)\n", numRounds);
+    printf("Using numThreads = %d (use third command line argument to change)\n", numThreads);
+    fflush(stdout);
+
+    // Open the listening socket on an ephemeral port, before forking, so the client knows the port.
+    const int listener(socket(AF_INET, SOCK_STREAM, 0));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addressSize(sizeof(address));
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr *>(&address), &addressSize) != 0)
+    {
+        printf("Failed to open listening socket\n");
+        return 1;
+    }
+
+    const unsigned short port(ntohs(address.sin_port));
+
+    const pid_t child(fork());
+    if (child == 0)
+    {
+        close(listener);
+        RunClient(port, numConnections, numRounds);
+        return 0;
+    }
+
+    SetNonBlocking(listener);
+
+    {
+        Theron::Framework framework(numThreads);
+        Theron::Receiver receiver;
+        Theron::Catcher<Closed> catcher;
+        receiver.RegisterHandler(&catcher, &Theron::Catcher<Closed>::Push);
+
+        Acceptor acceptor(framework, listener, receiver.GetAddress());
+        framework.WatchDescriptor(acceptor.GetAddress(), listener, Theron::DescriptorReady::READABLE);
+
+        // Wait for the client to finish, and for the server to see all of its connections closed.
+        int status(0);
+        waitpid(child, &status, 0);
+
+        int closed(0);
+        while (closed < numConnections)
+        {
+            closed += static_cast<int>(receiver.Wait(static_cast<Theron::uint32_t>(numConnections - closed)));
+        }
+
+        framework.UnwatchDescriptor(listener);
+    }
+
+    close(listener);
+    return 0;
+}
+
+
+#else
+
+
+int main()
+{
+    printf("This benchmark requires epoll (see THERON_EPOLL)\n");
+    return 0;
+}
+
+
+#endif // THERON_EPOLL
@@ -0,0 +1,282 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the aggregate throughput of reading many small files.
+// The benchmark first creates a number of small files in the current directory,
+// then reads them all back in two different ways:
+// - using the file I/O service of the framework, with all of the reads requested at once
+//   and the results delivered as messages. When io_uring is available (see THERON_IO_URING)
+//   the reads are submitted to the kernel in batches by a single service thread; otherwise
+//   they're performed by a small pool of threads.
+// - using a number of reader actors marked as blocking, which read the files with ordinary
+//   blocking calls in their handlers, executed by the framework's pool of blocking threads.
+//
+// For each method it reports the number of files read per second and the data rate.
+// The files are deleted at the end of the run. Since the files have just been written they're
+// likely to be in the operating system's file cache, so the benchmark mostly measures the
+// overheads of requesting the reads and delivering the results, rather than of the disk.
+//
+// Building with "io_uring=off" replaces the io_uring service with the thread pool, for comparison.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+#ifdef _MSC_VER
+#pragma warning(disable:4996) // 'fopen': This function or variable may be unsafe.
+#endif // _MSC_VER
+
+
+static const int MAX_READERS = 64;
+static const int MAX_FILE_NAME = 64;
+
+
+static void GetFileName(char *const buffer, const int index)
+{
+    sprintf(buffer, "FileReads_%d.tmp", index);
+}
+
+
+// Request to read one of the files, by index.
+struct ReadRequest
+{
+    inline explicit ReadRequest(const int index = 0) : mIndex(index)
+    {
+    }
+
+    int mIndex;
+};
+
+
+// Reader actor that reads files with ordinary blocking calls.
+class Reader : public Theron::Actor
+{
+public:
+
+    inline Reader(Theron::Framework &framework, const Theron::Address &receiver, const int fileSize) :
+      Theron::Actor(framework),
+      mReceiver(receiver),
+      mBuffer(new char[fileSize]),
+      mFileSize(fileSize)
+    {
+        SetBlocking();
+        RegisterHandler(this, &Reader::Read);
+    }
+
+    inline ~Reader()
+    {
+        delete [] mBuffer;
+    }
+
+private:
+
+    inline void Read(const ReadRequest &request, const Theron::Address /*from*/)
+    {
+        char fileName[MAX_FILE_NAME];
+        GetFileName(fileName, request.mIndex);
+
+        int size(0);
+        if (FILE *const handle = fopen(fileName, "rb"))
+        {
+            size = static_cast<int>(fread(mBuffer, 1, static_cast<size_t>(mFileSize), handle));
+            fclose(handle);
+        }
+
+        Send(size, mReceiver);
+    }
+
+    const Theron::Address mReceiver;
+    char *const mBuffer;
+    const int mFileSize;
+};
+
+
+// Receiver handler that counts the bytes read by the file I/O service and frees the buffers.
+class ResultCounter
+{
+public:
+
+    inline explicit ResultCounter(Theron::Framework &framework) : mFramework(framework), mBytes(0)
+    {
+    }
+
+    inline void Handler(const Theron::FileResult &result, const Theron::Address /*from*/)
+    {
+        mBytes += result.mSize;
+        mFramework.FreeFileBuffer(result.mBuffer);
+    }
+
+    Theron::Framework &mFramework;
+    Theron::uint64_t mBytes;
+};
+
+
+// Receiver handler that counts the bytes read by the blocking reader actors.
+class SizeCounter
+{
+public:
+
+    inline SizeCounter() : mBytes(0)
+    {
+    }
+
+    inline void Handler(const int &size, const Theron::Address /*from*/)
+    {
+        mBytes += static_cast<Theron::uint64_t>(size);
+    }
+
+    Theron::uint64_t mBytes;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(int);
+THERON_DECLARE_REGISTERED_MESSAGE(ReadRequest);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::FileResult);
+
+THERON_DEFINE_REGISTERED_MESSAGE(int);
+THERON_DEFINE_REGISTERED_MESSAGE(ReadRequest);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::FileResult);
+
+
+static void Report(const char *const name, const int numFiles, const Theron::uint64_t bytes, const double seconds)
+{
+    printf("%-10s read %d files (%.1f MB) in %.3f seconds: %9.0f files/s %8.1f MB/s\n",
+        name,
+        numFiles,
+        static_cast<double>(bytes) / (1024.0 * 1024.0),
+        seconds,
+        numFiles / seconds,
+        static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds);
+}
+
+
+static void ReadWithFileService(const int numThreads, const int numFiles, const int fileSize)
+{
+    Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+    params.mFileBufferSize = static_cast<Theron::uint32_t>(fileSize);
+
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+    ResultCounter counter(framework);
+    receiver.RegisterHandler(&counter, &ResultCounter::Handler);
+
+    Timer timer;
+    timer.Start();
+
+    char fileName[MAX_FILE_NAME];
+    for (int index = 0; index < numFiles; ++index)
+    {
+        GetFileName(fileName, index);
+        framework.ReadFile(receiver.GetAddress(), fileName, static_cast<Theron::uint32_t>(index));
+    }
+
+    int numReceived(0);
+    while (numReceived < numFiles)
+    {
+        numReceived += static_cast<int>(receiver.Wait(static_cast<Theron::uint32_t>(numFiles - numReceived)));
+    }
+
+    timer.Stop();
+
+    Report("service", numFiles, counter.mBytes, timer.Seconds());
+}
+
+
+static void ReadWithBlockingActors(const int numThreads, const int numReaders, const int numFiles, const int fileSize)
+{
+    Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+    params.mMaxBlockingThreads = static_cast<Theron::uint32_t>(numReaders);
+
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+    SizeCounter counter;
+    receiver.RegisterHandler(&counter, &SizeCounter::Handler);
+
+    Reader *readers[MAX_READERS];
+    for (int index = 0; index < numReaders; ++index)
+    {
+        readers[index] = new Reader(framework, receiver.GetAddress(), fileSize);
+    }
+
+    Timer timer;
+    timer.Start();
+
+    for (int index = 0; index < numFiles; ++index)
+    {
+        framework.Send(ReadRequest(index), receiver.GetAddress(), readers[index % numReaders]->GetAddress());
+    }
+
+    int numReceived(0);
+    while (numReceived < numFiles)
+    {
+        numReceived += static_cast<int>(receiver.Wait(static_cast<Theron::uint32_t>(numFiles - numReceived)));
+    }
+
+    timer.Stop();
+
+    Report("blocking", numFiles, counter.mBytes, timer.Seconds());
+
+    for (int index = 0; index < numReaders; ++index)
+    {
+        delete readers[index];
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numFiles = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 2000;
+    const int fileSize = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4096;
+    int numReaders = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 16;
+    const int numThreads = 4;
+
+    if (numReaders > MAX_READERS)
+    {
+        numReaders = MAX_READERS;
+    }
+
+    printf("Using numFiles = %d (use first command line argument to change)\n", numFiles);
+    printf("Using fileSize = %d (use second command line argument to change)\n", fileSize);
+    printf("Using numReaders = %d (use third command line argument to change)\n", numReaders);
+    printf("Using io_uring = %d (build with io_uring=[on|off] to change)\n", THERON_IO_URING);
+
+    // Create the files.
+    char *const contents(new char[fileSize]);
+    for (int index = 0; index < fileSize; ++index)
+    {
+        contents[index] = static_cast<char>('a' + index % 26);
+    }
+
+    char fileName[MAX_FILE_NAME];
+    for (int index = 0; index < numFiles; ++index)
+    {
+        GetFileName(fileName, index);
+        if (FILE *const handle = fopen(fileName, "wb"))
+        {
+            fwrite(contents, 1, static_cast<size_t>(fileSize), handle);
+            fclose(handle);
+        }
+    }
+
+    delete [] contents;
+
+    ReadWithFileService(numThreads, numFiles, fileSize);
+    ReadWithBlockingActors(numThreads, numReaders, numFiles, fileSize);
+
+    // Delete the files.
+    for (int index = 0; index < numFiles; ++index)
+    {
+        GetFileName(fileName, index);
+        remove(fileName);
+    }
+
+    return 0;
+}
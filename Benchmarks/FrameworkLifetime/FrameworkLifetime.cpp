@@ -0,0 +1,86 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the cost of creating and destroying frameworks.
+// Applications such as test suites may create and destroy thousands of frameworks, so the
+// time taken to start and stop the worker threads of a framework can dominate their run time.
+//
+// The benchmark repeatedly creates a framework with a given number of worker threads and
+// destroys it again, in two variants:
+// - an idle cycle, in which the framework is destroyed as soon as it's created.
+// - a busy cycle, in which an actor is created in the framework and sent a message,
+//   and the reply is waited for before the actor and framework are destroyed.
+//
+// For each variant it reports the average time per create/destroy cycle.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+class Replier : public Theron::Actor
+{
+public:
+
+    inline explicit Replier(Theron::Framework &framework) : Theron::Actor(framework)
+    {
+        RegisterHandler(this, &Replier::Handler);
+    }
+
+private:
+
+    inline void Handler(const int &message, const Theron::Address from)
+    {
+        Send(message, from);
+    }
+};
+
+
+static void RunCycles(const char *const name, const int numCycles, const int numThreads, const bool busy)
+{
+    Theron::Receiver receiver;
+
+    Timer timer;
+    timer.Start();
+
+    for (int cycle = 0; cycle < numCycles; ++cycle)
+    {
+        Theron::Framework framework(static_cast<Theron::uint32_t>(numThreads));
+
+        if (busy)
+        {
+            Replier replier(framework);
+            framework.Send(cycle, receiver.GetAddress(), replier.GetAddress());
+            receiver.Wait();
+        }
+    }
+
+    timer.Stop();
+
+    printf("%s: %d cycles in %.3f seconds, %.1f microseconds per cycle\n",
+        name,
+        numCycles,
+        timer.Seconds(),
+        timer.Seconds() * 1000000.0f / static_cast<float>(numCycles));
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numCycles = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 1000;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 16;
+
+    printf("Using numCycles = %d (use first command line argument to change)\n", numCycles);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+
+    RunCycles("Idle", numCycles, numThreads, false);
+    RunCycles("Busy", numCycles, numThreads, true);
+
+    return 0;
+}
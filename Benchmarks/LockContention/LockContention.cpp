@@ -0,0 +1,167 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This is a microbenchmark of the spinlock primitives used internally by Theron.
+// A number of threads repeatedly lock a shared lock, update some shared state in a short
+// critical section, and unlock it again, for a fixed period of time. The benchmark is run
+// once for each lock type: the simple test-and-set SpinLock, the FIFO TicketLock, and the
+// queued McsLock, in which each waiting thread spins on its own cache line.
+//
+// For each lock it reports the throughput (total acquisitions per second) and the fairness:
+// the smallest and largest numbers of acquisitions made by any one thread, and Jain's fairness
+// index of the per-thread acquisition counts, which is 1.0 when all threads get equal shares
+// and approaches 1/numThreads when one thread gets them all.
+//
+// Note that with the POSIX build (the default on Linux) the ticket and MCS locks fall back to
+// plain pthreads spinlocks, so the comparison is only meaningful in the c++11, boost or
+// windows builds. The results are also only meaningful with at least as many cores as threads.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/McsLock.h>
+#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Threading/Thread.h>
+#include <Theron/Detail/Threading/TicketLock.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+#include "../Common/Timer.h"
+
+
+static const int MAX_THREADS = 64;
+
+
+// Shared state of a single benchmark run.
+template <class LockType>
+struct SharedState
+{
+    inline SharedState() : mSharedCounter(0)
+    {
+    }
+
+    LockType mLock;
+    Theron::Detail::Atomic::UInt32 mStarted;
+    Theron::Detail::Atomic::UInt32 mStopped;
+    unsigned int mSharedCounter;
+};
+
+
+// Per-thread state, padded to avoid false sharing between the threads.
+template <class LockType>
+struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) WorkerState
+{
+    SharedState<LockType> *mShared;
+    unsigned int mAcquisitions;
+
+} THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+
+template <class LockType>
+static void WorkerEntryPoint(void *const context)
+{
+    WorkerState<LockType> *const state(reinterpret_cast<WorkerState<LockType> *>(context));
+    SharedState<LockType> *const shared(state->mShared);
+
+    // Wait for the starting signal so that all threads start contending together.
+    while (shared->mStarted.Load() == 0)
+    {
+        Theron::Detail::Utils::YieldToAnyThread();
+    }
+
+    unsigned int acquisitions(0);
+    while (shared->mStopped.LoadRelaxed() == 0)
+    {
+        shared->mLock.Lock();
+        ++shared->mSharedCounter;
+        shared->mLock.Unlock();
+
+        ++acquisitions;
+    }
+
+    state->mAcquisitions = acquisitions;
+}
+
+
+template <class LockType>
+static void RunBenchmark(const char *const name, const int numThreads, const int milliseconds)
+{
+    SharedState<LockType> shared;
+    WorkerState<LockType> states[MAX_THREADS];
+    Theron::Detail::Thread threads[MAX_THREADS];
+
+    for (int index = 0; index < numThreads; ++index)
+    {
+        states[index].mShared = &shared;
+        states[index].mAcquisitions = 0;
+        threads[index].Start(WorkerEntryPoint<LockType>, &states[index]);
+    }
+
+    Timer timer;
+    timer.Start();
+
+    shared.mStarted.Store(1);
+    Theron::Detail::Utils::SleepThread(static_cast<Theron::uint32_t>(milliseconds));
+    shared.mStopped.Store(1);
+
+    for (int index = 0; index < numThreads; ++index)
+    {
+        threads[index].Join();
+    }
+
+    timer.Stop();
+
+    double total(0.0);
+    double sumOfSquares(0.0);
+    unsigned int minimum(states[0].mAcquisitions);
+    unsigned int maximum(states[0].mAcquisitions);
+
+    for (int index = 0; index < numThreads; ++index)
+    {
+        const unsigned int acquisitions(states[index].mAcquisitions);
+        total += acquisitions;
+        sumOfSquares += static_cast<double>(acquisitions) * acquisitions;
+        minimum = acquisitions < minimum ? acquisitions : minimum;
+        maximum = acquisitions > maximum ? acquisitions : maximum;
+    }
+
+    const double fairness(sumOfSquares > 0.0 ? (total * total) / (numThreads * sumOfSquares) : 0.0);
+
+    printf("%-12s %12.0f locks/s   min %10u   max %10u   fairness %.3f\n",
+        name,
+        total / timer.Seconds(),
+        minimum,
+        maximum,
+        fairness);
+
+    if (shared.mSharedCounter != static_cast<unsigned int>(total))
+    {
+        printf("ERROR: %s lost updates to the shared counter\n", name);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    int numThreads = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 4;
+    const int milliseconds = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 1000;
+
+    if (numThreads > MAX_THREADS)
+    {
+        numThreads = MAX_THREADS;
+    }
+
+    printf("Using numThreads = %d (use first command line argument to change)\n", numThreads);
+    printf("Using milliseconds = %d (use second command line argument to change)\n", milliseconds);
+
+    RunBenchmark<Theron::Detail::SpinLock>("SpinLock", numThreads, milliseconds);
+    RunBenchmark<Theron::Detail::TicketLock>("TicketLock", numThreads, milliseconds);
+    RunBenchmark<Theron::Detail::McsLock>("McsLock", numThreads, milliseconds);
+
+    return 0;
+}
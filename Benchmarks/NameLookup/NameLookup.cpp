@@ -0,0 +1,177 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the cost of looking up registered names, as when messages are sent
+// to actors by name. A large number of names of the form 'actor.N.endpoint' are pooled and
+// registered in a name map, as endpoints do when named actors and receivers are created, and
+// are then looked up repeatedly in a scattered order.
+//
+// For each phase it reports the time taken per name: pooling the names, registering them,
+// looking up the pooled names in the map, and looking up names given as text, which first
+// finds the pooled copy of the text, as sending to an address constructed from a name does.
+// Finally the names are deregistered again. With a good hash the costs per name should stay
+// roughly flat as the number of names grows.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Network/Index.h>
+#include <Theron/Detail/Network/NameMap.h>
+#include <Theron/Detail/Strings/String.h>
+#include <Theron/Detail/Strings/StringPool.h>
+
+#include "../Common/Timer.h"
+
+
+static void Report(const char *const phase, const Timer &timer, const double operations)
+{
+    printf("%-12s %8.3f seconds   %8.1f nanoseconds per name\n",
+        phase,
+        timer.Seconds(),
+        timer.Seconds() * 1.0e9 / operations);
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numNames = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 100000;
+    const int numRounds = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 20;
+
+    printf("Using numNames = %d (use first command line argument to change)\n", numNames);
+    printf("Using numRounds = %d (use second command line argument to change)\n", numRounds);
+
+    // Hold a reference to the string pool, as frameworks and endpoints do.
+    Theron::Detail::StringPool::Ref stringPoolRef;
+
+    // The map is cache-line aligned, which plain new doesn't honour before C++17.
+    Theron::IAllocator *const allocator(Theron::AllocatorManager::GetAllocator());
+    void *const nameMapMemory(allocator->AllocateAligned(sizeof(Theron::Detail::NameMap), THERON_CACHELINE_ALIGNMENT));
+    Theron::Detail::NameMap *const nameMap(new (nameMapMemory) Theron::Detail::NameMap());
+
+    char **const text(new char *[numNames]);
+    Theron::Detail::String *const names(new Theron::Detail::String[numNames]);
+
+    for (int index = 0; index < numNames; ++index)
+    {
+        text[index] = new char[32];
+        sprintf(text[index], "actor.%d.endpoint", index);
+    }
+
+    // Visit the names in a scattered order, so consecutive lookups don't touch neighbouring names.
+    int *const order(new int[numNames]);
+    for (int index = 0; index < numNames; ++index)
+    {
+        order[index] = static_cast<int>((static_cast<Theron::uint64_t>(index) * 7919) % numNames);
+    }
+
+    Timer timer;
+
+    timer.Start();
+
+    for (int index = 0; index < numNames; ++index)
+    {
+        names[index] = Theron::Detail::String(text[index]);
+    }
+
+    timer.Stop();
+    Report("pool", timer, numNames);
+
+    timer.Start();
+
+    for (int index = 0; index < numNames; ++index)
+    {
+        const Theron::Detail::Index mailboxIndex(1, static_cast<Theron::uint32_t>(index));
+        if (!nameMap->Insert(names[index], mailboxIndex))
+        {
+            printf("Failed to register name '%s'\n", text[index]);
+            return 1;
+        }
+    }
+
+    timer.Stop();
+    Report("register", timer, numNames);
+
+    Theron::uint32_t checksum(0);
+    int missing(0);
+
+    timer.Start();
+
+    for (int round = 0; round < numRounds; ++round)
+    {
+        for (int index = 0; index < numNames; ++index)
+        {
+            Theron::Detail::Index mailboxIndex;
+            if (nameMap->Get(names[order[index]], mailboxIndex))
+            {
+                checksum += mailboxIndex.mUInt32;
+            }
+            else
+            {
+                ++missing;
+            }
+        }
+    }
+
+    timer.Stop();
+    Report("lookup", timer, static_cast<double>(numNames) * numRounds);
+
+    timer.Start();
+
+    for (int round = 0; round < numRounds; ++round)
+    {
+        for (int index = 0; index < numNames; ++index)
+        {
+            const Theron::Detail::String name(text[order[index]]);
+
+            Theron::Detail::Index mailboxIndex;
+            if (nameMap->Get(name, mailboxIndex))
+            {
+                checksum += mailboxIndex.mUInt32;
+            }
+            else
+            {
+                ++missing;
+            }
+        }
+    }
+
+    timer.Stop();
+    Report("lookup text", timer, static_cast<double>(numNames) * numRounds);
+
+    timer.Start();
+
+    for (int index = 0; index < numNames; ++index)
+    {
+        nameMap->Remove(names[index]);
+    }
+
+    timer.Stop();
+    Report("deregister", timer, numNames);
+
+    if (missing != 0)
+    {
+        printf("Failed to find %d names\n", missing);
+    }
+
+    printf("Checksum %u\n", checksum);
+
+    nameMap->~NameMap();
+    allocator->Free(nameMapMemory, sizeof(Theron::Detail::NameMap));
+
+    for (int index = 0; index < numNames; ++index)
+    {
+        delete [] text[index];
+    }
+
+    delete [] order;
+    delete [] names;
+    delete [] text;
+
+    return (missing == 0) ? 0 : 1;
+}
@@ -21,6 +21,14 @@
 // n is the initial value of the integer message initially sent to Ping. The latency of the
 // message sending is calculated as the total execution time divided by the number of messages n.
 //
+// The benchmark is run twice: once with Ping and Pong sending each message with Send, and
+// once with them using Reply to answer each message and Forward to pass the final message
+// to the client, both of which reuse the memory of the message being handled.
+//
+// On Linux it also reports the number of processor cycles spent per message, counted over all
+// the threads of the framework, where the kernel allows it. The integer messages are trivially
+// destructible, so destroying them involves no calls, just the freeing of their memory.
+//
 
 
 #include <stdio.h>
@@ -28,6 +36,7 @@
 
 #include <Theron/Theron.h>
 
+#include "../Common/EventCounter.h"
 #include "../Common/Timer.h"
 
 
@@ -47,7 +56,9 @@ public:
         Theron::Address mPartner;
     };
 
-    inline PingPong(Theron::Framework &framework) : Theron::Actor(framework)
+    inline PingPong(Theron::Framework &framework, const bool recycle) :
+      Theron::Actor(framework),
+      mRecycle(recycle)
     {
         RegisterHandler(this, &PingPong::Start);
     }
@@ -63,18 +74,42 @@ private:
         RegisterHandler(this, &PingPong::Receive);
     }
 
-    inline void Receive(const int &message, const Theron::Address /*from*/)
+    inline void Receive(const int &message, const Theron::Address from)
     {
-        if (message > 0)
+        if (mRecycle)
         {
-            Send(message - 1, mPartner);
+            // Apart from the initial count, the partner is the sender, so reply to it,
+            // reusing the message memory.
+            if (message > 0)
+            {
+                if (from == mPartner)
+                {
+                    Reply(message - 1);
+                }
+                else
+                {
+                    Send(message - 1, mPartner);
+                }
+            }
+            else
+            {
+                Forward(mCaller);
+            }
         }
         else
         {
-            Send(message, mCaller);
+            if (message > 0)
+            {
+                Send(message - 1, mPartner);
+            }
+            else
+            {
+                Send(message, mCaller);
+            }
         }
     }
 
+    const bool mRecycle;
     Theron::Address mCaller;
     Theron::Address mPartner;
 };
@@ -88,40 +123,67 @@ THERON_DEFINE_REGISTERED_MESSAGE(int);
 THERON_DEFINE_REGISTERED_MESSAGE(PingPong::StartMessage);
 
 
-int main(int argc, char *argv[])
+static void RunBenchmark(const char *const name, const int numMessages, const int numThreads, const bool recycle)
 {
-    const int numMessages = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 50000000;
-    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 16;
+    printf("Starting %d message sends between ping and pong using %s...\n", numMessages, name);
 
-    printf("Using numMessages = %d (use first command line argument to change)\n", numMessages);
-    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
-    printf("Starting %d message sends between ping and pong...\n", numMessages);
+    // Count the cycles of the threads of the framework, which are counted once the threads have exited.
+    // The count includes the start-up and shut-down of the framework, and any time spent spinning idle.
+    EventCounter cycleCounter(EventCounter::CPU_CYCLES);
+    Theron::uint64_t cycles(0);
 
-    Theron::Framework framework(numThreads);
-    Theron::Receiver receiver;
+    Timer timer;
 
-    PingPong ping(framework);
-    PingPong pong(framework);
+    {
+        Theron::Framework framework(numThreads);
+        Theron::Receiver receiver;
 
-    // Start Ping and Pong, sending each the address of the other and the address of the receiver.
-    const PingPong::StartMessage pingStart(receiver.GetAddress(), pong.GetAddress());
-    framework.Send(pingStart, receiver.GetAddress(), ping.GetAddress());
-    const PingPong::StartMessage pongStart(receiver.GetAddress(), ping.GetAddress());
-    framework.Send(pongStart, receiver.GetAddress(), pong.GetAddress());
+        PingPong ping(framework, recycle);
+        PingPong pong(framework, recycle);
 
-    Timer timer;
-    timer.Start();
+        // Start Ping and Pong, sending each the address of the other and the address of the receiver.
+        const PingPong::StartMessage pingStart(receiver.GetAddress(), pong.GetAddress());
+        framework.Send(pingStart, receiver.GetAddress(), ping.GetAddress());
+        const PingPong::StartMessage pongStart(receiver.GetAddress(), ping.GetAddress());
+        framework.Send(pongStart, receiver.GetAddress(), pong.GetAddress());
 
-    // Send the initial integer count to Ping.
-    framework.Send(numMessages, receiver.GetAddress(), ping.GetAddress());
+        timer.Start();
 
-    // Wait to hear back from either Ping or Pong when the count reaches zero.
-    receiver.Wait();
-    timer.Stop();
+        // Send the initial integer count to Ping.
+        framework.Send(numMessages, receiver.GetAddress(), ping.GetAddress());
+
+        // Wait to hear back from either Ping or Pong when the count reaches zero.
+        receiver.Wait();
+        timer.Stop();
+    }
 
     // The number of full cycles is half the number of messages.
     printf("Completed %d message response cycles in %.1f seconds\n", numMessages / 2, timer.Seconds());
     printf("Average response time is %.10f seconds\n", timer.Seconds() / (numMessages / 2));
+    printf("Average time per message is %.1f nanoseconds\n", timer.Seconds() * 1.0e9 / numMessages);
+
+    if (cycleCounter.Read(cycles))
+    {
+        printf("Processor cycles per message %.1f, summed over all threads\n",
+            static_cast<double>(cycles) / numMessages);
+    }
+    else
+    {
+        printf("Processor cycles per message unavailable\n");
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numMessages = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 50000000;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 16;
+
+    printf("Using numMessages = %d (use first command line argument to change)\n", numMessages);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+
+    RunBenchmark("Send", numMessages, numThreads, false);
+    RunBenchmark("Reply and Forward", numMessages, numThreads, true);
 
 #if THERON_ENABLE_DEFAULTALLOCATOR_CHECKS
     Theron::IAllocator *const allocator(Theron::AllocatorManager::GetAllocator());
@@ -0,0 +1,232 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the cost of passing large payloads, such as 1MB image tiles, through
+// a pipeline of actors. Five stage actors are chained together, and each reads one byte from
+// every cache line of each tile it receives, as a stand-in for real processing, before passing
+// the tile on to the next stage. The last stage passes the tiles back to the main thread, which
+// keeps a fixed number of tiles in flight, sending a new one whenever one comes back.
+//
+// It's run twice: once with the tiles carried by value in the messages, so that each is copied
+// at every stage, and once with the tiles held in buffers acquired from a BufferPool, so that
+// only reference-counted handles to them are passed, using Forward to reuse the messages.
+// Passing 'huge' as the third command line argument backs the buffers with huge pages.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+static const int NUM_STAGES = 5;
+static const int NUM_IN_FLIGHT = 8;
+static const Theron::uint32_t TILE_SIZE = 1024 * 1024;
+
+
+struct Tile
+{
+    char mData[TILE_SIZE];
+};
+
+
+// Reads one byte from each cache line of a tile.
+static Theron::uint32_t Process(const char *const data, const Theron::uint32_t size)
+{
+    Theron::uint32_t sum(0);
+    for (Theron::uint32_t offset = 0; offset < size; offset += 64)
+    {
+        sum += static_cast<unsigned char>(data[offset]);
+    }
+
+    return sum;
+}
+
+
+class Stage : public Theron::Actor
+{
+public:
+
+    inline Stage(Theron::Framework &framework, const Theron::Address &next) :
+      Theron::Actor(framework),
+      mSum(0),
+      mNext(next)
+    {
+        RegisterHandler(this, &Stage::HandleTile);
+        RegisterHandler(this, &Stage::HandleBuffer);
+    }
+
+    Theron::uint32_t mSum;
+
+private:
+
+    inline void HandleTile(const Tile &tile, const Theron::Address /*from*/)
+    {
+        mSum += Process(tile.mData, TILE_SIZE);
+        Send(tile, mNext);
+    }
+
+    inline void HandleBuffer(const Theron::SharedBuffer &buffer, const Theron::Address /*from*/)
+    {
+        mSum += Process(buffer.GetData(), buffer.GetSize());
+        Forward(mNext);
+    }
+
+    const Theron::Address mNext;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(Tile);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::SharedBuffer);
+
+THERON_DEFINE_REGISTERED_MESSAGE(Tile);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::SharedBuffer);
+
+
+struct Sink
+{
+    inline void HandleTile(const Tile &/*tile*/, const Theron::Address /*from*/)
+    {
+    }
+
+    inline void HandleBuffer(const Theron::SharedBuffer &/*buffer*/, const Theron::Address /*from*/)
+    {
+    }
+};
+
+
+// Sends a new tile into the pipeline, either by value or in a buffer.
+static void SendTile(
+    Theron::Framework &framework,
+    Theron::BufferPool *const bufferPool,
+    const Tile &tile,
+    const Theron::Address &from,
+    const Theron::Address &first)
+{
+    if (bufferPool)
+    {
+        Theron::SharedBuffer buffer(bufferPool->Acquire(TILE_SIZE));
+        memcpy(buffer.GetData(), tile.mData, TILE_SIZE);
+        framework.Send(buffer, from, first);
+    }
+    else
+    {
+        framework.Send(tile, from, first);
+    }
+}
+
+
+static double RunBenchmark(
+    const char *const name,
+    const int numTiles,
+    const int numThreads,
+    const Tile &tile,
+    Theron::BufferPool *const bufferPool)
+{
+    printf("Passing %d tiles of %u bytes through %d stages %s...\n", numTiles, TILE_SIZE, NUM_STAGES, name);
+
+    Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+
+    Sink sink;
+    receiver.RegisterHandler(&sink, &Sink::HandleTile);
+    receiver.RegisterHandler(&sink, &Sink::HandleBuffer);
+
+    // Create the stages from the last to the first, so each knows the next.
+    Stage *stages[NUM_STAGES];
+    Theron::Address next(receiver.GetAddress());
+
+    for (int index = NUM_STAGES - 1; index >= 0; --index)
+    {
+        stages[index] = new Stage(framework, next);
+        next = stages[index]->GetAddress();
+    }
+
+    Timer timer;
+    timer.Start();
+
+    // Keep a fixed number of tiles in flight until they've all been sent.
+    int numSent(0);
+    int numReceived(0);
+
+    while (numSent < numTiles && numSent < NUM_IN_FLIGHT)
+    {
+        SendTile(framework, bufferPool, tile, receiver.GetAddress(), next);
+        ++numSent;
+    }
+
+    while (numReceived < numTiles)
+    {
+        const int numArrived(static_cast<int>(receiver.Wait()));
+        numReceived += numArrived;
+
+        for (int count = 0; count < numArrived && numSent < numTiles; ++count)
+        {
+            SendTile(framework, bufferPool, tile, receiver.GetAddress(), next);
+            ++numSent;
+        }
+    }
+
+    timer.Stop();
+
+    for (int index = 0; index < NUM_STAGES; ++index)
+    {
+        delete stages[index];
+    }
+
+    const double seconds(timer.Seconds());
+    const double megabytes(static_cast<double>(numTiles) * NUM_STAGES * TILE_SIZE / (1024.0 * 1024.0));
+
+    printf("Processed in %.3f seconds (%.1f microseconds per tile per stage, %.0f MB/s through the stages)\n",
+        seconds,
+        seconds * 1.0e6 / (static_cast<double>(numTiles) * NUM_STAGES),
+        megabytes / seconds);
+
+    return seconds;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numTiles = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 2000;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4;
+    const bool hugePages = (argc > 3 && strcmp(argv[3], "huge") == 0);
+
+    printf("Using numTiles = %d (use first command line argument to change)\n", numTiles);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+    printf("Using buffers = %s (use 'huge' as third command line argument to use huge pages)\n", hugePages ? "huge" : "default");
+
+    // The tile is too big for the stack.
+    Tile *const tile(new Tile);
+    for (Theron::uint32_t offset = 0; offset < TILE_SIZE; ++offset)
+    {
+        tile->mData[offset] = static_cast<char>(offset);
+    }
+
+    const double copySeconds(RunBenchmark("by value", numTiles, numThreads, *tile, 0));
+
+    double bufferSeconds(0.0);
+
+    {
+        Theron::HugePageAllocator hugePageAllocator;
+        Theron::BufferPool bufferPool(hugePages ? &hugePageAllocator : 0);
+
+        bufferSeconds = RunBenchmark("in pooled buffers", numTiles, numThreads, *tile, &bufferPool);
+
+        printf("Buffer pool reserved %llu KB for at most %d tiles in flight\n",
+            static_cast<unsigned long long>(bufferPool.GetBytesReserved() / 1024),
+            NUM_IN_FLIGHT);
+    }
+
+    printf("Pooled buffers took %.1f%% of the time of copying\n", bufferSeconds * 100.0 / copySeconds);
+
+    delete tile;
+    return 0;
+}
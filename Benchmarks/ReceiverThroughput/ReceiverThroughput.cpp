@@ -0,0 +1,135 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the throughput of messages sent by actors to a Receiver.
+// Receivers are the usual way for non-actor code, such as the main thread, to wait
+// for results from actors. Every message pushed into a receiver takes the receiver's
+// mutex and pulses its condition variable, so the cost of those synchronization
+// primitives dominates the receiver's throughput.
+//
+// A number of sender actors each send their share of the messages to a single receiver
+// as fast as they can, while the main thread waits on the receiver and consumes the
+// arriving messages in batches. The reported throughput is the number of messages
+// received per second.
+//
+// Building with "futex=off" replaces the futex-based mutex and condition variable
+// with the pthreads primitives, for comparison.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+static const int MAX_SENDERS = 64;
+
+
+class Sender : public Theron::Actor
+{
+public:
+
+    struct StartMessage
+    {
+        inline StartMessage(const Theron::Address &receiver, const int count) :
+          mReceiver(receiver),
+          mCount(count)
+        {
+        }
+
+        Theron::Address mReceiver;
+        int mCount;
+    };
+
+    inline Sender(Theron::Framework &framework) : Theron::Actor(framework)
+    {
+        RegisterHandler(this, &Sender::Start);
+    }
+
+private:
+
+    inline void Start(const StartMessage &message, const Theron::Address /*from*/)
+    {
+        for (int index = 0; index < message.mCount; ++index)
+        {
+            Send(index, message.mReceiver);
+        }
+    }
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(int);
+THERON_DECLARE_REGISTERED_MESSAGE(Sender::StartMessage);
+
+THERON_DEFINE_REGISTERED_MESSAGE(int);
+THERON_DEFINE_REGISTERED_MESSAGE(Sender::StartMessage);
+
+
+int main(int argc, char *argv[])
+{
+    const int numMessages = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 10000000;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 16;
+    int numSenders = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 4;
+
+    if (numSenders > MAX_SENDERS)
+    {
+        numSenders = MAX_SENDERS;
+    }
+
+    printf("Using numMessages = %d (use first command line argument to change)\n", numMessages);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+    printf("Using numSenders = %d (use third command line argument to change)\n", numSenders);
+    printf("Sending %d messages from %d actors to a receiver...\n", numMessages, numSenders);
+
+    Theron::Framework framework(numThreads);
+    Theron::Receiver receiver;
+    Sender *senders[MAX_SENDERS];
+
+    for (int index = 0; index < numSenders; ++index)
+    {
+        senders[index] = new Sender(framework);
+    }
+
+    Timer timer;
+    timer.Start();
+
+    // Divide the messages between the senders.
+    int numSent(0);
+    for (int index = 0; index < numSenders; ++index)
+    {
+        const int count((numMessages - numSent) / (numSenders - index));
+        framework.Send(Sender::StartMessage(receiver.GetAddress(), count), receiver.GetAddress(), senders[index]->GetAddress());
+        numSent += count;
+    }
+
+    // Wait for all the messages, consuming them in batches as they arrive.
+    int numReceived(0);
+    while (numReceived < numMessages)
+    {
+        numReceived += static_cast<int>(receiver.Wait(static_cast<Theron::uint32_t>(numMessages - numReceived)));
+    }
+
+    timer.Stop();
+
+    printf("Received %d messages in %.2f seconds\n", numReceived, timer.Seconds());
+    printf("Throughput is %.0f messages per second\n", numReceived / timer.Seconds());
+
+    for (int index = 0; index < numSenders; ++index)
+    {
+        delete senders[index];
+    }
+
+#if THERON_ENABLE_DEFAULTALLOCATOR_CHECKS
+    Theron::IAllocator *const allocator(Theron::AllocatorManager::GetAllocator());
+    const int allocationCount(static_cast<Theron::DefaultAllocator *>(allocator)->GetAllocationCount());
+    const int peakBytesAllocated(static_cast<Theron::DefaultAllocator *>(allocator)->GetPeakBytesAllocated());
+    printf("Total number of allocations: %d calls\n", allocationCount);
+    printf("Peak memory usage in bytes: %d bytes\n", peakBytesAllocated);
+#endif // THERON_ENABLE_DEFAULTALLOCATOR_CHECKS
+
+}
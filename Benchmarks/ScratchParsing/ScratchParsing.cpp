@@ -0,0 +1,249 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the cost of temporary allocations made by message handlers, using
+// a 'parser' actor that parses lines of comma-separated values. For each line it receives, the
+// parser splits the line into fields, copies the text of each field into a buffer, and parses
+// the numeric fields, building each result in a std::vector that grows as it goes, as typical
+// handler code does. The vectors are thrown away when the handler returns.
+//
+// The benchmark is run twice: once with the vectors using the standard allocator, and once
+// with them using the actor's scratch allocator, which carves memory from a per-thread arena
+// by bumping a pointer and reclaims it all at once after each message. For each run it reports
+// the time taken to parse all the lines and the processor time spent inside the handlers.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Threading/Clock.h>
+
+#include "../Common/Timer.h"
+
+
+static const Theron::uint32_t NUM_LINES = 64;
+static const Theron::uint32_t NUM_FIELDS = 24;
+
+
+struct Field
+{
+    Theron::uint32_t mOffset;
+    Theron::uint32_t mLength;
+};
+
+
+template <template <class> class AllocatorType>
+class Parser : public Theron::Actor
+{
+public:
+
+    inline Parser(
+        Theron::Framework &framework,
+        const char *const *const lines,
+        const Theron::uint32_t numMessages) :
+      Theron::Actor(framework),
+      mLines(lines),
+      mNumMessages(numMessages),
+      mNumParsed(0),
+      mChecksum(0),
+      mBusyTicks(0)
+    {
+        RegisterHandler(this, &Parser::Parse);
+    }
+
+    inline double BusySeconds() const
+    {
+        return static_cast<double>(mBusyTicks) / static_cast<double>(Theron::Detail::Clock::GetFrequency());
+    }
+
+private:
+
+    typedef std::vector<Field, AllocatorType<Field> > FieldVector;
+    typedef std::vector<char, AllocatorType<char> > CharVector;
+    typedef std::vector<Theron::uint32_t, AllocatorType<Theron::uint32_t> > ValueVector;
+
+    inline void Parse(const Theron::uint32_t &lineIndex, const Theron::Address from)
+    {
+        const Theron::uint64_t start(Theron::Detail::Clock::GetTicks());
+
+        const AllocatorType<char> allocator(MakeAllocator(static_cast<AllocatorType<char> *>(0)));
+        const char *const line(mLines[lineIndex]);
+
+        // Split the line into fields.
+        FieldVector fields(allocator);
+        Theron::uint32_t offset(0);
+        Theron::uint32_t index(0);
+
+        while (true)
+        {
+            if (line[index] == ',' || line[index] == '\0')
+            {
+                Field field;
+                field.mOffset = offset;
+                field.mLength = index - offset;
+                fields.push_back(field);
+
+                if (line[index] == '\0')
+                {
+                    break;
+                }
+
+                offset = index + 1;
+            }
+
+            ++index;
+        }
+
+        // Copy the text of each field, and parse the numeric ones.
+        CharVector text(allocator);
+        ValueVector values(allocator);
+
+        for (typename FieldVector::const_iterator it(fields.begin()); it != fields.end(); ++it)
+        {
+            const char *const first(line + it->mOffset);
+            const char *const last(first + it->mLength);
+
+            Theron::uint32_t value(0);
+            bool numeric(it->mLength > 0);
+
+            for (const char *ch(first); ch != last; ++ch)
+            {
+                text.push_back(*ch);
+
+                if (*ch >= '0' && *ch <= '9')
+                {
+                    value = value * 10 + static_cast<Theron::uint32_t>(*ch - '0');
+                }
+                else
+                {
+                    numeric = false;
+                }
+            }
+
+            text.push_back('\0');
+
+            if (numeric)
+            {
+                values.push_back(value);
+            }
+        }
+
+        for (typename ValueVector::const_iterator it(values.begin()); it != values.end(); ++it)
+        {
+            mChecksum += *it;
+        }
+
+        mChecksum += static_cast<Theron::uint32_t>(text.size());
+
+        mBusyTicks += Theron::Detail::Clock::GetTicks() - start;
+
+        if (++mNumParsed == mNumMessages)
+        {
+            Send(mChecksum, from);
+        }
+    }
+
+    inline std::allocator<char> MakeAllocator(std::allocator<char> *) const
+    {
+        return std::allocator<char>();
+    }
+
+    inline Theron::StlAllocator<char> MakeAllocator(Theron::StlAllocator<char> *) const
+    {
+        return Theron::StlAllocator<char>(GetScratchAllocator());
+    }
+
+    const char *const *const mLines;
+    const Theron::uint32_t mNumMessages;
+    Theron::uint32_t mNumParsed;
+    Theron::uint32_t mChecksum;
+    Theron::uint64_t mBusyTicks;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::uint32_t);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::uint32_t);
+
+
+template <template <class> class AllocatorType>
+static void RunBenchmark(const char *const name, const char *const *const lines, const Theron::uint32_t numMessages)
+{
+    Theron::Framework::Parameters params(1);
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+
+    typedef Theron::Catcher<Theron::uint32_t> ChecksumCatcher;
+    ChecksumCatcher catcher;
+    receiver.RegisterHandler(&catcher, &ChecksumCatcher::Push);
+
+    Parser<AllocatorType> parser(framework, lines, numMessages);
+
+    Timer timer;
+    timer.Start();
+
+    for (Theron::uint32_t index = 0; index < numMessages; ++index)
+    {
+        framework.Send(index % NUM_LINES, receiver.GetAddress(), parser.GetAddress());
+    }
+
+    receiver.Wait();
+    timer.Stop();
+
+    Theron::uint32_t checksum(0);
+    Theron::Address from;
+    catcher.Pop(checksum, from);
+
+    printf("%-10s %8.3f seconds   handlers %8.3f seconds   %8.1f nanoseconds per line   checksum %u\n",
+        name,
+        timer.Seconds(),
+        parser.BusySeconds(),
+        parser.BusySeconds() * 1.0e9 / numMessages,
+        checksum);
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numMessages = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 500000;
+
+    printf("Using numMessages = %d (use first command line argument to change)\n", numMessages);
+
+    // Generate lines of mixed numeric and text fields, of varying lengths.
+    char *lines[NUM_LINES];
+    for (Theron::uint32_t lineIndex = 0; lineIndex < NUM_LINES; ++lineIndex)
+    {
+        lines[lineIndex] = new char[NUM_FIELDS * 16];
+
+        char *ch(lines[lineIndex]);
+        for (Theron::uint32_t fieldIndex = 0; fieldIndex < NUM_FIELDS; ++fieldIndex)
+        {
+            if (fieldIndex % 3 == 2)
+            {
+                ch += sprintf(ch, "field%u", lineIndex);
+            }
+            else
+            {
+                ch += sprintf(ch, "%u", lineIndex * 7919 + fieldIndex * 104729);
+            }
+
+            *ch++ = (fieldIndex + 1 < NUM_FIELDS) ? ',' : '\0';
+        }
+    }
+
+    RunBenchmark<std::allocator>("standard", lines, static_cast<Theron::uint32_t>(numMessages));
+    RunBenchmark<Theron::StlAllocator>("scratch", lines, static_cast<Theron::uint32_t>(numMessages));
+
+    for (Theron::uint32_t lineIndex = 0; lineIndex < NUM_LINES; ++lineIndex)
+    {
+        delete [] lines[lineIndex];
+    }
+
+    return 0;
+}
@@ -0,0 +1,274 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the cost of creating very many actors and sending them messages,
+// after the well-known 'skynet' benchmark. A root actor creates ten child actors, each of which
+// creates ten children of its own, and so on, until the leaves of the tree number the requested
+// count. Each leaf replies to its parent with its own number, and each parent replies to its own
+// parent with the sum of the replies of its children, until the root reports the grand total.
+// The tree is then destroyed, and the whole round repeated a few times.
+//
+// With many thousands of actors, each with a mailbox in a directory page, and messages spread
+// over the memory used by the actors, the workload touches many pages and suffers misses in the
+// processor's TLB. It's intended to be run once with the default allocator, and again using
+// the huge page allocator, by passing 'huge' as the third command line argument, to compare.
+// On Linux it also reports the number of data TLB misses, where the kernel allows it.
+//
+// Actors are limited by the size of the mailbox directory to about a million, so the number
+// of leaves is at most 100000.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include <Theron/Theron.h>
+
+#include "../Common/EventCounter.h"
+#include "../Common/Timer.h"
+
+
+static const Theron::uint32_t BRANCHING = 10;
+
+
+struct Spawn
+{
+    Theron::uint64_t mFirst;
+    Theron::uint32_t mNumLeaves;
+};
+
+
+class Node : public Theron::Actor
+{
+public:
+
+    inline static Node *Create(Theron::Framework &framework)
+    {
+        // Allocate the actors with the allocator used by Theron, so they come from the same memory.
+        Theron::IAllocator *const allocator(Theron::AllocatorManager::GetAllocator());
+        void *const memory(allocator->AllocateAligned(sizeof(Node), THERON_CACHELINE_ALIGNMENT));
+        return new (memory) Node(framework);
+    }
+
+    inline static void Destroy(Node *const node)
+    {
+        node->~Node();
+        Theron::AllocatorManager::GetAllocator()->Free(node, sizeof(Node));
+    }
+
+    inline explicit Node(Theron::Framework &framework) :
+      Theron::Actor(framework),
+      mParent(),
+      mNumChildren(0),
+      mNumPending(0),
+      mSum(0)
+    {
+        RegisterHandler(this, &Node::Start);
+        RegisterHandler(this, &Node::Collect);
+    }
+
+    inline ~Node()
+    {
+        for (Theron::uint32_t index = 0; index < mNumChildren; ++index)
+        {
+            Destroy(mChildren[index]);
+        }
+    }
+
+private:
+
+    inline void Start(const Spawn &spawn, const Theron::Address from)
+    {
+        mParent = from;
+
+        if (spawn.mNumLeaves == 1)
+        {
+            Send(spawn.mFirst, from);
+            return;
+        }
+
+        const Theron::uint32_t childLeaves(spawn.mNumLeaves / BRANCHING);
+
+        mNumChildren = BRANCHING;
+        mNumPending = BRANCHING;
+        mSum = 0;
+
+        for (Theron::uint32_t index = 0; index < BRANCHING; ++index)
+        {
+            mChildren[index] = Create(GetFramework());
+
+            Spawn childSpawn;
+            childSpawn.mFirst = spawn.mFirst + index * childLeaves;
+            childSpawn.mNumLeaves = childLeaves;
+
+            Send(childSpawn, mChildren[index]->GetAddress());
+        }
+    }
+
+    inline void Collect(const Theron::uint64_t &sum, const Theron::Address /*from*/)
+    {
+        mSum += sum;
+        if (--mNumPending == 0)
+        {
+            Send(mSum, mParent);
+        }
+    }
+
+    Theron::Address mParent;
+    Node *mChildren[BRANCHING];
+    Theron::uint32_t mNumChildren;
+    Theron::uint32_t mNumPending;
+    Theron::uint64_t mSum;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(Spawn);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::uint64_t);
+
+THERON_DEFINE_REGISTERED_MESSAGE(Spawn);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::uint64_t);
+
+
+static Theron::uint64_t ReadHugePageKilobytes()
+{
+    Theron::uint64_t kilobytes(0);
+
+#if defined(__linux__)
+
+    // Totals of the memory of the process backed by transparent huge pages.
+    if (FILE *const file = fopen("/proc/self/smaps_rollup", "r"))
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), file))
+        {
+            unsigned long long value(0);
+            if (sscanf(line, "AnonHugePages: %llu kB", &value) == 1)
+            {
+                kilobytes += value;
+            }
+        }
+
+        fclose(file);
+    }
+
+#endif
+
+    return kilobytes;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numLeaves = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 100000;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4;
+    const bool hugePages = (argc > 3 && strcmp(argv[3], "huge") == 0);
+    const int numRounds = (argc > 4 && atoi(argv[4]) > 0) ? atoi(argv[4]) : 5;
+
+    printf("Using numLeaves = %d (use first command line argument to change)\n", numLeaves);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+    printf("Using allocator = %s (use 'huge' as third command line argument to use huge pages)\n", hugePages ? "huge" : "default");
+    printf("Using numRounds = %d (use fourth command line argument to change)\n", numRounds);
+
+    Theron::uint32_t treeLeaves(1);
+    while (treeLeaves < static_cast<Theron::uint32_t>(numLeaves) && treeLeaves < 100000)
+    {
+        treeLeaves *= BRANCHING;
+    }
+
+    if (treeLeaves != static_cast<Theron::uint32_t>(numLeaves))
+    {
+        printf("Number of leaves must be a power of ten, at most 100000\n");
+        return 1;
+    }
+
+    // The allocator has to be set before any Theron objects are created.
+    Theron::HugePageAllocator hugePageAllocator;
+    if (hugePages)
+    {
+        Theron::AllocatorManager::SetAllocator(&hugePageAllocator);
+    }
+
+    const Theron::uint64_t expected(static_cast<Theron::uint64_t>(numLeaves) * (numLeaves - 1) / 2);
+    bool correct(true);
+    double totalSeconds(0.0);
+
+    // Count misses in the threads of each framework, which are counted once the threads have exited.
+    EventCounter tlbMissCounter(EventCounter::DTLB_LOAD_MISSES);
+    Theron::uint64_t tlbMisses(0);
+
+    for (int round = 0; round < numRounds; ++round)
+    {
+        Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+
+        typedef Theron::Catcher<Theron::uint64_t> SumCatcher;
+        SumCatcher catcher;
+        receiver.RegisterHandler(&catcher, &SumCatcher::Push);
+
+        Timer timer;
+        timer.Start();
+
+        Node *const root(Node::Create(framework));
+
+        Spawn spawn;
+        spawn.mFirst = 0;
+        spawn.mNumLeaves = static_cast<Theron::uint32_t>(numLeaves);
+
+        framework.Send(spawn, receiver.GetAddress(), root->GetAddress());
+        receiver.Wait();
+
+        timer.Stop();
+        totalSeconds += timer.Seconds();
+
+        Theron::uint64_t sum(0);
+        Theron::Address from;
+        catcher.Pop(sum, from);
+        correct = correct && (sum == expected);
+
+        Node::Destroy(root);
+    }
+
+    const bool haveTlbMisses(tlbMissCounter.Read(tlbMisses));
+    const Theron::uint64_t numActors((static_cast<Theron::uint64_t>(numLeaves) * BRANCHING - 1) / (BRANCHING - 1));
+
+    printf("Processed %d rounds of %llu actors in %.3f seconds (%.1f nanoseconds per actor)\n",
+        numRounds,
+        static_cast<unsigned long long>(numActors),
+        totalSeconds,
+        totalSeconds * 1.0e9 / (static_cast<double>(numActors) * numRounds));
+
+    if (haveTlbMisses)
+    {
+        printf("Data TLB load misses %llu (%.1f per actor), including creation and destruction of the trees\n",
+            static_cast<unsigned long long>(tlbMisses),
+            static_cast<double>(tlbMisses) / (static_cast<double>(numActors) * numRounds));
+    }
+    else
+    {
+        printf("Data TLB load misses unavailable\n");
+    }
+
+    if (hugePages)
+    {
+        printf("Huge page allocator reserved %llu KB, %llu KB of it marked for huge pages; process has %llu KB of transparent huge pages\n",
+            static_cast<unsigned long long>(hugePageAllocator.GetBytesReserved() / 1024),
+            static_cast<unsigned long long>(hugePageAllocator.GetHugePageBytes() / 1024),
+            static_cast<unsigned long long>(ReadHugePageKilobytes()));
+
+        // Restore the default allocator before the huge page allocator is destroyed.
+        Theron::AllocatorManager::SetAllocator(0);
+    }
+
+    if (!correct)
+    {
+        printf("Sum was wrong\n");
+        return 1;
+    }
+
+    return 0;
+}
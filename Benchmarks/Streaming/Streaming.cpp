@@ -0,0 +1,217 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark measures the throughput of a large in-memory transfer between two actors,
+// sent as a stream of chunks with flow control. The producer writes each chunk into a buffer
+// acquired from a BufferPool and sends it to the consumer, which reads one byte from every
+// cache line of the chunk, checking its contents, before acknowledging it. The producer can
+// only have a fixed window of chunks in flight, and writes more as the consumer returns credit
+// for the chunks it has consumed, so the memory used stays bounded however much is transferred.
+//
+// By default 10GB is transferred in chunks of 1MB, with a window of 8 chunks.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Theron/Theron.h>
+
+#include "../Common/Timer.h"
+
+
+class Producer : public Theron::Actor
+{
+public:
+
+    inline Producer(
+        Theron::Framework &framework,
+        Theron::BufferPool &bufferPool,
+        const Theron::Address &consumer,
+        const Theron::Address &client,
+        const Theron::uint32_t numChunks,
+        const Theron::uint32_t chunkSize,
+        const Theron::uint32_t window) :
+      Theron::Actor(framework),
+      mMaxBuffers(0),
+      mBufferPool(bufferPool),
+      mWriter(*this, bufferPool, consumer, window),
+      mClient(client),
+      mNumChunks(numChunks),
+      mChunkSize(chunkSize)
+    {
+        RegisterHandler(this, &Producer::HandleStart);
+        RegisterHandler(this, &Producer::HandleCredit);
+    }
+
+    Theron::uint32_t mMaxBuffers;
+
+private:
+
+    inline void HandleStart(const bool &/*start*/, const Theron::Address /*from*/)
+    {
+        WriteChunks();
+    }
+
+    inline void HandleCredit(const Theron::StreamCredit &credit, const Theron::Address /*from*/)
+    {
+        mWriter.Credit(credit);
+        WriteChunks();
+
+        // Tell the main thread once the consumer has received the whole stream.
+        if (mWriter.IsFinished())
+        {
+            Send(mWriter.GetChunksWritten(), mClient);
+        }
+    }
+
+    inline void WriteChunks()
+    {
+        while (mWriter.GetCredit() && mWriter.GetChunksWritten() < mNumChunks)
+        {
+            Theron::SharedBuffer chunk(mWriter.Acquire(mChunkSize));
+            memset(chunk.GetData(), static_cast<int>(mWriter.GetChunksWritten() & 0xFF), chunk.GetSize());
+            mWriter.Write(chunk);
+
+            const Theron::uint32_t buffers(mBufferPool.GetBuffersAcquired());
+            mMaxBuffers = buffers > mMaxBuffers ? buffers : mMaxBuffers;
+        }
+
+        if (mWriter.GetChunksWritten() == mNumChunks)
+        {
+            mWriter.Close();
+        }
+    }
+
+    Theron::BufferPool &mBufferPool;
+    Theron::StreamWriter mWriter;
+    const Theron::Address mClient;
+    const Theron::uint32_t mNumChunks;
+    const Theron::uint32_t mChunkSize;
+};
+
+
+class Consumer : public Theron::Actor
+{
+public:
+
+    inline explicit Consumer(Theron::Framework &framework) :
+      Theron::Actor(framework),
+      mErrors(0),
+      mReader(*this)
+    {
+        RegisterHandler(this, &Consumer::HandleChunk);
+    }
+
+    Theron::uint32_t mErrors;
+
+private:
+
+    inline void HandleChunk(const Theron::StreamChunk &chunk, const Theron::Address from)
+    {
+        if (!chunk.mEnd)
+        {
+            // Read one byte from each cache line, checking it was written by the producer.
+            const unsigned char expected(static_cast<unsigned char>(chunk.mSequence & 0xFF));
+            const char *const data(chunk.mBuffer.GetData());
+            const Theron::uint32_t size(chunk.mBuffer.GetSize());
+
+            for (Theron::uint32_t offset = 0; offset < size; offset += 64)
+            {
+                mErrors += (static_cast<unsigned char>(data[offset]) != expected) ? 1 : 0;
+            }
+        }
+
+        mReader.Consumed(chunk, from);
+    }
+
+    Theron::StreamReader mReader;
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(bool);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::uint32_t);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::StreamChunk);
+THERON_DECLARE_REGISTERED_MESSAGE(Theron::StreamCredit);
+
+THERON_DEFINE_REGISTERED_MESSAGE(bool);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::uint32_t);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::StreamChunk);
+THERON_DEFINE_REGISTERED_MESSAGE(Theron::StreamCredit);
+
+
+int main(int argc, char *argv[])
+{
+    const int numMegabytes = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 10240;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 2;
+    const int window = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 8;
+    const int chunkKilobytes = (argc > 4 && atoi(argv[4]) > 0) ? atoi(argv[4]) : 1024;
+
+    printf("Using numMegabytes = %d (use first command line argument to change)\n", numMegabytes);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+    printf("Using window = %d chunks (use third command line argument to change)\n", window);
+    printf("Using chunkKilobytes = %d (use fourth command line argument to change)\n", chunkKilobytes);
+
+    const Theron::uint32_t chunkSize(static_cast<Theron::uint32_t>(chunkKilobytes) * 1024);
+    const Theron::uint64_t totalBytes(static_cast<Theron::uint64_t>(numMegabytes) * 1024 * 1024);
+    const Theron::uint32_t numChunks(static_cast<Theron::uint32_t>((totalBytes + chunkSize - 1) / chunkSize));
+
+    printf("Streaming %u chunks of %u bytes between two actors...\n", numChunks, chunkSize);
+
+    Theron::BufferPool bufferPool;
+    Theron::Receiver receiver;
+    Theron::Catcher<Theron::uint32_t> catcher;
+    receiver.RegisterHandler(&catcher, &Theron::Catcher<Theron::uint32_t>::Push);
+
+    Theron::uint32_t maxBuffers(0);
+    Theron::uint32_t errors(0);
+    double seconds(0.0);
+
+    {
+        Theron::Framework::Parameters params(static_cast<Theron::uint32_t>(numThreads));
+        Theron::Framework framework(params);
+
+        Consumer consumer(framework);
+        Producer producer(
+            framework,
+            bufferPool,
+            consumer.GetAddress(),
+            receiver.GetAddress(),
+            numChunks,
+            chunkSize,
+            static_cast<Theron::uint32_t>(window));
+
+        Timer timer;
+        timer.Start();
+
+        framework.Send(true, receiver.GetAddress(), producer.GetAddress());
+        receiver.Wait();
+
+        timer.Stop();
+
+        seconds = timer.Seconds();
+        maxBuffers = producer.mMaxBuffers;
+        errors = consumer.mErrors;
+    }
+
+    Theron::uint32_t chunksWritten(0);
+    Theron::Address from;
+    catcher.Pop(chunksWritten, from);
+
+    const double gigabytes(static_cast<double>(numChunks) * chunkSize / (1024.0 * 1024.0 * 1024.0));
+
+    printf("Transferred %u chunks (%u errors) in %.3f seconds (%.2f GB/s)\n",
+        chunksWritten,
+        errors,
+        seconds,
+        gigabytes / seconds);
+
+    printf("Buffer pool reserved %llu KB, with at most %u chunks acquired at once\n",
+        static_cast<unsigned long long>(bufferPool.GetBytesReserved() / 1024),
+        maxBuffers);
+
+    return 0;
+}
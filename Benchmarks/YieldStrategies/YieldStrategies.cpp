@@ -0,0 +1,163 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+//
+// This benchmark compares the worker thread yield strategies under a mixed load, in which
+// bursts of work are separated by idle periods. Each burst is a short rally of messages
+// passed back and forth between a pair of actors, after which the last actor notifies a
+// receiver in the main thread. Between bursts the main thread sleeps, leaving the worker
+// threads idle.
+//
+// For each yield strategy the benchmark reports the average and worst latency of a burst,
+// measured by the main thread from sending the first message to being notified of the last,
+// and the CPU time consumed by the process as a percentage of the elapsed time. Strategies
+// that spin while idle respond quickly but burn CPU during the idle periods; strategies that
+// wait on condition variables use little CPU but pay for a wakeup at the start of every burst.
+//
+// The idle period is varied between runs so that the adaptive strategy, which learns the
+// typical idle gap of each worker thread, is seen both with gaps short enough to spin
+// through and gaps long enough that it should park.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <Theron/Theron.h>
+
+#include <Theron/Detail/Threading/Utils.h>
+
+#include "../Common/Timer.h"
+
+
+class Rally
+{
+public:
+
+    inline Rally(const Theron::Address &partner, const Theron::Address &receiver, const int count) :
+      mPartner(partner),
+      mReceiver(receiver),
+      mCount(count)
+    {
+    }
+
+    Theron::Address mPartner;
+    Theron::Address mReceiver;
+    int mCount;
+};
+
+
+class Player : public Theron::Actor
+{
+public:
+
+    inline Player(Theron::Framework &framework) : Theron::Actor(framework)
+    {
+        RegisterHandler(this, &Player::Hit);
+    }
+
+private:
+
+    inline void Hit(const Rally &rally, const Theron::Address from)
+    {
+        if (rally.mCount > 0)
+        {
+            Send(Rally(from, rally.mReceiver, rally.mCount - 1), rally.mPartner);
+        }
+        else
+        {
+            Send(rally.mCount, rally.mReceiver);
+        }
+    }
+};
+
+
+// Register the message types so that registered names are used instead of dynamic_cast.
+THERON_DECLARE_REGISTERED_MESSAGE(int);
+THERON_DECLARE_REGISTERED_MESSAGE(Rally);
+
+THERON_DEFINE_REGISTERED_MESSAGE(int);
+THERON_DEFINE_REGISTERED_MESSAGE(Rally);
+
+
+static void RunBenchmark(
+    const char *const name,
+    const Theron::YieldStrategy yieldStrategy,
+    const int numThreads,
+    const int numBursts,
+    const int burstLength,
+    const int idleMilliseconds)
+{
+    Theron::Framework::Parameters params(numThreads);
+    params.mYieldStrategy = yieldStrategy;
+
+    Theron::Framework framework(params);
+    Theron::Receiver receiver;
+    Player playerA(framework);
+    Player playerB(framework);
+
+    Timer wallTimer;
+    Timer burstTimer;
+    double totalLatency(0.0);
+    double maxLatency(0.0);
+
+    const clock_t startCpu(clock());
+    wallTimer.Start();
+
+    for (int burst = 0; burst < numBursts; ++burst)
+    {
+        burstTimer.Start();
+
+        framework.Send(
+            Rally(playerB.GetAddress(), receiver.GetAddress(), burstLength),
+            playerB.GetAddress(),
+            playerA.GetAddress());
+
+        receiver.Wait();
+        burstTimer.Stop();
+
+        const double latency(burstTimer.Seconds() * 1000000.0);
+        totalLatency += latency;
+        maxLatency = latency > maxLatency ? latency : maxLatency;
+
+        Theron::Detail::Utils::SleepThread(static_cast<Theron::uint32_t>(idleMilliseconds));
+    }
+
+    wallTimer.Stop();
+    const clock_t endCpu(clock());
+
+    const double cpuSeconds(static_cast<double>(endCpu - startCpu) / CLOCKS_PER_SEC);
+
+    printf("%-10s idle %4d ms   latency avg %9.1f us   max %9.1f us   cpu %6.1f%%\n",
+        name,
+        idleMilliseconds,
+        totalLatency / numBursts,
+        maxLatency,
+        100.0 * cpuSeconds / wallTimer.Seconds());
+}
+
+
+int main(int argc, char *argv[])
+{
+    const int numBursts = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 200;
+    const int numThreads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4;
+    const int burstLength = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 1000;
+
+    printf("Using numBursts = %d (use first command line argument to change)\n", numBursts);
+    printf("Using numThreads = %d (use second command line argument to change)\n", numThreads);
+    printf("Using burstLength = %d (use third command line argument to change)\n", burstLength);
+
+    const int idlePeriods[] = { 0, 1, 10 };
+    const int numIdlePeriods = sizeof(idlePeriods) / sizeof(idlePeriods[0]);
+
+    for (int index = 0; index < numIdlePeriods; ++index)
+    {
+        RunBenchmark("CONDITION", Theron::YIELD_STRATEGY_CONDITION, numThreads, numBursts, burstLength, idlePeriods[index]);
+        RunBenchmark("HYBRID", Theron::YIELD_STRATEGY_HYBRID, numThreads, numBursts, burstLength, idlePeriods[index]);
+        RunBenchmark("SPIN", Theron::YIELD_STRATEGY_SPIN, numThreads, numBursts, burstLength, idlePeriods[index]);
+        RunBenchmark("ADAPTIVE", Theron::YIELD_STRATEGY_ADAPTIVE, numThreads, numBursts, burstLength, idlePeriods[index]);
+    }
+
+    return 0;
+}
@@ -28,6 +28,8 @@ Actor baseclass.
 #include <Theron/Detail/Handlers/DefaultHandlerCollection.h>
 #include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
 #include <Theron/Detail/Handlers/HandlerCollection.h>
+#include <Theron/Detail/Mailboxes/Conflater.h>
+#include <Theron/Detail/Mailboxes/IConflater.h>
 #include <Theron/Detail/Messages/IMessage.h>
 #include <Theron/Detail/Messages/MessageCreator.h>
 #include <Theron/Detail/Mailboxes/Mailbox.h>
@@ -50,6 +52,8 @@ namespace Theron
 
 
 class Framework;
+class StreamReader;
+class StreamWriter;
 
 namespace Detail
 {
@@ -97,6 +101,8 @@ class Actor
 public:
 
     friend class Framework;
+    friend class StreamReader;
+    friend class StreamWriter;
     friend class Detail::MailboxProcessor;
 
     /**
@@ -578,6 +584,141 @@ protected:
         ActorType *const actor,
         void (ActorType::*handler)(const void *const data, const uint32_t size, const Address from));
 
+    /**
+    \brief Marks the actor as one whose message handlers may block.
+
+    Message handlers are normally executed by the worker threads of the framework, which
+    are shared by all of its actors. A handler that blocks, for example by reading a file
+    or waiting for a reply from a database, stalls the worker thread executing it, and
+    delays the processing of other actors queued behind it.
+
+    Actors whose handlers may block should call this method, typically in their constructors.
+    The handlers of blocking actors are executed by a separate pool of worker threads,
+    leaving the main worker threads free to execute the handlers of other actors. The
+    blocking pool is created when the first actor in the framework is marked as blocking,
+    and grows while all of its threads are blocked, up to the limit set by
+    \ref Framework::Parameters::mMaxBlockingThreads.
+
+    \code
+    class FileReader : public Theron::Actor
+    {
+    public:
+
+        explicit FileReader(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            SetBlocking();
+            RegisterHandler(this, &FileReader::Read);
+        }
+
+    private:
+
+        void Read(const ReadRequest &request, const Theron::Address from);
+    };
+    \endcode
+
+    \note Handing messages between the pools adds some overhead, so actors with short,
+    non-blocking handlers should not be marked as blocking.
+
+    \param blocking True to mark the actor as blocking, false to unmark it.
+    */
+    void SetBlocking(const bool blocking = true);
+
+    /**
+    \brief Conflates messages of the given type that carry the same key.
+
+    Some actors only care about the latest value of each of a number of keys, for example
+    the latest price of each instrument in a stream of market data updates. If such an actor
+    falls behind, queueing every update wastes memory and handler time on values that are
+    already out of date. After calling this method, a message of the given type delivered to
+    the actor replaces any message of the same type with the same key that is still waiting
+    in its mailbox, taking its place in the queue, rather than being queued behind it. So
+    the mailbox holds at most one message per key, and the actor only ever sees the latest.
+
+    The key is identified by a pointer to a data member of the message type, whose values are
+    compared with operator==. Actors typically call this method in their constructors:
+
+    \code
+    struct Quote
+    {
+        Theron::uint32_t mInstrument;
+        double mPrice;
+    };
+
+    class PriceBoard : public Theron::Actor
+    {
+    public:
+
+        explicit PriceBoard(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            ConflateMessages(&Quote::mInstrument);
+            RegisterHandler(this, &PriceBoard::Update);
+        }
+
+    private:
+
+        void Update(const Quote &quote, const Theron::Address from);
+    };
+    \endcode
+
+    The message that is being handled is never replaced. Pending messages of conflated types
+    are indexed by key, so the message a new one supersedes is found without searching the
+    mailbox. When the sender is in the same framework, the value of the pending message is
+    just overwritten in place, with the new sender's address, and no message is allocated.
+    Conflation only applies to messages sent by actors and non-actor code in the local
+    process; it can't be undone except by destroying the actor.
+
+    \note Keys of integral and pointer types are hashed. Keys of other types all hash alike,
+    so messages with such keys are matched by comparing their keys in turn, which suits
+    actors with only a few distinct keys.
+    \note The value of a replaced message is destructed and the new value copy-constructed
+    in its place, so the message type needn't support assignment.
+
+    \tparam ValueType The message type to conflate.
+    \tparam KeyType The type of the key member.
+    \param key Pointer to the data member of the message type holding its key.
+    \return True, unless the conflater couldn't be allocated.
+    */
+    template <class ValueType, class KeyType>
+    inline bool ConflateMessages(KeyType ValueType::*key);
+
+    /**
+    \brief Returns an allocator for temporary memory used within a message handler.
+
+    Handlers often need short-lived working memory, for example to parse or transform the
+    message they're handling. Memory allocated from the returned allocator is carved from
+    a per-thread arena simply by bumping a pointer, and is reclaimed all at once after the
+    message has been handled, so allocating it costs almost nothing and freeing it is free.
+    Standard containers can use the arena via \ref StlAllocator:
+
+    \code
+    class Parser : public Theron::Actor
+    {
+    public:
+
+        explicit Parser(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &Parser::Parse);
+        }
+
+    private:
+
+        typedef Theron::StlAllocator<int> ScratchAllocator;
+
+        void Parse(const std::string &line, const Theron::Address from)
+        {
+            std::vector<int, ScratchAllocator> fields((ScratchAllocator(GetScratchAllocator())));
+            // ...
+        }
+    };
+    \endcode
+
+    \note Scratch memory is only valid until the handler returns, so mustn't be kept in the actor
+    or sent in messages. Outside message handlers, for example in actor constructors, the
+    returned allocator is the general-purpose allocator, and memory allocated with it must
+    be freed as usual.
+    */
+    inline IAllocator *GetScratchAllocator() const;
+
     /**
     \brief Sends a message to the entity (actor or Receiver) at the given address.
 
@@ -702,6 +843,119 @@ protected:
     template <class ValueType>
     inline bool Send(const ValueType &value, const Address &address) const;
 
+    /**
+    \brief Sends a message that expires if it isn't handled within the given time.
+
+    This method is like the other \ref Send overload, but gives the message a deadline of
+    the given number of milliseconds from now. If the message is still waiting in the mailbox
+    of the addressed actor when its deadline passes, it's dropped without being handled: its
+    message handlers aren't executed, and instead it's counted and passed to the expiry handler
+    of the receiving actor's framework, if one is set (see \ref Framework::SetExpiryHandler).
+    This lets actors that fall behind under load shed messages that would be useless by the
+    time they were handled, rather than spend time handling them.
+
+    Deadlines are checked just before a message is handled, so a message whose handler has
+    started is always handled completely. Messages sent to receivers, or to actors in other
+    processes, don't expire.
+
+    \tparam ValueType The message type (any copyable class or Plain-Old-Data type).
+    \param value The message value to be sent.
+    \param address The address of the destination Receiver or Actor mailbox.
+    \param timeToLive Time in milliseconds within which the message should be handled.
+    Zero means the message never expires.
+    \return True, if the message was delivered, otherwise false.
+
+    \see Framework::GetNumExpiredMessages
+    */
+    template <class ValueType>
+    inline bool Send(const ValueType &value, const Address &address, const uint32_t timeToLive) const;
+
+    /**
+    \brief Sends a message back to the sender of the message being handled, reusing its memory.
+
+    Within a message handler, Reply(value) is equivalent to Send(value, from), where from is
+    the address passed to the handler. But actors that answer requests, or pass messages back
+    and forth, allocate a message for each reply just before the message they're handling is
+    freed. Reply avoids that: if the memory block of the message being handled is big enough,
+    and aligned well enough, for the reply, the reply is built in the same block and sent in
+    place of freeing it, once the handler has returned. Otherwise the reply is sent as usual.
+
+    \code
+    class Echo : public Theron::Actor
+    {
+    public:
+
+        explicit Echo(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &Echo::Handler);
+        }
+
+    private:
+
+        void Handler(const int &request, const Theron::Address from)
+        {
+            Reply(request + 1);
+        }
+    };
+    \endcode
+
+    Only one reply or forwarded message can reuse the block of the message being handled; any
+    further replies are sent as usual. The reply value is copied when Reply is called, so the
+    handler can keep using the message it's handling, but the reply is only sent after the
+    handler returns, so it follows any messages the handler sends by other means.
+
+    \tparam ValueType The message type (any copyable class or Plain-Old-Data type).
+    \param value The message value to be sent.
+    \return True, if the message was delivered or will be sent when the handler returns, otherwise false.
+    False is always returned when Reply is called outside a message handler.
+
+    \see Forward
+    */
+    template <class ValueType>
+    inline bool Reply(const ValueType &value) const;
+
+    /**
+    \brief Forwards the message being handled, unchanged, to another address.
+
+    Within a message handler, Forward passes on the message being handled, without copying it:
+    the message itself, with the same value and the same sender, is sent to the given address
+    just after the handler returns, in place of being freed. So the recipient sees the message
+    as sent by the original sender, and can reply to it directly.
+
+    \code
+    class Router : public Theron::Actor
+    {
+    public:
+
+        Router(Theron::Framework &framework, const Theron::Address &worker) :
+          Theron::Actor(framework),
+          mWorker(worker)
+        {
+            RegisterHandler(this, &Router::Handler);
+        }
+
+    private:
+
+        void Handler(const Request &request, const Theron::Address from)
+        {
+            Forward(mWorker);
+        }
+
+        const Theron::Address mWorker;
+    };
+    \endcode
+
+    A message can only be forwarded once, and can't be both forwarded and replied to using
+    \ref Reply, since both reuse it. Forward returns false without sending anything if the
+    message has already been reused, or if it's called outside a message handler.
+
+    \param address The address of the destination Receiver or Actor mailbox.
+    \return True, if the message will be forwarded when the handler returns, otherwise false.
+
+    \see Reply
+    */
+    inline bool Forward(const Address &address) const;
+
     /**
     \brief Deprecated.
 
@@ -731,6 +985,21 @@ private:
         Detail::FallbackHandlerCollection *const fallbackHandlers,
         Detail::IMessage *const message);
 
+    /**
+    Rebuilds a reply in the block of the handled message, once it's popped, and sends it.
+    */
+    template <class ValueType>
+    inline static void SendReply(
+        Detail::MailboxContext *const mailboxContext,
+        Detail::IMessage *const message);
+
+    /**
+    Sends the handled message on, once it's popped.
+    */
+    inline static void SendForward(
+        Detail::MailboxContext *const mailboxContext,
+        Detail::IMessage *const message);
+
     /**
     Handle an unhandled message.
     */
@@ -743,6 +1012,7 @@ private:
     Detail::HandlerCollection mMessageHandlers;         ///< The message handlers registered by this actor.
     Detail::DefaultHandlerCollection mDefaultHandlers;  ///< Default message handlers registered by this actor.
     Detail::MailboxContext *mMailboxContext;            ///< Remembers the context of the worker thread processing the actor.
+    Detail::List<Detail::IConflater> mConflaters;       ///< Conflaters of message types that replace pending messages.
 
     void *mMemory;                                      ///< Pointer to memory block containing final actor type.
 };
@@ -827,8 +1097,43 @@ inline bool Actor::SetDefaultHandler(
 }
 
 
+template <class ValueType, class KeyType>
+inline bool Actor::ConflateMessages(KeyType ValueType::*key)
+{
+    typedef Detail::Conflater<ValueType, KeyType> ConflaterType;
+
+    void *const memory(AllocatorManager::GetCache()->Allocate(sizeof(ConflaterType)));
+    if (memory == 0)
+    {
+        return false;
+    }
+
+    mFramework->AddActorConflater(this, new (memory) ConflaterType(key));
+    return true;
+}
+
+
+THERON_FORCEINLINE IAllocator *Actor::GetScratchAllocator() const
+{
+    // The mailbox context is only set while the actor is handling a message on a worker thread.
+    if (mMailboxContext && mMailboxContext->mScratchArena)
+    {
+        return mMailboxContext->mScratchArena;
+    }
+
+    return AllocatorManager::GetCache();
+}
+
+
 template <class ValueType>
 THERON_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address) const
+{
+    return Send(value, address, 0);
+}
+
+
+template <class ValueType>
+THERON_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address, const uint32_t timeToLive) const
 {
     // Try to use the processor context owned by a worker thread.
     // The current thread will be a worker thread if this method has been called from a message
@@ -844,14 +1149,26 @@ THERON_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &addre
         mailboxContext = mFramework->GetMailboxContext();
     }
 
+    // A value superseding a pending message of an actor that conflates it just overwrites it.
+    if (mFramework->ConflateWithinFramework(value, mAddress, address, timeToLive))
+    {
+        return true;
+    }
+
     // Allocate a message. It'll be deleted by the worker thread that handles it.
     Detail::IMessage *const message(Detail::MessageCreator::Create(
         mailboxContext->mMessageAllocator,
         value,
-        mAddress));
+        mAddress,
+        mailboxContext->mMessageSlots));
 
     if (message)
     {
+        if (timeToLive)
+        {
+            message->SetDeadline(Detail::MessageExpiry::GetDeadline(timeToLive));
+        }
+
         // Call the message sending implementation using the acquired processor context.
         return mFramework->SendInternal(
             mailboxContext,
@@ -863,6 +1180,64 @@ THERON_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &addre
 }
 
 
+template <class ValueType>
+inline bool Actor::Reply(const ValueType &value) const
+{
+    typedef Detail::Message<ValueType> MessageType;
+
+    // The recycler only holds a message while the actor is handling it on a worker thread.
+    Detail::MailboxContext *const mailboxContext(mMailboxContext);
+    if (mailboxContext == 0)
+    {
+        return false;
+    }
+
+    Detail::MessageRecycler &recycler(mailboxContext->mMessageRecycler);
+    Detail::IMessage *const message(recycler.GetMessage());
+    if (message == 0)
+    {
+        return false;
+    }
+
+    // Reuse the block of the handled message if it's free to reuse and fits the reply.
+    // The reply value is kept in scratch memory until the handled message is popped.
+    if (recycler.Available() &&
+        mailboxContext->mScratchArena &&
+        MessageType::GetSize() <= message->GetBlockSize() &&
+        THERON_ALIGNED(message->GetBlock(), MessageType::GetAlignment()))
+    {
+        void *const memory(mailboxContext->mScratchArena->AllocateAligned(
+            sizeof(ValueType),
+            THERON_ALIGNOF(ValueType)));
+
+        if (memory)
+        {
+            new (memory) ValueType(value);
+            recycler.Claim(&Actor::SendReply<ValueType>, mFramework, memory, mAddress, message->From());
+            return true;
+        }
+    }
+
+    return Send(value, message->From());
+}
+
+
+THERON_FORCEINLINE bool Actor::Forward(const Address &address) const
+{
+    Detail::MailboxContext *const mailboxContext(mMailboxContext);
+    if (mailboxContext == 0 || !mailboxContext->mMessageRecycler.Available())
+    {
+        return false;
+    }
+
+    // The forwarded message keeps its original sender.
+    Detail::MessageRecycler &recycler(mailboxContext->mMessageRecycler);
+    recycler.Claim(&Actor::SendForward, mFramework, 0, recycler.GetMessage()->From(), address);
+
+    return true;
+}
+
+
 template <class ValueType>
 THERON_FORCEINLINE bool Actor::TailSend(const ValueType &value, const Address &address) const
 {
@@ -871,6 +1246,37 @@ THERON_FORCEINLINE bool Actor::TailSend(const ValueType &value, const Address &a
 }
 
 
+template <class ValueType>
+inline void Actor::SendReply(
+    Detail::MailboxContext *const mailboxContext,
+    Detail::IMessage *const message)
+{
+    Detail::MessageRecycler &recycler(mailboxContext->mMessageRecycler);
+
+    void *const block(message->GetBlock());
+    const uint32_t blockSize(message->GetBlockSize());
+
+    // Destruct the value of the handled message but keep its block.
+    message->Release();
+
+    // Build the reply in the block from the copy of its value, which is then destructed.
+    ValueType *const value(reinterpret_cast<ValueType *>(recycler.GetValue()));
+    Detail::IMessage *const reply(Detail::Message<ValueType>::Initialize(block, blockSize, *value, recycler.GetFrom()));
+    value->~ValueType();
+
+    recycler.GetFramework()->SendInternal(mailboxContext, reply, recycler.GetAddress());
+}
+
+
+inline void Actor::SendForward(
+    Detail::MailboxContext *const mailboxContext,
+    Detail::IMessage *const message)
+{
+    const Detail::MessageRecycler &recycler(mailboxContext->mMessageRecycler);
+    recycler.GetFramework()->SendInternal(mailboxContext, message, recycler.GetAddress());
+}
+
+
 THERON_FORCEINLINE void Actor::ProcessMessage(
     Detail::MailboxContext *const mailboxContext,
     Detail::FallbackHandlerCollection *const fallbackHandlers,
@@ -14,8 +14,7 @@ Static manager class for allocators used within Theron.
 #include <Theron/Defines.h>
 #include <Theron/IAllocator.h>
 
-#include <Theron/Detail/Allocators/CachingAllocator.h>
-#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Allocators/LockFreeCachingAllocator.h>
 
 
 #ifdef _MSC_VER
@@ -60,6 +59,9 @@ Theron::AllocatorManager::SetAllocator(&allocator);
 If the \ref DefaultAllocator is replaced with a custom allocator then it must be
 replaced at application start, before any Theron objects (\ref EndPoint "endpoints",
 \ref Framework "frameworks", \ref Actor "actors" or \ref Receiver "receivers") are constructed.
+The exception is that SetAllocator can be called again with a null pointer, to restore the
+default allocator once all Theron objects have been destroyed, before a custom allocator
+that frees its memory on destruction (such as \ref HugePageAllocator) is itself destroyed.
 \ref GetAllocator can be called any number of times after \ref SetAllocator is called.
 */
 class AllocatorManager
@@ -82,7 +84,8 @@ public:
     Theron::AllocatorManager::SetAllocator(&allocator);
     \endcode
     
-    \note This method can't be called at static construction time.
+    \note This method can't be called at static construction time. Memory cached internally
+    is returned to the previous allocator before it's replaced.
 
     \see GetAllocator
     */
@@ -128,17 +131,16 @@ private:
 
     struct CacheTraits
     {
-        typedef Detail::SpinLock LockType;
-
+        // The global cache is shared by all frameworks, so its pools are lock-free and
+        // each is padded to a cache line of its own.
         struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) AlignType
         {
         } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
 
-        static const uint32_t MAX_POOLS = 8;
-        static const uint32_t MAX_BLOCKS = 16;
+        static const uint32_t SLAB_SIZE = 16384;
     };
 
-    typedef Detail::CachingAllocator<CacheTraits> CacheType;
+    typedef Detail::LockFreeCachingAllocator<CacheTraits> CacheType;
 
     THERON_FORCEINLINE AllocatorManager()
     {
@@ -54,6 +54,7 @@ namespace Theron
 
 // In Boost builds we reuse the convenient Boost integer types.
 typedef boost::uint8_t uint8_t;
+typedef boost::uint16_t uint16_t;
 typedef boost::uint32_t uint32_t;
 typedef boost::int32_t int32_t;
 typedef boost::uint64_t uint64_t;
@@ -69,6 +70,7 @@ typedef unsigned long uintptr_t;
 
 // Promote the global namespace types into the Theron namespace.
 typedef ::uint8_t uint8_t;
+typedef ::uint16_t uint16_t;
 typedef ::uint32_t uint32_t;
 typedef ::int32_t int32_t;
 typedef ::uint64_t uint64_t;
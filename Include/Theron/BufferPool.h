@@ -0,0 +1,334 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_BUFFERPOOL_H
+#define THERON_BUFFERPOOL_H
+
+
+/**
+\file BufferPool.h
+A pool of large, reference-counted buffers that can be shared between actors without copying.
+*/
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/SpinLock.h>
+
+
+namespace Theron
+{
+
+
+class SharedBuffer;
+
+
+/**
+\brief A thread-safe pool of large memory buffers, handed out via reference-counted \ref SharedBuffer handles.
+
+Messages are copied when they're sent, which makes sending large payloads, such as image tiles
+of a megabyte or so, expensive. Sending raw pointers to the payloads instead avoids the copying,
+but leaves the application to work out when the payloads can be freed. A BufferPool hands out
+buffers via \ref SharedBuffer handles, which are small and cheap to copy, so can be sent in messages;
+copying a handle shares the buffer rather than copying it. Each buffer counts the handles that
+refer to it, and is returned to the pool automatically when the last of them is destroyed.
+
+Buffer sizes are rounded up to size classes, which are powers of two from 4KB up to 64MB.
+Buffers of up to 2MB are carved from 2MB slabs allocated from the pool's allocator, and larger
+buffers each get a slab of their own. Free buffers are kept by the pool for reuse, and the slabs
+are only freed when the pool is destroyed.
+
+By default the slabs are allocated from the allocator used by Theron. To back them with huge pages,
+which reduces misses in the processor's TLB when streaming through large buffers, construct the
+pool with a \ref HugePageAllocator:
+
+\code
+Theron::HugePageAllocator hugePageAllocator;
+Theron::BufferPool bufferPool(&hugePageAllocator);
+
+Theron::SharedBuffer tile(bufferPool.Acquire(1024 * 1024));
+FillTile(tile.GetData(), tile.GetSize());
+
+// The tile is shared with the receiving actor, not copied.
+framework.Send(tile, from, filter.GetAddress());
+\endcode
+
+\note The pool must outlive all the handles to its buffers, including those in messages that
+haven't been handled yet.
+*/
+class BufferPool
+{
+public:
+
+    friend class SharedBuffer;
+
+    /**
+    \brief Size in bytes of the smallest size class of buffers.
+    */
+    static const uint32_t MIN_BUFFER_SIZE = 4096;
+
+    /**
+    \brief Size in bytes of the largest buffer that can be acquired.
+    */
+    static const uint32_t MAX_BUFFER_SIZE = 64 * 1024 * 1024;
+
+    /**
+    \brief Size in bytes of the slabs from which smaller buffers are carved.
+    */
+    static const uint32_t SLAB_SIZE = 2 * 1024 * 1024;
+
+    /**
+    \brief Constructor.
+
+    No memory is allocated until the first buffer is acquired.
+
+    \param allocator Allocator from which the slabs are allocated. If null, the allocator used
+    by Theron is used, as returned by \ref AllocatorManager::GetAllocator.
+    */
+    explicit BufferPool(IAllocator *const allocator = 0);
+
+    /**
+    \brief Destructor. Frees all the slabs.
+
+    \note All handles to the buffers of the pool must have been destroyed.
+    */
+    ~BufferPool();
+
+    /**
+    \brief Acquires a buffer of at least the given size.
+
+    The contents of the buffer are undefined. The buffer is returned to the pool when the
+    returned handle, and all copies of it, have been destroyed.
+
+    \param size Size of the buffer in bytes, at most \ref MAX_BUFFER_SIZE.
+    \return A handle to the buffer, or a null handle if the size is too large or memory ran out.
+    */
+    SharedBuffer Acquire(const uint32_t size);
+
+    /**
+    \brief Gets the number of buffers currently acquired.
+    */
+    uint32_t GetBuffersAcquired() const;
+
+    /**
+    \brief Gets the total size of the slabs allocated by the pool, in bytes.
+    */
+    uint64_t GetBytesReserved() const;
+
+private:
+
+    static const uint32_t NUM_CLASSES = 15;             ///< Number of size classes, from 4KB to 64MB.
+
+    /**
+    Control block of a buffer, kept apart from the buffer memory so that it doesn't disturb
+    the alignment or size of the buffer.
+    */
+    struct Block
+    {
+        inline Block(BufferPool *const pool, char *const data, const uint32_t sizeClass) :
+          mPool(pool),
+          mData(data),
+          mNext(0),
+          mRefCount(0),
+          mSize(0),
+          mSizeClass(sizeClass)
+        {
+        }
+
+        BufferPool *mPool;                              ///< The pool that owns the buffer.
+        char *mData;                                    ///< The buffer memory.
+        Block *mNext;                                   ///< Next free buffer of the same size class, if any.
+        Detail::Atomic::UInt32 mRefCount;               ///< Number of handles referring to the buffer.
+        uint32_t mSize;                                 ///< Size of the buffer as requested when it was acquired.
+        uint32_t mSizeClass;                            ///< Size class of the buffer.
+    };
+
+    /**
+    A slab of buffer memory, followed in memory by the control blocks of its buffers.
+    */
+    struct Slab
+    {
+        Slab *mNext;                                    ///< Next slab allocated by the pool, if any.
+        char *mData;                                    ///< The slab memory, carved into buffers.
+        uint32_t mDataSize;                             ///< Size of the slab memory in bytes.
+        uint32_t mNumBlocks;                            ///< Number of buffers carved from the slab.
+    };
+
+    BufferPool(const BufferPool &other);
+    BufferPool &operator=(const BufferPool &other);
+
+    Block *AllocateSlab(const uint32_t sizeClass);
+    void Return(Block *const block);
+
+    IAllocator *mAllocator;                             ///< Allocator from which slabs are allocated.
+    mutable Detail::SpinLock mSpinLock;                 ///< Protects the pool's state.
+    Block *mFreeBlocks[NUM_CLASSES];                    ///< Free buffers of each size class.
+    Slab *mSlabs;                                       ///< All the slabs allocated by the pool.
+    uint32_t mBuffersAcquired;                          ///< Number of buffers currently acquired.
+    uint64_t mBytesReserved;                            ///< Total size of the slabs in bytes.
+};
+
+
+/**
+\brief A reference-counted handle to a buffer acquired from a \ref BufferPool.
+
+Copying a handle shares the buffer it refers to, so handles can be sent in messages
+cheaply regardless of the size of the buffer. The buffer is returned to its pool when the
+last handle referring to it is destroyed or released.
+
+\code
+class Stage : public Theron::Actor
+{
+public:
+
+    Stage(Theron::Framework &framework, const Theron::Address next) : Theron::Actor(framework), mNext(next)
+    {
+        RegisterHandler(this, &Stage::Handler);
+    }
+
+private:
+
+    void Handler(const Theron::SharedBuffer &buffer, const Theron::Address from)
+    {
+        Process(buffer.GetData(), buffer.GetSize());
+
+        // Pass the buffer on to the next stage, reusing the message that holds the handle.
+        Forward(mNext);
+    }
+
+    Theron::Address mNext;
+};
+\endcode
+
+\note The reference count is thread-safe, so handles to the same buffer can be copied and
+destroyed by different threads concurrently. The contents of the buffer aren't protected,
+so the application must make sure that threads don't write it while others access it,
+as in a pipeline where each stage only touches the buffer while it holds it.
+*/
+class SharedBuffer
+{
+public:
+
+    /**
+    \brief Default constructor. Constructs a null handle, referring to no buffer.
+    */
+    inline SharedBuffer() : mBlock(0)
+    {
+    }
+
+    /**
+    \brief Copy constructor. Shares the buffer referred to by the other handle, if any.
+    */
+    inline SharedBuffer(const SharedBuffer &other) : mBlock(other.mBlock)
+    {
+        if (mBlock)
+        {
+            mBlock->mRefCount.Increment();
+        }
+    }
+
+    /**
+    \brief Assignment operator. Releases the buffer referred to by the handle, and shares the other's.
+    */
+    inline SharedBuffer &operator=(const SharedBuffer &other)
+    {
+        if (other.mBlock)
+        {
+            other.mBlock->mRefCount.Increment();
+        }
+
+        Release();
+        mBlock = other.mBlock;
+        return *this;
+    }
+
+    /**
+    \brief Destructor. Releases the buffer, returning it to its pool if this is the last handle to it.
+    */
+    inline ~SharedBuffer()
+    {
+        Release();
+    }
+
+    /**
+    \brief Releases the buffer, after which the handle is null.
+
+    If this is the last handle to the buffer then the buffer is returned to its pool.
+    */
+    inline void Release();
+
+    /**
+    \brief Returns true if the handle refers to no buffer.
+    */
+    inline bool IsNull() const
+    {
+        return (mBlock == 0);
+    }
+
+    /**
+    \brief Returns true if this is the only handle referring to the buffer.
+
+    A buffer that isn't shared can safely be written by the holder of the handle.
+    */
+    inline bool IsUnique() const
+    {
+        return (mBlock != 0 && mBlock->mRefCount.LoadAcquire() == 1);
+    }
+
+    /**
+    \brief Gets a pointer to the memory of the buffer, which is aligned to at least a cache line.
+    */
+    inline char *GetData() const
+    {
+        THERON_ASSERT(mBlock);
+        return mBlock->mData;
+    }
+
+    /**
+    \brief Gets the size of the buffer in bytes, as requested when it was acquired.
+    */
+    inline uint32_t GetSize() const
+    {
+        THERON_ASSERT(mBlock);
+        return mBlock->mSize;
+    }
+
+private:
+
+    friend class BufferPool;
+
+    inline explicit SharedBuffer(BufferPool::Block *const block) : mBlock(block)
+    {
+    }
+
+    BufferPool::Block *mBlock;                          ///< Control block of the buffer, if any.
+};
+
+
+THERON_FORCEINLINE void SharedBuffer::Release()
+{
+    if (BufferPool::Block *const block = mBlock)
+    {
+        mBlock = 0;
+
+        // Drop the reference, publishing any writes to the buffer made via this handle.
+        uint32_t count(block->mRefCount.LoadRelaxed());
+        while (!block->mRefCount.CompareExchangeRelease(count, count - 1))
+        {
+        }
+
+        // The last handle synchronizes with the releases of the others before returning the buffer.
+        if (count == 1 && block->mRefCount.LoadAcquire() == 0)
+        {
+            block->mPool->Return(block);
+        }
+    }
+}
+
+
+} // namespace Theron
+
+
+#endif // THERON_BUFFERPOOL_H
@@ -311,6 +311,123 @@ preprocessor settings in Visual Studio.
 #endif
 
 
+/**
+\def THERON_FUTEX
+
+\brief Controls whether Linux futexes are used to implement mutexes and condition variables.
+
+If THERON_FUTEX is defined as 1 then the internal Mutex and Condition primitives are implemented
+directly on the Linux futex system call, in preference to pthreads, Boost or C++11. The futex-based
+primitives count their waiters and avoid making a system call at all when locking an uncontended
+mutex, unlocking a mutex that no thread is waiting for, or pulsing a condition with no waiters.
+
+This define is defined automatically if not predefined by the user. When automatically
+defined, it is defined as 1 in GCC builds on Linux, and 0 otherwise.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+*/
+
+
+#if !defined(THERON_FUTEX)
+#if THERON_GCC && defined(__linux__) && !THERON_WINDOWS
+#define THERON_FUTEX 1
+#else
+#define THERON_FUTEX 0
+#endif
+#endif
+
+
+/**
+\def THERON_IO_URING
+
+\brief Controls whether Linux io_uring is used to perform asynchronous file I/O.
+
+If THERON_IO_URING is defined as 1 then the file I/O service of each framework (see
+\ref Theron::Framework::ReadFile) submits its reads and writes to the kernel through an
+io_uring submission queue, serviced by a single thread, instead of performing them with
+blocking system calls on a small pool of threads. Where io_uring turns out to be unavailable
+at runtime, for example because the kernel is too old or the system call is blocked, the
+service falls back to the thread pool automatically.
+
+This define is defined automatically if not predefined by the user. When automatically
+defined, it is defined as 1 in GCC builds on Linux, and 0 otherwise. Building with io_uring
+support requires kernel headers from Linux 5.6 or later.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+*/
+
+
+#if !defined(THERON_IO_URING)
+#if THERON_GCC && defined(__linux__) && !THERON_WINDOWS
+#define THERON_IO_URING 1
+#else
+#define THERON_IO_URING 0
+#endif
+#endif
+
+
+/**
+\def THERON_EPOLL
+
+\brief Controls whether Linux epoll is used to deliver readiness of file descriptors to actors.
+
+If THERON_EPOLL is defined as 1 then each framework can watch file descriptors, such as
+sockets and pipes, on behalf of its actors (see \ref Theron::Framework::WatchDescriptor).
+A single reactor thread per framework waits on an epoll instance and delivers each readiness
+event to the watching actor as a \ref Theron::DescriptorReady message. If it's defined as 0
+then watching descriptors isn't supported, and WatchDescriptor always fails.
+
+This define is defined automatically if not predefined by the user. When automatically
+defined, it is defined as 1 in GCC builds on Linux, and 0 otherwise.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+*/
+
+
+#if !defined(THERON_EPOLL)
+#if THERON_GCC && defined(__linux__) && !THERON_WINDOWS
+#define THERON_EPOLL 1
+#else
+#define THERON_EPOLL 0
+#endif
+#endif
+
+
+/**
+\def THERON_SSE42
+
+\brief Controls whether SSE4.2 instructions are used to hash strings.
+
+If THERON_SSE42 is defined as 1 then the hash used to look up names and pooled strings
+is computed with the SSE4.2 CRC32 instruction, eight bytes at a time, in preference to a
+portable multiply-and-rotate hash. Both hashes are good enough for the open-addressing tables
+they feed; the instruction is just faster.
+
+This define is defined automatically if not predefined by the user. When automatically
+defined, it is defined as 1 when the compiler targets processors with SSE4.2, as with
+-msse4.2 or -march=native in GCC builds or /arch:AVX in Visual Studio, and 0 otherwise.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+*/
+
+
+#if !defined(THERON_SSE42)
+#if defined(__SSE4_2__) || (THERON_MSVC && defined(__AVX__))
+#define THERON_SSE42 1
+#else
+#define THERON_SSE42 0
+#endif
+#endif
+
+
 /**
 \def BOOST_THREAD_BUILD_LIB
 
@@ -568,6 +685,43 @@ preprocessor settings in Visual Studio.
 #endif
 
 
+/**
+\def THERON_ENABLE_PERF_COUNTERS
+
+\brief Controls sampling of hardware performance counters around message handlers.
+
+If the value of this define is non-zero then each worker thread opens a group of hardware
+performance counters (CPU cycles, retired instructions, last-level cache misses and branch
+misses) via the Linux perf_event_open system call, and samples them around the execution of
+each message handler. The sampled event counts are accumulated into the per-framework
+event counters, and also into 64-bit per-actor-class totals, which are global to the process.
+
+If the kernel forbids the use of performance events (for example because of the value of
+/proc/sys/kernel/perf_event_paranoid, or because the process runs inside a restricted container)
+then the counters are silently disabled and the event counts remain zero. Only user-space events
+are counted.
+
+Sampling the counters costs two system calls per handler invocation, so this is intended
+for profiling builds only. It is only supported on Linux, and has no effect elsewhere.
+The counted values are reported through the framework event counters, so
+\ref THERON_ENABLE_COUNTERS must also be enabled for them to be queryable.
+
+Defaults to 0 (disabled). Define this as 1 to enable hardware performance counters.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+
+\see Theron::Framework::GetCounterValue
+\see Theron::Framework::GetActorCounterValue
+*/
+
+
+#if !defined(THERON_ENABLE_PERF_COUNTERS)
+#define THERON_ENABLE_PERF_COUNTERS 0
+#endif
+
+
 /**
 \def THERON_CACHELINE_ALIGNMENT
 
@@ -598,6 +752,34 @@ that you need to change it.
 #endif
 
 
+/**
+\def THERON_MESSAGE_SLOT_SIZE
+
+\brief Describes the size of the fixed-size memory slots in which small messages are allocated.
+
+Messages sent by actors are usually allocated with the exact size and alignment they need, from a
+per-thread cache that searches its pools for a block of the right size and alignment. Messages small
+enough to fit in a slot, together with Theron's internal message header, are instead allocated from
+a per-thread pool of slots that are all of this size and aligned to \ref THERON_CACHELINE_ALIGNMENT,
+so allocating and freeing them involves no searching. Whether a message type fits is decided at
+compile time from its size and alignment.
+
+By default it is set to 128 bytes, which fits message values of up to about 64 bytes in size.
+Setting it to zero disables the slots, so that all messages are allocated with their exact sizes.
+
+The default definition can be overridden by defining it globally in the build - either
+via the makefile command line options, on the GCC command line using -D, or in the project
+preprocessor settings in Visual Studio.
+
+\note Non-zero values should be multiples of \ref THERON_CACHELINE_ALIGNMENT.
+*/
+
+
+#if !defined(THERON_MESSAGE_SLOT_SIZE)
+#define THERON_MESSAGE_SLOT_SIZE 128
+#endif
+
+
 /**
 \def THERON_NUMA
 
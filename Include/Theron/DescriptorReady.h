@@ -0,0 +1,106 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DESCRIPTORREADY_H
+#define THERON_DESCRIPTORREADY_H
+
+
+/**
+\file DescriptorReady.h
+Readiness notification message for watched file descriptors.
+*/
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief Message sent to an actor when a file descriptor it's watching becomes ready.
+
+Actors can ask the framework to watch file descriptors, such as sockets and pipes, with
+\ref Framework::WatchDescriptor. When a watched descriptor becomes readable or writable,
+a DescriptorReady message is sent to the watching address, which can handle it like any
+other message:
+
+\code
+class Connection : public Theron::Actor
+{
+public:
+
+    Connection(Theron::Framework &framework, const int socket) : Theron::Actor(framework), mSocket(socket)
+    {
+        RegisterHandler(this, &Connection::Handler);
+        GetFramework().WatchDescriptor(GetAddress(), mSocket, Theron::DescriptorReady::READABLE);
+    }
+
+private:
+
+    void Handler(const Theron::DescriptorReady &ready, const Theron::Address from)
+    {
+        char buffer[256];
+        const ssize_t size(recv(mSocket, buffer, sizeof(buffer), 0));
+
+        if (size > 0)
+        {
+            send(mSocket, buffer, size, 0);
+
+            // Watches are one-shot, so the descriptor must be watched again after each event.
+            GetFramework().WatchDescriptor(GetAddress(), mSocket, Theron::DescriptorReady::READABLE);
+        }
+    }
+
+    int mSocket;
+};
+\endcode
+
+Each watch delivers at most one message, after which the descriptor isn't watched again
+until the actor calls WatchDescriptor again, typically at the end of its handler. So an
+actor never has more than one readiness message queued for a given descriptor, and
+there's no race between the actor reading the descriptor and the next event.
+
+\note Readiness is only a hint: by the time the message is handled the descriptor may no
+longer be ready. Watched descriptors should be non-blocking, and handlers should expect
+reads and writes to fail with EAGAIN.
+
+\note If the message types of an application are registered (see \ref THERON_DECLARE_REGISTERED_MESSAGE)
+then DescriptorReady must be registered too, like any other message type.
+*/
+struct DescriptorReady
+{
+    /**
+    \brief Readiness events, combined as bit flags.
+    */
+    enum Event
+    {
+        READABLE = (1 << 0),        ///< The descriptor can be read without blocking.
+        WRITABLE = (1 << 1),        ///< The descriptor can be written without blocking.
+        HANGUP = (1 << 2),          ///< The peer closed the connection. Always reported, whether watched or not.
+        FAILURE = (1 << 3)          ///< An error is pending on the descriptor. Always reported, whether watched or not.
+    };
+
+    /**
+    \brief Constructor.
+    */
+    inline DescriptorReady(
+        const int descriptor = -1,
+        const uint32_t events = 0,
+        const uint32_t tag = 0) :
+      mDescriptor(descriptor),
+      mEvents(events),
+      mTag(tag)
+    {
+    }
+
+    int mDescriptor;        ///< The descriptor that became ready.
+    uint32_t mEvents;       ///< Combination of \ref Event flags that occurred.
+    uint32_t mTag;          ///< User-defined value passed with the watch, for identifying the descriptor.
+};
+
+
+} // namespace Theron
+
+
+#endif // THERON_DESCRIPTORREADY_H
@@ -0,0 +1,306 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_ALLOCATORS_LOCKFREECACHINGALLOCATOR_H
+#define THERON_DETAIL_ALLOCATORS_LOCKFREECACHINGALLOCATOR_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Allocators/LockFreePool.h>
+
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4324)  // structure was padded due to __declspec(align())
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+A thread-safe caching allocator that caches free memory blocks without locking.
+
+Unlike \ref CachingAllocator, which keeps a few pools of blocks of arbitrary sizes behind
+a single lock, the lock-free caching allocator rounds the sizes of small blocks up to a fixed
+set of size classes, and allocates the blocks of each size class from a \ref LockFreePool of
+its own. Threads allocating and freeing blocks of different sizes touch different pools, and
+threads using the same pool never wait on each other, so the cache scales to many threads.
+
+Sizes up to 1KB are rounded up to multiples of 16 bytes, and larger sizes up to 16KB are
+rounded up to powers of two. The blocks of each size class are carved from slabs that its
+pool allocates from the wrapped allocator, and are returned to the pool when freed, so the
+cache never frees a block to the wrapped allocator while another thread may be fetching it.
+The slabs are only freed by \ref Clear, once all their blocks have been freed.
+Larger blocks, and blocks with alignments above the alignment of their size class, which
+is the largest power of two dividing its size, up to 64 bytes, are allocated from the wrapped
+allocator directly, and freed to it.
+
+\note As for \ref CachingAllocator, blocks must be freed with the size they were allocated with,
+or else without a size, in which case they're looked up in the slabs of all the size classes.
+
+\tparam CacheTraits Traits providing an AlignType, used to pad the pool of each size class,
+and SLAB_SIZE, the size in bytes of the first slab allocated by each pool.
+*/
+template <class CacheTraits>
+class LockFreeCachingAllocator : public Theron::IAllocator
+{
+public:
+
+    /**
+    Default constructor.
+    Constructs an uninitialized LockFreeCachingAllocator referencing no lower-level allocator.
+    */
+    inline LockFreeCachingAllocator();
+
+    /**
+    Explicit constructor.
+    Constructs a LockFreeCachingAllocator around an externally owned lower-level allocator.
+    The LockFreeCachingAllocator adds caching of small allocations.
+    \param allocator Pointer to a lower-level allocator which the cache will wrap.
+    */
+    inline explicit LockFreeCachingAllocator(IAllocator *const allocator);
+
+    /**
+    Destructor.
+    */
+    inline virtual ~LockFreeCachingAllocator();
+
+    /**
+    Sets the internal allocator which is wrapped, or cached, by the caching allocator.
+    \note This should only be called at start-of-day before any calls to Allocate.
+    */
+    inline void SetAllocator(IAllocator *const allocator);
+
+    /**
+    Gets the internal allocator which is wrapped, or cached, by the caching allocator.
+    */
+    inline IAllocator *GetAllocator() const;
+
+    /**
+    Allocates a memory block of the given size.
+    */
+    inline virtual void *Allocate(const uint32_t size);
+
+    /**
+    Allocates a memory block of the given size and alignment.
+    */
+    inline virtual void *AllocateAligned(const uint32_t size, const uint32_t alignment);
+
+    /**
+    Frees a previously allocated memory block.
+    */
+    inline virtual void Free(void *const block);
+
+    /**
+    Frees a previously allocated memory block of a known size.
+    */
+    inline virtual void Free(void *const block, const uint32_t size);
+
+    /**
+    Frees the slabs of the size classes whose blocks have all been freed.
+    \note This should only be called when no other threads are using the cache.
+    */
+    inline void Clear();
+
+private:
+
+    static const uint32_t NUM_SMALL_CLASSES = 64;   ///< Number of size classes of 16-byte granularity, up to 1KB.
+    static const uint32_t NUM_CLASSES = 68;         ///< Total number of size classes, including powers of two up to 16KB.
+    static const uint32_t MAX_CACHED_SIZE = 16384;  ///< Size of the largest size class.
+
+    class Entry
+    {
+    public:
+
+        typedef Detail::LockFreePool<CacheTraits::SLAB_SIZE> PoolType;
+
+        typename CacheTraits::AlignType mAlign;
+        PoolType mPool;
+    };
+
+    LockFreeCachingAllocator(const LockFreeCachingAllocator &other);
+    LockFreeCachingAllocator &operator=(const LockFreeCachingAllocator &other);
+
+    inline void Initialize();
+
+    inline static uint32_t SizeClass(const uint32_t size);
+    inline static uint32_t ClassSize(const uint32_t sizeClass);
+
+    IAllocator *mAllocator;                         ///< Pointer to a wrapped low-level allocator.
+    Entry mEntries[NUM_CLASSES];                    ///< Pools of memory blocks of each size class.
+};
+
+
+template <class CacheTraits>
+THERON_FORCEINLINE LockFreeCachingAllocator<CacheTraits>::LockFreeCachingAllocator() : mAllocator(0)
+{
+    Initialize();
+}
+
+
+template <class CacheTraits>
+THERON_FORCEINLINE LockFreeCachingAllocator<CacheTraits>::LockFreeCachingAllocator(IAllocator *const allocator) : mAllocator(allocator)
+{
+    Initialize();
+}
+
+
+template <class CacheTraits>
+THERON_FORCEINLINE LockFreeCachingAllocator<CacheTraits>::~LockFreeCachingAllocator()
+{
+    Clear();
+}
+
+
+template <class CacheTraits>
+inline void LockFreeCachingAllocator<CacheTraits>::SetAllocator(IAllocator *const allocator)
+{
+    mAllocator = allocator;
+}
+
+
+template <class CacheTraits>
+inline IAllocator *LockFreeCachingAllocator<CacheTraits>::GetAllocator() const
+{
+    return mAllocator;
+}
+
+
+template <class CacheTraits>
+inline void *LockFreeCachingAllocator<CacheTraits>::Allocate(const uint32_t size)
+{
+    // Assume word-size alignment by default.
+    return AllocateAligned(size, sizeof(void *));
+}
+
+
+template <class CacheTraits>
+inline void *LockFreeCachingAllocator<CacheTraits>::AllocateAligned(const uint32_t size, const uint32_t alignment)
+{
+    // Alignment values are expected to be powers of two and at least 4 bytes.
+    THERON_ASSERT(alignment >= 4);
+    THERON_ASSERT((alignment & (alignment - 1)) == 0);
+
+    if (size <= MAX_CACHED_SIZE)
+    {
+        typename Entry::PoolType &pool(mEntries[SizeClass(size)].mPool);
+        if (alignment <= pool.GetBlockAlignment())
+        {
+            return pool.Allocate(mAllocator);
+        }
+    }
+
+    // Large blocks, and blocks more aligned than the blocks of their size class, aren't cached.
+    return mAllocator->AllocateAligned(size, alignment);
+}
+
+
+template <class CacheTraits>
+inline void LockFreeCachingAllocator<CacheTraits>::Free(void *const block)
+{
+    THERON_ASSERT(block);
+
+    // Search the slabs of all the size classes for the block, which is slow but rare.
+    for (uint32_t sizeClass = 0; sizeClass < NUM_CLASSES; ++sizeClass)
+    {
+        if (mEntries[sizeClass].mPool.Free(block))
+        {
+            return;
+        }
+    }
+
+    mAllocator->Free(block);
+}
+
+
+template <class CacheTraits>
+inline void LockFreeCachingAllocator<CacheTraits>::Free(void *const block, const uint32_t size)
+{
+    THERON_ASSERT(block);
+
+    // Blocks that aren't from the slabs of their size class were allocated directly.
+    if (size > MAX_CACHED_SIZE || !mEntries[SizeClass(size)].mPool.Free(block))
+    {
+        mAllocator->Free(block, size);
+    }
+}
+
+
+template <class CacheTraits>
+inline void LockFreeCachingAllocator<CacheTraits>::Clear()
+{
+    // Slabs with blocks that are still allocated are kept, so the blocks stay valid.
+    for (uint32_t sizeClass = 0; sizeClass < NUM_CLASSES; ++sizeClass)
+    {
+        mEntries[sizeClass].mPool.Clear(mAllocator);
+    }
+}
+
+
+template <class CacheTraits>
+inline void LockFreeCachingAllocator<CacheTraits>::Initialize()
+{
+    for (uint32_t sizeClass = 0; sizeClass < NUM_CLASSES; ++sizeClass)
+    {
+        mEntries[sizeClass].mPool.Initialize(ClassSize(sizeClass));
+    }
+}
+
+
+template <class CacheTraits>
+THERON_FORCEINLINE uint32_t LockFreeCachingAllocator<CacheTraits>::SizeClass(const uint32_t size)
+{
+    THERON_ASSERT(size <= MAX_CACHED_SIZE);
+
+    // Small sizes are rounded up to multiples of 16 bytes, including zero.
+    if (size <= NUM_SMALL_CLASSES * 16)
+    {
+        return (size > 16 ? (size - 1) / 16 : 0);
+    }
+
+    // Larger sizes are rounded up to powers of two.
+    uint32_t sizeClass(NUM_SMALL_CLASSES);
+    uint32_t classSize(NUM_SMALL_CLASSES * 32);
+
+    while (classSize < size)
+    {
+        classSize <<= 1;
+        ++sizeClass;
+    }
+
+    THERON_ASSERT(sizeClass < NUM_CLASSES);
+    return sizeClass;
+}
+
+
+template <class CacheTraits>
+THERON_FORCEINLINE uint32_t LockFreeCachingAllocator<CacheTraits>::ClassSize(const uint32_t sizeClass)
+{
+    THERON_ASSERT(sizeClass < NUM_CLASSES);
+
+    if (sizeClass < NUM_SMALL_CLASSES)
+    {
+        return (sizeClass + 1) * 16;
+    }
+
+    return (NUM_SMALL_CLASSES * 32) << (sizeClass - NUM_SMALL_CLASSES);
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
+
+
+#endif // THERON_DETAIL_ALLOCATORS_LOCKFREECACHINGALLOCATOR_H
@@ -0,0 +1,397 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_ALLOCATORS_LOCKFREEPOOL_H
+#define THERON_DETAIL_ALLOCATORS_LOCKFREEPOOL_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Lock.h>
+#include <Theron/Detail/Threading/Mutex.h>
+
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4324)  // structure was padded due to __declspec(align())
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+A thread-safe pool of memory blocks of a single size, which can be used concurrently without locking.
+
+The blocks are carved from slabs of memory which the pool allocates from a lower-level allocator,
+and which it owns until it's cleared, so a block is never returned to the lower-level allocator
+while another thread may be fetching it. Free blocks are held in a lock-free stack, and blocks
+that have never been used are carved from the newest slab by bumping an offset, so memory is
+only touched as it's needed. The first slab is SLAB_SIZE bytes, and each slab is twice the size
+of the last, up to 64MB, so the number of slabs stays small however many blocks are in use.
+
+Blocks are identified by 32-bit indices, made of the number of their slab and their offset
+within it, rather than by their addresses. The head of the stack packs the index of the top
+block together with a 32-bit tag that's incremented by every change to the stack, and is
+replaced with a 64-bit compare-and-exchange, so a thread that's preempted in the middle of
+a fetch can't be fooled by the same block being fetched and added back in the meantime (the
+'ABA' problem), whatever the width of the addresses used by the platform.
+
+\note The block size must be a multiple of 16 bytes. Blocks are aligned to the largest power of
+two dividing the block size, up to 64 bytes.
+\note A fetch may read the link stored in a block that another thread has fetched concurrently,
+before discovering the stack has changed and retrying. That's safe because the slab holding the
+block stays allocated until the pool is cleared, which mustn't be done while it's in use.
+
+\tparam SLAB_SIZE The size in bytes of the first slab.
+*/
+template <uint32_t SLAB_SIZE>
+class LockFreePool
+{
+public:
+
+    /**
+    Default constructor.
+    Constructs a pool with no block size, which must be initialized before it's used.
+    \note The slabs of the pool aren't freed on destruction, only by \ref Clear.
+    */
+    inline LockFreePool();
+
+    /**
+    Sets the size of the blocks held by the pool.
+    \note This should only be called at start-of-day before any blocks are allocated.
+    */
+    inline void Initialize(const uint32_t blockSize);
+
+    /**
+    Gets the size of the blocks held by the pool.
+    */
+    inline uint32_t GetBlockSize() const;
+
+    /**
+    Gets the alignment of the blocks held by the pool.
+    */
+    inline uint32_t GetBlockAlignment() const;
+
+    /**
+    Allocates a block, carving a new slab from the given allocator if the pool has no free blocks.
+    \return Zero if a new slab couldn't be allocated.
+    */
+    inline void *Allocate(IAllocator *const allocator);
+
+    /**
+    Returns a block to the pool, if it was allocated from the pool.
+    \return False if the block isn't from the slabs of the pool, in which case it's ignored.
+    */
+    inline bool Free(void *const block);
+
+    /**
+    Frees the slabs of the pool to the given allocator, if all their blocks have been freed.
+    \return False if any blocks are still allocated, in which case the slabs are kept.
+    \note This should only be called when no other threads are using the pool.
+    */
+    inline bool Clear(IAllocator *const allocator);
+
+private:
+
+    static const uint32_t GRANULE_SIZE = 16;            ///< Units in which offsets within slabs are counted.
+    static const uint32_t OFFSET_BITS = 24;             ///< Number of low bits of an index holding the offset in granules.
+    static const uint32_t OFFSET_MASK = (1U << OFFSET_BITS) - 1;
+    static const uint32_t MAX_SLABS = 32;               ///< Maximum number of slabs of each pool.
+    static const uint32_t MAX_SLAB_SIZE = 64 * 1024 * 1024;    ///< Size in bytes beyond which slabs stop growing.
+    static const uint32_t MAX_ALIGNMENT = 64;           ///< Alignment of the slabs, and so the largest alignment of the blocks.
+
+    /**
+    A node representing a free memory block within the pool.
+    Nodes are created in-place within the free blocks they represent.
+    */
+    struct Node
+    {
+        uint32_t mNext;                                 ///< Index of the next node in the stack, or zero.
+    };
+
+    LockFreePool(const LockFreePool &other);
+    LockFreePool &operator=(const LockFreePool &other);
+
+    /**
+    Gets the size in bytes of the slab with the given number.
+    */
+    inline uint32_t SlabSize(const uint32_t slab) const;
+
+    /**
+    Gets the address of the block with the given index, which is the index of the top of
+    the stack or of the next block to be carved, and so refers to a published slab.
+    */
+    inline Node *GetNode(const uint32_t index) const;
+
+    /**
+    Carves a block that's never been used from the newest slab, allocating a new slab if it's full.
+    */
+    inline void *Carve(IAllocator *const allocator);
+
+    /**
+    Allocates the slab after the given number of slabs, unless another thread has already done so.
+    */
+    inline bool Grow(IAllocator *const allocator, const uint32_t count);
+
+    Atomic::UInt64 mHead;                               ///< Tag of the stack in the high word and index of the top node in the low word.
+    Atomic::UInt32 mCursor;                             ///< Number of slabs in the high bits and offset of the next block to carve in the low bits.
+    uint32_t mBlockSize;                                ///< Size of each block in bytes.
+    Mutex mGrowMutex;                                   ///< Serializes the allocation of new slabs.
+    char *mSlabs[MAX_SLABS];                            ///< Slabs from which the blocks are carved.
+};
+
+
+template <uint32_t SLAB_SIZE>
+inline LockFreePool<SLAB_SIZE>::LockFreePool() :
+  mHead(0),
+  mCursor(0),
+  mBlockSize(0),
+  mGrowMutex()
+{
+    for (uint32_t slab = 0; slab < MAX_SLABS; ++slab)
+    {
+        mSlabs[slab] = 0;
+    }
+}
+
+
+template <uint32_t SLAB_SIZE>
+inline void LockFreePool<SLAB_SIZE>::Initialize(const uint32_t blockSize)
+{
+    THERON_ASSERT(blockSize > 0 && blockSize % GRANULE_SIZE == 0);
+    THERON_ASSERT(mCursor.LoadRelaxed() == 0);
+
+    mBlockSize = blockSize;
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE uint32_t LockFreePool<SLAB_SIZE>::GetBlockSize() const
+{
+    return mBlockSize;
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE uint32_t LockFreePool<SLAB_SIZE>::GetBlockAlignment() const
+{
+    // Blocks are at multiples of the block size from the starts of their slabs.
+    const uint32_t alignment(mBlockSize & (0 - mBlockSize));
+    return (alignment < MAX_ALIGNMENT ? alignment : MAX_ALIGNMENT);
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE void *LockFreePool<SLAB_SIZE>::Allocate(IAllocator *const allocator)
+{
+    uint64_t head(mHead.LoadAcquire());
+    while (true)
+    {
+        const uint32_t index(static_cast<uint32_t>(head));
+        if (index == 0)
+        {
+            return Carve(allocator);
+        }
+
+        // The node may have been fetched by another thread since we read the head, in
+        // which case the link read here is garbage, but the tag makes the exchange fail.
+        Node *const top(GetNode(index));
+        const uint64_t tag((head >> 32) + 1);
+
+        if (mHead.CompareExchange(head, (tag << 32) | top->mNext))
+        {
+            return top;
+        }
+    }
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE bool LockFreePool<SLAB_SIZE>::Free(void *const block)
+{
+    THERON_ASSERT(block);
+
+    // Search the slabs from the newest, which is the largest, for the one holding the block.
+    const char *const address(reinterpret_cast<const char *>(block));
+    uint32_t slab(mCursor.LoadAcquire() >> OFFSET_BITS);
+
+    while (slab--)
+    {
+        const char *const start(mSlabs[slab]);
+        if (address < start || address >= start + SlabSize(slab))
+        {
+            continue;
+        }
+
+        const uint32_t offset(static_cast<uint32_t>(address - start) / GRANULE_SIZE);
+        const uint32_t index(((slab + 1) << OFFSET_BITS) | offset);
+
+        // The node is private to this thread until the exchange publishes it.
+        Node *const node(reinterpret_cast<Node *>(block));
+        uint64_t head(mHead.LoadAcquire());
+
+        while (true)
+        {
+            const uint64_t tag((head >> 32) + 1);
+            node->mNext = static_cast<uint32_t>(head);
+
+            if (mHead.CompareExchange(head, (tag << 32) | index))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+template <uint32_t SLAB_SIZE>
+inline bool LockFreePool<SLAB_SIZE>::Clear(IAllocator *const allocator)
+{
+    const uint32_t cursor(mCursor.LoadAcquire());
+    const uint32_t count(cursor >> OFFSET_BITS);
+
+    if (count == 0)
+    {
+        return true;
+    }
+
+    // Each slab but the newest was filled before the next was allocated.
+    uint64_t carved((cursor & OFFSET_MASK) * GRANULE_SIZE / mBlockSize);
+    for (uint32_t slab = 0; slab + 1 < count; ++slab)
+    {
+        carved += SlabSize(slab) / mBlockSize;
+    }
+
+    uint64_t freed(0);
+    uint32_t index(static_cast<uint32_t>(mHead.LoadAcquire()));
+
+    while (index)
+    {
+        ++freed;
+        index = GetNode(index)->mNext;
+    }
+
+    // Blocks that are still allocated would be invalidated by freeing their slabs.
+    if (freed != carved)
+    {
+        return false;
+    }
+
+    for (uint32_t slab = 0; slab < count; ++slab)
+    {
+        allocator->Free(mSlabs[slab], SlabSize(slab));
+        mSlabs[slab] = 0;
+    }
+
+    mHead.ExchangeRelaxed(0);
+    mCursor.StoreRelease(0);
+
+    return true;
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE uint32_t LockFreePool<SLAB_SIZE>::SlabSize(const uint32_t slab) const
+{
+    // Slabs hold at least one block, and are otherwise a whole number of blocks.
+    const uint64_t size(static_cast<uint64_t>(SLAB_SIZE) << slab);
+    const uint64_t capped(size < MAX_SLAB_SIZE ? size : MAX_SLAB_SIZE);
+
+    return (capped > mBlockSize ? static_cast<uint32_t>(capped - capped % mBlockSize) : mBlockSize);
+}
+
+
+template <uint32_t SLAB_SIZE>
+THERON_FORCEINLINE typename LockFreePool<SLAB_SIZE>::Node *LockFreePool<SLAB_SIZE>::GetNode(const uint32_t index) const
+{
+    const uint32_t slab((index >> OFFSET_BITS) - 1);
+    const uint32_t offset(index & OFFSET_MASK);
+
+    THERON_ASSERT(slab < MAX_SLABS && mSlabs[slab]);
+    return reinterpret_cast<Node *>(mSlabs[slab] + offset * GRANULE_SIZE);
+}
+
+
+template <uint32_t SLAB_SIZE>
+inline void *LockFreePool<SLAB_SIZE>::Carve(IAllocator *const allocator)
+{
+    THERON_ASSERT(mBlockSize);
+
+    const uint32_t granules(mBlockSize / GRANULE_SIZE);
+    uint32_t cursor(mCursor.LoadAcquire());
+
+    while (true)
+    {
+        const uint32_t count(cursor >> OFFSET_BITS);
+        const uint32_t offset(cursor & OFFSET_MASK);
+
+        // The cursor is the index of the next block to carve, if it fits in the newest slab.
+        if (count && (offset + granules) * GRANULE_SIZE <= SlabSize(count - 1))
+        {
+            if (mCursor.CompareExchangeAcquire(cursor, cursor + granules))
+            {
+                return GetNode(cursor);
+            }
+
+            continue;
+        }
+
+        if (!Grow(allocator, count))
+        {
+            return 0;
+        }
+
+        cursor = mCursor.LoadAcquire();
+    }
+}
+
+
+template <uint32_t SLAB_SIZE>
+inline bool LockFreePool<SLAB_SIZE>::Grow(IAllocator *const allocator, const uint32_t count)
+{
+    Lock lock(mGrowMutex);
+
+    // Another thread may have added the slab while we waited for the lock.
+    if ((mCursor.LoadRelaxed() >> OFFSET_BITS) != count)
+    {
+        return true;
+    }
+
+    if (count == MAX_SLABS)
+    {
+        return false;
+    }
+
+    void *const slab(allocator->AllocateAligned(SlabSize(count), MAX_ALIGNMENT));
+    if (slab == 0)
+    {
+        return false;
+    }
+
+    // The slab is published by the cursor, which points at its first block.
+    mSlabs[count] = reinterpret_cast<char *>(slab);
+    mCursor.StoreRelease((count + 1) << OFFSET_BITS);
+
+    return true;
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
+
+
+#endif // THERON_DETAIL_ALLOCATORS_LOCKFREEPOOL_H
@@ -0,0 +1,243 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_ALLOCATORS_SCRATCHARENA_H
+#define THERON_DETAIL_ALLOCATORS_SCRATCHARENA_H
+
+
+#include <Theron/Align.h>
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Bump allocator for short-lived scratch memory, owned by a single worker thread.
+
+Allocations are carved from the current chunk by bumping a pointer, and frees are ignored.
+All the memory is reclaimed at once by \ref Reset, which the worker thread calls after each
+message is handled. When a chunk fills up, a chunk of twice the size is allocated, and on reset
+only the most recent, largest chunk is kept, so the arena settles on a single chunk big enough
+for the hungriest handler and then stops calling the global allocator altogether.
+
+\note The arena isn't thread-safe; it's only used by the worker thread that owns it.
+*/
+class ScratchArena : public IAllocator
+{
+public:
+
+    /**
+    Default constructor. No memory is allocated until the arena is first used.
+    */
+    inline ScratchArena();
+
+    /**
+    Destructor. Frees all the chunks.
+    */
+    inline virtual ~ScratchArena();
+
+    /**
+    Allocates memory aligned to the size of a pointer.
+    */
+    inline virtual void *Allocate(const SizeType size);
+
+    /**
+    Allocates memory aligned to the given power-of-two alignment.
+    */
+    inline virtual void *AllocateAligned(const SizeType size, const SizeType alignment);
+
+    /**
+    Ignored. Scratch memory is reclaimed all at once, by \ref Reset.
+    */
+    inline virtual void Free(void *const memory);
+
+    /**
+    Ignored. Scratch memory is reclaimed all at once, by \ref Reset.
+    */
+    inline virtual void Free(void *const memory, const SizeType size);
+
+    /**
+    Reclaims all the memory allocated since the last reset, invalidating it.
+    */
+    inline void Reset();
+
+private:
+
+    static const uint32_t MIN_CHUNK_SIZE = 16384;   ///< Size of the first chunk allocated, in bytes.
+    static const uint32_t MAX_CHUNK_SIZE = 0xFFFFFFFF;  ///< Largest chunk size that can be recorded, in bytes.
+
+    /**
+    Header at the start of each chunk.
+    */
+    struct Chunk
+    {
+        Chunk *mNext;                               ///< Next older chunk, if any.
+        uint32_t mSize;                             ///< Size of the chunk in bytes, including the header.
+    };
+
+    ScratchArena(const ScratchArena &other);
+    ScratchArena &operator=(const ScratchArena &other);
+
+    /**
+    Allocates a new current chunk big enough for the given allocation, and allocates from it.
+    */
+    void *AllocateChunk(const SizeType size, const SizeType alignment);
+
+    /**
+    Points the bump pointer at the start of the given chunk.
+    */
+    inline void Rewind(Chunk *const chunk);
+
+    Chunk *mChunks;                                 ///< Current chunk, linked to older chunks, if any.
+    char *mNext;                                    ///< Next free byte in the current chunk.
+    char *mEnd;                                     ///< End of the current chunk.
+};
+
+
+inline ScratchArena::ScratchArena() :
+  mChunks(0),
+  mNext(0),
+  mEnd(0)
+{
+}
+
+
+inline ScratchArena::~ScratchArena()
+{
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    while (mChunks)
+    {
+        Chunk *const chunk(mChunks);
+        mChunks = chunk->mNext;
+
+        allocator->Free(chunk, chunk->mSize);
+    }
+}
+
+
+THERON_FORCEINLINE void *ScratchArena::Allocate(const SizeType size)
+{
+    return AllocateAligned(size, sizeof(void *));
+}
+
+
+THERON_FORCEINLINE void *ScratchArena::AllocateAligned(const SizeType size, const SizeType alignment)
+{
+    THERON_ASSERT((alignment & (alignment - 1)) == 0);
+
+    char *block(mNext);
+    THERON_ALIGN(block, alignment);
+
+    if (mNext && block <= mEnd && size <= static_cast<SizeType>(mEnd - block))
+    {
+        mNext = block + size;
+        return block;
+    }
+
+    return AllocateChunk(size, alignment);
+}
+
+
+THERON_FORCEINLINE void ScratchArena::Free(void *const /*memory*/)
+{
+}
+
+
+THERON_FORCEINLINE void ScratchArena::Free(void *const /*memory*/, const SizeType /*size*/)
+{
+}
+
+
+THERON_FORCEINLINE void ScratchArena::Reset()
+{
+    Chunk *const chunk(mChunks);
+    if (chunk == 0)
+    {
+        return;
+    }
+
+    // Keep only the current chunk, which is the largest, once the arena has grown.
+    if (chunk->mNext)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+
+        Chunk *older(chunk->mNext);
+        while (older)
+        {
+            Chunk *const next(older->mNext);
+            allocator->Free(older, older->mSize);
+            older = next;
+        }
+
+        chunk->mNext = 0;
+    }
+
+    Rewind(chunk);
+}
+
+
+inline void *ScratchArena::AllocateChunk(const SizeType size, const SizeType alignment)
+{
+    // Double the size of the previous chunk, or more if the allocation wouldn't fit.
+    // The sizes are computed in 64 bits so that doubling a large chunk can't wrap to zero.
+    const uint64_t required(static_cast<uint64_t>(sizeof(Chunk)) + alignment + size);
+    uint64_t chunkSize(mChunks ? static_cast<uint64_t>(mChunks->mSize) * 2 : MIN_CHUNK_SIZE);
+    while (chunkSize < required)
+    {
+        chunkSize *= 2;
+    }
+
+    // Beyond the largest size a chunk can record, allocate just what's required, if that fits.
+    if (chunkSize > MAX_CHUNK_SIZE)
+    {
+        if (required > MAX_CHUNK_SIZE)
+        {
+            return 0;
+        }
+
+        chunkSize = required;
+    }
+
+    void *const memory(AllocatorManager::GetCache()->AllocateAligned(
+        static_cast<SizeType>(chunkSize),
+        THERON_CACHELINE_ALIGNMENT));
+    if (memory == 0)
+    {
+        return 0;
+    }
+
+    Chunk *const chunk(reinterpret_cast<Chunk *>(memory));
+    chunk->mNext = mChunks;
+    chunk->mSize = static_cast<uint32_t>(chunkSize);
+
+    mChunks = chunk;
+    Rewind(chunk);
+
+    char *block(mNext);
+    THERON_ALIGN(block, alignment);
+    THERON_ASSERT(block + size <= mEnd);
+
+    mNext = block + size;
+    return block;
+}
+
+
+THERON_FORCEINLINE void ScratchArena::Rewind(Chunk *const chunk)
+{
+    mNext = reinterpret_cast<char *>(chunk) + sizeof(Chunk);
+    mEnd = reinterpret_cast<char *>(chunk) + chunk->mSize;
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_ALLOCATORS_SCRATCHARENA_H
@@ -0,0 +1,155 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_ALLOCATORS_SLOTPOOL_H
+#define THERON_DETAIL_ALLOCATORS_SLOTPOOL_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+A pool of memory slots of a single fixed size and alignment, for use by a single thread.
+
+Unlike \ref CachingAllocator, which keeps pools of blocks of several sizes and searches
+them for one of the requested size and alignment, the slot pool only ever holds slots of
+one size, all allocated with the same alignment. So allocating a slot is just popping the
+top of a free list, and freeing one is just pushing it, with no searching at all.
+
+Slots are allocated from the wrapped allocator when the pool is empty, and freed to it when
+the pool is full, with the slot size.
+
+\note The pool isn't thread-safe, so is only used by one thread at a time.
+\note Slots must be at least the size of a pointer, and aligned at least to the alignment of one.
+
+\tparam SLOT_SIZE The size in bytes of every slot.
+\tparam SLOT_ALIGNMENT The alignment in bytes of every slot.
+\tparam MAX_SLOTS The maximum number of free slots held by the pool.
+*/
+template <uint32_t SLOT_SIZE, uint32_t SLOT_ALIGNMENT, uint32_t MAX_SLOTS>
+class SlotPool
+{
+public:
+
+    static const uint32_t SIZE = SLOT_SIZE;             ///< The size in bytes of every slot.
+    static const uint32_t ALIGNMENT = SLOT_ALIGNMENT;   ///< The alignment in bytes of every slot.
+
+    /**
+    Default constructor.
+    Constructs a pool referencing no lower-level allocator.
+    */
+    inline SlotPool() :
+      mAllocator(0),
+      mHead(0),
+      mCount(0)
+    {
+    }
+
+    /**
+    Destructor.
+    */
+    inline ~SlotPool()
+    {
+        Clear();
+    }
+
+    /**
+    Sets the allocator from which slots are allocated, and to which they're freed.
+    \note This should only be called at start-of-day before any calls to Allocate.
+    */
+    inline void SetAllocator(IAllocator *const allocator)
+    {
+        mAllocator = allocator;
+    }
+
+    /**
+    Gets the allocator from which slots are allocated.
+    */
+    inline IAllocator *GetAllocator() const
+    {
+        return mAllocator;
+    }
+
+    /**
+    Allocates a slot, taking a free one from the pool if any.
+    */
+    THERON_FORCEINLINE void *Allocate()
+    {
+        if (Node *const node = mHead)
+        {
+            mHead = node->mNext;
+            --mCount;
+            return node;
+        }
+
+        THERON_ASSERT(mAllocator);
+        return mAllocator->AllocateAligned(SLOT_SIZE, SLOT_ALIGNMENT);
+    }
+
+    /**
+    Frees a slot, keeping it in the pool unless the pool is full.
+    \note Slots needn't have been allocated by this pool, but must have the slot size and alignment.
+    */
+    THERON_FORCEINLINE void Free(void *const slot)
+    {
+        THERON_ASSERT(slot);
+        THERON_ASSERT(THERON_ALIGNED(slot, SLOT_ALIGNMENT));
+
+        if (mCount < MAX_SLOTS)
+        {
+            Node *const node(reinterpret_cast<Node *>(slot));
+            node->mNext = mHead;
+            mHead = node;
+            ++mCount;
+            return;
+        }
+
+        mAllocator->Free(slot, SLOT_SIZE);
+    }
+
+    /**
+    Frees all the free slots held by the pool.
+    */
+    inline void Clear()
+    {
+        while (Node *const node = mHead)
+        {
+            mHead = node->mNext;
+            mAllocator->Free(node, SLOT_SIZE);
+        }
+
+        mCount = 0;
+    }
+
+private:
+
+    /**
+    A node representing a free slot, created in-place within the slot.
+    */
+    struct Node
+    {
+        Node *mNext;                                    ///< Pointer to the next free slot.
+    };
+
+    SlotPool(const SlotPool &other);
+    SlotPool &operator=(const SlotPool &other);
+
+    IAllocator *mAllocator;                             ///< Allocator from which slots are allocated.
+    Node *mHead;                                        ///< Top of the list of free slots.
+    uint32_t mCount;                                    ///< Number of free slots in the list.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_ALLOCATORS_SLOTPOOL_H
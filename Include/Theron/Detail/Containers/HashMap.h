@@ -0,0 +1,439 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_CONTAINERS_HASHMAP_H
+#define THERON_DETAIL_CONTAINERS_HASHMAP_H
+
+
+#include <new>
+
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Resizable open-addressing hash map, mapping unique keys to values.
+
+Entries are stored inline in a power-of-two table of slots, probed linearly from the slot
+given by the hash of the key. Each slot caches the full 32-bit hash of its key, so probes
+compare keys only when the hashes match. The table doubles in size when it becomes three
+quarters full, and removals shift later entries back rather than leaving tombstones, so
+lookups stay short however many keys have come and gone.
+
+The hash type provides a static Compute function returning a 32-bit hash of a key, and a
+static Equal function comparing two keys. The table is allocated with the global allocator.
+\note The map isn't thread-safe; users protect it with their own locks.
+*/
+template <class KeyType, class ValueType, class HashType>
+class HashMap
+{
+private:
+
+    struct Slot
+    {
+        uint32_t mHash;             ///< Hash of the key, or zero if the slot is empty.
+        KeyType mKey;               ///< Key of the entry in the slot.
+        ValueType mValue;           ///< Value of the entry in the slot.
+    };
+
+public:
+
+    /**
+    Iterates the entries of the map, in no particular order.
+    \note The map mustn't be changed while it's being iterated.
+    */
+    class Iterator
+    {
+    public:
+
+        friend class HashMap;
+
+        /**
+        Moves to the next entry, returning false if there are no more.
+        \note This method must be called once before calling \ref GetKey or \ref GetValue.
+        */
+        THERON_FORCEINLINE bool Next()
+        {
+            while (++mIndex < mCapacity)
+            {
+                if (mSlots[mIndex].mHash != 0)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        THERON_FORCEINLINE const KeyType &GetKey() const
+        {
+            return mSlots[mIndex].mKey;
+        }
+
+        THERON_FORCEINLINE const ValueType &GetValue() const
+        {
+            return mSlots[mIndex].mValue;
+        }
+
+    private:
+
+        THERON_FORCEINLINE Iterator(const Slot *const slots, const uint32_t capacity) :
+          mSlots(slots),
+          mCapacity(capacity),
+          mIndex(static_cast<uint32_t>(-1))
+        {
+        }
+
+        const Slot *mSlots;
+        uint32_t mCapacity;
+        uint32_t mIndex;
+    };
+
+    /**
+    Default constructor. The table isn't allocated until the first insert.
+    */
+    inline HashMap();
+
+    /**
+    Destructor.
+    */
+    inline ~HashMap();
+
+    /**
+    Inserts an entry with the given key and value, if there isn't one with the key already.
+    \return True, if the entry was inserted; false if the key was present or the table couldn't grow.
+    */
+    inline bool Insert(const KeyType &key, const ValueType &value);
+
+    /**
+    Removes the entry with the given key, if there is one.
+    \return True, if an entry was removed.
+    */
+    inline bool Remove(const KeyType &key);
+
+    /**
+    Removes all the entries, keeping the table for reuse.
+    */
+    inline void Clear();
+
+    /**
+    Returns a pointer to the value of the entry with the given key, or null if there's none.
+    */
+    inline ValueType *Find(const KeyType &key);
+
+    /**
+    Returns a pointer to the value of the entry with the given key, or null if there's none.
+    */
+    inline const ValueType *Find(const KeyType &key) const;
+
+    /**
+    Returns true if the map contains an entry with the given key.
+    */
+    inline bool Contains(const KeyType &key) const;
+
+    /**
+    Returns the number of entries in the map.
+    */
+    inline uint32_t Count() const;
+
+    /**
+    Returns an iterator enumerating the entries of the map.
+    */
+    inline Iterator GetIterator() const;
+
+private:
+
+    static const uint32_t MIN_CAPACITY = 16;
+
+    HashMap(const HashMap &other);
+    HashMap &operator=(const HashMap &other);
+
+    /**
+    Returns the hash of a key, which is never zero since that marks empty slots.
+    */
+    THERON_FORCEINLINE static uint32_t Hash(const KeyType &key)
+    {
+        const uint32_t hash(HashType::Compute(key));
+        return hash ? hash : 1;
+    }
+
+    /**
+    Returns the index of the slot holding the entry with the given key, or the capacity if there's none.
+    */
+    inline uint32_t Search(const KeyType &key, const uint32_t hash) const;
+
+    /**
+    Moves the entries to a new table with the given number of slots.
+    */
+    inline bool Resize(const uint32_t capacity);
+
+    Slot *mSlots;                   ///< Table of slots, or null until the first insert.
+    uint32_t mCapacity;             ///< Number of slots in the table; a power of two.
+    uint32_t mCount;                ///< Number of occupied slots.
+};
+
+
+template <class KeyType, class ValueType, class HashType>
+inline HashMap<KeyType, ValueType, HashType>::HashMap() :
+  mSlots(0),
+  mCapacity(0),
+  mCount(0)
+{
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+inline HashMap<KeyType, ValueType, HashType>::~HashMap()
+{
+    if (mSlots)
+    {
+        for (uint32_t index = 0; index < mCapacity; ++index)
+        {
+            Slot &slot(mSlots[index]);
+            if (slot.mHash != 0)
+            {
+                slot.mKey.~KeyType();
+                slot.mValue.~ValueType();
+            }
+        }
+
+        AllocatorManager::GetCache()->Free(mSlots, mCapacity * sizeof(Slot));
+    }
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+inline bool HashMap<KeyType, ValueType, HashType>::Insert(const KeyType &key, const ValueType &value)
+{
+    const uint32_t hash(Hash(key));
+    if (Search(key, hash) != mCapacity)
+    {
+        return false;
+    }
+
+    // Keep the table at most three quarters full, so probe sequences stay short.
+    if ((mCount + 1) * 4 > mCapacity * 3)
+    {
+        if (!Resize(mCapacity ? mCapacity * 2 : MIN_CAPACITY))
+        {
+            return false;
+        }
+    }
+
+    const uint32_t mask(mCapacity - 1);
+    uint32_t index(hash & mask);
+
+    while (mSlots[index].mHash != 0)
+    {
+        index = (index + 1) & mask;
+    }
+
+    Slot &slot(mSlots[index]);
+    slot.mHash = hash;
+    new (&slot.mKey) KeyType(key);
+    new (&slot.mValue) ValueType(value);
+
+    ++mCount;
+    return true;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+inline bool HashMap<KeyType, ValueType, HashType>::Remove(const KeyType &key)
+{
+    uint32_t index(Search(key, Hash(key)));
+    if (index == mCapacity)
+    {
+        return false;
+    }
+
+    mSlots[index].mKey.~KeyType();
+    mSlots[index].mValue.~ValueType();
+
+    // Shift back later entries of the probe sequence that the removal would otherwise cut off
+    // from their home slots. An entry can fill the hole if its home isn't between the two.
+    const uint32_t mask(mCapacity - 1);
+    uint32_t next(index);
+
+    while (true)
+    {
+        next = (next + 1) & mask;
+
+        Slot &slot(mSlots[next]);
+        if (slot.mHash == 0)
+        {
+            break;
+        }
+
+        const uint32_t home(slot.mHash & mask);
+        if (((next - home) & mask) >= ((next - index) & mask))
+        {
+            Slot &hole(mSlots[index]);
+            hole.mHash = slot.mHash;
+            new (&hole.mKey) KeyType(slot.mKey);
+            new (&hole.mValue) ValueType(slot.mValue);
+
+            slot.mKey.~KeyType();
+            slot.mValue.~ValueType();
+
+            index = next;
+        }
+    }
+
+    mSlots[index].mHash = 0;
+
+    --mCount;
+    return true;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+inline void HashMap<KeyType, ValueType, HashType>::Clear()
+{
+    for (uint32_t index = 0; mCount > 0 && index < mCapacity; ++index)
+    {
+        Slot &slot(mSlots[index]);
+        if (slot.mHash != 0)
+        {
+            slot.mKey.~KeyType();
+            slot.mValue.~ValueType();
+            slot.mHash = 0;
+
+            --mCount;
+        }
+    }
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE ValueType *HashMap<KeyType, ValueType, HashType>::Find(const KeyType &key)
+{
+    const uint32_t index(Search(key, Hash(key)));
+    return (index != mCapacity) ? &mSlots[index].mValue : 0;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE const ValueType *HashMap<KeyType, ValueType, HashType>::Find(const KeyType &key) const
+{
+    const uint32_t index(Search(key, Hash(key)));
+    return (index != mCapacity) ? &mSlots[index].mValue : 0;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE bool HashMap<KeyType, ValueType, HashType>::Contains(const KeyType &key) const
+{
+    return (Search(key, Hash(key)) != mCapacity);
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE uint32_t HashMap<KeyType, ValueType, HashType>::Count() const
+{
+    return mCount;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE typename HashMap<KeyType, ValueType, HashType>::Iterator HashMap<KeyType, ValueType, HashType>::GetIterator() const
+{
+    return Iterator(mSlots, mCapacity);
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+THERON_FORCEINLINE uint32_t HashMap<KeyType, ValueType, HashType>::Search(const KeyType &key, const uint32_t hash) const
+{
+    if (mCount == 0)
+    {
+        return mCapacity;
+    }
+
+    const uint32_t mask(mCapacity - 1);
+    uint32_t index(hash & mask);
+
+    // The table is never full, so every probe sequence ends at an empty slot.
+    while (mSlots[index].mHash != 0)
+    {
+        const Slot &slot(mSlots[index]);
+        if (slot.mHash == hash && HashType::Equal(slot.mKey, key))
+        {
+            return index;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    return mCapacity;
+}
+
+
+template <class KeyType, class ValueType, class HashType>
+inline bool HashMap<KeyType, ValueType, HashType>::Resize(const uint32_t capacity)
+{
+    THERON_ASSERT((capacity & (capacity - 1)) == 0);
+    THERON_ASSERT(capacity > mCount);
+
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    Slot *const slots(reinterpret_cast<Slot *>(allocator->Allocate(capacity * sizeof(Slot))));
+    if (slots == 0)
+    {
+        return false;
+    }
+
+    for (uint32_t index = 0; index < capacity; ++index)
+    {
+        slots[index].mHash = 0;
+    }
+
+    // Move the entries to the new table, re-probing from their home slots.
+    const uint32_t mask(capacity - 1);
+    for (uint32_t oldIndex = 0; oldIndex < mCapacity; ++oldIndex)
+    {
+        Slot &oldSlot(mSlots[oldIndex]);
+        if (oldSlot.mHash == 0)
+        {
+            continue;
+        }
+
+        uint32_t index(oldSlot.mHash & mask);
+        while (slots[index].mHash != 0)
+        {
+            index = (index + 1) & mask;
+        }
+
+        Slot &slot(slots[index]);
+        slot.mHash = oldSlot.mHash;
+        new (&slot.mKey) KeyType(oldSlot.mKey);
+        new (&slot.mValue) ValueType(oldSlot.mValue);
+
+        oldSlot.mKey.~KeyType();
+        oldSlot.mValue.~ValueType();
+    }
+
+    if (mSlots)
+    {
+        allocator->Free(mSlots, mCapacity * sizeof(Slot));
+    }
+
+    mSlots = slots;
+    mCapacity = capacity;
+
+    return true;
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_CONTAINERS_HASHMAP_H
@@ -25,8 +25,8 @@ namespace Detail
 A fast unbounded queue.
 
 The queue is unbounded and internally is a doubly-linked, intrusive linked list.
-The head and tail are stored as 'dummy' nodes to simplify insertion and removal.
-The head and tail are separate nodes to separate the concerns of pushers and poppers.
+The queue itself holds just pointers to the items at the front and back, so it's
+only two pointers in size and can be embedded cheaply in small objects like mailboxes.
 
 \note The queue is intrusive and the item type is expected to derive from Queue<ItemType>::Node.
 */
@@ -38,8 +38,9 @@ public:
     /**
     Baseclass that adds link members to node types that derive from it.
     In order to be used with the queue, item classes must derive from Node.
+    \note Nodes aren't cache-line aligned; item classes that need that can align themselves.
     */
-    class THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) Node
+    class Node
     {
     public:
 
@@ -55,7 +56,7 @@ public:
         Node(const Node &other);
         Node &operator=(const Node &other);
 
-    } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+    };
 
     /**
     Constructor
@@ -90,24 +91,29 @@ public:
     */
     inline ItemType *Pop();
 
+    /**
+    Returns the item queued behind the given item, or null if the given item is at the back.
+    */
+    inline ItemType *Next(ItemType *const item) const;
+
+    /**
+    Replaces an item in the queue with another item, which takes its place in the queue.
+    */
+    inline void Replace(ItemType *const existing, ItemType *const item);
+
 private:
 
     Queue(const Queue &other);
     Queue &operator=(const Queue &other);
 
-    Node mHead;     ///< Dummy node that is always the head of the list.
-    Node mTail;     ///< Dummy node that is always the tail of the list.
+    Node *mFront;   ///< Item at the front of the queue, or null if the queue is empty.
+    Node *mBack;    ///< Item at the back of the queue, or null if the queue is empty.
 };
 
 
 template <class ItemType>
-THERON_FORCEINLINE Queue<ItemType>::Queue() : mHead(), mTail()
+THERON_FORCEINLINE Queue<ItemType>::Queue() : mFront(0), mBack(0)
 {
-    mHead.mNext = 0;
-    mHead.mPrev = &mTail;
-
-    mTail.mNext = &mHead;
-    mTail.mPrev = 0;
 }
 
 
@@ -115,18 +121,15 @@ template <class ItemType>
 THERON_FORCEINLINE Queue<ItemType>::~Queue()
 {
     // If the queue hasn't been emptied by the caller we'll leak the nodes.
-    THERON_ASSERT(mHead.mNext == 0);
-    THERON_ASSERT(mHead.mPrev == &mTail);
-
-    THERON_ASSERT(mTail.mNext == &mHead);
-    THERON_ASSERT(mTail.mPrev == 0);
+    THERON_ASSERT(mFront == 0);
+    THERON_ASSERT(mBack == 0);
 }
 
 
 template <class ItemType>
 THERON_FORCEINLINE bool Queue<ItemType>::Empty() const
 {
-    return (mHead.mPrev == &mTail);
+    return (mFront == 0);
 }
 
 
@@ -137,19 +140,27 @@ THERON_FORCEINLINE void Queue<ItemType>::Push(ItemType *const item)
 #if THERON_DEBUG
 
     // Check that the pushed item isn't already in the queue.
-    for (Node *node(mHead.mPrev); node != &mTail; node = node->mPrev)
+    for (Node *node(mFront); node != 0; node = node->mPrev)
     {
         THERON_ASSERT(node != item);
     }
 
 #endif
 
-    // Doubly-linked list insert at back, ie. in front of the dummy tail.
-    item->mPrev = &mTail;
-    item->mNext = mTail.mNext;
+    // Doubly-linked list insert at back. Next links point towards the front, previous links towards the back.
+    item->mPrev = 0;
+    item->mNext = mBack;
+
+    if (mBack)
+    {
+        mBack->mPrev = item;
+    }
+    else
+    {
+        mFront = item;
+    }
 
-    mTail.mNext->mPrev = item;
-    mTail.mNext = item;
+    mBack = item;
 }
 
 
@@ -157,27 +168,72 @@ template <class ItemType>
 THERON_FORCEINLINE ItemType *Queue<ItemType>::Front() const
 {
     // It's illegal to call Front when the queue is empty.
-    THERON_ASSERT(mHead.mPrev != &mTail);
-    return static_cast<ItemType *>(mHead.mPrev);
+    THERON_ASSERT(mFront);
+    return static_cast<ItemType *>(mFront);
 }
 
 
 template <class ItemType>
 THERON_FORCEINLINE ItemType *Queue<ItemType>::Pop()
 {
-    Node *const item(mHead.mPrev);
+    Node *const item(mFront);
 
     // It's illegal to call Pop when the queue is empty.
-    THERON_ASSERT(item != &mTail);
+    THERON_ASSERT(item);
 
-    // Doubly-linked list remove from front, ie. behind the dummy head.
-    item->mPrev->mNext = &mHead;
-    mHead.mPrev = item->mPrev;
+    // Doubly-linked list remove from front.
+    mFront = item->mPrev;
+
+    if (mFront)
+    {
+        mFront->mNext = 0;
+    }
+    else
+    {
+        mBack = 0;
+    }
 
     return static_cast<ItemType *>(item);
 }
 
 
+template <class ItemType>
+THERON_FORCEINLINE ItemType *Queue<ItemType>::Next(ItemType *const item) const
+{
+    // Items further back in the queue are reached by following the previous links.
+    return static_cast<ItemType *>(item->mPrev);
+}
+
+
+template <class ItemType>
+THERON_FORCEINLINE void Queue<ItemType>::Replace(ItemType *const existing, ItemType *const item)
+{
+    THERON_ASSERT(existing != item);
+
+    // Link the new item to the neighbours of the existing item, if it has any.
+    item->mNext = existing->mNext;
+    item->mPrev = existing->mPrev;
+
+    if (existing->mNext)
+    {
+        existing->mNext->mPrev = item;
+    }
+    else
+    {
+        mFront = item;
+    }
+
+    if (existing->mPrev)
+    {
+        existing->mPrev->mNext = item;
+    }
+    else
+    {
+        mBack = item;
+    }
+}
+
+
 } // namespace Detail
 } // namespace Theron
 
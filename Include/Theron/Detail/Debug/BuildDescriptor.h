@@ -138,6 +138,11 @@ inline void BuildDescriptor::GenerateInline(char *const identifier)
         strcat(identifier, ".posix");
     }
 
+    if (THERON_FUTEX)
+    {
+        strcat(identifier, ".futex");
+    }
+
     if (THERON_NUMA)
     {
         strcat(identifier, ".numa");
@@ -167,6 +172,11 @@ inline void BuildDescriptor::GenerateInline(char *const identifier)
     {
         strcat(identifier, ".build");
     }
+
+    if (THERON_ENABLE_PERF_COUNTERS)
+    {
+        strcat(identifier, ".perf");
+    }
 }
 
 
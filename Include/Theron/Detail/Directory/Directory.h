@@ -20,10 +20,26 @@ namespace Detail
 {
 
 
+/**
+Empty side record, for directories whose entries keep no data in a side array.
+*/
+struct DirectoryNoSide
+{
+    template <class EntryType>
+    THERON_FORCEINLINE void Attach(EntryType &/*entry*/)
+    {
+    }
+};
+
+
 /**
 A registry that maps unique indices to addressable entities.
+
+Entries are allocated a page at a time. Each page can also hold a side array of records of a
+second type, one per entry, for data that's rarely touched and so is better kept out of the
+entries themselves. Each side record is attached to its entry when the page is allocated.
 */
-template <class EntryType>
+template <class EntryType, class SideType = DirectoryNoSide>
 class Directory
 {
 public:
@@ -51,12 +67,21 @@ public:
 
 private:
 
-    static const uint32_t ENTRIES_PER_PAGE = 1024;  ///< Number of entries in each allocated page (power of two!).
-    static const uint32_t MAX_PAGES = 1024;         ///< Maximum number of allocated pages.
+    static const uint32_t ENTRIES_PER_PAGE = 256;   ///< Number of entries in each allocated page (power of two!).
+    static const uint32_t MAX_PAGES = 4096;         ///< Maximum number of allocated pages.
 
     struct Page
     {
+        inline Page()
+        {
+            for (uint32_t index = 0; index < ENTRIES_PER_PAGE; ++index)
+            {
+                mSides[index].Attach(mEntries[index]);
+            }
+        }
+
         EntryType mEntries[ENTRIES_PER_PAGE];       ///< Array of entries making up this page.
+        SideType mSides[ENTRIES_PER_PAGE];          ///< Side records of the entries.
     };
 
     Directory(const Directory &other);
@@ -68,8 +93,8 @@ private:
 };
 
 
-template <class EntryType>
-inline Directory<EntryType>::Directory() :
+template <class EntryType, class SideType>
+inline Directory<EntryType, SideType>::Directory() :
   mMutex(),
   mNextIndex(0)
 {
@@ -81,8 +106,8 @@ inline Directory<EntryType>::Directory() :
 }
 
 
-template <class EntryType>
-inline Directory<EntryType>::~Directory()
+template <class EntryType, class SideType>
+inline Directory<EntryType, SideType>::~Directory()
 {
     IAllocator *const pageAllocator(AllocatorManager::GetCache());
 
@@ -99,8 +124,8 @@ inline Directory<EntryType>::~Directory()
 }
 
 
-template <class EntryType>
-inline uint32_t Directory<EntryType>::Allocate(uint32_t index)
+template <class EntryType, class SideType>
+inline uint32_t Directory<EntryType, SideType>::Allocate(uint32_t index)
 {
     mMutex.Lock();
 
@@ -140,8 +165,8 @@ inline uint32_t Directory<EntryType>::Allocate(uint32_t index)
 }
 
 
-template <class EntryType>
-THERON_FORCEINLINE EntryType &Directory<EntryType>::GetEntry(const uint32_t index)
+template <class EntryType, class SideType>
+THERON_FORCEINLINE EntryType &Directory<EntryType, SideType>::GetEntry(const uint32_t index)
 {
     // Compute the page and offset.
     // TODO: Use a mask?
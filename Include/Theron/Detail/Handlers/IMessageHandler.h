@@ -8,6 +8,7 @@
 
 #include <Theron/Detail/Containers/List.h>
 #include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
 
 
 namespace Theron
@@ -31,7 +32,21 @@ public:
     /**
     Default constructor.
     */
-    THERON_FORCEINLINE IMessageHandler() : mMarked(false), mPredictedSendCount(0)
+    THERON_FORCEINLINE IMessageHandler() :
+      mMarked(false),
+      mPredictedSendCount(0),
+      mPerfCounterTotals(0)
+    {
+    }
+
+    /**
+    Constructor.
+    \param perfCounterTotals Hardware event totals of the class of actor that registered the handler.
+    */
+    THERON_FORCEINLINE explicit IMessageHandler(PerfCounterTotals *const perfCounterTotals) :
+      mMarked(false),
+      mPredictedSendCount(0),
+      mPerfCounterTotals(perfCounterTotals)
     {
     }
 
@@ -62,6 +77,11 @@ public:
     */
     inline uint32_t GetPredictedSendCount() const;
 
+    /**
+    Gets the hardware event totals into which the handler's executions are accumulated, if any.
+    */
+    inline PerfCounterTotals *GetPerfCounterTotals() const;
+
     /**
     Returns the unique name of the message type handled by this handler.
     */
@@ -80,6 +100,7 @@ private:
 
     bool mMarked;                   ///< Flag used to mark the handler for deletion.
     uint32_t mPredictedSendCount;   ///< Number of messages that are predicted to be sent by the handler.
+    PerfCounterTotals *mPerfCounterTotals;  ///< Per-actor-class hardware event totals.
 };
 
 
@@ -111,6 +132,12 @@ THERON_FORCEINLINE uint32_t IMessageHandler::GetPredictedSendCount() const
 }
 
 
+THERON_FORCEINLINE PerfCounterTotals *IMessageHandler::GetPerfCounterTotals() const
+{
+    return mPerfCounterTotals;
+}
+
+
 } // namespace Detail
 } // namespace Theron
 
@@ -12,6 +12,7 @@
 #include <Theron/Detail/Messages/Message.h>
 #include <Theron/Detail/Messages/MessageCast.h>
 #include <Theron/Detail/Messages/MessageTraits.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
 
 
 namespace Theron
@@ -54,7 +55,9 @@ public:
     /**
     Constructor.
     */
-    inline explicit MessageHandler(HandlerFunction function) : mHandlerFunction(function)
+    inline explicit MessageHandler(HandlerFunction function) :
+      IMessageHandler(&ActorPerfCounters<ActorType>::smTotals),
+      mHandlerFunction(function)
     {
     }
 
@@ -0,0 +1,238 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_IO_FILESERVICE_H
+#define THERON_DETAIL_IO_FILESERVICE_H
+
+
+#include <Theron/Address.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Containers/Queue.h>
+#include <Theron/Detail/IO/IoUring.h>
+#include <Theron/Detail/Threading/Condition.h>
+#include <Theron/Detail/Threading/Mutex.h>
+#include <Theron/Detail/Threading/Thread.h>
+
+
+namespace Theron
+{
+
+
+class Framework;
+
+
+namespace Detail
+{
+
+
+/**
+Per-framework service that performs file reads and writes on behalf of actors, without
+blocking the worker threads of the framework.
+
+Requests are queued by the calling thread and performed asynchronously. When a request
+completes, a \ref FileResult message is sent to the requesting address, carrying the
+pooled buffer that was read into or written from.
+
+Where \ref THERON_IO_URING is enabled and the kernel supports it, the requests are
+performed by a single service thread that owns an io_uring instance. Each request is an open,
+followed by a read or write linked to a close, and a batch of operations on many files
+is submitted and reaped with a single system call. New requests
+are signalled to the service thread with an eventfd, which the ring itself reads, so the
+thread only ever waits in one place. Otherwise the requests are performed with blocking
+calls by a small pool of threads.
+*/
+class FileService
+{
+public:
+
+    /**
+    Constructor.
+    \param framework Framework whose actors the results are sent to.
+    \param threadCount Number of threads in the pool used when io_uring is unavailable.
+    \param bufferSize Size of each pooled buffer, which limits the size of a single read or write.
+    \param queueDepth Maximum number of requests in flight in the io_uring instance at once.
+    */
+    FileService(
+        Framework *const framework,
+        const uint32_t threadCount,
+        const uint32_t bufferSize,
+        const uint32_t queueDepth);
+
+    /**
+    Destructor.
+    */
+    ~FileService();
+
+    /**
+    Starts the service thread, or threads.
+    */
+    void Initialize();
+
+    /**
+    Completes all outstanding requests and stops the service threads.
+    */
+    void Release();
+
+    /**
+    Queues a request to read a file into a pooled buffer.
+    Up to the buffer size is read, starting at the given offset.
+    \return False if the request couldn't be queued, in which case no result is sent.
+    */
+    bool Read(
+        const Address &client,
+        const char *const fileName,
+        const uint32_t tag,
+        const uint64_t offset);
+
+    /**
+    Queues a request to write a pooled buffer to a file, which is created if it doesn't exist.
+    Ownership of the buffer passes to the service, which returns it with the result.
+    \return False if the request couldn't be queued, in which case no result is sent and the buffer still belongs to the caller.
+    */
+    bool Write(
+        const Address &client,
+        const char *const fileName,
+        void *const buffer,
+        const uint32_t size,
+        const uint32_t tag,
+        const uint64_t offset);
+
+    /**
+    Allocates a pooled buffer of \ref GetBufferSize bytes.
+    */
+    void *AllocateBuffer();
+
+    /**
+    Returns a pooled buffer to the pool.
+    */
+    void FreeBuffer(void *const buffer);
+
+    /**
+    Returns the size of the pooled buffers in bytes.
+    */
+    inline uint32_t GetBufferSize() const
+    {
+        return mBufferSize;
+    }
+
+    /**
+    Returns true if the requests are performed using io_uring, rather than by the thread pool.
+    */
+    inline bool UsingIoUring() const
+    {
+        return mUsingIoUring;
+    }
+
+private:
+
+    /**
+    A queued or in-flight file request.
+    */
+    class Request : public Queue<Request>::Node
+    {
+    public:
+
+        enum Operation
+        {
+            OPERATION_READ = 0,
+            OPERATION_WRITE
+        };
+
+        enum State
+        {
+            STATE_OPEN = 0,
+            STATE_TRANSFER
+        };
+
+        inline Request() :
+          mClient(),
+          mFileName(0),
+          mOperation(OPERATION_READ),
+          mState(STATE_OPEN),
+          mFileDescriptor(-1),
+          mOffset(0),
+          mBuffer(0),
+          mSize(0),
+          mTag(0),
+          mTransferred(0),
+          mError(0)
+        {
+        }
+
+        Address mClient;                ///< Address to which the result is sent.
+        char *mFileName;                ///< Owned copy of the name of the file.
+        Operation mOperation;           ///< Whether the request is a read or a write.
+        State mState;                   ///< Operation currently in flight in the io_uring instance.
+        int mFileDescriptor;            ///< Descriptor of the opened file.
+        uint64_t mOffset;               ///< Offset within the file at which to read or write.
+        void *mBuffer;                  ///< Pooled buffer read into or written from.
+        uint32_t mSize;                 ///< Number of bytes to read or write.
+        uint32_t mTag;                  ///< User-defined value returned with the result.
+        uint32_t mTransferred;          ///< Number of bytes actually read or written.
+        uint32_t mError;                ///< Error code, or zero on success.
+
+    private:
+
+        Request(const Request &other);
+        Request &operator=(const Request &other);
+    };
+
+    typedef Queue<Request> RequestQueue;
+
+    static const uint32_t MAX_THREADS = 16;
+
+    FileService(const FileService &other);
+    FileService &operator=(const FileService &other);
+
+    static void PoolThreadEntryPoint(void *const context);
+
+    Request *CreateRequest(const Address &client, const char *const fileName);
+    void DestroyRequest(Request *const request);
+    void Enqueue(Request *const request);
+    void Complete(Request *const request);
+    void RunPool();
+    void Transfer(Request *const request);
+
+#if THERON_IO_URING
+
+    static void RingThreadEntryPoint(void *const context);
+
+    bool StartRing();
+    void RunRing();
+    void WakeRing();
+    void ArmWake();
+    void StartOperation(Request *const request);
+
+#endif // THERON_IO_URING
+
+    Framework *const mFramework;        ///< Framework whose actors the results are sent to.
+    const uint32_t mThreadCount;        ///< Number of threads in the fallback pool.
+    const uint32_t mBufferSize;         ///< Size of each pooled buffer in bytes.
+    const uint32_t mQueueDepth;         ///< Maximum number of requests in flight in the ring.
+    bool mUsingIoUring;                 ///< Whether the requests are performed using io_uring.
+    Condition mCondition;               ///< Protects the pending queue, and wakes the pool threads.
+    RequestQueue mPending;              ///< Requests waiting to be performed.
+    bool mStopping;                     ///< Set when the service is released.
+    Mutex mBufferLock;                  ///< Protects the free list of pooled buffers.
+    void *mFreeBuffers;                 ///< Free list of pooled buffers, linked through their first word.
+    Thread mThreads[MAX_THREADS];       ///< Service threads.
+    uint32_t mStartedThreads;           ///< Number of service threads started.
+
+#if THERON_IO_URING
+
+    IoUring mRing;                      ///< Ring owned by the service thread.
+    int mWakeDescriptor;                ///< Eventfd used to signal new requests to the service thread.
+    uint64_t mWakeValue;                ///< Target of the ring's pending read from the eventfd.
+    bool mWakePending;                  ///< Set while a signal is pending, so that signals aren't repeated.
+    uint32_t mActive;                   ///< Number of requests in flight in the ring.
+
+#endif // THERON_IO_URING
+
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_IO_FILESERVICE_H
@@ -0,0 +1,374 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_IO_IOURING_H
+#define THERON_DETAIL_IO_IOURING_H
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+#if THERON_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#endif // THERON_IO_URING
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+#if THERON_IO_URING
+
+
+/**
+Minimal wrapper around a Linux io_uring instance, made directly with the system calls.
+
+The ring consists of a submission queue, into which the owner writes entries describing
+operations, and a completion queue, from which it reads their results. Both queues are
+shared with the kernel through memory mapped from the ring file descriptor, so submitting
+a batch of operations and waiting for completions costs a single system call.
+
+\note The ring isn't thread-safe: a single thread is expected to own it.
+*/
+class IoUring
+{
+public:
+
+    /**
+    Constructor. The ring is unusable until \ref Initialize is called successfully.
+    */
+    inline IoUring() :
+      mFileDescriptor(-1),
+      mSubmissionRing(0),
+      mSubmissionRingSize(0),
+      mCompletionRing(0),
+      mCompletionRingSize(0),
+      mEntries(0),
+      mEntriesSize(0),
+      mSubmissionHead(0),
+      mSubmissionTail(0),
+      mSubmissionMask(0),
+      mSubmissionArray(0),
+      mSubmissionSize(0),
+      mLocalTail(0),
+      mUnsubmitted(0),
+      mCompletionHead(0),
+      mCompletionTail(0),
+      mCompletionMask(0),
+      mCompletions(0)
+    {
+    }
+
+    /**
+    Destructor.
+    */
+    inline ~IoUring()
+    {
+        Release();
+    }
+
+    /**
+    Creates the ring with at least the given number of submission entries.
+    \param opcodes Array of the operation codes the caller intends to use.
+    \param opcodeCount Number of operation codes in the array.
+    \return False if io_uring is unavailable, or doesn't support all of the given operations.
+    */
+    inline bool Initialize(const uint32_t entries, const uint8_t *const opcodes, const uint32_t opcodeCount);
+
+    /**
+    Destroys the ring. Any operations still in flight are cancelled.
+    */
+    inline void Release();
+
+    /**
+    Returns a zeroed submission queue entry to be filled in by the caller, or zero if the queue is full.
+    The entry is passed to the kernel by the next call to \ref Submit.
+    */
+    inline io_uring_sqe *GetEntry();
+
+    /**
+    Submits any new entries to the kernel, and optionally waits for at least one completion.
+    \return False if the system call failed for a reason other than being interrupted.
+    */
+    inline bool Submit(const bool wait);
+
+    /**
+    Returns the oldest unconsumed completion queue entry, or zero if there are none.
+    */
+    inline io_uring_cqe *PeekCompletion();
+
+    /**
+    Consumes the completion queue entry returned by the preceding call to \ref PeekCompletion.
+    */
+    inline void ConsumeCompletion();
+
+private:
+
+    IoUring(const IoUring &other);
+    IoUring &operator=(const IoUring &other);
+
+    inline bool Probe(const uint8_t *const opcodes, const uint32_t opcodeCount) const;
+
+    int mFileDescriptor;                ///< File descriptor of the ring.
+    void *mSubmissionRing;              ///< Mapped submission queue ring.
+    size_t mSubmissionRingSize;         ///< Size of the mapped submission queue ring in bytes.
+    void *mCompletionRing;              ///< Mapped completion queue ring, possibly the same mapping.
+    size_t mCompletionRingSize;         ///< Size of the mapped completion queue ring in bytes.
+    io_uring_sqe *mEntries;             ///< Mapped array of submission queue entries.
+    size_t mEntriesSize;                ///< Size of the mapped array of entries in bytes.
+    uint32_t *mSubmissionHead;          ///< Submission queue head, advanced by the kernel.
+    uint32_t *mSubmissionTail;          ///< Submission queue tail, advanced by us.
+    uint32_t mSubmissionMask;           ///< Mask applied to submission queue indices.
+    uint32_t *mSubmissionArray;         ///< Indirection array from submission queue slots to entries.
+    uint32_t mSubmissionSize;           ///< Number of entries in the submission queue.
+    uint32_t mLocalTail;                ///< Submission queue tail including entries not yet published.
+    uint32_t mUnsubmitted;              ///< Number of entries published but not yet submitted.
+    uint32_t *mCompletionHead;          ///< Completion queue head, advanced by us.
+    uint32_t *mCompletionTail;          ///< Completion queue tail, advanced by the kernel.
+    uint32_t mCompletionMask;           ///< Mask applied to completion queue indices.
+    io_uring_cqe *mCompletions;         ///< Mapped array of completion queue entries.
+};
+
+
+inline bool IoUring::Initialize(const uint32_t entries, const uint8_t *const opcodes, const uint32_t opcodeCount)
+{
+    THERON_ASSERT(mFileDescriptor < 0);
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    const long fileDescriptor(syscall(__NR_io_uring_setup, entries, &params));
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    mFileDescriptor = static_cast<int>(fileDescriptor);
+
+    if (!Probe(opcodes, opcodeCount))
+    {
+        Release();
+        return false;
+    }
+
+    mSubmissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    mCompletionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    mEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    // Newer kernels map both rings with a single mapping.
+    const bool singleMapping((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+    if (singleMapping && mCompletionRingSize > mSubmissionRingSize)
+    {
+        mSubmissionRingSize = mCompletionRingSize;
+    }
+
+    void *const submissionRing(mmap(
+        0,
+        mSubmissionRingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        mFileDescriptor,
+        IORING_OFF_SQ_RING));
+
+    if (submissionRing == MAP_FAILED)
+    {
+        Release();
+        return false;
+    }
+
+    mSubmissionRing = submissionRing;
+
+    if (singleMapping)
+    {
+        mCompletionRing = mSubmissionRing;
+        mCompletionRingSize = mSubmissionRingSize;
+    }
+    else
+    {
+        void *const completionRing(mmap(
+            0,
+            mCompletionRingSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            mFileDescriptor,
+            IORING_OFF_CQ_RING));
+
+        if (completionRing == MAP_FAILED)
+        {
+            Release();
+            return false;
+        }
+
+        mCompletionRing = completionRing;
+    }
+
+    void *const submissionEntries(mmap(
+        0,
+        mEntriesSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        mFileDescriptor,
+        IORING_OFF_SQES));
+
+    if (submissionEntries == MAP_FAILED)
+    {
+        Release();
+        return false;
+    }
+
+    mEntries = static_cast<io_uring_sqe *>(submissionEntries);
+
+    char *const submissionBase(static_cast<char *>(mSubmissionRing));
+    mSubmissionHead = reinterpret_cast<uint32_t *>(submissionBase + params.sq_off.head);
+    mSubmissionTail = reinterpret_cast<uint32_t *>(submissionBase + params.sq_off.tail);
+    mSubmissionMask = *reinterpret_cast<uint32_t *>(submissionBase + params.sq_off.ring_mask);
+    mSubmissionArray = reinterpret_cast<uint32_t *>(submissionBase + params.sq_off.array);
+    mSubmissionSize = params.sq_entries;
+    mLocalTail = *mSubmissionTail;
+    mUnsubmitted = 0;
+
+    char *const completionBase(static_cast<char *>(mCompletionRing));
+    mCompletionHead = reinterpret_cast<uint32_t *>(completionBase + params.cq_off.head);
+    mCompletionTail = reinterpret_cast<uint32_t *>(completionBase + params.cq_off.tail);
+    mCompletionMask = *reinterpret_cast<uint32_t *>(completionBase + params.cq_off.ring_mask);
+    mCompletions = reinterpret_cast<io_uring_cqe *>(completionBase + params.cq_off.cqes);
+
+    return true;
+}
+
+
+inline void IoUring::Release()
+{
+    if (mEntries)
+    {
+        munmap(mEntries, mEntriesSize);
+        mEntries = 0;
+    }
+
+    if (mCompletionRing && mCompletionRing != mSubmissionRing)
+    {
+        munmap(mCompletionRing, mCompletionRingSize);
+    }
+
+    mCompletionRing = 0;
+
+    if (mSubmissionRing)
+    {
+        munmap(mSubmissionRing, mSubmissionRingSize);
+        mSubmissionRing = 0;
+    }
+
+    if (mFileDescriptor >= 0)
+    {
+        close(mFileDescriptor);
+        mFileDescriptor = -1;
+    }
+}
+
+
+THERON_FORCEINLINE io_uring_sqe *IoUring::GetEntry()
+{
+    // The kernel advances the head as it consumes entries.
+    const uint32_t head(__atomic_load_n(mSubmissionHead, __ATOMIC_ACQUIRE));
+    if (mLocalTail - head >= mSubmissionSize)
+    {
+        return 0;
+    }
+
+    const uint32_t index(mLocalTail & mSubmissionMask);
+    io_uring_sqe *const entry(mEntries + index);
+    memset(entry, 0, sizeof(io_uring_sqe));
+
+    mSubmissionArray[index] = index;
+    ++mLocalTail;
+    ++mUnsubmitted;
+
+    return entry;
+}
+
+
+inline bool IoUring::Submit(const bool wait)
+{
+    // Publish the new entries to the kernel before entering it.
+    __atomic_store_n(mSubmissionTail, mLocalTail, __ATOMIC_RELEASE);
+
+    const uint32_t flags(wait ? IORING_ENTER_GETEVENTS : 0);
+    const long submitted(syscall(__NR_io_uring_enter, mFileDescriptor, mUnsubmitted, wait ? 1 : 0, flags, 0, 0));
+
+    if (submitted < 0)
+    {
+        return (errno == EINTR || errno == EAGAIN || errno == EBUSY);
+    }
+
+    mUnsubmitted -= static_cast<uint32_t>(submitted);
+    return true;
+}
+
+
+THERON_FORCEINLINE io_uring_cqe *IoUring::PeekCompletion()
+{
+    // Only we advance the head, but the kernel advances the tail as operations complete.
+    const uint32_t head(*mCompletionHead);
+    const uint32_t tail(__atomic_load_n(mCompletionTail, __ATOMIC_ACQUIRE));
+
+    if (head == tail)
+    {
+        return 0;
+    }
+
+    return mCompletions + (head & mCompletionMask);
+}
+
+
+THERON_FORCEINLINE void IoUring::ConsumeCompletion()
+{
+    // Release the entry back to the kernel only once we've finished reading it.
+    __atomic_store_n(mCompletionHead, *mCompletionHead + 1, __ATOMIC_RELEASE);
+}
+
+
+inline bool IoUring::Probe(const uint8_t *const opcodes, const uint32_t opcodeCount) const
+{
+    // The probe structure is followed in memory by an array of per-operation entries.
+    static const uint32_t MAX_PROBE_OPS = 256;
+    uint64_t buffer[(sizeof(io_uring_probe) + MAX_PROBE_OPS * sizeof(io_uring_probe_op)) / sizeof(uint64_t) + 1];
+    memset(buffer, 0, sizeof(buffer));
+
+    io_uring_probe *const probe(reinterpret_cast<io_uring_probe *>(buffer));
+
+    // Kernels too old to support probing are too old to support the operations we need.
+    if (syscall(__NR_io_uring_register, mFileDescriptor, IORING_REGISTER_PROBE, probe, MAX_PROBE_OPS) < 0)
+    {
+        return false;
+    }
+
+    for (uint32_t index = 0; index < opcodeCount; ++index)
+    {
+        const uint8_t opcode(opcodes[index]);
+        if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+#endif // THERON_IO_URING
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_IO_IOURING_H
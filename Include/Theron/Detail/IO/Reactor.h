@@ -0,0 +1,147 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_IO_REACTOR_H
+#define THERON_DETAIL_IO_REACTOR_H
+
+
+#include <Theron/Address.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Containers/Map.h>
+#include <Theron/Detail/Threading/Mutex.h>
+#include <Theron/Detail/Threading/Thread.h>
+
+
+namespace Theron
+{
+
+
+class Framework;
+
+
+namespace Detail
+{
+
+
+/**
+Per-framework service that watches file descriptors on behalf of actors, and sends them
+a \ref DescriptorReady message when a watched descriptor becomes ready.
+
+Where \ref THERON_EPOLL is enabled, a single reactor thread waits on an epoll instance
+containing all the watched descriptors. Each watch is one-shot: once a descriptor has been
+reported it isn't reported again until it's watched again, so each watching actor has at
+most one readiness message per descriptor in flight.
+
+All the events returned by a single wait are delivered together, as one batch of sends.
+The mailboxes that become non-empty are pushed onto the scheduler's work queue with a single
+lock, and the worker threads are woken once, rather than once per event.
+
+The service is also woken through an eventfd in the epoll set, so the reactor thread only
+ever waits in one place.
+*/
+class Reactor
+{
+public:
+
+    /**
+    Constructor.
+    \param framework Framework whose actors the readiness messages are sent to.
+    */
+    explicit Reactor(Framework *const framework);
+
+    /**
+    Destructor.
+    */
+    ~Reactor();
+
+    /**
+    Creates the epoll instance and starts the reactor thread.
+    \return False if the reactor couldn't be started, or watching descriptors isn't supported.
+    */
+    bool Initialize();
+
+    /**
+    Stops the reactor thread. Readiness events that haven't yet been delivered are dropped.
+    */
+    void Release();
+
+    /**
+    Watches a descriptor, sending a single readiness message to the client when it becomes ready.
+    Watching a descriptor that's already watched replaces the earlier watch.
+    \param events Combination of \ref DescriptorReady::Event flags to watch for.
+    \return False if the descriptor couldn't be watched, in which case no message is sent.
+    */
+    bool Watch(
+        const Address &client,
+        const int descriptor,
+        const uint32_t events,
+        const uint32_t tag);
+
+    /**
+    Stops watching a descriptor.
+    \return False if the descriptor wasn't watched.
+    */
+    bool Unwatch(const int descriptor);
+
+private:
+
+    /**
+    The recipient of the readiness messages for a watched descriptor.
+    */
+    struct Registration
+    {
+        inline Registration(const Address &client, const uint32_t tag) :
+          mClient(client),
+          mTag(tag)
+        {
+        }
+
+        Address mClient;                ///< Address to which readiness messages are sent.
+        uint32_t mTag;                  ///< User-defined value returned with the messages.
+    };
+
+    /**
+    Hashes descriptors, which are small integers allocated lowest first, into buckets.
+    */
+    class DescriptorHash
+    {
+    public:
+
+        enum
+        {
+            RANGE = 1024
+        };
+
+        THERON_FORCEINLINE static uint32_t Compute(const int descriptor)
+        {
+            return static_cast<uint32_t>(descriptor) & (RANGE - 1);
+        }
+    };
+
+    typedef Map<int, Registration, DescriptorHash> RegistrationMap;
+
+    static const uint32_t MAX_EVENTS = 256;
+
+    Reactor(const Reactor &other);
+    Reactor &operator=(const Reactor &other);
+
+    static void ThreadEntryPoint(void *const context);
+
+    RegistrationMap::Node *Find(const int descriptor) const;
+    void Run();
+
+    Framework *const mFramework;        ///< Framework whose actors the messages are sent to.
+    Mutex mLock;                        ///< Protects the registrations.
+    RegistrationMap mRegistrations;     ///< Recipients of the watched descriptors, keyed by descriptor.
+    int mEpollDescriptor;               ///< The epoll instance containing the watched descriptors.
+    int mWakeDescriptor;                ///< Eventfd used to wake the reactor thread for shutdown.
+    Thread mThread;                     ///< The reactor thread.
+    bool mStarted;                      ///< Whether the reactor thread is running.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_IO_REACTOR_H
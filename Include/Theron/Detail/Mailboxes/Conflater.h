@@ -0,0 +1,99 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MAILBOXES_CONFLATER_H
+#define THERON_DETAIL_MAILBOXES_CONFLATER_H
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Mailboxes/IConflater.h>
+#include <Theron/Detail/Mailboxes/KeyHash.h>
+#include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Messages/Message.h>
+#include <Theron/Detail/Messages/MessageCast.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
+#include <Theron/Detail/Messages/MessageTraits.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Instantiable class template that remembers a conflated message type and the member of
+the message value that holds its key.
+
+Messages are cast at runtime in the same way as by message handlers, using either C++
+dynamic_cast or the registered type names of the messages. Keys are hashed by \ref KeyHash.
+
+\tparam ValueType The type of message conflated by this conflater.
+\tparam KeyType The type of the key member, which must be comparable with operator==.
+*/
+template <class ValueType, class KeyType>
+class Conflater : public IConflater
+{
+public:
+
+    /**
+    Pointer to the member of the message value that holds its key.
+    */
+    typedef KeyType ValueType::*KeyMember;
+
+    /**
+    Constructor.
+    */
+    inline explicit Conflater(KeyMember key) :
+      IConflater(&MessageTypeDescriptor<ValueType>::smDescriptor),
+      mKey(key)
+    {
+    }
+
+    /**
+    Virtual destructor.
+    */
+    inline virtual ~Conflater()
+    {
+    }
+
+    /**
+    Returns true if the given message is of the type conflated by this conflater.
+    */
+    inline virtual bool Accepts(const IMessage *const message) const
+    {
+        typedef MessageCast<MessageTraits<ValueType>::HAS_TYPE_NAME> MessageCaster;
+        return (MessageCaster:: template CastMessage<ValueType>(message) != 0);
+    }
+
+    /**
+    Returns a hash of the key of the given value.
+    */
+    inline virtual uint32_t Hash(const void *const value) const
+    {
+        return KeyHash<KeyType>::Compute(reinterpret_cast<const ValueType *>(value)->*mKey);
+    }
+
+    /**
+    Returns true if the two given values have the same key.
+    */
+    inline virtual bool Equal(const void *const a, const void *const b) const
+    {
+        return (reinterpret_cast<const ValueType *>(a)->*mKey == reinterpret_cast<const ValueType *>(b)->*mKey);
+    }
+
+private:
+
+    Conflater(const Conflater &other);
+    Conflater &operator=(const Conflater &other);
+
+    const KeyMember mKey;       ///< Pointer to the member of the message value that holds its key.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MAILBOXES_CONFLATER_H
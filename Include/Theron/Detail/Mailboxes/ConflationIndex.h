@@ -0,0 +1,130 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MAILBOXES_CONFLATIONINDEX_H
+#define THERON_DETAIL_MAILBOXES_CONFLATIONINDEX_H
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Containers/HashMap.h>
+#include <Theron/Detail/Mailboxes/IConflater.h>
+#include <Theron/Detail/Messages/IMessage.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Index of the pending messages in a mailbox that can still be replaced by conflation.
+
+Messages are indexed by the conflater of their type and the keys they carry, so a message
+superseding one of them is found with a hash lookup rather than by searching the mailbox.
+The keys refer to the values of the indexed messages, which stay put while they're pending,
+so no copies of keys are kept. At most one pending message is indexed for each key.
+\note The index isn't thread-safe; it's protected by the lock of its mailbox.
+*/
+class ConflationIndex
+{
+public:
+
+    /**
+    Default constructor. No memory is allocated until a message is indexed.
+    */
+    inline ConflationIndex() : mMessages()
+    {
+    }
+
+    /**
+    Indexes a pending message accepted by the given conflater, unless one with the same key is indexed.
+    */
+    inline void Insert(const IConflater *const conflater, IMessage *const message)
+    {
+        mMessages.Insert(Key(conflater, message->GetMessageData()), message);
+    }
+
+    /**
+    Unindexes the given message, accepted by the given conflater, if it's indexed.
+    */
+    inline void Remove(const IConflater *const conflater, IMessage *const message)
+    {
+        const Key key(conflater, message->GetMessageData());
+
+        // Another message with the same key may be indexed in its place.
+        IMessage *const *const indexed(mMessages.Find(key));
+        if (indexed && *indexed == message)
+        {
+            mMessages.Remove(key);
+        }
+    }
+
+    /**
+    Returns the indexed message with the same key as the given value, or null if there's none.
+    \param conflater The conflater of the message type.
+    \param value A value of the type conflated by the conflater.
+    */
+    THERON_FORCEINLINE IMessage *Find(const IConflater *const conflater, const void *const value) const
+    {
+        IMessage *const *const indexed(mMessages.Find(Key(conflater, value)));
+        return indexed ? *indexed : 0;
+    }
+
+    /**
+    Unindexes all the messages.
+    */
+    inline void Clear()
+    {
+        mMessages.Clear();
+    }
+
+private:
+
+    /**
+    Identifies a key by the conflater of its message type and a value carrying it.
+    */
+    struct Key
+    {
+        THERON_FORCEINLINE Key(const IConflater *const conflater, const void *const value) :
+          mConflater(conflater),
+          mValue(value)
+        {
+        }
+
+        const IConflater *mConflater;       ///< Conflater of the message type.
+        const void *mValue;                 ///< Value carrying the key.
+    };
+
+    /**
+    Hashes keys for the hash map, keeping the keys of different message types apart.
+    */
+    struct KeyHasher
+    {
+        THERON_FORCEINLINE static uint32_t Compute(const Key &key)
+        {
+            const uint32_t conflater(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(key.mConflater) >> 4));
+            return key.mConflater->Hash(key.mValue) ^ conflater;
+        }
+
+        THERON_FORCEINLINE static bool Equal(const Key &a, const Key &b)
+        {
+            return (a.mConflater == b.mConflater && a.mConflater->Equal(a.mValue, b.mValue));
+        }
+    };
+
+    typedef HashMap<Key, IMessage *, KeyHasher> MessageMap;
+
+    ConflationIndex(const ConflationIndex &other);
+    ConflationIndex &operator=(const ConflationIndex &other);
+
+    MessageMap mMessages;           ///< Indexed messages, by conflater and key.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MAILBOXES_CONFLATIONINDEX_H
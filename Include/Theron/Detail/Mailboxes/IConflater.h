@@ -0,0 +1,82 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MAILBOXES_ICONFLATER_H
+#define THERON_DETAIL_MAILBOXES_ICONFLATER_H
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Containers/List.h>
+#include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Baseclass that allows conflaters of various message types to be stored in lists.
+
+A conflater identifies messages of one type that carry the same key, so that a newly
+delivered message can replace the pending message it supersedes in a mailbox. Values are
+passed to the key functions as blind data, and must be of the conflated type.
+*/
+class IConflater : public List<IConflater>::Node
+{
+public:
+
+    /**
+    Constructor.
+    \param descriptor Descriptor of the conflated message type.
+    */
+    inline explicit IConflater(const MessageDescriptor *const descriptor) : mDescriptor(descriptor)
+    {
+    }
+
+    /**
+    Virtual destructor.
+    */
+    inline virtual ~IConflater()
+    {
+    }
+
+    /**
+    Returns the descriptor of the conflated message type, which identifies values of the type before they're sent.
+    */
+    THERON_FORCEINLINE const MessageDescriptor *GetDescriptor() const
+    {
+        return mDescriptor;
+    }
+
+    /**
+    Returns true if the given message is of the type conflated by this conflater.
+    */
+    virtual bool Accepts(const IMessage *const message) const = 0;
+
+    /**
+    Returns a hash of the key of the given value.
+    */
+    virtual uint32_t Hash(const void *const value) const = 0;
+
+    /**
+    Returns true if the two given values have the same key, so one supersedes the other.
+    */
+    virtual bool Equal(const void *const a, const void *const b) const = 0;
+
+private:
+
+    IConflater(const IConflater &other);
+    IConflater &operator=(const IConflater &other);
+
+    const MessageDescriptor *const mDescriptor;     ///< Descriptor of the conflated message type.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MAILBOXES_ICONFLATER_H
@@ -0,0 +1,85 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MAILBOXES_KEYHASH_H
+#define THERON_DETAIL_MAILBOXES_KEYHASH_H
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Hashes the keys of conflated messages, so pending messages can be looked up by key.
+
+Keys of integral and pointer types are hashed by value. Keys of other types all hash
+alike, so pending messages with such keys are still found, but by comparing the keys
+one by one with operator==, as if the pending messages were searched in turn.
+
+\tparam KeyType The type of the key member of a conflated message type.
+*/
+template <class KeyType>
+class KeyHash
+{
+public:
+
+    THERON_FORCEINLINE static uint32_t Compute(const KeyType &/*key*/)
+    {
+        return 0;
+    }
+};
+
+
+/**
+Hashes integral keys, widened to 64 bits.
+*/
+class IntegerKeyHash
+{
+public:
+
+    THERON_FORCEINLINE static uint32_t Compute(const uint64_t key)
+    {
+        // Multiplicative hashing mixes the key best into the top bits of the product.
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+};
+
+
+template <> class KeyHash<bool> : public IntegerKeyHash {};
+template <> class KeyHash<char> : public IntegerKeyHash {};
+template <> class KeyHash<signed char> : public IntegerKeyHash {};
+template <> class KeyHash<unsigned char> : public IntegerKeyHash {};
+template <> class KeyHash<short> : public IntegerKeyHash {};
+template <> class KeyHash<unsigned short> : public IntegerKeyHash {};
+template <> class KeyHash<int> : public IntegerKeyHash {};
+template <> class KeyHash<unsigned int> : public IntegerKeyHash {};
+template <> class KeyHash<long> : public IntegerKeyHash {};
+template <> class KeyHash<unsigned long> : public IntegerKeyHash {};
+template <> class KeyHash<long long> : public IntegerKeyHash {};
+template <> class KeyHash<unsigned long long> : public IntegerKeyHash {};
+
+
+/**
+Hashes pointer keys by address.
+*/
+template <class PointeeType>
+class KeyHash<PointeeType *>
+{
+public:
+
+    THERON_FORCEINLINE static uint32_t Compute(PointeeType *const key)
+    {
+        return IntegerKeyHash::Compute(reinterpret_cast<uintptr_t>(key));
+    }
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MAILBOXES_KEYHASH_H
@@ -8,10 +8,14 @@
 #include <Theron/BasicTypes.h>
 #include <Theron/Defines.h>
 
+#include <Theron/Detail/Containers/List.h>
 #include <Theron/Detail/Containers/Queue.h>
+#include <Theron/Detail/Mailboxes/ConflationIndex.h>
+#include <Theron/Detail/Mailboxes/IConflater.h>
 #include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
 #include <Theron/Detail/Strings/String.h>
-#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Threading/TicketLock.h>
 
 
 #ifdef _MSC_VER
@@ -33,13 +37,59 @@ namespace Detail
 
 /**
 An individual mailbox with a specific address.
+
+The fields touched whenever a message is sent to the mailbox or processed from it are packed
+into a single cache line. Rarely used fields, such as the name and the conflaters, are kept in a
+separate \ref Cold record, which the mailbox directory allocates in a side array alongside the
+mailboxes and attaches to each mailbox.
 */
 class THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) Mailbox : public Queue<Mailbox>::Node
 {
 public:
 
+    /**
+    Rarely used fields of a mailbox, kept out of its cache line.
+    */
+    class Cold
+    {
+    public:
+
+        inline Cold() :
+          mName(),
+          mConflaters(0),
+          mConflated(),
+          mPartner(0),
+          mPartnerWeight(0),
+          mTimestamp(0)
+        {
+        }
+
+        /**
+        Attaches the record to the given mailbox.
+        */
+        inline void Attach(Mailbox &mailbox)
+        {
+            mailbox.mCold = this;
+        }
+
+        String mName;                           ///< Name of the mailbox.
+        const List<IConflater> *mConflaters;    ///< Conflaters of the registered actor, if it conflates messages.
+        ConflationIndex mConflated;             ///< Pending messages that can still be replaced by conflation.
+        Mailbox *mPartner;                      ///< Mailbox most often sent to, in a sampled frequency sketch.
+        uint32_t mPartnerWeight;                ///< Sketch count of the sends to the partner mailbox.
+        uint64_t mTimestamp;                    ///< Used for measuring mailbox scheduling latencies.
+
+    private:
+
+        Cold(const Cold &other);
+        Cold &operator=(const Cold &other);
+    };
+
+    friend class Cold;
+
     /**
     Default constructor.
+    \note The mailbox can't be used until a \ref Cold record has been attached to it.
     */
     inline Mailbox();
 
@@ -72,6 +122,7 @@ public:
 
     /**
     Pushes a message into the mailbox.
+    Messages of types conflated by the registered actor are indexed, so later messages can replace them.
     */
     inline void Push(IMessage *const message);
 
@@ -113,6 +164,7 @@ public:
 
     /**
     Pins the mailbox, preventing the registered actor from being changed.
+    The front message is being processed once the mailbox is pinned, so can no longer be replaced.
     */
     inline void Pin();
 
@@ -126,6 +178,71 @@ public:
     */
     inline bool IsPinned() const;
 
+    /**
+    Marks the mailbox as belonging to an actor whose message handlers may block.
+    \note The mailbox should be locked. The mark is cleared when the actor is deregistered.
+    */
+    inline void SetBlocking(const bool blocking);
+
+    /**
+    Returns true if the mailbox is processed by the framework's pool of blocking worker threads.
+    */
+    inline bool IsBlocking() const;
+
+    /**
+    Sets the conflaters of the registered actor, identifying messages that replace pending messages.
+    Messages already pending are indexed, except the front message if it's being processed.
+    \note The mailbox should be locked. The conflaters are cleared when the actor is deregistered.
+    */
+    inline void SetConflaters(const List<IConflater> *const conflaters);
+
+    /**
+    Returns true if the registered actor conflates messages of some types.
+    */
+    inline bool IsConflating() const;
+
+    /**
+    Replaces a pending message superseded by the given message with the given message, if any.
+    The front message isn't replaced while the mailbox is pinned, since it's being processed.
+    \note The mailbox should be locked.
+    \return The replaced message, which is no longer in the mailbox, or null if none was replaced.
+    */
+    inline IMessage *Conflate(IMessage *const message);
+
+    /**
+    Finds the pending message that a message carrying the given value would replace, if any.
+    This allows the value of the pending message to be overwritten in place, before a new
+    message is allocated. Types are identified by their descriptors, so a miss is possible
+    where a message would still replace a pending one, but never a false hit.
+    \note The mailbox should be locked.
+    \param descriptor Descriptor of the type of the value.
+    \param value The value, which is of the type identified by the descriptor.
+    \return The pending message, which is of the same type, or null if there's none.
+    */
+    inline IMessage *FindConflated(const MessageDescriptor *const descriptor, const void *const value) const;
+
+    /**
+    Gets a reference to the mailbox this mailbox has been seen sending to most often, if any.
+    \note This is only accessed by the worker thread processing the mailbox, and read by the manager thread.
+    */
+    inline Mailbox *&Partner();
+
+    /**
+    Gets a reference to the sampled weight of the sends to the partner mailbox.
+    */
+    inline uint32_t &PartnerWeight();
+
+    /**
+    Sets the home worker thread of the mailbox, on which it's preferably processed.
+    \note The mailbox should be locked. The home is cleared when the actor is deregistered.
+    */
+    inline void SetHome(const uint32_t home);
+
+    /**
+    Returns the home worker thread of the mailbox, or zero if it has none.
+    */
+    inline uint32_t GetHome() const;
+
     /**
     Gets a reference to the timestamp value stored in the mailbox.
     */
@@ -140,38 +257,61 @@ private:
 
     typedef Queue<IMessage> MessageQueue;
 
+    static const uint8_t FLAG_BLOCKING = 1 << 0;       ///< The actor's handlers may block.
+    static const uint8_t FLAG_CONFLATING = 1 << 1;     ///< The actor conflates messages of some types.
+
+    Mailbox(const Mailbox &other);
+    Mailbox &operator=(const Mailbox &other);
+
+    /**
+    Returns the conflater of the registered actor that accepts the given message, if any.
+    */
+    inline const IConflater *GetConflater(const IMessage *const message) const;
+
+    /**
+    Indexes a pending message, if it's of a conflated type.
+    */
+    inline void Index(IMessage *const message);
+
+    /**
+    Unindexes a pending message, if it's of a conflated type.
+    */
+    inline void Unindex(IMessage *const message);
+
     MessageQueue mQueue;                        ///< Queue of messages in this mailbox.
-    String mName;                               ///< Name of this mailbox.
     Actor *mActor;                              ///< Pointer to the actor registered with this mailbox, if any.
-    mutable SpinLock mSpinLock;                 ///< Thread synchronization object protecting the mailbox.
+    Cold *mCold;                                ///< Rarely used fields, in the directory's side array.
+    mutable TicketLock mSpinLock;               ///< Thread synchronization object protecting the mailbox.
     uint32_t mMessageCount;                     ///< Size of the message queue.
-    uint32_t mPinCount;                         ///< Pinning a mailboxes prevents the actor from being deregistered.
-    uint64_t mTimestamp;                        ///< Used for measuring mailbox scheduling latencies.
+    uint16_t mPinCount;                         ///< Pinning a mailboxes prevents the actor from being deregistered.
+    uint8_t mHome;                              ///< Home worker thread chosen by the manager thread, or zero.
+    uint8_t mFlags;                             ///< Flags describing the registered actor.
 
 } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
 
 
 inline Mailbox::Mailbox() :
   mQueue(),
-  mName(),
   mActor(0),
+  mCold(0),
   mSpinLock(),
   mMessageCount(0),
   mPinCount(0),
-  mTimestamp(0)
+  mHome(0),
+  mFlags(0)
 {
 }
 
 
 THERON_FORCEINLINE String Mailbox::GetName() const
 {
-    return mName;
+    return mCold->mName;
 }
 
 
 THERON_FORCEINLINE void Mailbox::SetName(const String &name)
 {
-    mName = name;
+    mCold->mName = name;
 }
 
 
@@ -197,6 +337,11 @@ THERON_FORCEINLINE void Mailbox::Push(IMessage *const message)
 {
     mQueue.Push(message);
     ++mMessageCount;
+
+    if (mFlags & FLAG_CONFLATING)
+    {
+        Index(message);
+    }
 }
 
 
@@ -237,6 +382,14 @@ THERON_FORCEINLINE void Mailbox::DeregisterActor()
     THERON_ASSERT(mActor != 0);
 
     mActor = 0;
+    mHome = 0;
+    mFlags = 0;
+
+    // The index refers to the conflaters, which are freed with the actor.
+    mCold->mConflaters = 0;
+    mCold->mConflated.Clear();
+    mCold->mPartner = 0;
+    mCold->mPartnerWeight = 0;
 }
 
 
@@ -248,7 +401,13 @@ THERON_FORCEINLINE Actor *Mailbox::GetActor() const
 
 THERON_FORCEINLINE void Mailbox::Pin()
 {
+    THERON_ASSERT(mPinCount < 0xFFFF);
     ++mPinCount;
+
+    if ((mFlags & FLAG_CONFLATING) && !mQueue.Empty())
+    {
+        Unindex(mQueue.Front());
+    }
 }
 
 
@@ -265,15 +424,170 @@ THERON_FORCEINLINE bool Mailbox::IsPinned() const
 }
 
 
+THERON_FORCEINLINE void Mailbox::SetBlocking(const bool blocking)
+{
+    // Blocking mailboxes are processed by the blocking pool, which doesn't place them.
+    mFlags = static_cast<uint8_t>(blocking ? (mFlags | FLAG_BLOCKING) : (mFlags & ~FLAG_BLOCKING));
+    mHome = 0;
+}
+
+
+THERON_FORCEINLINE bool Mailbox::IsBlocking() const
+{
+    return ((mFlags & FLAG_BLOCKING) != 0);
+}
+
+
+THERON_FORCEINLINE void Mailbox::SetConflaters(const List<IConflater> *const conflaters)
+{
+    mCold->mConflaters = conflaters;
+    mCold->mConflated.Clear();
+    mFlags = static_cast<uint8_t>(conflaters ? (mFlags | FLAG_CONFLATING) : (mFlags & ~FLAG_CONFLATING));
+
+    if (conflaters == 0 || mQueue.Empty())
+    {
+        return;
+    }
+
+    // The front message of a pinned mailbox is being processed, so can't be replaced.
+    IMessage *pending(mQueue.Front());
+    if (mPinCount > 0)
+    {
+        pending = mQueue.Next(pending);
+    }
+
+    while (pending)
+    {
+        Index(pending);
+        pending = mQueue.Next(pending);
+    }
+}
+
+
+THERON_FORCEINLINE bool Mailbox::IsConflating() const
+{
+    return ((mFlags & FLAG_CONFLATING) != 0);
+}
+
+
+inline IMessage *Mailbox::Conflate(IMessage *const message)
+{
+    THERON_ASSERT(mCold->mConflaters);
+
+    const IConflater *const conflater(GetConflater(message));
+    if (conflater == 0)
+    {
+        return 0;
+    }
+
+    // Only pending messages that aren't being processed are indexed.
+    ConflationIndex &index(mCold->mConflated);
+    IMessage *const pending(index.Find(conflater, message->GetMessageData()));
+    if (pending == 0)
+    {
+        return 0;
+    }
+
+    mQueue.Replace(pending, message);
+
+    // The key of the index entry refers to the value of the replaced message.
+    index.Remove(conflater, pending);
+    index.Insert(conflater, message);
+
+    return pending;
+}
+
+
+inline IMessage *Mailbox::FindConflated(const MessageDescriptor *const descriptor, const void *const value) const
+{
+    // Senders may check the flag without the lock, so it can be stale.
+    if (mCold->mConflaters == 0)
+    {
+        return 0;
+    }
+
+    List<IConflater>::Iterator conflaters(mCold->mConflaters->GetIterator());
+    while (conflaters.Next())
+    {
+        const IConflater *const conflater(conflaters.Get());
+        if (conflater->GetDescriptor() == descriptor)
+        {
+            return mCold->mConflated.Find(conflater, value);
+        }
+    }
+
+    return 0;
+}
+
+
+inline const IConflater *Mailbox::GetConflater(const IMessage *const message) const
+{
+    List<IConflater>::Iterator conflaters(mCold->mConflaters->GetIterator());
+    while (conflaters.Next())
+    {
+        const IConflater *const conflater(conflaters.Get());
+        if (conflater->Accepts(message))
+        {
+            return conflater;
+        }
+    }
+
+    return 0;
+}
+
+
+inline void Mailbox::Index(IMessage *const message)
+{
+    if (const IConflater *const conflater = GetConflater(message))
+    {
+        mCold->mConflated.Insert(conflater, message);
+    }
+}
+
+
+inline void Mailbox::Unindex(IMessage *const message)
+{
+    if (const IConflater *const conflater = GetConflater(message))
+    {
+        mCold->mConflated.Remove(conflater, message);
+    }
+}
+
+
+THERON_FORCEINLINE Mailbox *&Mailbox::Partner()
+{
+    return mCold->mPartner;
+}
+
+
+THERON_FORCEINLINE uint32_t &Mailbox::PartnerWeight()
+{
+    return mCold->mPartnerWeight;
+}
+
+
+THERON_FORCEINLINE void Mailbox::SetHome(const uint32_t home)
+{
+    THERON_ASSERT(home <= 0xFF);
+    mHome = static_cast<uint8_t>(home);
+}
+
+
+THERON_FORCEINLINE uint32_t Mailbox::GetHome() const
+{
+    return mHome;
+}
+
+
 THERON_FORCEINLINE uint64_t &Mailbox::Timestamp()
 {
-    return mTimestamp;
+    return mCold->mTimestamp;
 }
 
 
 THERON_FORCEINLINE const uint64_t &Mailbox::Timestamp() const
 {
-    return mTimestamp;
+    return mCold->mTimestamp;
 }
 
 
@@ -9,6 +9,7 @@
 #include <Theron/Defines.h>
 
 #include <Theron/Detail/Containers/Queue.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
 
 
 namespace Theron
@@ -19,6 +20,11 @@ namespace Detail
 
 /**
 Interface describing the generic API of the message class template.
+
+The interface has no virtual functions: instead each message refers to the descriptor of its
+value type, which describes the value and how to destruct it. So messages carry no pointer to
+a table of virtual functions, and handling and destroying them involves no indirect calls,
+except to destruct values of types that aren't trivially destructible.
 */
 class IMessage : public Queue<IMessage>::Node
 {
@@ -51,6 +57,23 @@ public:
         return mBlockSize;
     }
 
+    /**
+    Sets the deadline by which the message should be handled, in milliseconds of the process clock.
+    A deadline of zero means the message has no deadline.
+    */
+    THERON_FORCEINLINE void SetDeadline(const uint32_t deadline)
+    {
+        mDeadline = deadline;
+    }
+
+    /**
+    Returns the deadline by which the message should be handled, or zero if it has none.
+    */
+    THERON_FORCEINLINE uint32_t GetDeadline() const
+    {
+        return mDeadline;
+    }
+
     /**
     Returns the message value as blind data.
     */
@@ -60,28 +83,42 @@ public:
         return mBlock;
     }
 
+    /**
+    Returns the descriptor of the type of the message value.
+    */
+    THERON_FORCEINLINE const MessageDescriptor *GetDescriptor() const
+    {
+        return mDescriptor;
+    }
+
     /**
     Returns the size in bytes of the message data.
     */
-    virtual uint32_t GetMessageSize() const = 0;
+    THERON_FORCEINLINE uint32_t GetMessageSize() const
+    {
+        return mDescriptor->mSize;
+    }
 
     /**
     Returns the name of the message type.
     This uniquely identifies the type of the message value.
     \note Unless explicitly specified to avoid C++ RTTI, message names are null.
     */
-    virtual const char *TypeName() const = 0;
-
-    /**
-    Allows the message instance to destruct its constructed value object before being freed.
-    */
-    virtual void Release() = 0;
+    THERON_FORCEINLINE const char *TypeName() const
+    {
+        return *mDescriptor->mTypeName;
+    }
 
     /**
-    Virtual destructor.
+    Destructs the message value before the message is freed.
+    Values of trivially destructible types aren't destructed at all.
     */
-    virtual ~IMessage()
+    THERON_FORCEINLINE void Release()
     {
+        if (const MessageDescriptor::DestroyFunction destroy = mDescriptor->mDestroy)
+        {
+            destroy(mBlock);
+        }
     }
 
 protected:
@@ -91,16 +128,27 @@ protected:
     \param from The address from which the message was sent.
     \param block The memory block containing the message.
     \param blockSize The size of the memory block containing the message.
-    \param typeName String identifier uniquely identifying the type of the message value.
+    \param descriptor Descriptor of the type of the message value.
     */
     THERON_FORCEINLINE IMessage(
         const Address &from,
         void *const block,
-        const uint32_t blockSize) :
+        const uint32_t blockSize,
+        const MessageDescriptor *const descriptor) :
+      mDescriptor(descriptor),
       mFrom(from),
       mBlock(block),
-      mBlockSize(blockSize)
+      mBlockSize(blockSize),
+      mDeadline(0)
+    {
+    }
+
+    /**
+    Sets the address from which the message was sent, when its value is replaced.
+    */
+    THERON_FORCEINLINE void SetFrom(const Address &from)
     {
+        mFrom = from;
     }
 
 private:
@@ -108,9 +156,11 @@ private:
     IMessage(const IMessage &other);
     IMessage &operator=(const IMessage &other);
 
-    const Address mFrom;            ///< The address from which the message was sent.
+    const MessageDescriptor *const mDescriptor;     ///< Descriptor of the type of the message value.
+    Address mFrom;                  ///< The address from which the message was sent.
     void *const mBlock;             ///< Pointer to the memory block containing the message.
     const uint32_t mBlockSize;      ///< Total size of the message memory block in bytes.
+    uint32_t mDeadline;             ///< Deadline in milliseconds of the process clock, or zero if none.
 };
 
 
@@ -5,6 +5,7 @@
 
 #include <new>
 
+#include <Theron/Align.h>
 #include <Theron/AllocatorManager.h>
 #include <Theron/Assert.h>
 #include <Theron/BasicTypes.h>
@@ -12,6 +13,7 @@
 
 #include <Theron/Detail/Alignment/MessageAlignment.h>
 #include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
 #include <Theron/Detail/Messages/MessageSize.h>
 #include <Theron/Detail/Messages/MessageTraits.h>
 
@@ -32,13 +34,6 @@ public:
 
     typedef Message<ValueType> ThisType;
 
-    /**
-    Virtual destructor.
-    */
-    THERON_FORCEINLINE virtual ~Message()
-    {
-    }
-
     /**
     Returns the memory block size required to initialize a message of this type.
     */
@@ -47,8 +42,8 @@ public:
         // We allocate an aligned buffer to hold the message and its copy of the value.
         // We lay the message and its value side by side in memory.
         // The value is first, since it's the value that needs the alignment.
-        // The message object itself doesn't need special alignment.
-        return MessageSize<ValueType>::GetSize() + sizeof(ThisType);
+        // The message object only needs natural alignment, so follows the padded value.
+        return GetObjectOffset() + sizeof(ThisType);
     }
 
     /**
@@ -56,7 +51,11 @@ public:
     */
     THERON_FORCEINLINE static uint32_t GetAlignment()
     {
-        return MessageAlignment<ValueType>::ALIGNMENT;
+        // The block must also be aligned well enough for the message object.
+        const uint32_t valueAlignment(MessageAlignment<ValueType>::ALIGNMENT);
+        const uint32_t objectAlignment(THERON_ALIGNOF(ThisType));
+
+        return valueAlignment > objectAlignment ? valueAlignment : objectAlignment;
     }
 
     /**
@@ -72,40 +71,41 @@ public:
         // Messages are explicitly copied to avoid shared memory.
         ValueType *const pValue = new (block) ValueType(value);
 
-        // Allocate the message object immediately after the value, passing it the value's address.
-        char *const pObject(reinterpret_cast<char *>(pValue) + MessageSize<ValueType>::GetSize());
+        // Allocate the message object after the padded value, passing it the value's address.
+        char *const pObject(reinterpret_cast<char *>(pValue) + GetObjectOffset());
         return new (pObject) ThisType(pValue, from);
     }
 
     /**
-    Returns the name of the message type.
-    This uniquely identifies the type of the message value.
-    \note Unless explicitly specified to avoid C++ RTTI, message names are null.
+    Initializes a message of this type in a recycled memory block, which may be larger than needed.
+    The message keeps the size of the whole block, so that the block is freed with its true size.
     */
-    virtual const char *TypeName() const
+    THERON_FORCEINLINE static ThisType *Initialize(
+        void *const block,
+        const uint32_t blockSize,
+        const ValueType &value,
+        const Address &from)
     {
-        return MessageTraits<ValueType>::TYPE_NAME;
-    }
+        THERON_ASSERT(block);
+        THERON_ASSERT(blockSize >= GetSize());
+        THERON_ASSERT(THERON_ALIGNED(block, GetAlignment()));
 
-    /**
-    Allows the message instance to destruct its constructed value object before being freed.
-    */
-    virtual void Release()
-    {
-        // The referenced block owned by this message is blind data, but we know it holds
-        // an instance of the value type, that needs to be explicitly destructed.
-        // We have to call the destructor manually because we constructed the object in-place.
-        Value().~ValueType();
+        ValueType *const pValue = new (block) ValueType(value);
+        char *const pObject(reinterpret_cast<char *>(pValue) + GetObjectOffset());
+        return new (pObject) ThisType(pValue, blockSize, from);
     }
 
     /**
-    Returns the size in bytes of the message value.
+    Replaces the value carried by a pending message, and the address from which it was sent.
+    The value is destructed and copy-constructed in place, so value types needn't be assignable.
     */
-    virtual uint32_t GetMessageSize() const
+    THERON_FORCEINLINE void Replace(const ValueType &value, const Address &from)
     {
-        // Calculate the size of the message value itself. There's no padding between the
-        // message value block and the Message object that follows it.
-        return GetBlockSize() - static_cast<uint32_t>(sizeof(ThisType));
+        ValueType *const pValue(reinterpret_cast<ValueType *>(GetBlock()));
+        pValue->~ValueType();
+        new (pValue) ValueType(value);
+
+        SetFrom(from);
     }
 
     /**
@@ -119,11 +119,30 @@ public:
 
 private:
 
+    /**
+    Returns the offset of the message object from the start of the memory block.
+    The value is padded so that the message object that follows it is correctly aligned.
+    */
+    THERON_FORCEINLINE static uint32_t GetObjectOffset()
+    {
+        uint32_t valueSize(MessageSize<ValueType>::GetSize());
+        return THERON_ROUNDUP(valueSize, THERON_ALIGNOF(ThisType));
+    }
+
     /**
     Private constructor.
     */
     THERON_FORCEINLINE Message(void *const block, const Address &from) :
-      IMessage(from, block, ThisType::GetSize())
+      IMessage(from, block, ThisType::GetSize(), &MessageTypeDescriptor<ValueType>::smDescriptor)
+    {
+        THERON_ASSERT(block);
+    }
+
+    /**
+    Private constructor for messages in recycled blocks of the given size.
+    */
+    THERON_FORCEINLINE Message(void *const block, const uint32_t blockSize, const Address &from) :
+      IMessage(from, block, blockSize, &MessageTypeDescriptor<ValueType>::smDescriptor)
     {
         THERON_ASSERT(block);
     }
@@ -0,0 +1,228 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MESSAGES_MESSAGEBUDGET_H
+#define THERON_DETAIL_MESSAGES_MESSAGEBUDGET_H
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/MessageBudgetPolicy.h>
+
+#include <Theron/Detail/Containers/List.h>
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Condition.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Accounts for the memory of the messages waiting in the mailboxes of a framework, and
+enforces an optional budget on it.
+
+Messages are charged when they're pushed into one of the framework's mailboxes, and credited
+when the worker thread that processed them destroys them. Each worker thread keeps a running
+count of its own charges and credits in an \ref Account, which only it writes, so accounting
+for a message costs the thread a single non-atomic addition. The count is added to the shared
+total only once it grows past a small threshold. Messages pushed by other threads, which share
+a mailbox context, are charged to the shared total directly.
+
+The shared total is therefore out by up to the threshold per worker thread. It's only used to
+spot sends that might exceed the budget: those compute the exact usage, by adding up the counts
+of all the registered accounts, before applying the policy. The peak usage is sampled whenever
+counts are added to the total.
+*/
+class MessageBudget
+{
+public:
+
+    /**
+    Per-thread count of message bytes charged and credited but not yet added to the shared total.
+    */
+    class Account : public List<Account>::Node
+    {
+    public:
+
+        inline Account() : mBytes(0)
+        {
+        }
+
+        volatile int32_t mBytes;        ///< Bytes charged minus bytes credited. Written only by the owning thread.
+
+    private:
+
+        Account(const Account &other);
+        Account &operator=(const Account &other);
+    };
+
+    /**
+    Constructor.
+    \param budget Limit in bytes on the memory of waiting messages. Zero disables accounting.
+    */
+    MessageBudget(
+        const uint32_t budget,
+        const MessageBudgetPolicy policy,
+        const MessageBudgetCallback callback,
+        void *const callbackContext);
+
+    /**
+    Returns true if the budget is enabled, and so messages should be accounted for.
+    */
+    THERON_FORCEINLINE bool Enabled() const
+    {
+        return (mBudget != 0);
+    }
+
+    /**
+    Returns the policy applied to messages that would exceed the budget.
+    */
+    THERON_FORCEINLINE MessageBudgetPolicy GetPolicy() const
+    {
+        return mPolicy;
+    }
+
+    /**
+    Registers the account of a worker thread, so its count is included in the exact usage.
+    */
+    void Register(Account *const account);
+
+    /**
+    Deregisters a previously registered account, adding its count to the shared total.
+    */
+    void Deregister(Account *const account);
+
+    /**
+    Charges the budget for a message, unless the policy refuses it.
+    \param account Account of the calling worker thread, or null if the caller isn't a worker thread.
+    \return False if the message was refused, in which case nothing was charged.
+    */
+    THERON_FORCEINLINE bool Charge(Account *const account, const uint32_t bytes);
+
+    /**
+    Charges the budget for a message unconditionally.
+    */
+    THERON_FORCEINLINE void Add(Account *const account, const uint32_t bytes);
+
+    /**
+    Credits the budget for a message that has been destroyed.
+    */
+    THERON_FORCEINLINE void Credit(Account *const account, const uint32_t bytes);
+
+    /**
+    Waits until the framework has room for a message of the given size.
+    A message larger than the whole budget is admitted once no other messages are waiting.
+    \note The caller mustn't be a worker thread, which would stop the messages being processed.
+    */
+    void WaitForRoom(const uint32_t bytes);
+
+    /**
+    Returns the exact number of bytes of message memory in use.
+    */
+    uint32_t GetUsage() const;
+
+    /**
+    Returns the peak number of bytes of message memory in use, as sampled.
+    */
+    uint32_t GetPeakUsage() const;
+
+private:
+
+    static const int32_t FLUSH_THRESHOLD = 4096;    ///< Size of per-thread count added to the shared total.
+    static const uint32_t WAIT_PERIOD = 1;          ///< Milliseconds between checks of the exact usage while waiting.
+
+    MessageBudget(const MessageBudget &other);
+    MessageBudget &operator=(const MessageBudget &other);
+
+    /**
+    Decides whether to accept a message that may exceed the budget.
+    */
+    bool Admit(const uint32_t bytes);
+
+    /**
+    Adds the count of an account to the shared total.
+    */
+    void Flush(Account *const account);
+
+    /**
+    Adds a change in usage to the shared total, and updates the peak.
+    */
+    void Update(const int32_t bytes);
+
+    /**
+    Adds up the shared total and the counts of the registered accounts.
+    \note The condition's mutex should be held.
+    */
+    int32_t ComputeUsage() const;
+
+    const int32_t mBudget;                          ///< Limit on message memory in bytes, or zero if disabled.
+    const MessageBudgetPolicy mPolicy;              ///< What to do with messages that would exceed the budget.
+    const MessageBudgetCallback mCallback;          ///< Callback deciding what to do, with MESSAGE_BUDGET_CALLBACK.
+    void *const mCallbackContext;                   ///< User-defined context pointer passed to the callback.
+    Atomic::UInt32 mTotal;                          ///< Signed total of the counts added from accounts and direct charges.
+    Atomic::UInt32 mPeak;                           ///< Highest sampled usage.
+    Atomic::UInt32 mWaiters;                        ///< Number of threads waiting for room.
+    mutable Condition mCondition;                   ///< Pulsed when usage falls while threads wait. Its mutex protects the accounts.
+    List<Account> mAccounts;                        ///< Registered per-thread accounts.
+};
+
+
+THERON_FORCEINLINE bool MessageBudget::Charge(Account *const account, const uint32_t bytes)
+{
+    // The counts not yet added to the total can make it look fuller than it is, so check exactly before refusing.
+    const int32_t local(account ? account->mBytes : 0);
+    if (static_cast<int32_t>(mTotal.LoadRelaxed()) + local + static_cast<int32_t>(bytes) > mBudget && !Admit(bytes))
+    {
+        return false;
+    }
+
+    Add(account, bytes);
+    return true;
+}
+
+
+THERON_FORCEINLINE void MessageBudget::Add(Account *const account, const uint32_t bytes)
+{
+    if (account)
+    {
+        const int32_t count(account->mBytes + static_cast<int32_t>(bytes));
+        account->mBytes = count;
+
+        if (count > FLUSH_THRESHOLD)
+        {
+            Flush(account);
+        }
+
+        return;
+    }
+
+    Update(static_cast<int32_t>(bytes));
+}
+
+
+THERON_FORCEINLINE void MessageBudget::Credit(Account *const account, const uint32_t bytes)
+{
+    if (account)
+    {
+        const int32_t count(account->mBytes - static_cast<int32_t>(bytes));
+        account->mBytes = count;
+
+        // Credits are passed on immediately while senders are waiting for room.
+        if (count < -FLUSH_THRESHOLD || mWaiters.LoadRelaxed() != 0)
+        {
+            Flush(account);
+        }
+
+        return;
+    }
+
+    Update(-static_cast<int32_t>(bytes));
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MESSAGES_MESSAGEBUDGET_H
@@ -8,6 +8,7 @@
 
 #include <Theron/Detail/Messages/IMessage.h>
 #include <Theron/Detail/Messages/Message.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
 #include <Theron/Detail/Messages/MessageTraits.h>
 
 
@@ -25,12 +26,13 @@ If the unknown message is of the target type then the cast succeeds and a pointe
 to the typecast message is returned, otherwise a null pointer is returned.
 
 This utility roughly mimics the functionality of dynamic_cast, but includes
-two alternate implementations: one that uses dynamic_cast directly and another
-that rolls its own runtime type information only for message classes. The
+two alternate implementations: one that compares the C++ type information of
+the message values and another that rolls its own runtime type information
+only for message classes. The
 advantage of the second implementation is that the storage overhead of the extra
 runtime type information is not imposed on \em all classes, as with the C++ RTTI.
-If the second implementation is used consistently then dynamic_cast is not
-called at all, using a partial template specialization trick, and the C++ RTTI
+If the second implementation is used consistently then typeid is not
+used at all, using a partial template specialization trick, and the C++ RTTI
 functionality can be turned off (usually by means of a compiler option).
 
 \note Partial template specialization is used here as a device to avoid
@@ -96,14 +98,28 @@ public:
         // Explicit type IDs must be defined for all message types or none at all.
         THERON_ASSERT_MSG(message->TypeName() == 0, "Only some message types are registered!");
 
-        // Try to convert the given message to a message of the expected type.
-        // The dynamic_cast used here requires Runtime Type Information (RTTI) support.
+        // Messages refer to the descriptor of their value type, which is usually unique,
+        // so in the common case the types match if the descriptors are the same.
+        const MessageDescriptor *const descriptor(message->GetDescriptor());
+        if (descriptor == &MessageTypeDescriptor<ValueType>::smDescriptor)
+        {
+            return reinterpret_cast<const Message<ValueType> *>(message);
+        }
+
+        // Otherwise compare the types themselves, since descriptors may be duplicated
+        // in different modules, such as shared libraries.
+        // The typeid used here requires Runtime Type Information (RTTI) support.
         // If you see a failure here then check RTTI is enabled in your build,
         // or if you actually intend to turn it off then register your message type name
         // with THERON_REGISTER_MESSAGE() -- see the RegisteringMessages sample.
         // That causes the default (unspecialized) version of this class to be used,
-        // which doesn't try to use dynamic_cast so doesn't require RTTI.
-        return dynamic_cast<const Message<ValueType> *>(message);
+        // which doesn't try to use typeid so doesn't require RTTI.
+        if (*descriptor->mTypeInfo() == typeid(ValueType))
+        {
+            return reinterpret_cast<const Message<ValueType> *>(message);
+        }
+
+        return 0;
     }
 };
 
@@ -10,6 +10,7 @@
 
 #include <Theron/Detail/Messages/IMessage.h>
 #include <Theron/Detail/Messages/Message.h>
+#include <Theron/Detail/Messages/MessageSlot.h>
 
 
 namespace Theron
@@ -27,19 +28,23 @@ public:
 
     /**
     Allocates and constructs a message with the given value and from address.
+    Messages small enough to fit in a slot are allocated in one, from the given slot pool if any.
     */
     template <class ValueType>
     inline static Message<ValueType> *Create(
         IAllocator *const messageAllocator,
         const ValueType &value,
-        const Address &from);
+        const Address &from,
+        MessageSlotPool *const messageSlots = 0);
 
     /**
     Destructs and frees a message of unknown type referenced by an interface pointer.
+    Messages allocated in slots are freed to the given slot pool if any.
     */
     inline static void Destroy(
         IAllocator *const messageAllocator,
-        IMessage *const message);
+        IMessage *const message,
+        MessageSlotPool *const messageSlots = 0);
 };
 
 
@@ -48,10 +53,27 @@ template <class ValueType>
 THERON_FORCEINLINE Message<ValueType> *MessageCreator::Create(
     IAllocator *const messageAllocator,
     const ValueType &value,
-    const Address &from)
+    const Address &from,
+    MessageSlotPool *const messageSlots)
 {
     typedef Message<ValueType> MessageType;
 
+    // Small messages are allocated in fixed-size slots, which is decided at compile time.
+    // The message keeps the size of the slot, so that it's freed as a slot.
+    if (MessageSlot<ValueType>::FITS)
+    {
+        void *const slot(messageSlots ?
+            messageSlots->Allocate() :
+            messageAllocator->AllocateAligned(MessageSlotPool::SIZE, MessageSlotPool::ALIGNMENT));
+
+        if (slot)
+        {
+            return MessageType::Initialize(slot, MessageSlotPool::SIZE, value, from);
+        }
+
+        return 0;
+    }
+
     const uint32_t blockSize(MessageType::GetSize());
     const uint32_t blockAlignment(MessageType::GetAlignment());
 
@@ -70,14 +92,19 @@ THERON_FORCEINLINE Message<ValueType> *MessageCreator::Create(
 
 THERON_FORCEINLINE void MessageCreator::Destroy(
     IAllocator *const messageAllocator,
-    IMessage *const message)
+    IMessage *const message,
+    MessageSlotPool *const messageSlots)
 {
-    // Call release on the message to give it chance to destruct its value type.
+    // Destruct the message value, unless its type is trivially destructible.
+    // The message object itself has a trivial destructor, so needn't be destructed.
     message->Release();
 
-    // Destruct the message object itself.
-    // This calls the derived Message class destructor by virtual function magic.
-    message->~IMessage();
+    // Message blocks of the slot size are always slots, or else are aligned even more strictly.
+    if (messageSlots && message->GetBlockSize() == MessageSlotPool::SIZE)
+    {
+        messageSlots->Free(message->GetBlock());
+        return;
+    }
 
     // Return the block to the global free list.
     messageAllocator->Free(message->GetBlock(), message->GetBlockSize());
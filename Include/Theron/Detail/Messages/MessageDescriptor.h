@@ -0,0 +1,118 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MESSAGES_MESSAGEDESCRIPTOR_H
+#define THERON_DETAIL_MESSAGES_MESSAGEDESCRIPTOR_H
+
+
+#include <typeinfo>
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Alignment/MessageAlignment.h>
+#include <Theron/Detail/Messages/MessageSize.h>
+#include <Theron/Detail/Messages/MessageTraits.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Compact description of a message value type, shared by all the messages carrying values of the type.
+
+Each message refers to the descriptor of its value type in place of a table of virtual functions,
+so querying the size and name of a message don't involve indirect calls, and destroying a message
+whose value type is trivially destructible, such as a Plain-Old-Data type, involves no calls at all.
+*/
+struct MessageDescriptor
+{
+    typedef void (*DestroyFunction)(void *const value);
+    typedef const std::type_info *(*TypeInfoFunction)();
+
+    uint32_t mSize;                             ///< Size of the value in bytes, as given by MessageSize.
+    uint32_t mAlignment;                        ///< Alignment of the value in bytes, as given by MessageAlignment.
+    DestroyFunction mDestroy;                   ///< Destructs the value, or null if it's trivially destructible.
+    TypeInfoFunction mTypeInfo;                 ///< Returns the C++ type information of unregistered types.
+    const char *const *mTypeName;               ///< Points to the registered name of the type, which is null if unregistered.
+};
+
+
+/**
+Tells whether destructing values of a type can be skipped, because their destructors do nothing.
+Where the compiler can't tell, values are always destructed.
+*/
+template <class ValueType>
+struct MessageDestruction
+{
+#if THERON_MSVC || THERON_GCC
+    static const bool TRIVIAL = __has_trivial_destructor(ValueType);
+#else
+    static const bool TRIVIAL = false;
+#endif
+};
+
+
+/**
+Returns the C++ runtime type information of unregistered message types, which are matched using it.
+*/
+template <class ValueType, bool HAS_TYPE_NAME = MessageTraits<ValueType>::HAS_TYPE_NAME>
+struct MessageTypeInfo
+{
+    inline static const std::type_info *Get()
+    {
+        return &typeid(ValueType);
+    }
+};
+
+
+/**
+Registered message types are matched using their names, so don't need C++ RTTI, which may be disabled.
+*/
+template <class ValueType>
+struct MessageTypeInfo<ValueType, true>
+{
+    inline static const std::type_info *Get()
+    {
+        return 0;
+    }
+};
+
+
+/**
+Holds the descriptor of each message value type.
+The descriptors are initialized statically, so are valid even during static initialization.
+*/
+template <class ValueType>
+class MessageTypeDescriptor
+{
+public:
+
+    static const MessageDescriptor smDescriptor;        ///< The descriptor of the value type.
+
+private:
+
+    inline static void Destroy(void *const value)
+    {
+        reinterpret_cast<ValueType *>(value)->~ValueType();
+    }
+};
+
+
+template <class ValueType>
+const MessageDescriptor MessageTypeDescriptor<ValueType>::smDescriptor =
+{
+    MessageSize<ValueType>::SIZE,
+    MessageAlignment<ValueType>::ALIGNMENT,
+    MessageDestruction<ValueType>::TRIVIAL ? 0 : &MessageTypeDescriptor<ValueType>::Destroy,
+    &MessageTypeInfo<ValueType>::Get,
+    &MessageTraits<ValueType>::TYPE_NAME
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MESSAGES_MESSAGEDESCRIPTOR_H
@@ -0,0 +1,118 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MESSAGES_MESSAGEEXPIRY_H
+#define THERON_DETAIL_MESSAGES_MESSAGEEXPIRY_H
+
+
+#include <Theron/Address.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
+#include <Theron/Detail/Messages/IMessage.h>
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Clock.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Drops messages whose deadlines passed while they waited in the mailboxes of a framework.
+
+Messages sent with a time-to-live carry a deadline, in milliseconds of a wrapping process clock.
+Worker threads check the deadline of each message that has one before executing its handler, and
+pass expired messages here instead. Expired messages are counted, and passed to the framework's
+expiry handler if one is set, before being destroyed as usual.
+*/
+class MessageExpiry
+{
+public:
+
+    /**
+    Default constructor.
+    */
+    MessageExpiry();
+
+    /**
+    Returns the deadline of a message sent now with the given time-to-live in milliseconds.
+    The returned deadline is never zero, which marks messages without one.
+    */
+    THERON_FORCEINLINE static uint32_t GetDeadline(const uint32_t timeToLive)
+    {
+        const uint32_t deadline(GetTime() + timeToLive);
+        return deadline ? deadline : 1;
+    }
+
+    /**
+    Returns true if the given message has a deadline and it has passed.
+    */
+    THERON_FORCEINLINE static bool Expired(const IMessage *const message)
+    {
+        const uint32_t deadline(message->GetDeadline());
+
+        // The clock wraps, so deadlines are compared relative to the current time.
+        return (deadline != 0 && static_cast<int32_t>(GetTime() - deadline) > 0);
+    }
+
+    /**
+    Sets the handler executed for expired messages.
+    */
+    template <class ObjectType>
+    inline bool SetHandler(
+        ObjectType *const handlerObject,
+        void (ObjectType::*handler)(const Address from))
+    {
+        return mHandlers.Set(handlerObject, handler);
+    }
+
+    /**
+    Sets the handler executed for expired messages, which is passed them as blind data.
+    */
+    template <class ObjectType>
+    inline bool SetHandler(
+        ObjectType *const handlerObject,
+        void (ObjectType::*handler)(const void *const data, const uint32_t size, const Address from))
+    {
+        return mHandlers.Set(handlerObject, handler);
+    }
+
+    /**
+    Counts an expired message and passes it to the expiry handler, if any.
+    \note This function is intentionally not force-inlined since messages don't usually expire.
+    */
+    void Expire(const IMessage *const message);
+
+    /**
+    Returns the number of messages that have expired.
+    */
+    THERON_FORCEINLINE uint32_t GetCount() const
+    {
+        return mCount.LoadRelaxed();
+    }
+
+private:
+
+    MessageExpiry(const MessageExpiry &other);
+    MessageExpiry &operator=(const MessageExpiry &other);
+
+    /**
+    Returns the wrapping process time in milliseconds.
+    */
+    THERON_FORCEINLINE static uint32_t GetTime()
+    {
+        return static_cast<uint32_t>(Clock::GetTicks() / (Clock::GetFrequency() / 1000));
+    }
+
+    FallbackHandlerCollection mHandlers;    ///< Handler executed for expired messages, if any.
+    Atomic::UInt32 mCount;                  ///< Number of messages that have expired.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MESSAGES_MESSAGEEXPIRY_H
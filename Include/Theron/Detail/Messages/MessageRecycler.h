@@ -0,0 +1,181 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MESSAGES_MESSAGERECYCLER_H
+#define THERON_DETAIL_MESSAGES_MESSAGERECYCLER_H
+
+
+#include <Theron/Address.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Messages/IMessage.h>
+
+
+namespace Theron
+{
+
+
+class Framework;
+
+
+namespace Detail
+{
+
+
+class MailboxContext;
+
+
+/**
+Records a request to recycle the memory block of the message being handled for an outgoing message.
+
+Actor::Reply and Actor::Forward claim the block of the message being handled, instead of
+allocating a new one, when it's big enough. The handled message is still queued in the
+actor's mailbox until its handlers have all returned, so the outgoing message can't be
+sent straight away; instead the recycler records how to send it, and the mailbox processor
+sends it once the handled message has been popped, in place of freeing the block.
+*/
+class MessageRecycler
+{
+public:
+
+    /**
+    Function that rebuilds the outgoing message in the block of the handled message, and sends it.
+    */
+    typedef void (*SendFunction)(MailboxContext *const mailboxContext, IMessage *const message);
+
+    /**
+    Constructor.
+    */
+    inline MessageRecycler() :
+      mMessage(0),
+      mSendFunction(0),
+      mFramework(0),
+      mValue(0),
+      mFrom(),
+      mAddress()
+    {
+    }
+
+    /**
+    Starts handling the given message, making its block available for recycling.
+    */
+    THERON_FORCEINLINE void Begin(IMessage *const message)
+    {
+        THERON_ASSERT(mSendFunction == 0);
+        mMessage = message;
+    }
+
+    /**
+    Finishes handling the message, after which its block is no longer available.
+    \return True if the block was claimed, in which case \ref Send must be called once it's popped.
+    */
+    THERON_FORCEINLINE bool End()
+    {
+        mMessage = 0;
+        return (mSendFunction != 0);
+    }
+
+    /**
+    Returns the message being handled, or zero if no message is being handled.
+    */
+    THERON_FORCEINLINE IMessage *GetMessage() const
+    {
+        return mMessage;
+    }
+
+    /**
+    Returns true if the block of the message being handled is still available for recycling.
+    */
+    THERON_FORCEINLINE bool Available() const
+    {
+        return (mMessage != 0 && mSendFunction == 0);
+    }
+
+    /**
+    Claims the block of the message being handled for an outgoing message.
+    \param sendFunction Function that sends the outgoing message once the handled message is popped.
+    \param framework The framework of the sending actor, via which the outgoing message is sent.
+    \param value Copy of the value of the outgoing message, if it's a new message, or zero.
+    \param from The address from which the outgoing message is sent.
+    \param address The address to which the outgoing message is sent.
+    */
+    THERON_FORCEINLINE void Claim(
+        SendFunction sendFunction,
+        Framework *const framework,
+        void *const value,
+        const Address &from,
+        const Address &address)
+    {
+        THERON_ASSERT(Available());
+
+        mSendFunction = sendFunction;
+        mFramework = framework;
+        mValue = value;
+        mFrom = from;
+        mAddress = address;
+    }
+
+    /**
+    Sends the outgoing message using the block of the handled message, which has been popped.
+    */
+    THERON_FORCEINLINE void Send(MailboxContext *const mailboxContext, IMessage *const message)
+    {
+        THERON_ASSERT(mSendFunction);
+
+        const SendFunction sendFunction(mSendFunction);
+        mSendFunction = 0;
+
+        sendFunction(mailboxContext, message);
+    }
+
+    /**
+    Returns the framework via which the outgoing message is sent.
+    */
+    THERON_FORCEINLINE Framework *GetFramework() const
+    {
+        return mFramework;
+    }
+
+    /**
+    Returns the copy of the value of the outgoing message, if any.
+    */
+    THERON_FORCEINLINE void *GetValue() const
+    {
+        return mValue;
+    }
+
+    /**
+    Returns the address from which the outgoing message is sent.
+    */
+    THERON_FORCEINLINE const Address &GetFrom() const
+    {
+        return mFrom;
+    }
+
+    /**
+    Returns the address to which the outgoing message is sent.
+    */
+    THERON_FORCEINLINE const Address &GetAddress() const
+    {
+        return mAddress;
+    }
+
+private:
+
+    MessageRecycler(const MessageRecycler &other);
+    MessageRecycler &operator=(const MessageRecycler &other);
+
+    IMessage *mMessage;                 ///< The message being handled, if any.
+    SendFunction mSendFunction;         ///< Sends the outgoing message, if the block has been claimed.
+    Framework *mFramework;              ///< Framework via which the outgoing message is sent.
+    void *mValue;                       ///< Copy of the value of the outgoing message, held in scratch memory.
+    Address mFrom;                      ///< Address from which the outgoing message is sent.
+    Address mAddress;                   ///< Address to which the outgoing message is sent.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MESSAGES_MESSAGERECYCLER_H
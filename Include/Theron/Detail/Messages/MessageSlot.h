@@ -0,0 +1,54 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_MESSAGES_MESSAGESLOT_H
+#define THERON_DETAIL_MESSAGES_MESSAGESLOT_H
+
+
+#include <Theron/Align.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Alignment/MessageAlignment.h>
+#include <Theron/Detail/Allocators/SlotPool.h>
+#include <Theron/Detail/Messages/Message.h>
+#include <Theron/Detail/Messages/MessageSize.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Per-thread pool of the fixed-size memory slots in which small messages are allocated.
+*/
+typedef SlotPool<THERON_MESSAGE_SLOT_SIZE, THERON_CACHELINE_ALIGNMENT, 256> MessageSlotPool;
+
+
+/**
+Tells whether messages of a given value type are small enough to be allocated in a slot.
+
+This is worked out at compile time from the size and alignment of the value type, mirroring
+Message::GetSize and Message::GetAlignment, so that the choice of slot or exactly sized block
+costs nothing at runtime.
+*/
+template <class ValueType>
+struct MessageSlot
+{
+    static const uint32_t OBJECT_ALIGNMENT = THERON_ALIGNOF(Message<ValueType>);
+    static const uint32_t VALUE_ALIGNMENT = MessageAlignment<ValueType>::ALIGNMENT;
+
+    static const uint32_t BLOCK_SIZE = ((MessageSize<ValueType>::SIZE + OBJECT_ALIGNMENT - 1) & ~(OBJECT_ALIGNMENT - 1)) +
+        static_cast<uint32_t>(sizeof(Message<ValueType>));
+
+    static const uint32_t BLOCK_ALIGNMENT = VALUE_ALIGNMENT > OBJECT_ALIGNMENT ? VALUE_ALIGNMENT : OBJECT_ALIGNMENT;
+
+    static const bool FITS = (BLOCK_SIZE <= MessageSlotPool::SIZE && BLOCK_ALIGNMENT <= MessageSlotPool::ALIGNMENT);
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_MESSAGES_MESSAGESLOT_H
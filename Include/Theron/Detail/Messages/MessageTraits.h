@@ -20,7 +20,7 @@ registered in the receiving actor.
 
 The default implementation defines a null pointer (no name) for all types.
 The null pointer is a reserved value and implies that the type has no explicit name.
-Types with null names are matched by means of dynamic_cast, which
+Types with null names are matched by means of typeid, which
 relies on RTTI (Runtime Type Information - the automatic storing of a
 type identifier in every class). By default Theron uses RTTI exclusively.
 
@@ -59,7 +59,7 @@ struct MessageTraits
     \brief Indicates whether the message type has an explicit name.
     Message types for which have valid type names are identified
     using their names rather than with built-in C++ Runtime Type Information
-    (RTTI) via dynamic_cast.
+    (RTTI) via typeid.
     */
     static const bool HAS_TYPE_NAME = false;
     
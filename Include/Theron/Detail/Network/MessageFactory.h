@@ -15,7 +15,7 @@
 #include <Theron/Defines.h>
 #include <Theron/IAllocator.h>
 
-#include <Theron/Detail/Containers/Map.h>
+#include <Theron/Detail/Containers/HashMap.h>
 #include <Theron/Detail/Messages/IMessage.h>
 #include <Theron/Detail/Messages/MessageCreator.h>
 #include <Theron/Detail/Messages/MessageSize.h>
@@ -134,7 +134,7 @@ private:
         }
     };
 
-    typedef Map<const char *, IMessageBuilder *, StringHash> MessageBuilderMap;
+    typedef HashMap<const char *, IMessageBuilder *, StringHash> MessageBuilderMap;
 
     MessageFactory(const MessageFactory &other);
     MessageFactory &operator=(const MessageFactory &other);
@@ -158,16 +158,14 @@ inline MessageFactory::~MessageFactory()
 {
     IAllocator *const allocator(AllocatorManager::GetCache());
 
-    // Clear the map on destruction.
-    while (MessageBuilderMap::Node *const node = mMap.Front())
+    // Destroy the builders on destruction; the map frees its own table.
+    MessageBuilderMap::Iterator entries(mMap.GetIterator());
+    while (entries.Next())
     {
-        mMap.Remove(node);
+        IMessageBuilder *const builder(entries.GetValue());
 
-        node->mValue->~IMessageBuilder();
-        allocator->Free(node->mValue);
-
-        node->~Node();
-        allocator->Free(node, sizeof(MessageBuilderMap::Node));
+        builder->~IMessageBuilder();
+        allocator->Free(builder);
     }
 }
 
@@ -179,7 +177,7 @@ inline bool MessageFactory::Register(const String &name)
 
     IAllocator *const allocator(AllocatorManager::GetCache());
 
-    // Allocate and construct the builder and node speculatively outside the spinlock.
+    // Allocate and construct the builder speculatively outside the spinlock.
     void *const builderMemory(allocator->Allocate(sizeof(MessageBuilderType)));
     if (builderMemory == 0)
     {
@@ -202,67 +200,39 @@ inline bool MessageFactory::Register(const String &name)
 
 inline bool MessageFactory::RegisterBuilder(const String &name, IMessageBuilder *const builder)
 {
-    IAllocator *const allocator(AllocatorManager::GetCache());
-    
-    void *const nodeMemory(allocator->Allocate(sizeof(MessageBuilderMap::Node)));
-    if (nodeMemory == 0)
-    {
-        return false;
-    }
-
-    MessageBuilderMap::Node *node = new (nodeMemory) MessageBuilderMap::Node(name.GetValue(), builder);
-
+    bool result(false);
     mSpinLock.Lock();
 
-    // Check for existing pairs with the same key. At most one is allowed.
-    if (!mMap.Contains(name.GetValue()) && mMap.Insert(node))
-    {
-        node = 0;
-    }
+    // At most one builder per key is allowed; the insert fails if the key is present.
+    result = mMap.Insert(name.GetValue(), builder);
 
     mSpinLock.Unlock();
-
-    // Destroy the builder and node if the insert failed.
-    if (node == 0)
-    {
-        return true;
-    }
-
-    node->~Node();
-    allocator->Free(node, sizeof(MessageBuilderMap::Node));
-
-    return false;
+    return result;
 }
 
 
 inline bool MessageFactory::Deregister(const String &name)
 {
-    IAllocator *const allocator(AllocatorManager::GetCache());
+    IMessageBuilder *builder(0);
     mSpinLock.Lock();
 
-    MessageBuilderMap::KeyNodeIterator nodes(mMap.GetKeyNodeIterator(name.GetValue()));
-    while (nodes.Next())
+    if (IMessageBuilder *const *const value = mMap.Find(name.GetValue()))
     {
-        MessageBuilderMap::Node *const node(nodes.Get());
-
-        if (mMap.Remove(node))
-        {
-            mSpinLock.Unlock();
-
-            node->mValue->~IMessageBuilder();
-            allocator->Free(node->mValue);
+        builder = *value;
+        mMap.Remove(name.GetValue());
+    }
 
-            node->~Node();
-            allocator->Free(node, sizeof(MessageBuilderMap::Node));
+    mSpinLock.Unlock();
 
-            mSpinLock.Lock();
-        }
+    // Destroy the builder outside the spinlock.
+    if (builder)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
 
-        // Restart the iterator since the deletion may have messed it up.
-        nodes = mMap.GetKeyNodeIterator(name.GetValue());
+        builder->~IMessageBuilder();
+        allocator->Free(builder);
     }
 
-    mSpinLock.Unlock();
     return true;
 }
 
@@ -272,7 +242,7 @@ inline bool MessageFactory::Contains(const String &name)
     bool result(false);
     mSpinLock.Lock();
 
-    result = mMap.GetKeyNodeIterator(name.GetValue()).Next();
+    result = mMap.Contains(name.GetValue());
 
     mSpinLock.Unlock();
     return result;
@@ -288,13 +258,9 @@ inline IMessage *MessageFactory::Build(
     IMessage *message(0);
     mSpinLock.Lock();
 
-    MessageBuilderMap::KeyNodeIterator nodes(mMap.GetKeyNodeIterator(name.GetValue()));
-    if (nodes.Next())
+    if (IMessageBuilder *const *const value = mMap.Find(name.GetValue()))
     {
-        const MessageBuilderMap::Node *const node(nodes.Get());
-        IMessageBuilder *const builder(node->mValue);
-
-        message = builder->Build(messageData, messageSize, from);
+        message = (*value)->Build(messageData, messageSize, from);
     }
 
     mSpinLock.Unlock();
@@ -3,18 +3,11 @@
 #define THERON_DETAIL_NETWORK_NAMEMAP_H
 
 
-#include <new>
-
-#include <string.h>
-#include <stdlib.h>
-
-#include <Theron/AllocatorManager.h>
 #include <Theron/Assert.h>
 #include <Theron/BasicTypes.h>
 #include <Theron/Defines.h>
-#include <Theron/IAllocator.h>
 
-#include <Theron/Detail/Containers/Map.h>
+#include <Theron/Detail/Containers/HashMap.h>
 #include <Theron/Detail/Network/Index.h>
 #include <Theron/Detail/Strings/String.h>
 #include <Theron/Detail/Strings/StringHash.h>
@@ -29,6 +22,7 @@ namespace Detail
 
 /**
 Associates string names to mailbox indices.
+The names are held in an open-addressing hash table, so lookups stay cheap with many registered names.
 */
 class NameMap
 {
@@ -71,13 +65,13 @@ public:
 
 private:
 
-    typedef Map<const char *, Index, StringHash> NameIndexMap;
+    typedef HashMap<const char *, Index, StringHash> NameIndexMap;
 
     NameMap(const NameMap &other);
     NameMap &operator=(const NameMap &other);
 
     mutable SpinLock mSpinLock;         ///< Thread-safe access.
-    NameIndexMap mMap;                  ///< Multimap of names to indices.
+    NameIndexMap mMap;                  ///< Map of names to indices.
 };
 
 
@@ -88,80 +82,28 @@ inline NameMap::NameMap() : mSpinLock(), mMap()
 
 inline NameMap::~NameMap()
 {
-    IAllocator *const allocator(AllocatorManager::GetCache());
-
-    // Clear the map on destruction.
-    while (NameIndexMap::Node *const node = mMap.Front())
-    {
-        mMap.Remove(node);
-
-        node->~Node();
-        allocator->Free(node, sizeof(NameIndexMap::Node));
-    }
 }
 
 
 inline bool NameMap::Insert(const String &name, const Index &index)
 {
-    IAllocator *const allocator(AllocatorManager::GetCache());
-    NameIndexMap::Node *node(0);
-
-    // Allocate and construct the node speculatively outside the spinlock.
-    void *const nodeMemory(allocator->Allocate(sizeof(NameIndexMap::Node)));
-    if (nodeMemory == 0)
-    {
-        return false;
-    }
-
-    node = new (nodeMemory) NameIndexMap::Node(name.GetValue(), index);
-
+    bool result(false);
     mSpinLock.Lock();
 
-    // Check for existing pairs with the same key. At most one is allowed.
+    // At most one pair with the same key is allowed.
     THERON_ASSERT(!mMap.Contains(name.GetValue()));
-    if (mMap.Insert(node))
-    {
-        node = 0;
-    }
+    result = mMap.Insert(name.GetValue(), index);
 
     mSpinLock.Unlock();
-
-    // Destroy the node if the insert failed.
-    if (node)
-    {
-        node->~Node();
-        allocator->Free(node, sizeof(NameIndexMap::Node));
-
-        return false;
-    }
-
-    return true;
+    return result;
 }
 
 
 inline bool NameMap::Remove(const String &name)
 {
-    IAllocator *const allocator(AllocatorManager::GetCache());
     mSpinLock.Lock();
 
-    NameIndexMap::KeyNodeIterator nodes(mMap.GetKeyNodeIterator(name.GetValue()));
-    while (nodes.Next())
-    {
-        NameIndexMap::Node *const node(nodes.Get());
-
-        if (mMap.Remove(node))
-        {
-            mSpinLock.Unlock();
-
-            node->~Node();
-            allocator->Free(node, sizeof(NameIndexMap::Node));
-
-            mSpinLock.Lock();
-        }
-
-        // Restart the iterator since the deletion may have messed it up.
-        nodes = mMap.GetKeyNodeIterator(name.GetValue());
-    }
+    mMap.Remove(name.GetValue());
 
     mSpinLock.Unlock();
     return true;
@@ -173,7 +115,7 @@ inline bool NameMap::Contains(const String &name)
     bool result(false);
     mSpinLock.Lock();
 
-    result = mMap.GetKeyNodeIterator(name.GetValue()).Next();
+    result = mMap.Contains(name.GetValue());
 
     mSpinLock.Unlock();
     return result;
@@ -185,11 +127,9 @@ inline bool NameMap::Get(const String &name, Index &index) const
     bool result(false);
     mSpinLock.Lock();
 
-    NameIndexMap::KeyNodeIterator nodes(mMap.GetKeyNodeIterator(name.GetValue()));
-    if (nodes.Next())
+    if (const Index *const value = mMap.Find(name.GetValue()))
     {
-        const NameIndexMap::Node *const node(nodes.Get());
-        index = node->mValue;
+        index = *value;
         result = true;
     }
 
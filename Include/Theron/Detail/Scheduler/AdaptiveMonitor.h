@@ -0,0 +1,269 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_SCHEDULER_ADAPTIVEMONITOR_H
+#define THERON_DETAIL_SCHEDULER_ADAPTIVEMONITOR_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/YieldStrategy.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Clock.h>
+#include <Theron/Detail/Threading/Condition.h>
+#include <Theron/Detail/Threading/Lock.h>
+#include <Theron/Detail/Threading/Mutex.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4324)  // structure was padded due to __declspec(align())
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+\brief Adaptive monitor thread synchronization primitive that learns how long workers wait for work.
+
+Each worker thread keeps an exponentially weighted moving average of the idle gaps it has
+seen: the times between starting to wait on an empty queue and popping the next mailbox.
+When the queue is empty the worker spins for a little longer than the typical gap, so that
+work arriving at the usual rate is picked up without a system call. If the typical gap is
+short it then yields its timeslice for a while, and finally it parks on a condition variable,
+so that workers which see long gaps stop burning CPU almost immediately.
+
+Pushing threads only pulse the condition when some worker is actually parked on it.
+*/
+class AdaptiveMonitor
+{
+public:
+
+    struct Context
+    {
+        inline Context() :
+          mWaitStart(0),
+          mIdleGap(0),
+          mWaitCount(0)
+        {
+        }
+
+        uint64_t mWaitStart;            ///< Time at which the current wait started, in clock ticks.
+        uint64_t mIdleGap;              ///< Moving average of the idle gaps seen, in clock ticks.
+        uint32_t mWaitCount;            ///< Number of calls to Wait in the current wait.
+    };
+
+    class LockType
+    {
+    public:
+
+        friend class AdaptiveMonitor;
+
+        THERON_FORCEINLINE explicit LockType(AdaptiveMonitor &monitor) : mLock(monitor.mCondition.GetMutex())
+        {
+        }
+
+        THERON_FORCEINLINE void Unlock()
+        {
+            mLock.Unlock();
+        }
+
+        THERON_FORCEINLINE void Relock()
+        {
+            mLock.Relock();
+        }
+
+    private:
+
+        LockType(const LockType &other);
+        LockType &operator=(const LockType &other);
+
+        Lock mLock;
+    };
+
+    friend class LockType;
+
+    /**
+    Constructs a monitor with the given yield strategy hint.
+    */
+    inline explicit AdaptiveMonitor(const YieldStrategy yieldStrategy);
+
+    /**
+    Initializes the context structure of a worker thread.
+    \note The calling thread must be a worker thread.
+    */
+    inline void InitializeWorkerContext(Context *const context);
+
+    /**
+    Resets the yield backoff following a successful acquire, learning from the length of the wait.
+    \note The calling thread should not hold a lock.
+    */
+    inline void ResetYield(Context *const context);
+
+    /**
+    Wakes at most one waiting thread.
+    \note The calling thread should hold a lock while changing the protected state but should release it before calling Pulse.
+    */
+    inline void Pulse();
+
+    /**
+    Wakes all waiting threads.
+    \note The calling thread should hold a lock while changing the protected state but should release it before calling PulseAll.
+    */
+    inline void PulseAll();
+
+    /**
+    Spins, yields, or puts the calling thread to sleep until it is woken by a pulse,
+    depending on how long the thread has waited so far and how long it typically waits.
+    \note The calling thread should hold a lock and should pass the lock as a parameter.
+    */
+    inline void Wait(Context *const context, LockType &lock);
+
+private:
+
+    /**
+    Number of waits after which a thread parks regardless of its timings.
+    This bounds the spinning when the platform has no usable clock.
+    */
+    static const uint32_t MAX_WAITS_BEFORE_PARK = 1000;
+
+    /**
+    Weight of each new sample in the moving average of idle gaps, as a power of two.
+    */
+    static const uint32_t IDLE_GAP_SHIFT = 3;
+
+    AdaptiveMonitor(const AdaptiveMonitor &other);
+    AdaptiveMonitor &operator=(const AdaptiveMonitor &other);
+
+    uint64_t mMinSpinTicks;             ///< Shortest time a waiting thread spins before yielding or parking.
+    uint64_t mMaxSpinTicks;             ///< Longest time a waiting thread spins before yielding or parking.
+    uint64_t mMaxYieldTicks;            ///< Longest time a waiting thread yields before parking.
+    uint64_t mMaxIdleGapTicks;          ///< Idle gaps longer than this are counted as this long.
+    Atomic::UInt32 mParked;             ///< Number of threads parked on the condition.
+    mutable Condition mCondition;
+};
+
+
+inline AdaptiveMonitor::AdaptiveMonitor(const YieldStrategy /*yieldStrategy*/) :
+  mMinSpinTicks(0),
+  mMaxSpinTicks(0),
+  mMaxYieldTicks(0),
+  mMaxIdleGapTicks(0),
+  mParked(0)
+{
+    const uint64_t ticksPerMicrosecond((Clock::GetFrequency() + 999999) / 1000000);
+
+    mMinSpinTicks = 2 * ticksPerMicrosecond;
+    mMaxSpinTicks = 50 * ticksPerMicrosecond;
+    mMaxYieldTicks = 200 * ticksPerMicrosecond;
+    mMaxIdleGapTicks = 1000 * ticksPerMicrosecond;
+}
+
+
+inline void AdaptiveMonitor::InitializeWorkerContext(Context *const context)
+{
+    // Start by assuming the gaps are long, so idle workers park promptly until they learn otherwise.
+    context->mWaitStart = 0;
+    context->mIdleGap = mMaxIdleGapTicks;
+    context->mWaitCount = 0;
+}
+
+
+THERON_FORCEINLINE void AdaptiveMonitor::ResetYield(Context *const context)
+{
+    if (context->mWaitCount)
+    {
+        uint64_t gap(Clock::GetTicks() - context->mWaitStart);
+        if (gap > mMaxIdleGapTicks)
+        {
+            gap = mMaxIdleGapTicks;
+        }
+
+        // The average moves an eighth of the way towards each new sample.
+        const uint64_t average(context->mIdleGap);
+        context->mIdleGap = average - (average >> IDLE_GAP_SHIFT) + (gap >> IDLE_GAP_SHIFT);
+        context->mWaitCount = 0;
+    }
+}
+
+
+THERON_FORCEINLINE void AdaptiveMonitor::Pulse()
+{
+    // Threads that are spinning or yielding will notice the work without being woken.
+    if (mParked.Load() != 0)
+    {
+        mCondition.Pulse();
+    }
+}
+
+
+THERON_FORCEINLINE void AdaptiveMonitor::PulseAll()
+{
+    mCondition.PulseAll();
+}
+
+
+inline void AdaptiveMonitor::Wait(Context *const context, LockType &lock)
+{
+    const uint64_t now(Clock::GetTicks());
+    if (context->mWaitCount++ == 0)
+    {
+        context->mWaitStart = now;
+    }
+
+    const uint64_t elapsed(now - context->mWaitStart);
+    const uint64_t expected(context->mIdleGap * 2);
+
+    if (context->mWaitCount < MAX_WAITS_BEFORE_PARK)
+    {
+        // Spin for about twice the typical gap, within limits.
+        uint64_t spinTicks(expected < mMaxSpinTicks ? expected : mMaxSpinTicks);
+        spinTicks = spinTicks > mMinSpinTicks ? spinTicks : mMinSpinTicks;
+
+        if (elapsed < spinTicks)
+        {
+            lock.Unlock();
+
+            for (uint32_t i = 0; i < 50; ++i)
+            {
+                Utils::YieldToHyperthread();
+            }
+
+            lock.Relock();
+            return;
+        }
+
+        // Yielding is only worthwhile if the work is expected to arrive soon.
+        if (expected < mMaxYieldTicks && elapsed < expected)
+        {
+            lock.Unlock();
+            Utils::YieldToAnyThread();
+            lock.Relock();
+            return;
+        }
+    }
+
+    // The parked count is only changed with the lock held, so a pushing thread
+    // that takes the lock after we've checked the queue will see it.
+    mParked.Increment();
+    mCondition.Wait(lock.mLock);
+    mParked.Decrement();
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
+
+
+#endif // THERON_DETAIL_SCHEDULER_ADAPTIVEMONITOR_H
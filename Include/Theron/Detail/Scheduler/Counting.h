@@ -43,12 +43,17 @@ enum Counter
     COUNTER_QUEUE_LATENCY_LOCAL_MAX,    ///< Maximum recorded local queue latency in microseconds.
     COUNTER_QUEUE_LATENCY_SHARED_MIN,   ///< Minimum recorded shared queue latency in microseconds.
     COUNTER_QUEUE_LATENCY_SHARED_MAX,   ///< Maximum recorded shared queue latency in microseconds.
+    COUNTER_HANDLER_CYCLES,             ///< CPU cycles spent executing message handlers.
+    COUNTER_HANDLER_INSTRUCTIONS,       ///< Instructions retired while executing message handlers.
+    COUNTER_HANDLER_CACHE_MISSES,       ///< Last-level cache misses while executing message handlers.
+    COUNTER_HANDLER_BRANCH_MISSES,      ///< Branch mispredictions while executing message handlers.
     MAX_COUNTERS                        ///< Number of counters available for querying.
 };
 
 
 /**
 Static helper that increments event counters.
+The counters are statistics only, and don't guard other data, so are accessed with relaxed memory ordering.
 */
 class Counting
 {
@@ -59,6 +64,7 @@ public:
 
     inline static void Reset(Atomic::UInt32 &counter, const uint32_t id);
     inline static void Increment(Atomic::UInt32 &counter);
+    inline static void Add(Atomic::UInt32 &counter, const uint32_t n);
     inline static void Raise(Atomic::UInt32 &counter, const uint32_t n);
     inline static void Lower(Atomic::UInt32 &counter, const uint32_t n);
     inline static void Accumulate(const Atomic::UInt32 &counter, const uint32_t id, uint32_t &n);
@@ -69,7 +75,7 @@ THERON_FORCEINLINE uint32_t Counting::Get(const Atomic::UInt32 & THERON_COUNTER_
 {
 #if THERON_ENABLE_COUNTERS
 
-    return counter.Load();
+    return counter.LoadRelaxed();
 
 #else
 
@@ -83,7 +89,7 @@ THERON_FORCEINLINE void Counting::Set(Atomic::UInt32 & THERON_COUNTER_ARG(counte
 {
 #if THERON_ENABLE_COUNTERS
 
-    counter.Store(n);
+    counter.StoreRelaxed(n);
 
 #endif
 }
@@ -98,13 +104,13 @@ THERON_FORCEINLINE void Counting::Reset(Atomic::UInt32 & THERON_COUNTER_ARG(coun
         case COUNTER_QUEUE_LATENCY_LOCAL_MIN:
         case COUNTER_QUEUE_LATENCY_SHARED_MIN:
         {
-            counter.Store(0xFFFFFFFF);
+            counter.StoreRelaxed(0xFFFFFFFF);
             break;
         }
 
         default:
         {
-            counter.Store(0);
+            counter.StoreRelaxed(0);
             break;
         }
     }
@@ -117,7 +123,18 @@ THERON_FORCEINLINE void Counting::Increment(Atomic::UInt32 & THERON_COUNTER_ARG(
 {
 #if THERON_ENABLE_COUNTERS
 
-    counter.Increment();
+    counter.AddRelaxed(1);
+
+#endif
+}
+
+
+THERON_FORCEINLINE void Counting::Add(Atomic::UInt32 & THERON_COUNTER_ARG(counter), const uint32_t THERON_COUNTER_ARG(n))
+{
+#if THERON_ENABLE_COUNTERS
+
+    // Counters are only written by the owning thread so this needn't be atomic.
+    counter.StoreRelaxed(counter.LoadRelaxed() + n);
 
 #endif
 }
@@ -127,12 +144,12 @@ THERON_FORCEINLINE void Counting::Raise(Atomic::UInt32 & THERON_COUNTER_ARG(coun
 {
 #if THERON_ENABLE_COUNTERS
 
-    uint32_t currentValue(counter.Load());
+    uint32_t currentValue(counter.LoadRelaxed());
     uint32_t backoff(0);
 
     while (n > currentValue)
     {
-        if (counter.CompareExchangeAcquire(currentValue, n))
+        if (counter.CompareExchangeRelaxed(currentValue, n))
         {
             break;
         }
@@ -148,12 +165,12 @@ THERON_FORCEINLINE void Counting::Lower(Atomic::UInt32 & THERON_COUNTER_ARG(coun
 {
 #if THERON_ENABLE_COUNTERS
 
-    uint32_t currentValue(counter.Load());
+    uint32_t currentValue(counter.LoadRelaxed());
     uint32_t backoff(0);
 
     while (n < currentValue)
     {
-        if (counter.CompareExchangeAcquire(currentValue, n))
+        if (counter.CompareExchangeRelaxed(currentValue, n))
         {
             break;
         }
@@ -172,7 +189,7 @@ THERON_FORCEINLINE void Counting::Accumulate(
 {
 #if THERON_ENABLE_COUNTERS
 
-    const uint32_t val(counter.Load());
+    const uint32_t val(counter.LoadRelaxed());
 
     switch (id)
     {
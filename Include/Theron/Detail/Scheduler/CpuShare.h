@@ -0,0 +1,210 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_SCHEDULER_CPUSHARE_H
+#define THERON_DETAIL_SCHEDULER_CPUSHARE_H
+
+
+#include <new>
+
+#include <Theron/AllocatorManager.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Containers/List.h>
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Clock.h>
+#include <Theron/Detail/Threading/Mutex.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Weighted share of the processors used by the worker threads of a framework.
+
+Frameworks with shares compete for the processors they have in common, as given by their
+node and processor masks. Time is divided into short windows, and each framework counts the
+processor time used by its worker threads in the current and previous windows. A worker thread
+whose framework has used more than its share, relative to the weight of another framework that
+is being held up, sleeps between mailboxes until the other framework has caught up.
+
+A framework counts as held up while its worker threads spend a significant part of their time
+kept off the processors, as shown by handlers taking longer to execute than the processor time
+they use, while the threads are being preempted. Frameworks that are idle, or get all the processor
+time they can use, therefore don't hold back the others, which keeps the sharing work-conserving.
+Because usage is only counted over the last two windows, no framework can save up processor time.
+
+Worker threads time their handlers individually with the cheap wall clock. Once the time amounts
+to a tenth of a millisecond they charge their framework for the processor time they've actually
+used since they last charged, where the platform can measure it, and at most once a millisecond
+they compare its usage with that of the other frameworks.
+*/
+class CpuShare : public List<CpuShare>::Node
+{
+public:
+
+    /**
+    Per-thread timing state of a worker thread.
+    */
+    class Slice
+    {
+    public:
+
+        inline Slice() : mStart(0), mPending(0), mThreadTime(0), mCheck(0), mPreemptions(0)
+        {
+        }
+
+        uint64_t mStart;                ///< Clock ticks at which the current handler started.
+        uint64_t mPending;              ///< Clock ticks of handler time not yet charged.
+        uint64_t mThreadTime;           ///< Processor time of the thread in microseconds when it last charged, if known.
+        uint64_t mCheck;                ///< Clock ticks after which the thread next compares usage.
+        uint32_t mPreemptions;          ///< Number of times the thread had been preempted when it last charged.
+
+    private:
+
+        Slice(const Slice &other);
+        Slice &operator=(const Slice &other);
+    };
+
+    /**
+    Constructor.
+    \param weight Relative weight of the framework. Zero disables sharing.
+    */
+    CpuShare(const uint32_t weight, const uint32_t nodeMask, const uint32_t processorMask);
+
+    /**
+    Returns true if the framework shares processors with other frameworks by weight.
+    */
+    THERON_FORCEINLINE bool Enabled() const
+    {
+        return (mWeight != 0);
+    }
+
+    /**
+    Adds the share to the process-wide set of competing shares.
+    */
+    void Register();
+
+    /**
+    Removes the share from the process-wide set of competing shares.
+    */
+    void Deregister();
+
+    /**
+    Called by a worker thread before it executes a handler.
+    */
+    THERON_FORCEINLINE void Begin(Slice *const slice)
+    {
+        slice->mStart = Clock::GetTicks();
+    }
+
+    /**
+    Called by a worker thread after it has executed a handler, and before it looks for the next one.
+    The thread may sleep here if its framework has used more than its share.
+    */
+    THERON_FORCEINLINE void End(Slice *const slice)
+    {
+        const uint64_t now(Clock::GetTicks());
+
+        slice->mPending += now - slice->mStart;
+        if (slice->mPending >= mChargeTicks)
+        {
+            Charge(slice, now);
+        }
+    }
+
+private:
+
+    static const uint32_t CHARGE_MICROSECONDS = 100;    ///< Handler time a thread accumulates before charging it.
+    static const uint32_t CHECK_MICROSECONDS = 1000;    ///< Minimum time between a thread's comparisons of usage.
+    static const uint32_t MARGIN_MICROSECONDS = 500;     ///< Processor time a framework may exceed its share by.
+    static const uint32_t WINDOW_MILLISECONDS = 20;     ///< Length of the windows over which usage is counted.
+    static const uint32_t THROTTLE_MILLISECONDS = 1;    ///< Time a thread sleeps before comparing again.
+    static const uint32_t HELD_UP_PERCENT = 25;         ///< Proportion of time held up above which a framework competes.
+
+    /**
+    Process-wide set of shares, created when the first share is registered and destroyed
+    when the last is deregistered.
+    */
+    struct Registry
+    {
+        Registry() : mLock(), mShares(), mWindow(0)
+        {
+        }
+
+        Mutex mLock;                    ///< Protects the list of shares and the usage of previous windows.
+        List<CpuShare> mShares;         ///< Registered shares.
+        Atomic::UInt32 mWindow;         ///< Index of the current window.
+    };
+
+    CpuShare(const CpuShare &other);
+    CpuShare &operator=(const CpuShare &other);
+
+    /**
+    Charges the processor time used by a thread, and sleeps while the framework is over its share.
+    */
+    void Charge(Slice *const slice, const uint64_t now);
+
+    /**
+    Returns true if the framework has used more than its share relative to a framework being held up.
+    \note The registry lock should be held.
+    */
+    bool OverShare() const;
+
+    /**
+    Returns the usage of the current and previous windows, scaled by the inverse of the weight.
+    \note The registry lock should be held.
+    */
+    uint64_t GetWeightedUsage() const;
+
+    /**
+    Starts a new window, if the current window has ended.
+    \note The registry lock should be held.
+    */
+    static void UpdateWindow(const uint32_t window);
+
+    /**
+    References the registry, creating it if it doesn't already exist.
+    */
+    static void Reference();
+
+    /**
+    Dereferences the registry, destroying it if this was the last reference.
+    */
+    static void Dereference();
+
+    /**
+    Atomically reads a count and resets it to zero.
+    */
+    static uint32_t Take(Atomic::UInt32 &count);
+
+    /**
+    Returns the index of the window containing the given clock time.
+    */
+    static uint32_t GetWindow(const uint64_t ticks);
+
+    static Registry *smRegistry;        ///< Pointer to the registry, while any shares are registered.
+    static Mutex smReferenceMutex;      ///< Synchronization object protecting reference counting.
+    static uint32_t smReferenceCount;   ///< Counts the number of registered shares.
+
+    const uint32_t mWeight;             ///< Relative weight of the framework, or zero.
+    const uint32_t mNodeMask;           ///< NUMA node affinity mask of the worker threads.
+    const uint32_t mProcessorMask;      ///< Processor affinity mask of the worker threads within each node.
+    const uint64_t mChargeTicks;        ///< Clock ticks of handler time a thread accumulates before charging it.
+    const uint64_t mCheckTicks;         ///< Minimum clock ticks between a thread's comparisons of usage.
+    Atomic::UInt32 mUsage;              ///< Processor time in microseconds used in the current window.
+    Atomic::UInt32 mHeldUp;             ///< Time in microseconds for which threads were held up in the current window.
+    uint32_t mLastUsage;                ///< Processor time in microseconds used in the previous window.
+    uint32_t mLastHeldUp;               ///< Time in microseconds for which threads were held up in the previous window.
+    bool mRegistered;                   ///< Whether the share is in the registry.
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_SCHEDULER_CPUSHARE_H
@@ -73,6 +73,20 @@ public:
     */
     virtual void Schedule(MailboxContext *const mailboxContext, Mailbox *const mailbox) = 0;
 
+    /**
+    Schedules for processing a batch of mailboxes that have received messages, with a single queue push.
+    \note The mailbox context must be a shared context, not associated with a worker thread.
+    */
+    virtual void ScheduleBatch(MailboxContext *const mailboxContext, Mailbox *const *const mailboxes, const uint32_t count) = 0;
+
+    /**
+    Processes up to the given number of queued messages on the calling thread.
+    
+ote Only schedulers without worker threads process messages this way. Others return zero.
+    eturn The number of messages processed.
+    */
+    virtual uint32_t Process(const uint32_t maxMessages) = 0;
+
     /**
     Sets a maximum limit on the number of worker threads enabled in the scheduler.
     */
@@ -7,9 +7,18 @@
 #include <Theron/Defines.h>
 #include <Theron/IAllocator.h>
 
+#include <Theron/Detail/Allocators/ScratchArena.h>
 #include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
 #include <Theron/Detail/Mailboxes/Mailbox.h>
+#include <Theron/Detail/Messages/MessageBudget.h>
+#include <Theron/Detail/Messages/MessageExpiry.h>
+#include <Theron/Detail/Messages/MessageRecycler.h>
+#include <Theron/Detail/Messages/MessageSlot.h>
+#include <Theron/Detail/Scheduler/CpuShare.h>
 #include <Theron/Detail/Scheduler/IScheduler.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
+#include <Theron/Detail/Scheduler/Placement.h>
+#include <Theron/Detail/Threading/Atomic.h>
 
 
 namespace Theron
@@ -22,7 +31,9 @@ namespace Detail
 Context structure holding data used by a worker thread to process mailboxes.
 
 \note The members of a single context are all accessed only by one worker thread
-so we don't need to worry about shared writes, including false sharing.
+so we don't need to worry about shared writes, including false sharing. The exception
+is the handler sequence number, which the scheduler's manager thread reads to detect
+worker threads that are blocked inside message handlers.
 */
 class MailboxContext
 {
@@ -36,9 +47,22 @@ public:
       mQueueContext(0),
       mFallbackHandlers(0),
       mMessageAllocator(0),
+      mMessageSlots(0),
       mMailbox(0),
+      mPerfCounters(0),
+      mMessageBudget(0),
+      mMessageAccount(0),
+      mMessageExpiry(0),
+      mCpuShare(0),
+      mCpuSlice(0),
+      mPlacementSamples(0),
+      mScratchArena(0),
+      mHandoffContext(0),
+      mMessageRecycler(),
+      mBlockingPool(false),
       mPredictedSendCount(0),
-      mSendCount(0)
+      mSendCount(0),
+      mHandlerSequence(0)
     {
     }
 
@@ -46,9 +70,22 @@ public:
     void *mQueueContext;                                ///< Pointer to the associated queue context.
     FallbackHandlerCollection *mFallbackHandlers;       ///< Pointer to fallback handlers for undelivered messages.
     IAllocator *mMessageAllocator;                      ///< Pointer to message memory block allocator.
+    MessageSlotPool *mMessageSlots;                     ///< Per-thread pool of slots for small messages, if any.
     Mailbox *mMailbox;                                  ///< Pointer to the mailbox that is being processed.
+    PerfCounters *mPerfCounters;                        ///< Pointer to per-thread hardware counters, if any.
+    MessageBudget *mMessageBudget;                      ///< Message memory budget of the framework, if enabled.
+    MessageBudget::Account *mMessageAccount;            ///< Per-thread message memory account, if any.
+    MessageExpiry *mMessageExpiry;                      ///< Drops messages whose deadlines have passed.
+    CpuShare *mCpuShare;                                ///< Processor share of the framework, if it competes for processors by weight.
+    CpuShare::Slice *mCpuSlice;                         ///< Per-thread timing state for the processor share, if any.
+    Placement::Samples *mPlacementSamples;              ///< Per-thread samples of sends between mailboxes, if actors are co-located.
+    ScratchArena *mScratchArena;                        ///< Per-thread scratch memory for handlers, reset after each message.
+    MailboxContext *mHandoffContext;                    ///< Shared context of the other pool, which processes the other kind of mailbox.
+    MessageRecycler mMessageRecycler;                   ///< Recycles the block of the handled message for a reply or forward.
+    bool mBlockingPool;                                 ///< Indicates whether the context belongs to the pool of blocking worker threads.
     uint32_t mPredictedSendCount;                       ///< Number of messages predicted to be sent by the handler.
     uint32_t mSendCount;                                ///< Messages sent so far by the handler being executed.
+    Atomic::UInt32 mHandlerSequence;                    ///< Incremented on entering and leaving a mailbox; odd while processing one.
 
 private:
 
@@ -11,6 +11,7 @@
 #include <Theron/Detail/Mailboxes/Mailbox.h>
 #include <Theron/Detail/Messages/IMessage.h>
 #include <Theron/Detail/Messages/MessageCreator.h>
+#include <Theron/Detail/Messages/MessageExpiry.h>
 #include <Theron/Detail/Scheduler/WorkerContext.h>
 
 
@@ -51,22 +52,56 @@ THERON_FORCEINLINE void MailboxProcessor::Process(WorkerContext *const workerCon
     THERON_ASSERT(fallbackHandlers);
     THERON_ASSERT(messageAllocator);
 
-    // Remember the mailbox we're processing in the context so we can query it.
-    mailboxContext->mMailbox = mailbox;
-
     // Pin the mailbox and get the registered actor and the first queued message.
     // At this point the mailbox shouldn't be enqueued in any other work items,
     // even if it contains more than one unprocessed message. This ensures that
     // each mailbox is only processed by one worker thread at a time.
     mailbox->Lock();
+
+    // Mailboxes of actors whose handlers may block are processed by a separate pool of
+    // worker threads, so they don't stall the actors queued behind them. If this thread
+    // belongs to the wrong pool then hand the still-scheduled mailbox to the other one.
+    if (mailbox->IsBlocking() != mailboxContext->mBlockingPool)
+    {
+        mailbox->Unlock();
+
+        MailboxContext *const handoffContext(mailboxContext->mHandoffContext);
+        THERON_ASSERT(handoffContext && handoffContext->mScheduler);
+
+        handoffContext->mScheduler->Schedule(handoffContext, mailbox);
+        return;
+    }
+
+    // Time the handler against the framework's processor share, if it has one.
+    CpuShare *const cpuShare(mailboxContext->mCpuShare);
+    if (cpuShare)
+    {
+        cpuShare->Begin(mailboxContext->mCpuSlice);
+    }
+
+    // Remember the mailbox we're processing in the context so we can query it.
+    mailboxContext->mMailbox = mailbox;
+
+    // The manager thread watches the sequence number to spot threads blocked in handlers.
+    // Only this thread writes it, so a relaxed load and release store suffice.
+    mailboxContext->mHandlerSequence.StoreRelease(mailboxContext->mHandlerSequence.LoadRelaxed() + 1);
+
     mailbox->Pin();
     Actor *const actor(mailbox->GetActor());
     IMessage *const message(mailbox->Front());
     mailbox->Unlock();
 
+    // Messages whose deadlines passed while they waited are dropped without executing their handlers.
     // If an actor is registered at the mailbox then process it.
-    if (actor)
+    if (MessageExpiry::Expired(message))
+    {
+        THERON_ASSERT(mailboxContext->mMessageExpiry);
+        mailboxContext->mMessageExpiry->Expire(message);
+    }
+    else if (actor)
     {
+        // The handlers may claim the message's block for a reply or forward.
+        mailboxContext->mMessageRecycler.Begin(message);
         actor->ProcessMessage(mailboxContext, fallbackHandlers, message);
     }
     else
@@ -74,6 +109,8 @@ THERON_FORCEINLINE void MailboxProcessor::Process(WorkerContext *const workerCon
         fallbackHandlers->Handle(message);
     }
 
+    const bool recycled(mailboxContext->mMessageRecycler.End());
+
     // Pop the message we just processed from the mailbox, then check whether the
     // mailbox is now empty, and reschedule the mailbox if it's not.
     // The locking of the mailbox here and in the main scheduling ensures that
@@ -90,8 +127,36 @@ THERON_FORCEINLINE void MailboxProcessor::Process(WorkerContext *const workerCon
 
     mailbox->Unlock();
 
+    mailboxContext->mHandlerSequence.StoreRelease(mailboxContext->mHandlerSequence.LoadRelaxed() + 1);
+
+    // Credit the framework's message budget for the message, which is no longer waiting.
+    if (MessageBudget *const messageBudget = mailboxContext->mMessageBudget)
+    {
+        messageBudget->Credit(mailboxContext->mMessageAccount, message->GetBlockSize());
+    }
+
     // Destroy the message, but only after we've popped it from the queue.
-    MessageCreator::Destroy(messageAllocator, message);
+    // If its block was claimed by a handler then send the outgoing message in it instead.
+    if (recycled)
+    {
+        mailboxContext->mMessageRecycler.Send(mailboxContext, message);
+    }
+    else
+    {
+        MessageCreator::Destroy(messageAllocator, message, mailboxContext->mMessageSlots);
+    }
+
+    // Reclaim any scratch memory the handlers used, all at once.
+    if (ScratchArena *const scratchArena = mailboxContext->mScratchArena)
+    {
+        scratchArena->Reset();
+    }
+
+    // Charge the handler time, and wait here if the framework has used more than its share.
+    if (cpuShare)
+    {
+        cpuShare->End(mailboxContext->mCpuSlice);
+    }
 }
 
 
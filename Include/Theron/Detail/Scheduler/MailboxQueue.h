@@ -32,6 +32,10 @@ namespace Detail
 
 /**
 \brief Generic mailbox queue implementation with specialized per-thread local queues.
+
+When placement is enabled, worker threads also claim home queues, to which mailboxes given
+their thread as a home are pushed. Threads process their own home queue before the shared queue,
+and take mailboxes from the home queues of other threads only when both are empty.
 */
 template <class MonitorType>
 class MailboxQueue
@@ -55,6 +59,7 @@ public:
         inline ContextType() :
           mRunning(false),
           mShared(false),
+          mHome(0),
           mLocalWorkQueue(0)
         {
         }
@@ -70,6 +75,7 @@ public:
 
         bool mRunning;                                      ///< Used to signal the thread to terminate.
         bool mShared;                                       ///< Indicates whether this is the 'shared' context.
+        uint32_t mHome;                                     ///< Index plus one of the thread's home queue, or zero.
         Mailbox *mLocalWorkQueue;                           ///< Local thread-specific single-item work queue.
         typename MonitorType::Context mMonitorContext;      ///< Per-thread monitor primitive context.
         Aligned<Atomic::UInt32> mCounters[MAX_COUNTERS];    ///< Array of per-context event counters.
@@ -100,6 +106,12 @@ public:
     */
     inline void ReleaseWorkerContext(ContextType *const context);
 
+    /**
+    Moves any items in the local and home queues of a stopping worker thread to the shared queue.
+    \note The calling thread must be the worker thread that owns the context.
+    */
+    inline void FlushLocalQueue(ContextType *const context);
+
     /**
     Resets to zero the given counter for the given thread context.
     */
@@ -110,6 +122,12 @@ public:
     */
     inline uint32_t GetCounterValue(const ContextType *const context, const uint32_t counter) const;
 
+    /**
+    Adds to the value of the given counter for the given thread context.
+    \note Must only be called by the thread that owns the context.
+    */
+    inline void AddCounterValue(ContextType *const context, const uint32_t counter, const uint32_t n) const;
+
     /**
     Accumulates the value of the given counter for the given thread context.
     */
@@ -133,11 +151,32 @@ public:
     */
     inline void WakeAll();
 
+    /**
+    Gives each worker thread started from now on a home queue, if one is free.
+    */
+    inline void EnableHomes();
+
+    /**
+    Returns true if the given home belongs to a running worker thread.
+    */
+    inline bool IsHome(const uint32_t home) const;
+
+    /**
+    Returns the homes of the running worker threads in turn, or zero if there are none.
+    */
+    inline uint32_t ChooseHome();
+
     /**
     Pushes a mailbox into the queue, scheduling it for processing.
     */
     inline void Push(ContextType *const context, Mailbox *mailbox, const SchedulerHints &hints);
 
+    /**
+    Pushes a batch of mailboxes into the shared queue, taking the queue lock only once.
+    \note The context must be a shared context, not associated with a worker thread.
+    */
+    inline void PushBatch(ContextType *const context, Mailbox *const *const mailboxes, const uint32_t count);
+
     /**
     Pops a previously pushed mailbox from the queue for processing.
     */
@@ -148,18 +187,40 @@ private:
     MailboxQueue(const MailboxQueue &other);
     MailboxQueue &operator=(const MailboxQueue &other);
 
+    static const uint32_t MAX_HOMES = 32;   ///< Maximum number of worker threads with home queues.
+
     inline static bool PreferLocalQueue(
         const ContextType *const context,
         const SchedulerHints &hints);
 
+    /**
+    Pops a mailbox from the home queue of the thread, the shared queue, or another home queue, in that order.
+    \note The monitor lock should be held.
+    */
+    inline Mailbox *PopShared(ContextType *const context);
+
     mutable MonitorType mMonitor;           ///< Synchronizes access to the shared queue.
     Queue<Mailbox> mSharedWorkQueue;        ///< Work queue shared by all the threads in a scheduler.
+    bool mHomesEnabled;                     ///< Indicates whether worker threads claim home queues.
+    uint32_t mHomeItemCount;                ///< Number of mailboxes in all the home queues.
+    uint32_t mNextHome;                     ///< Index of the home queue chosen next.
+    ContextType *mHomes[MAX_HOMES];         ///< Context of the worker thread owning each home queue, if any.
+    Queue<Mailbox> mHomeQueues[MAX_HOMES];  ///< Work queues of mailboxes preferably processed by one worker thread.
 };
 
 
 template <class MonitorType>
-inline MailboxQueue<MonitorType>::MailboxQueue(const YieldStrategy yieldStrategy) : mMonitor(yieldStrategy)
+inline MailboxQueue<MonitorType>::MailboxQueue(const YieldStrategy yieldStrategy) :
+  mMonitor(yieldStrategy),
+  mSharedWorkQueue(),
+  mHomesEnabled(false),
+  mHomeItemCount(0),
+  mNextHome(0)
 {
+    for (uint32_t index = 0; index < MAX_HOMES; ++index)
+    {
+        mHomes[index] = 0;
+    }
 }
 
 
@@ -179,6 +240,22 @@ inline void MailboxQueue<MonitorType>::InitializeWorkerContext(ContextType *cons
 
     mMonitor.InitializeWorkerContext(&context->mMonitorContext);
 
+    // Claim a free home queue, if placement is enabled.
+    {
+        typename MonitorType::LockType lock(mMonitor);
+
+        context->mHome = 0;
+        for (uint32_t index = 0; mHomesEnabled && index < MAX_HOMES; ++index)
+        {
+            if (mHomes[index] == 0)
+            {
+                mHomes[index] = context;
+                context->mHome = index + 1;
+                break;
+            }
+        }
+    }
+
     // The minimum counters need to be initialized to maxint.
     Counting::Reset(context->mCounters[COUNTER_QUEUE_LATENCY_LOCAL_MIN].mValue, COUNTER_QUEUE_LATENCY_LOCAL_MIN);
     Counting::Reset(context->mCounters[COUNTER_QUEUE_LATENCY_SHARED_MIN].mValue, COUNTER_QUEUE_LATENCY_SHARED_MIN);
@@ -199,6 +276,44 @@ inline void MailboxQueue<MonitorType>::ReleaseWorkerContext(ContextType *const c
 }
 
 
+template <class MonitorType>
+inline void MailboxQueue<MonitorType>::FlushLocalQueue(ContextType *const context)
+{
+    Mailbox *const mailbox(context->mLocalWorkQueue);
+    context->mLocalWorkQueue = 0;
+
+    if (mailbox == 0 && context->mHome == 0)
+    {
+        return;
+    }
+
+    {
+        typename MonitorType::LockType lock(mMonitor);
+
+        if (mailbox)
+        {
+            mSharedWorkQueue.Push(mailbox);
+        }
+
+        // Give up the home queue, so mailboxes homed on the thread are pushed to the shared queue.
+        if (const uint32_t home = context->mHome)
+        {
+            Queue<Mailbox> &homeQueue(mHomeQueues[home - 1]);
+            while (!homeQueue.Empty())
+            {
+                mSharedWorkQueue.Push(homeQueue.Pop());
+                --mHomeItemCount;
+            }
+
+            mHomes[home - 1] = 0;
+            context->mHome = 0;
+        }
+    }
+
+    mMonitor.PulseAll();
+}
+
+
 template <class MonitorType>
 inline void MailboxQueue<MonitorType>::ResetCounter(ContextType *const context, const uint32_t counter) const
 {
@@ -213,6 +328,13 @@ THERON_FORCEINLINE uint32_t MailboxQueue<MonitorType>::GetCounterValue(const Con
 }
 
 
+template <class MonitorType>
+THERON_FORCEINLINE void MailboxQueue<MonitorType>::AddCounterValue(ContextType *const context, const uint32_t counter, const uint32_t n) const
+{
+    Counting::Add(context->mCounters[counter].mValue, n);
+}
+
+
 template <class MonitorType>
 THERON_FORCEINLINE void MailboxQueue<MonitorType>::AccumulateCounterValue(
     const ContextType *const context,
@@ -233,9 +355,9 @@ THERON_FORCEINLINE bool MailboxQueue<MonitorType>::Empty(const ContextType *cons
         return false;
     }
 
-    // Check the shared work queue.
+    // Check the shared work queue and the home queues.
     typename MonitorType::LockType lock(mMonitor);
-    return mSharedWorkQueue.Empty();
+    return (mSharedWorkQueue.Empty() && mHomeItemCount == 0);
 }
 
 
@@ -253,6 +375,42 @@ THERON_FORCEINLINE void MailboxQueue<MonitorType>::WakeAll()
 }
 
 
+template <class MonitorType>
+inline void MailboxQueue<MonitorType>::EnableHomes()
+{
+    typename MonitorType::LockType lock(mMonitor);
+    mHomesEnabled = true;
+}
+
+
+template <class MonitorType>
+inline bool MailboxQueue<MonitorType>::IsHome(const uint32_t home) const
+{
+    typename MonitorType::LockType lock(mMonitor);
+    return (home != 0 && home <= MAX_HOMES && mHomes[home - 1] != 0);
+}
+
+
+template <class MonitorType>
+inline uint32_t MailboxQueue<MonitorType>::ChooseHome()
+{
+    typename MonitorType::LockType lock(mMonitor);
+
+    for (uint32_t count = 0; count < MAX_HOMES; ++count)
+    {
+        const uint32_t index(mNextHome);
+        mNextHome = (mNextHome + 1) % MAX_HOMES;
+
+        if (mHomes[index])
+        {
+            return index + 1;
+        }
+    }
+
+    return 0;
+}
+
+
 template <class MonitorType>
 THERON_FORCEINLINE void MailboxQueue<MonitorType>::Push(
     ContextType *const context,
@@ -297,20 +455,80 @@ THERON_FORCEINLINE void MailboxQueue<MonitorType>::Push(
         mailbox = previous;
     }
 
-    // Push the mailbox onto the shared work queue.
-    // Because the shared queue is accessed by multiple threads we have to protect it.
+    // Push the mailbox onto its home queue if it has one, or else the shared work queue.
+    // Because the shared queues are accessed by multiple threads we have to protect them.
+    bool wake(true);
+
     {
         typename MonitorType::LockType lock(mMonitor);
-        mSharedWorkQueue.Push(mailbox);
+
+        const uint32_t home(mailbox->GetHome());
+        if (home != 0 && home <= MAX_HOMES && mHomes[home - 1] != 0)
+        {
+            // A thread pushing to its own empty home queue processes the mailbox next itself.
+            // Waking another thread would only have it take the mailbox, often while it's still locked.
+            wake = (mHomes[home - 1] != context || !mHomeQueues[home - 1].Empty());
+            mHomeQueues[home - 1].Push(mailbox);
+            ++mHomeItemCount;
+        }
+        else
+        {
+            mSharedWorkQueue.Push(mailbox);
+        }
     }
 
     // Pulse the condition associated with the shared queue to wake a worker thread.
     // It's okay to release the lock before calling Pulse.
-    mMonitor.Pulse();
+    if (wake)
+    {
+        mMonitor.Pulse();
+    }
+
     Counting::Increment(context->mCounters[COUNTER_SHARED_PUSHES].mValue);
 }
 
 
+template <class MonitorType>
+inline void MailboxQueue<MonitorType>::PushBatch(
+    ContextType *const context,
+    Mailbox *const *const mailboxes,
+    const uint32_t count)
+{
+    THERON_ASSERT(context->mShared);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    {
+        typename MonitorType::LockType lock(mMonitor);
+
+        for (uint32_t index = 0; index < count; ++index)
+        {
+
+#if THERON_ENABLE_COUNTERS
+            mailboxes[index]->Timestamp() = Clock::GetTicks();
+#endif // THERON_ENABLE_COUNTERS
+
+            mSharedWorkQueue.Push(mailboxes[index]);
+        }
+    }
+
+    // Wake as many worker threads as there are mailboxes, or just one.
+    if (count > 1)
+    {
+        mMonitor.PulseAll();
+    }
+    else
+    {
+        mMonitor.Pulse();
+    }
+
+    Counting::Add(context->mCounters[COUNTER_SHARED_PUSHES].mValue, count);
+}
+
+
 template <class MonitorType>
 THERON_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::Pop(ContextType *const context)
 {
@@ -331,18 +549,18 @@ THERON_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::Pop(ContextType *const co
     }
     else
     {
-        // Wait on the shared queue until we pop a mailbox from it.
-        // Because the shared queue is accessed by multiple threads we have to protect it.
+        // Wait on the shared queues until we pop a mailbox from one of them.
+        // Because the shared queues are accessed by multiple threads we have to protect them.
         typename MonitorType::LockType lock(mMonitor);
-        while (mSharedWorkQueue.Empty() && context->mRunning == true)
+        while (mSharedWorkQueue.Empty() && mHomeItemCount == 0 && context->mRunning == true)
         {
             Counting::Increment(context->mCounters[COUNTER_YIELDS].mValue);
             mMonitor.Wait(&context->mMonitorContext, lock);
         }
 
-        if (!mSharedWorkQueue.Empty())
+        mailbox = PopShared(context);
+        if (mailbox)
         {
-            mailbox = static_cast<Mailbox *>(mSharedWorkQueue.Pop());
             mMonitor.ResetYield(&context->mMonitorContext);
         }
 
@@ -375,6 +593,34 @@ THERON_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::Pop(ContextType *const co
 }
 
 
+template <class MonitorType>
+THERON_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::PopShared(ContextType *const context)
+{
+    if (context->mHome && !mHomeQueues[context->mHome - 1].Empty())
+    {
+        --mHomeItemCount;
+        return static_cast<Mailbox *>(mHomeQueues[context->mHome - 1].Pop());
+    }
+
+    if (!mSharedWorkQueue.Empty())
+    {
+        return static_cast<Mailbox *>(mSharedWorkQueue.Pop());
+    }
+
+    // Take a mailbox homed on another thread rather than wait while it's busy.
+    for (uint32_t index = 0; mHomeItemCount != 0 && index < MAX_HOMES; ++index)
+    {
+        if (!mHomeQueues[index].Empty())
+        {
+            --mHomeItemCount;
+            return static_cast<Mailbox *>(mHomeQueues[index].Pop());
+        }
+    }
+
+    return 0;
+}
+
+
 template <class MonitorType>
 THERON_FORCEINLINE bool MailboxQueue<MonitorType>::PreferLocalQueue(
     const ContextType *const context,
@@ -11,7 +11,7 @@
 
 #include <Theron/Detail/Scheduler/YieldImplementation.h>
 #include <Theron/Detail/Scheduler/YieldPolicy.h>
-#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Threading/McsLock.h>
 
 
 #ifdef _MSC_VER
@@ -28,6 +28,9 @@ namespace Detail
 
 /**
 \brief Non-blocking monitor thread synchronization primitive based on a spinlock.
+
+The monitor protects the shared work queue, which all the worker threads contend for,
+so it uses a queued \ref McsLock in which each waiting thread spins on its own cache line.
 */
 class NonBlockingMonitor
 {
@@ -67,7 +70,7 @@ public:
         LockType(const LockType &other);
         LockType &operator=(const LockType &other);
 
-        SpinLock &mSpinLock;
+        McsLock &mSpinLock;
     };
 
     friend class LockType;
@@ -113,7 +116,7 @@ private:
     NonBlockingMonitor &operator=(const NonBlockingMonitor &other);
 
     YieldStrategy mYieldStrategy;
-    mutable SpinLock mSpinLock;
+    mutable McsLock mSpinLock;
 };
 
 
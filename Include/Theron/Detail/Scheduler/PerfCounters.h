@@ -0,0 +1,213 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_SCHEDULER_PERFCOUNTERS_H
+#define THERON_DETAIL_SCHEDULER_PERFCOUNTERS_H
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+\brief Enumerated type that lists the sampled hardware performance events.
+
+The events are listed in the same order as the corresponding handler counters
+in the \ref Counter enumeration.
+*/
+enum PerfEvent
+{
+    PERF_EVENT_CYCLES = 0,              ///< CPU cycles spent in user mode.
+    PERF_EVENT_INSTRUCTIONS,            ///< Instructions retired in user mode.
+    PERF_EVENT_CACHE_MISSES,            ///< Last-level cache misses.
+    PERF_EVENT_BRANCH_MISSES,           ///< Mispredicted branches.
+    MAX_PERF_EVENTS                     ///< Number of sampled events.
+};
+
+
+/**
+Thread-safe totals of hardware performance events, accumulated over many handler executions.
+The totals are 64-bit, since 32-bit totals of cycles or instructions wrap within seconds.
+*/
+class PerfCounterTotals
+{
+public:
+
+    /**
+    Default constructor.
+    */
+    inline PerfCounterTotals()
+    {
+    }
+
+    /**
+    Adds the given number of occurrences of an event to the total.
+    */
+    inline void Add(const uint32_t event, const uint64_t n);
+
+    /**
+    Gets the current total of the given event.
+    */
+    inline uint64_t Get(const uint32_t event) const;
+
+    /**
+    Resets all the totals to zero.
+    */
+    inline void Reset();
+
+private:
+
+    PerfCounterTotals(const PerfCounterTotals &other);
+    PerfCounterTotals &operator=(const PerfCounterTotals &other);
+
+    Atomic::UInt64 mValues[MAX_PERF_EVENTS];    ///< Total of each event.
+};
+
+
+/**
+Per-actor-class totals of hardware performance events.
+There is one instantiation per actor class, which is global to the process: the handlers
+of actors of the class are counted together, whichever framework they belong to.
+*/
+template <class ActorType>
+class ActorPerfCounters
+{
+public:
+
+    static PerfCounterTotals smTotals;          ///< Totals for all handlers of the actor class.
+};
+
+
+template <class ActorType>
+PerfCounterTotals ActorPerfCounters<ActorType>::smTotals;
+
+
+/**
+Per-worker group of hardware performance counters.
+
+The counters are opened lazily, on the worker thread that owns them, the first time
+they are started, and measure only that thread. If the kernel refuses to open them
+then they are marked as disabled and never opened again.
+
+\note The counters of a single instance must only be used by one thread.
+*/
+class PerfCounters
+{
+public:
+
+    /**
+    Constructor. Doesn't open the counters.
+    */
+    PerfCounters();
+
+    /**
+    Destructor. Closes the counters if open.
+    */
+    ~PerfCounters();
+
+    /**
+    Closes the counters, allowing them to be reopened on a different thread.
+    */
+    void Close();
+
+    /**
+    Takes a snapshot of the counter values at the start of a measured interval.
+    Opens the counters on the calling thread if they haven't been opened yet.
+    */
+    THERON_FORCEINLINE void Start()
+    {
+        if (mState == STATE_CLOSED)
+        {
+            Open();
+        }
+
+        if (mState == STATE_OPEN)
+        {
+            Read(mStartValues);
+        }
+    }
+
+    /**
+    Reads the number of events counted since the last call to Start.
+    \return True if the counters are open and were read successfully.
+    */
+    THERON_FORCEINLINE bool Stop(uint64_t *const deltas)
+    {
+        uint64_t values[MAX_PERF_EVENTS];
+        if (mState == STATE_OPEN && Read(values))
+        {
+            for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+            {
+                deltas[event] = values[event] - mStartValues[event];
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+
+    enum State
+    {
+        STATE_CLOSED = 0,           ///< Not yet opened.
+        STATE_OPEN,                 ///< Opened successfully.
+        STATE_DISABLED              ///< Opening failed; don't try again.
+    };
+
+    PerfCounters(const PerfCounters &other);
+    PerfCounters &operator=(const PerfCounters &other);
+
+    /**
+    Opens the counter group for the calling thread.
+    */
+    void Open();
+
+    /**
+    Reads the current values of all the counters in the group.
+    */
+    bool Read(uint64_t *const values);
+
+    State mState;                               ///< Whether the counters are open.
+    int mGroupLeader;                           ///< File descriptor of the group leader counter.
+    int mDescriptors[MAX_PERF_EVENTS];          ///< File descriptors of the individual counters.
+    uint64_t mStartValues[MAX_PERF_EVENTS];     ///< Counter values at the start of the measured interval.
+};
+
+
+THERON_FORCEINLINE void PerfCounterTotals::Add(const uint32_t event, const uint64_t n)
+{
+    THERON_ASSERT(event < MAX_PERF_EVENTS);
+    mValues[event].AddRelaxed(n);
+}
+
+
+THERON_FORCEINLINE uint64_t PerfCounterTotals::Get(const uint32_t event) const
+{
+    THERON_ASSERT(event < MAX_PERF_EVENTS);
+    return mValues[event].LoadAcquire();
+}
+
+
+inline void PerfCounterTotals::Reset()
+{
+    for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+    {
+        mValues[event].ExchangeRelaxed(0);
+    }
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_SCHEDULER_PERFCOUNTERS_H
@@ -0,0 +1,141 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_SCHEDULER_PLACEMENT_H
+#define THERON_DETAIL_SCHEDULER_PLACEMENT_H
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Mailboxes/Mailbox.h>
+#include <Theron/Detail/Threading/Atomic.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Communication-graph-aware placement of mailboxes on worker threads.
+
+Worker threads sample the messages sent by the mailboxes they process. Each mailbox keeps a
+one-counter frequency sketch of its sends, which converges on the mailbox it sends to most
+often, provided that one receives more than half of its messages. Mailboxes whose sketches have
+settled are passed to the manager thread in a small per-thread ring of candidates. Each period,
+the manager thread gives pairs of mailboxes that each send mostly to the other the same home
+worker thread, and the work queue prefers to process mailboxes on their home threads, so the
+messages they exchange stay in the caches of one processor.
+
+Homes are only preferences: idle worker threads take mailboxes from the home queues of busy ones.
+*/
+class Placement
+{
+public:
+
+    static const uint32_t MAX_CANDIDATES = 64;          ///< Size of the per-thread candidate ring. Must be a power of two.
+
+    /**
+    Per-thread sampling state of a worker thread.
+
+    The worker thread publishes each candidate by storing it and then advancing the write count
+    with release ordering, and the manager thread reads the write count with acquire ordering
+    before reading the candidates, so it never reads a candidate from before it was written.
+    */
+    class Samples
+    {
+    public:
+
+        inline Samples() : mSends(0), mWrite(0), mRead(0)
+        {
+        }
+
+        uint32_t mSends;                                ///< Number of sends seen by the thread. Only accessed by the worker thread.
+        Atomic::UInt32 mWrite;                          ///< Number of candidates written by the worker thread.
+        uint32_t mRead;                                 ///< Number of candidates read. Only accessed by the manager thread.
+        Atomic::Pointer<Mailbox> mCandidates[MAX_CANDIDATES];   ///< Ring of mailboxes that send mostly to one other.
+
+    private:
+
+        Samples(const Samples &other);
+        Samples &operator=(const Samples &other);
+    };
+
+    /**
+    Samples a message sent by one mailbox to another, from the worker thread processing the sender.
+    */
+    THERON_FORCEINLINE static void Sample(Samples *const samples, Mailbox *const sender, Mailbox *const receiver)
+    {
+        if ((++samples->mSends & (SAMPLE_PERIOD - 1)) != 0)
+        {
+            return;
+        }
+
+        // The sketch's count goes up with sends to its partner and down with sends to others,
+        // and the partner is replaced once the count falls to zero.
+        Mailbox *&partner(sender->Partner());
+        uint32_t &weight(sender->PartnerWeight());
+
+        if (partner == receiver)
+        {
+            if (weight < MAX_WEIGHT)
+            {
+                ++weight;
+            }
+        }
+        else if (weight > 0)
+        {
+            --weight;
+            return;
+        }
+        else
+        {
+            partner = receiver;
+            weight = 1;
+        }
+
+        if (weight >= MIN_WEIGHT)
+        {
+            const uint32_t write(samples->mWrite.LoadRelaxed());
+            samples->mCandidates[write & (MAX_CANDIDATES - 1)].StoreRelease(sender);
+            samples->mWrite.StoreRelease(write + 1);
+        }
+    }
+
+    /**
+    Returns the mailbox that the given mailbox and its partner each send mostly to the other, if any.
+    \note The sketches are read without synchronization, since they're only a heuristic.
+    */
+    inline static Mailbox *GetMutualPartner(Mailbox *const mailbox)
+    {
+        Mailbox *const partner(mailbox->Partner());
+        if (partner == 0 || partner == mailbox || mailbox->PartnerWeight() < MIN_WEIGHT)
+        {
+            return 0;
+        }
+
+        if (partner->Partner() != mailbox || partner->PartnerWeight() < MIN_WEIGHT)
+        {
+            return 0;
+        }
+
+        return partner;
+    }
+
+private:
+
+    static const uint32_t SAMPLE_PERIOD = 16;           ///< Sends per sample. Must be a power of two.
+    static const uint32_t MIN_WEIGHT = 4;               ///< Sketch count above which a partner is considered settled.
+    static const uint32_t MAX_WEIGHT = 16;              ///< Limit on the sketch count, so it can follow a change of partner.
+
+    Placement();
+    Placement(const Placement &other);
+    Placement &operator=(const Placement &other);
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_SCHEDULER_PLACEMENT_H
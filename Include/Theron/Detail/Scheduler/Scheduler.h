@@ -17,14 +17,19 @@
 #include <Theron/Detail/Directory/Directory.h>
 #include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
 #include <Theron/Detail/Mailboxes/Mailbox.h>
+#include <Theron/Detail/Messages/MessageBudget.h>
+#include <Theron/Detail/Scheduler/CpuShare.h>
 #include <Theron/Detail/Scheduler/IScheduler.h>
 #include <Theron/Detail/Scheduler/MailboxContext.h>
 #include <Theron/Detail/Scheduler/MailboxProcessor.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
+#include <Theron/Detail/Scheduler/Placement.h>
 #include <Theron/Detail/Scheduler/SchedulerHints.h>
 #include <Theron/Detail/Scheduler/ThreadPool.h>
 #include <Theron/Detail/Scheduler/WorkerContext.h>
 #include <Theron/Detail/Threading/Atomic.h>
 #include <Theron/Detail/Threading/Condition.h>
+#include <Theron/Detail/Threading/Lock.h>
 #include <Theron/Detail/Threading/Mutex.h>
 #include <Theron/Detail/Threading/Thread.h>
 
@@ -44,6 +49,29 @@ namespace Detail
 
 /**
 Mailbox scheduler.
+
+A framework has a main scheduler and, if any of its actors are marked as blocking,
+a second scheduler whose worker threads process only the mailboxes of those actors.
+Each scheduler's worker threads hand mailboxes of the other kind to the other scheduler.
+
+Worker threads that stay inside the same message handler for a whole period of the
+manager thread are assumed to be blocked. If all of a scheduler's worker threads are
+blocked while work is waiting in the shared queue, the manager thread compensates by
+starting an extra worker thread, up to a limit, and retires the extra threads again
+once they're no longer needed. The handlers executed by the blocking scheduler are all
+assumed to block, so its threads count as blocked whenever they're executing handlers.
+This is how the blocking pool, which starts with a single thread, grows to match the
+number of concurrently blocked handlers.
+
+The initial worker threads are started directly by \ref Initialize, on the calling thread.
+Between periods the manager thread waits on a condition, which is pulsed when the target
+thread count changes and when the scheduler is released, so those changes take effect
+immediately rather than at the end of the current period. Threads being stopped are all
+signalled and woken together, and then joined, so they terminate in parallel.
+
+If actors are co-located, the worker threads sample the sends between mailboxes, and each period
+the manager thread gives pairs of mailboxes that mostly message each other the same home thread
+(see \ref Placement).
 */
 template <class QueueType>
 class Scheduler : public IScheduler
@@ -54,14 +82,18 @@ public:
     Constructor.
     */
     inline explicit Scheduler(
-        Directory<Mailbox> *const mailboxes,
+        Directory<Mailbox, Mailbox::Cold> *const mailboxes,
         FallbackHandlerCollection *const fallbackHandlers,
         IAllocator *const messageAllocator,
         MailboxContext *const sharedMailboxContext,
         const uint32_t nodeMask,
         const uint32_t processorMask,
         const float threadPriority,
-        const YieldStrategy yieldStrategy);
+        const YieldStrategy yieldStrategy,
+        MailboxContext *const handoffMailboxContext,
+        const bool blockingPool,
+        const uint32_t maxCompensationThreads,
+        const bool colocateActors);
 
     /**
     Virtual destructor.
@@ -93,6 +125,16 @@ public:
     */
     inline virtual void Schedule(MailboxContext *const mailboxContext, Mailbox *const mailbox);
 
+    /**
+    Schedules for processing a batch of mailboxes that have received messages.
+    */
+    inline virtual void ScheduleBatch(MailboxContext *const mailboxContext, Mailbox *const *const mailboxes, const uint32_t count);
+
+    /**
+    Messages are processed by the worker threads, so this does nothing.
+    */
+    inline virtual uint32_t Process(const uint32_t maxMessages);
+
     inline virtual void SetMaxThreads(const uint32_t count);
     inline virtual void SetMinThreads(const uint32_t count);
     inline virtual uint32_t GetMaxThreads() const;
@@ -114,6 +156,10 @@ private:
     typedef typename ThreadPool::ThreadContext ThreadContext;
     typedef List<ThreadContext> ContextList;
 
+    static const uint32_t SHORT_MANAGER_PERIOD = 10;            ///< Manager thread period in milliseconds while threads are busy.
+    static const uint32_t LONG_MANAGER_PERIOD = 100;            ///< Manager thread period in milliseconds while threads are idle.
+    static const uint32_t QUIET_PERIODS_BEFORE_RETIRING = 10;   ///< Unblocked periods before an extra thread is retired.
+
     Scheduler(const Scheduler &other);
     Scheduler &operator=(const Scheduler &other);
 
@@ -122,6 +168,14 @@ private:
     */
     inline bool QueuesEmpty() const;
 
+    /**
+    Checks whether all the running worker threads are blocked in message handlers.
+    Threads count as blocked if they've been in the same handler since the last call,
+    or, in the blocking scheduler, if they're in any handler.
+    \note The thread context lock should be held.
+    */
+    inline bool WorkersBlocked(bool &inHandler);
+
     /**
     Static entry point function for the manager thread.
     This is a static function that calls the real entry point member function.
@@ -133,8 +187,36 @@ private:
     */
     inline void ManagerThreadProc();
 
+    /**
+    Starts worker threads, restarting stopped threads before creating new ones, until the given number are running.
+    \note The thread context lock should be held.
+    */
+    inline void StartWorkerThreads(const uint32_t targetThreadCount);
+
+    /**
+    Stops running worker threads until only the given number are running.
+    \note The thread context lock should be held.
+    */
+    inline void StopWorkerThreads(const uint32_t targetThreadCount);
+
+    /**
+    Gives the mutual partners among the mailboxes sampled by the worker threads the same home thread.
+    \note The thread context lock should be held.
+    */
+    inline void UpdatePlacement();
+
+    /**
+    Gives a mailbox and its mutual partner, if it has one, the same home thread.
+    */
+    inline void Place(Mailbox *const mailbox);
+
+    /**
+    Wakes the manager thread, so that it acts on a change without waiting for the end of its period.
+    */
+    inline void WakeManager();
+
     // Referenced external objects.
-    Directory<Mailbox> *mMailboxes;                     ///< Pointer to external mailbox array.
+    Directory<Mailbox, Mailbox::Cold> *mMailboxes;                     ///< Pointer to external mailbox array.
     FallbackHandlerCollection *mFallbackHandlers;       ///< Pointer to external fallback message handler collection.
     IAllocator *mMessageAllocator;                      ///< Pointer to external message memory block allocator.
     MailboxContext *mSharedMailboxContext;              ///< Pointer to external mailbox context shared by all worker threads.
@@ -143,31 +225,43 @@ private:
     uint32_t mNodeMask;                                 ///< NUMA node affinity mask.
     uint32_t mProcessorMask;                            ///< Processor affinity mask with each NUMA node.
     float mThreadPriority;                              ///< Relative scheduling priority of the worker threads.
+    MailboxContext *mHandoffMailboxContext;             ///< Shared mailbox context of the other scheduler, if any.
+    bool mBlockingPool;                                 ///< Indicates whether this scheduler processes blocking mailboxes.
+    uint32_t mMaxCompensationThreads;                   ///< Limit on extra threads started for blocked threads.
+    bool mColocateActors;                               ///< Indicates whether mailboxes that message each other are co-located.
 
     QueueContext mSharedQueueContext;                   ///< Per-framework queue context shared by all worker threads.
     QueueType mQueue;                                   ///< Instantiation of the work queue implementation.
 
     // Manager thread state.
     Thread mManagerThread;                              ///< Dynamically creates and destroys the worker threads.
+    Condition mManagerCondition;                        ///< Wakes the manager thread early. Its mutex protects the flags below.
     bool mRunning;                                      ///< Flag used to terminate the manager thread.
+    bool mManagerWoken;                                 ///< Set when the manager thread is woken, in case it wasn't yet waiting.
     Atomic::UInt32 mTargetThreadCount;                  ///< Desired number of worker threads.
     Atomic::UInt32 mPeakThreadCount;                    ///< Peak number of worker threads.
     Atomic::UInt32 mThreadCount;                        ///< Actual number of worker threads.
     ContextList mThreadContexts;                        ///< List of worker thread context objects.
     mutable Mutex mThreadContextLock;                   ///< Protects the thread context list.
+    uint32_t mCompensationThreads;                      ///< Extra worker threads started for blocked threads.
+    uint32_t mQuietPeriods;                             ///< Manager periods since worker threads were last blocked.
 };
 
 
 template <class QueueType>
 inline Scheduler<QueueType>::Scheduler(
-    Directory<Mailbox> *const mailboxes,
+    Directory<Mailbox, Mailbox::Cold> *const mailboxes,
     FallbackHandlerCollection *const fallbackHandlers,
     IAllocator *const messageAllocator,
     MailboxContext *const sharedMailboxContext,
     const uint32_t nodeMask,
     const uint32_t processorMask,
     const float threadPriority,
-    const YieldStrategy yieldStrategy) :
+    const YieldStrategy yieldStrategy,
+    MailboxContext *const handoffMailboxContext,
+    const bool blockingPool,
+    const uint32_t maxCompensationThreads,
+    const bool colocateActors) :
   mMailboxes(mailboxes),
   mFallbackHandlers(fallbackHandlers),
   mMessageAllocator(messageAllocator),
@@ -175,15 +269,23 @@ inline Scheduler<QueueType>::Scheduler(
   mNodeMask(nodeMask),
   mProcessorMask(processorMask),
   mThreadPriority(threadPriority),
+  mHandoffMailboxContext(handoffMailboxContext),
+  mBlockingPool(blockingPool),
+  mMaxCompensationThreads(maxCompensationThreads),
+  mColocateActors(colocateActors),
   mSharedQueueContext(),
   mQueue(yieldStrategy),
   mManagerThread(),
+  mManagerCondition(),
   mRunning(false),
+  mManagerWoken(false),
   mTargetThreadCount(0),
   mPeakThreadCount(0),
   mThreadCount(0),
   mThreadContexts(),
-  mThreadContextLock()
+  mThreadContextLock(),
+  mCompensationThreads(0),
+  mQuietPeriods(0)
 {
 }
 
@@ -205,23 +307,32 @@ inline void Scheduler<QueueType>::Initialize(const uint32_t threadCount)
     mSharedMailboxContext->mFallbackHandlers = mFallbackHandlers;
     mSharedMailboxContext->mScheduler = this;
     mSharedMailboxContext->mQueueContext = &mSharedQueueContext;
+    mSharedMailboxContext->mHandoffContext = mHandoffMailboxContext;
+    mSharedMailboxContext->mBlockingPool = mBlockingPool;
 
     mQueue.InitializeSharedContext(&mSharedQueueContext);
 
-    // Set the initial thread count and affinity masks.
-    mThreadCount.Store(0);
-    mTargetThreadCount.Store(threadCount);
+    // Worker threads claim home queues as they start, if mailboxes are co-located.
+    if (mColocateActors)
+    {
+        mQueue.EnableHomes();
+    }
+
+    // Set the initial thread count.
+    // Starting the manager thread publishes these, so they needn't be ordered.
+    mThreadCount.StoreRelaxed(0);
+    mTargetThreadCount.StoreRelaxed(threadCount);
+
+    // Start the initial worker threads here, rather than waiting for the manager thread to start them.
+    // Each worker thread sets itself up, so they get going in parallel.
+    mThreadContextLock.Lock();
+    StartWorkerThreads(threadCount);
+    mThreadContextLock.Unlock();
 
     // Start the manager thread.
     mRunning = true;
+    mManagerWoken = false;
     mManagerThread.Start(ManagerThreadEntryPoint, this);
-
-    // Wait for the manager thread to start all the worker threads.
-    uint32_t backoff(0);
-    while (mThreadCount.Load() < mTargetThreadCount.Load())
-    {
-        Utils::Backoff(backoff);
-    }
 }
 
 
@@ -235,21 +346,19 @@ inline void Scheduler<QueueType>::Release()
         Utils::Backoff(backoff);
     }
 
-    // Reset the target thread count so the manager thread will kill all the threads.
-    mTargetThreadCount.Store(0);
-
-    // Wait for all the running threads to be stopped.
-    backoff = 0;
-    while (mThreadCount.Load() > 0)
+    // Reset the target thread count and wake the manager thread, which stops all the
+    // worker threads and then terminates.
     {
-        // Pulse any threads that are waiting so they can terminate.
-        mQueue.WakeAll();
-        Utils::Backoff(backoff);
+        Lock lock(mManagerCondition.GetMutex());
+
+        mTargetThreadCount.StoreRelease(0);
+        mRunning = false;
+        mManagerWoken = true;
+        mManagerCondition.Pulse();
     }
 
-    // Kill the manager thread and wait for it to terminate.
-    mRunning = false;
     mManagerThread.Join();
+    THERON_ASSERT(mThreadCount.LoadRelaxed() == 0);
 
     mQueue.ReleaseSharedContext(&mSharedQueueContext);
 }
@@ -262,6 +371,14 @@ inline void Scheduler<QueueType>::BeginHandler(MailboxContext *const mailboxCont
     // Reset the message send count in the context and start counting sends for this handler.
     mailboxContext->mPredictedSendCount = messageHandler->GetPredictedSendCount();
     mailboxContext->mSendCount = 0;
+
+#if THERON_ENABLE_PERF_COUNTERS
+    // Snapshot the hardware counters of worker threads (the shared context has none).
+    if (PerfCounters *const perfCounters = mailboxContext->mPerfCounters)
+    {
+        perfCounters->Start();
+    }
+#endif // THERON_ENABLE_PERF_COUNTERS
 }
 
 
@@ -271,6 +388,28 @@ inline void Scheduler<QueueType>::EndHandler(MailboxContext *const mailboxContex
     // Update the cached message send count for this handler.
     // These counts are used to predict which of a handler's message sends will be its last.
     messageHandler->ReportSendCount(mailboxContext->mSendCount);
+
+#if THERON_ENABLE_PERF_COUNTERS
+    // Accumulate the hardware events counted during the handler, per thread and per actor class.
+    // The per-thread counters are 32-bit like the other framework counters, the per-class totals 64-bit.
+    uint64_t deltas[MAX_PERF_EVENTS];
+    PerfCounters *const perfCounters(mailboxContext->mPerfCounters);
+
+    if (perfCounters && perfCounters->Stop(deltas))
+    {
+        QueueContext *const queueContext(reinterpret_cast<QueueContext *>(mailboxContext->mQueueContext));
+        PerfCounterTotals *const totals(messageHandler->GetPerfCounterTotals());
+
+        for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+        {
+            mQueue.AddCounterValue(queueContext, COUNTER_HANDLER_CYCLES + event, static_cast<uint32_t>(deltas[event]));
+            if (totals)
+            {
+                totals->Add(event, deltas[event]);
+            }
+        }
+    }
+#endif // THERON_ENABLE_PERF_COUNTERS
 }
 
 
@@ -301,6 +440,15 @@ inline void Scheduler<QueueType>::Schedule(MailboxContext *const mailboxContext,
         hints.mMessageCount = sendingMailbox->Count();
     }
 
+    // Sample the sends of worker threads, so that mailboxes that message each other can be co-located.
+    if (Placement::Samples *const samples = mailboxContext->mPlacementSamples)
+    {
+        if (hints.mSend && sendingMailbox)
+        {
+            Placement::Sample(samples, sendingMailbox, mailbox);
+        }
+    }
+
     mQueue.Push(queueContext, mailbox, hints);
 
     // We remember the number of messages each message handler sends, so we can
@@ -309,12 +457,33 @@ inline void Scheduler<QueueType>::Schedule(MailboxContext *const mailboxContext,
 }
 
 
+template <class QueueType>
+inline void Scheduler<QueueType>::ScheduleBatch(
+    MailboxContext *const mailboxContext,
+    Mailbox *const *const mailboxes,
+    const uint32_t count)
+{
+    QueueContext *const queueContext(reinterpret_cast<QueueContext *>(mailboxContext->mQueueContext));
+
+    // Batches are only scheduled from outside the worker threads, so always go to the shared queue.
+    mQueue.PushBatch(queueContext, mailboxes, count);
+}
+
+
+template <class QueueType>
+inline uint32_t Scheduler<QueueType>::Process(const uint32_t /*maxMessages*/)
+{
+    return 0;
+}
+
+
 template <class QueueType>
 inline void Scheduler<QueueType>::SetMaxThreads(const uint32_t count)
 {
-    if (mTargetThreadCount.Load() > count)
+    if (mTargetThreadCount.LoadRelaxed() > count)
     {
-        mTargetThreadCount.Store(count);
+        mTargetThreadCount.StoreRelease(count);
+        WakeManager();
     }
 }
 
@@ -322,9 +491,10 @@ inline void Scheduler<QueueType>::SetMaxThreads(const uint32_t count)
 template <class QueueType>
 inline void Scheduler<QueueType>::SetMinThreads(const uint32_t count)
 {
-    if (mTargetThreadCount.Load() < count)
+    if (mTargetThreadCount.LoadRelaxed() < count)
     {
-        mTargetThreadCount.Store(count);
+        mTargetThreadCount.StoreRelease(count);
+        WakeManager();
     }
 }
 
@@ -332,28 +502,28 @@ inline void Scheduler<QueueType>::SetMinThreads(const uint32_t count)
 template <class QueueType>
 inline uint32_t Scheduler<QueueType>::GetMaxThreads() const
 {
-    return mTargetThreadCount.Load();
+    return mTargetThreadCount.LoadRelaxed();
 }
 
 
 template <class QueueType>
 inline uint32_t Scheduler<QueueType>::GetMinThreads() const
 {
-    return mTargetThreadCount.Load();
+    return mTargetThreadCount.LoadRelaxed();
 }
 
 
 template <class QueueType>
 inline uint32_t Scheduler<QueueType>::GetNumThreads() const
 {
-    return mThreadCount.Load();
+    return mThreadCount.LoadRelaxed();
 }
 
 
 template <class QueueType>
 inline uint32_t Scheduler<QueueType>::GetPeakThreads() const
 {
-    return mPeakThreadCount.Load();
+    return mPeakThreadCount.LoadRelaxed();
 }
 
 
@@ -388,6 +558,43 @@ inline bool Scheduler<QueueType>::QueuesEmpty() const
 }
 
 
+template <class QueueType>
+inline bool Scheduler<QueueType>::WorkersBlocked(bool &inHandler)
+{
+    uint32_t runningCount(0);
+    uint32_t blockedCount(0);
+
+    inHandler = false;
+
+    typename ContextList::Iterator contexts(mThreadContexts.GetIterator());
+    while (contexts.Next())
+    {
+        ThreadContext *const threadContext(contexts.Get());
+        if (ThreadPool::IsRunning(threadContext))
+        {
+            WorkerContext &workerContext(threadContext->mUserContext);
+
+            // The sequence number is odd while the thread is processing a mailbox.
+            // The acquire pairs with the worker's release, so a change of mailbox is always seen.
+            const uint32_t sequence(workerContext.mMailboxContext.mHandlerSequence.LoadAcquire());
+            if (sequence & 1)
+            {
+                inHandler = true;
+                if (mBlockingPool || sequence == workerContext.mObservedSequence)
+                {
+                    ++blockedCount;
+                }
+            }
+
+            workerContext.mObservedSequence = sequence;
+            ++runningCount;
+        }
+    }
+
+    return (runningCount > 0 && blockedCount == runningCount);
+}
+
+
 template <class QueueType>
 inline void Scheduler<QueueType>::ResetCounters()
 {
@@ -484,112 +691,323 @@ inline void Scheduler<QueueType>::ManagerThreadProc()
 {
     IAllocator *const allocator(AllocatorManager::GetCache());
 
-    while (mRunning)
+    bool running(true);
+    while (running)
     {
+        {
+            Lock lock(mManagerCondition.GetMutex());
+            running = mRunning;
+        }
+
         mThreadContextLock.Lock();
 
-        // Re-start stopped worker threads while the thread count is too low.
-        typename ContextList::Iterator contexts(mThreadContexts.GetIterator());
-        while (mThreadCount.Load() < mTargetThreadCount.Load() && contexts.Next())
+        // Start an extra thread if all the threads are blocked and work is waiting.
+        // Retire the extra threads one at a time once none have been blocked for a while.
+        bool inHandler(false);
+        if (WorkersBlocked(inHandler) && !mQueue.Empty(&mSharedQueueContext))
         {
-            ThreadContext *const threadContext(contexts.Get());
-            if (!ThreadPool::IsRunning(threadContext))
+            if (mCompensationThreads < mMaxCompensationThreads)
             {
-                if (!ThreadPool::StartThread(
-                    threadContext,
-                    mNodeMask,
-                    mProcessorMask,
-                    mThreadPriority))
-                {
-                    break;
-                }
-
-                mThreadCount.Increment();
+                ++mCompensationThreads;
             }
+
+            mQuietPeriods = 0;
+        }
+        else if (mCompensationThreads > 0 && ++mQuietPeriods >= QUIET_PERIODS_BEFORE_RETIRING)
+        {
+            --mCompensationThreads;
+            mQuietPeriods = 0;
+        }
+
+        // Extra threads are only added while the scheduler is running normally.
+        const uint32_t requestedThreadCount(mTargetThreadCount.LoadAcquire());
+        if (requestedThreadCount == 0)
+        {
+            mCompensationThreads = 0;
+        }
+
+        const uint32_t targetThreadCount(requestedThreadCount + mCompensationThreads);
+
+        StartWorkerThreads(targetThreadCount);
+        StopWorkerThreads(targetThreadCount);
+
+        if (mColocateActors)
+        {
+            UpdatePlacement();
         }
 
-        // Create new worker threads while the thread count is still too low.
-        while (mThreadCount.Load() < mTargetThreadCount.Load())
+        mThreadContextLock.Unlock();
+
+        // The manager thread spends most of its time waiting. It wakes more often while
+        // threads are in handlers, so that blocked threads are compensated promptly.
+        // It's woken early when the target thread count changes or the scheduler is released.
+        if (running)
         {
-            // Create a thread context structure wrapping the worker context.
-            void *const contextMemory = allocator->AllocateAligned(sizeof(ThreadContext), THERON_CACHELINE_ALIGNMENT);
-            THERON_ASSERT_MSG(contextMemory, "Failed to allocate worker thread context");
-
-            ThreadContext *const threadContext = new (contextMemory) ThreadContext(&mQueue);
-
-            // Set up the mailbox context for the worker thread.
-            // The mailbox context holds pointers to the scheduler and queue context.
-            // These are used to push mailboxes that still need further processing.
-            threadContext->mUserContext.mMessageCache.SetAllocator(mMessageAllocator);
-            threadContext->mUserContext.mMailboxContext.mMessageAllocator = &threadContext->mUserContext.mMessageCache;
-            threadContext->mUserContext.mMailboxContext.mFallbackHandlers = mFallbackHandlers;
-            threadContext->mUserContext.mMailboxContext.mScheduler = this;
-            threadContext->mUserContext.mMailboxContext.mQueueContext = &threadContext->mQueueContext;
-
-            // Create a worker thread with the created context.
-            if (!ThreadPool::CreateThread(threadContext))
+            Lock lock(mManagerCondition.GetMutex());
+            if (!mManagerWoken)
             {
-                THERON_FAIL_MSG("Failed to create worker thread");
+                mManagerCondition.TimedWait(lock, inHandler || mCompensationThreads > 0 ? SHORT_MANAGER_PERIOD : LONG_MANAGER_PERIOD);
             }
 
-            // Start the thread on the given node and processors.
+            mManagerWoken = false;
+        }
+    }
+
+    // Free all the allocated thread context objects.
+    while (!mThreadContexts.Empty())
+    {
+        ThreadContext *const threadContext(mThreadContexts.Front());
+        mThreadContexts.Remove(threadContext);
+
+        // Wait for the thread to stop and then destroy it.
+        ThreadPool::DestroyThread(threadContext);
+
+        if (MessageBudget *const messageBudget = threadContext->mUserContext.mMailboxContext.mMessageBudget)
+        {
+            messageBudget->Deregister(&threadContext->mUserContext.mMessageAccount);
+        }
+
+        // Destruct and free the per-thread context.
+        threadContext->~ThreadContext();
+        allocator->Free(threadContext, sizeof(ThreadContext));
+    }
+}
+
+
+template <class QueueType>
+inline void Scheduler<QueueType>::StartWorkerThreads(const uint32_t targetThreadCount)
+{
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    // Re-start stopped worker threads while the thread count is too low.
+    typename ContextList::Iterator contexts(mThreadContexts.GetIterator());
+    while (mThreadCount.LoadRelaxed() < targetThreadCount && contexts.Next())
+    {
+        ThreadContext *const threadContext(contexts.Get());
+        if (!ThreadPool::IsRunning(threadContext))
+        {
+            // Hardware counters are per-thread, so are reopened by the restarted thread.
+            threadContext->mUserContext.mPerfCounters.Close();
+
             if (!ThreadPool::StartThread(
                 threadContext,
                 mNodeMask,
                 mProcessorMask,
                 mThreadPriority))
             {
-                THERON_FAIL_MSG("Failed to start worker thread");
+                break;
             }
 
-            // Remember the context so we can reuse it and eventually destroy it.
-            mThreadContexts.Insert(threadContext);
-
-            // Track the peak thread count.
             mThreadCount.Increment();
-            if (mThreadCount.Load() > mPeakThreadCount.Load())
-            {
-                mPeakThreadCount.Store(mThreadCount.Load());
-            }
         }
+    }
 
-        // Stop some running worker threads while the thread count is too high.
-        contexts = mThreadContexts.GetIterator();
-        while (mThreadCount.Load() > mTargetThreadCount.Load() && contexts.Next())
+    // Create new worker threads while the thread count is still too low.
+    while (mThreadCount.LoadRelaxed() < targetThreadCount)
+    {
+        // Create a thread context structure wrapping the worker context.
+        void *const contextMemory = allocator->AllocateAligned(sizeof(ThreadContext), THERON_CACHELINE_ALIGNMENT);
+        THERON_ASSERT_MSG(contextMemory, "Failed to allocate worker thread context");
+
+        ThreadContext *const threadContext = new (contextMemory) ThreadContext(&mQueue);
+
+        // Set up the mailbox context for the worker thread.
+        // The mailbox context holds pointers to the scheduler and queue context.
+        // These are used to push mailboxes that still need further processing.
+        threadContext->mUserContext.mMessageCache.SetAllocator(mMessageAllocator);
+        threadContext->mUserContext.mMailboxContext.mMessageAllocator = &threadContext->mUserContext.mMessageCache;
+        threadContext->mUserContext.mMessageSlots.SetAllocator(mMessageAllocator);
+        threadContext->mUserContext.mMailboxContext.mMessageSlots = &threadContext->mUserContext.mMessageSlots;
+        threadContext->mUserContext.mMailboxContext.mFallbackHandlers = mFallbackHandlers;
+        threadContext->mUserContext.mMailboxContext.mScheduler = this;
+        threadContext->mUserContext.mMailboxContext.mQueueContext = &threadContext->mQueueContext;
+        threadContext->mUserContext.mMailboxContext.mPerfCounters = &threadContext->mUserContext.mPerfCounters;
+        threadContext->mUserContext.mMailboxContext.mHandoffContext = mHandoffMailboxContext;
+        threadContext->mUserContext.mMailboxContext.mBlockingPool = mBlockingPool;
+        threadContext->mUserContext.mMailboxContext.mMessageExpiry = mSharedMailboxContext->mMessageExpiry;
+        threadContext->mUserContext.mMailboxContext.mScratchArena = &threadContext->mUserContext.mScratchArena;
+
+        // Worker threads account for message memory in their own accounts, registered with the framework's budget.
+        if (MessageBudget *const messageBudget = mSharedMailboxContext->mMessageBudget)
         {
-            ThreadContext *const threadContext(contexts.Get());
-            if (ThreadPool::IsRunning(threadContext))
-            {
-                // Mark the thread as stopped and wake all the waiting threads.
-                ThreadPool::StopThread(threadContext);
-                mQueue.WakeAll();
+            threadContext->mUserContext.mMailboxContext.mMessageBudget = messageBudget;
+            threadContext->mUserContext.mMailboxContext.mMessageAccount = &threadContext->mUserContext.mMessageAccount;
+            messageBudget->Register(&threadContext->mUserContext.mMessageAccount);
+        }
+
+        // Likewise they time their handlers against the framework's processor share, if it has one.
+        if (CpuShare *const cpuShare = mSharedMailboxContext->mCpuShare)
+        {
+            threadContext->mUserContext.mMailboxContext.mCpuShare = cpuShare;
+            threadContext->mUserContext.mMailboxContext.mCpuSlice = &threadContext->mUserContext.mCpuSlice;
+        }
+
+        // And they sample their sends for the manager thread, if mailboxes are co-located.
+        if (mColocateActors)
+        {
+            threadContext->mUserContext.mMailboxContext.mPlacementSamples = &threadContext->mUserContext.mPlacementSamples;
+        }
+
+        // Create a worker thread with the created context.
+        if (!ThreadPool::CreateThread(threadContext))
+        {
+            THERON_FAIL_MSG("Failed to create worker thread");
+        }
+
+        // Start the thread on the given node and processors.
+        if (!ThreadPool::StartThread(
+            threadContext,
+            mNodeMask,
+            mProcessorMask,
+            mThreadPriority))
+        {
+            THERON_FAIL_MSG("Failed to start worker thread");
+        }
+
+        // Remember the context so we can reuse it and eventually destroy it.
+        mThreadContexts.Insert(threadContext);
+
+        // Track the peak thread count.
+        mThreadCount.Increment();
+        if (mThreadCount.LoadRelaxed() > mPeakThreadCount.LoadRelaxed())
+        {
+            mPeakThreadCount.StoreRelaxed(mThreadCount.LoadRelaxed());
+        }
+    }
+}
+
+
+template <class QueueType>
+inline void Scheduler<QueueType>::StopWorkerThreads(const uint32_t targetThreadCount)
+{
+    // Mark the surplus running threads as stopped.
+    uint32_t stoppingCount(0);
+    typename ContextList::Iterator contexts(mThreadContexts.GetIterator());
+    while (mThreadCount.LoadRelaxed() - stoppingCount > targetThreadCount && contexts.Next())
+    {
+        ThreadContext *const threadContext(contexts.Get());
+        if (ThreadPool::IsRunning(threadContext))
+        {
+            ThreadPool::StopThread(threadContext);
+            ++stoppingCount;
+        }
+    }
+
+    if (stoppingCount == 0)
+    {
+        return;
+    }
 
-                // Wait for the stopped thread to actually terminate.
-                ThreadPool::JoinThread(threadContext);
+    // Wake all the waiting threads once, and then wait for the stopped threads to terminate.
+    // Stopping them all before waiting for any lets them terminate in parallel.
+    mQueue.WakeAll();
 
-                mThreadCount.Decrement();
+    contexts = mThreadContexts.GetIterator();
+    while (contexts.Next())
+    {
+        ThreadContext *const threadContext(contexts.Get());
+        if (!ThreadPool::IsRunning(threadContext) && threadContext->mThread->Running())
+        {
+            ThreadPool::JoinThread(threadContext);
+            mThreadCount.Decrement();
+        }
+    }
+}
+
+
+template <class QueueType>
+inline void Scheduler<QueueType>::UpdatePlacement()
+{
+    typename ContextList::Iterator contexts(mThreadContexts.GetIterator());
+    while (contexts.Next())
+    {
+        Placement::Samples &samples(contexts.Get()->mUserContext.mPlacementSamples);
+
+        // Candidates overwritten before they were read are skipped.
+        // The acquire pairs with the worker's release, so the candidates up to the count are visible.
+        const uint32_t write(samples.mWrite.LoadAcquire());
+        uint32_t read(samples.mRead);
+
+        if (write - read > Placement::MAX_CANDIDATES)
+        {
+            read = write - Placement::MAX_CANDIDATES;
+        }
+
+        while (read != write)
+        {
+            if (Mailbox *const mailbox = samples.mCandidates[read & (Placement::MAX_CANDIDATES - 1)].LoadAcquire())
+            {
+                Place(mailbox);
             }
+
+            ++read;
         }
 
-        mThreadContextLock.Unlock();
+        samples.mRead = read;
+    }
+}
 
-        // The manager thread spends most of its time asleep.
-        Utils::SleepThread(100);
+
+template <class QueueType>
+inline void Scheduler<QueueType>::Place(Mailbox *const mailbox)
+{
+    Mailbox *const partner(Placement::GetMutualPartner(mailbox));
+    if (partner == 0)
+    {
+        return;
     }
 
-    // Free all the allocated thread context objects.
-    while (!mThreadContexts.Empty())
+    // Keep the pair's existing home if it's still valid, or else choose the next thread in turn.
+    const uint32_t mailboxHome(mailbox->GetHome());
+    const uint32_t partnerHome(partner->GetHome());
+
+    uint32_t home(0);
+    if (mQueue.IsHome(mailboxHome))
     {
-        ThreadContext *const threadContext(mThreadContexts.Front());
-        mThreadContexts.Remove(threadContext);
+        if (mailboxHome == partnerHome)
+        {
+            return;
+        }
 
-        // Wait for the thread to stop and then destroy it.
-        ThreadPool::DestroyThread(threadContext);
+        home = mailboxHome;
+    }
+    else if (mQueue.IsHome(partnerHome))
+    {
+        home = partnerHome;
+    }
+    else
+    {
+        home = mQueue.ChooseHome();
+    }
 
-        // Destruct and free the per-thread context.
-        threadContext->~ThreadContext();
-        allocator->Free(threadContext, sizeof(ThreadContext));
+    if (home == 0)
+    {
+        return;
     }
+
+    // Mailboxes of blocking actors, and of deregistered ones, aren't placed.
+    Mailbox *const pair[2] = { mailbox, partner };
+    for (uint32_t index = 0; index < 2; ++index)
+    {
+        pair[index]->Lock();
+
+        if (pair[index]->GetActor() && !pair[index]->IsBlocking())
+        {
+            pair[index]->SetHome(home);
+        }
+
+        pair[index]->Unlock();
+    }
+}
+
+
+template <class QueueType>
+inline void Scheduler<QueueType>::WakeManager()
+{
+    Lock lock(mManagerCondition.GetMutex());
+
+    mManagerWoken = true;
+    mManagerCondition.Pulse();
 }
 
 
@@ -0,0 +1,317 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_SCHEDULER_SYNCHRONOUSSCHEDULER_H
+#define THERON_DETAIL_SCHEDULER_SYNCHRONOUSSCHEDULER_H
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Containers/Queue.h>
+#include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
+#include <Theron/Detail/Mailboxes/Mailbox.h>
+#include <Theron/Detail/Messages/MessageBudget.h>
+#include <Theron/Detail/Scheduler/Counting.h>
+#include <Theron/Detail/Scheduler/IScheduler.h>
+#include <Theron/Detail/Scheduler/MailboxContext.h>
+#include <Theron/Detail/Scheduler/MailboxProcessor.h>
+#include <Theron/Detail/Scheduler/WorkerContext.h>
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Lock.h>
+#include <Theron/Detail/Threading/Mutex.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+Mailbox scheduler without worker threads, driven by the application.
+
+Scheduled mailboxes are queued in a single work queue, and are only processed when the
+application calls \ref Process, on the calling thread. No threads are started, not even
+a manager thread, and scheduling a mailbox never wakes another thread. Messages sent by
+the handlers executed within Process are queued behind the messages already waiting,
+so processing is deterministic given the same sequence of sends.
+
+Mailboxes can still be scheduled by other threads, for example by non-actor code sending
+messages, or by the framework's I/O services, so the queue is protected by a lock.
+The calling thread acts as a worker thread, with a context of its own, so Process must
+not be called by more than one thread at once.
+*/
+class SynchronousScheduler : public IScheduler
+{
+public:
+
+    /**
+    Constructor.
+    */
+    inline SynchronousScheduler(
+        FallbackHandlerCollection *const fallbackHandlers,
+        IAllocator *const messageAllocator,
+        MailboxContext *const sharedMailboxContext,
+        MailboxContext *const handoffMailboxContext);
+
+    /**
+    Virtual destructor.
+    */
+    inline virtual ~SynchronousScheduler();
+
+    /**
+    Initializes the scheduler. The thread count is ignored, since there are no worker threads.
+    */
+    inline virtual void Initialize(const uint32_t threadCount);
+
+    /**
+    Tears down the scheduler, processing any messages still queued on the calling thread.
+    */
+    inline virtual void Release();
+
+    inline virtual void BeginHandler(MailboxContext *const mailboxContext, IMessageHandler *const messageHandler);
+    inline virtual void EndHandler(MailboxContext *const mailboxContext, IMessageHandler *const messageHandler);
+    inline virtual void Schedule(MailboxContext *const mailboxContext, Mailbox *const mailbox);
+    inline virtual void ScheduleBatch(MailboxContext *const mailboxContext, Mailbox *const *const mailboxes, const uint32_t count);
+
+    /**
+    Processes up to the given number of queued messages on the calling thread.
+    */
+    inline virtual uint32_t Process(const uint32_t maxMessages);
+
+    inline virtual void SetMaxThreads(const uint32_t count);
+    inline virtual void SetMinThreads(const uint32_t count);
+    inline virtual uint32_t GetMaxThreads() const;
+    inline virtual uint32_t GetMinThreads() const;
+    inline virtual uint32_t GetNumThreads() const;
+    inline virtual uint32_t GetPeakThreads() const;
+    inline virtual void ResetCounters();
+    inline virtual uint32_t GetCounterValue(const uint32_t counter) const;
+
+    inline virtual uint32_t GetPerThreadCounterValues(
+        const uint32_t counter,
+        uint32_t *const perThreadCounts,
+        const uint32_t maxCounts) const;
+
+private:
+
+    SynchronousScheduler(const SynchronousScheduler &other);
+    SynchronousScheduler &operator=(const SynchronousScheduler &other);
+
+    FallbackHandlerCollection *mFallbackHandlers;       ///< Pointer to external fallback message handler collection.
+    IAllocator *mMessageAllocator;                      ///< Pointer to external message memory block allocator.
+    MailboxContext *mSharedMailboxContext;              ///< Pointer to external shared mailbox context.
+    MailboxContext *mHandoffMailboxContext;             ///< Shared mailbox context of the blocking scheduler, if any.
+    mutable Mutex mQueueLock;                           ///< Protects the work queue.
+    Queue<Mailbox> mWorkQueue;                          ///< Mailboxes waiting to be processed.
+    WorkerContext mWorkerContext;                       ///< Context of the thread calling Process.
+    Atomic::UInt32 mCounters[MAX_COUNTERS];             ///< Event counters.
+};
+
+
+inline SynchronousScheduler::SynchronousScheduler(
+    FallbackHandlerCollection *const fallbackHandlers,
+    IAllocator *const messageAllocator,
+    MailboxContext *const sharedMailboxContext,
+    MailboxContext *const handoffMailboxContext) :
+  mFallbackHandlers(fallbackHandlers),
+  mMessageAllocator(messageAllocator),
+  mSharedMailboxContext(sharedMailboxContext),
+  mHandoffMailboxContext(handoffMailboxContext),
+  mQueueLock(),
+  mWorkQueue(),
+  mWorkerContext()
+{
+}
+
+
+inline SynchronousScheduler::~SynchronousScheduler()
+{
+}
+
+
+inline void SynchronousScheduler::Initialize(const uint32_t /*threadCount*/)
+{
+    // The shared context is used by non-actor code, and the worker context by handlers executed in Process.
+    // Both push mailboxes back to this scheduler.
+    mSharedMailboxContext->mMessageAllocator = mMessageAllocator;
+    mSharedMailboxContext->mFallbackHandlers = mFallbackHandlers;
+    mSharedMailboxContext->mScheduler = this;
+    mSharedMailboxContext->mQueueContext = 0;
+    mSharedMailboxContext->mHandoffContext = mHandoffMailboxContext;
+    mSharedMailboxContext->mBlockingPool = false;
+
+    mWorkerContext.mMessageCache.SetAllocator(mMessageAllocator);
+    mWorkerContext.mMailboxContext.mMessageAllocator = &mWorkerContext.mMessageCache;
+    mWorkerContext.mMessageSlots.SetAllocator(mMessageAllocator);
+    mWorkerContext.mMailboxContext.mMessageSlots = &mWorkerContext.mMessageSlots;
+    mWorkerContext.mMailboxContext.mFallbackHandlers = mFallbackHandlers;
+    mWorkerContext.mMailboxContext.mScheduler = this;
+    mWorkerContext.mMailboxContext.mQueueContext = 0;
+    mWorkerContext.mMailboxContext.mHandoffContext = mHandoffMailboxContext;
+    mWorkerContext.mMailboxContext.mBlockingPool = false;
+    mWorkerContext.mMailboxContext.mMessageExpiry = mSharedMailboxContext->mMessageExpiry;
+    mWorkerContext.mMailboxContext.mScratchArena = &mWorkerContext.mScratchArena;
+
+    if (MessageBudget *const messageBudget = mSharedMailboxContext->mMessageBudget)
+    {
+        mWorkerContext.mMailboxContext.mMessageBudget = messageBudget;
+        mWorkerContext.mMailboxContext.mMessageAccount = &mWorkerContext.mMessageAccount;
+        messageBudget->Register(&mWorkerContext.mMessageAccount);
+    }
+
+    ResetCounters();
+}
+
+
+inline void SynchronousScheduler::Release()
+{
+    // Process the remaining messages, to avoid memory leaks.
+    Process(0xFFFFFFFF);
+
+    if (MessageBudget *const messageBudget = mWorkerContext.mMailboxContext.mMessageBudget)
+    {
+        messageBudget->Deregister(&mWorkerContext.mMessageAccount);
+    }
+}
+
+
+inline void SynchronousScheduler::BeginHandler(MailboxContext *const mailboxContext, IMessageHandler *const messageHandler)
+{
+    mailboxContext->mPredictedSendCount = messageHandler->GetPredictedSendCount();
+    mailboxContext->mSendCount = 0;
+}
+
+
+inline void SynchronousScheduler::EndHandler(MailboxContext *const mailboxContext, IMessageHandler *const messageHandler)
+{
+    messageHandler->ReportSendCount(mailboxContext->mSendCount);
+}
+
+
+inline void SynchronousScheduler::Schedule(MailboxContext *const mailboxContext, Mailbox *const mailbox)
+{
+    Counting::Raise(mCounters[COUNTER_MAILBOX_QUEUE_MAX], mailbox->Count());
+    Counting::Increment(mCounters[COUNTER_SHARED_PUSHES]);
+
+    {
+        Lock lock(mQueueLock);
+        mWorkQueue.Push(mailbox);
+    }
+
+    ++mailboxContext->mSendCount;
+}
+
+
+inline void SynchronousScheduler::ScheduleBatch(MailboxContext *const /*mailboxContext*/, Mailbox *const *const mailboxes, const uint32_t count)
+{
+    Counting::Add(mCounters[COUNTER_SHARED_PUSHES], count);
+
+    Lock lock(mQueueLock);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        mWorkQueue.Push(mailboxes[index]);
+    }
+}
+
+
+inline uint32_t SynchronousScheduler::Process(const uint32_t maxMessages)
+{
+    uint32_t processed(0);
+
+    while (processed < maxMessages)
+    {
+        Mailbox *mailbox(0);
+
+        {
+            Lock lock(mQueueLock);
+            if (mWorkQueue.Empty())
+            {
+                break;
+            }
+
+            mailbox = mWorkQueue.Pop();
+        }
+
+        // Each call processes one message, and re-queues the mailbox at the back if it's not empty.
+        MailboxProcessor::Process(&mWorkerContext, mailbox);
+        ++processed;
+    }
+
+    Counting::Add(mCounters[COUNTER_MESSAGES_PROCESSED], processed);
+    return processed;
+}
+
+
+inline void SynchronousScheduler::SetMaxThreads(const uint32_t /*count*/)
+{
+}
+
+
+inline void SynchronousScheduler::SetMinThreads(const uint32_t /*count*/)
+{
+}
+
+
+inline uint32_t SynchronousScheduler::GetMaxThreads() const
+{
+    return 0;
+}
+
+
+inline uint32_t SynchronousScheduler::GetMinThreads() const
+{
+    return 0;
+}
+
+
+inline uint32_t SynchronousScheduler::GetNumThreads() const
+{
+    return 0;
+}
+
+
+inline uint32_t SynchronousScheduler::GetPeakThreads() const
+{
+    return 0;
+}
+
+
+inline void SynchronousScheduler::ResetCounters()
+{
+    for (uint32_t counter = 0; counter < (uint32_t) MAX_COUNTERS; ++counter)
+    {
+        Counting::Reset(mCounters[counter], counter);
+    }
+}
+
+
+inline uint32_t SynchronousScheduler::GetCounterValue(const uint32_t counter) const
+{
+    return Counting::Get(mCounters[counter]);
+}
+
+
+inline uint32_t SynchronousScheduler::GetPerThreadCounterValues(
+    const uint32_t counter,
+    uint32_t *const perThreadCounts,
+    const uint32_t maxCounts) const
+{
+    // The calling thread counts as the only thread.
+    if (maxCounts == 0)
+    {
+        return 0;
+    }
+
+    perThreadCounts[0] = Counting::Get(mCounters[counter]);
+    return 1;
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_SCHEDULER_SYNCHRONOUSSCHEDULER_H
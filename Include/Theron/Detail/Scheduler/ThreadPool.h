@@ -262,6 +262,10 @@ inline void ThreadPool<QueueType, ContextType, ProcessorType>::ThreadEntryPoint(
             ProcessorType::Process(userContext, item);
         }
     }
+
+    // Hand on any work left in the local queue, which no other thread can see,
+    // so that it isn't stranded while the thread is stopped.
+    queue->FlushLocalQueue(queueContext);
 }
 
 
@@ -4,7 +4,13 @@
 
 
 #include <Theron/Detail/Allocators/CachingAllocator.h>
+#include <Theron/Detail/Allocators/ScratchArena.h>
+#include <Theron/Detail/Messages/MessageBudget.h>
+#include <Theron/Detail/Messages/MessageSlot.h>
+#include <Theron/Detail/Scheduler/CpuShare.h>
 #include <Theron/Detail/Scheduler/MailboxContext.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
+#include <Theron/Detail/Scheduler/Placement.h>
 
 
 #ifdef _MSC_VER
@@ -30,12 +36,19 @@ public:
     /**
     Constructor.
     */
-    inline WorkerContext()
+    inline WorkerContext() : mObservedSequence(0)
     {
     }
 
     CachingAllocator<> mMessageCache;       ///< Per-thread cache of message memory blocks.
+    MessageSlotPool mMessageSlots;          ///< Per-thread pool of slots for small messages.
     MailboxContext mMailboxContext;         ///< Per-thread context for mailbox processing.
+    PerfCounters mPerfCounters;             ///< Per-thread hardware performance counters.
+    MessageBudget::Account mMessageAccount; ///< Per-thread count of message memory charged to the framework's budget.
+    CpuShare::Slice mCpuSlice;              ///< Per-thread timing of handlers charged to the framework's processor share.
+    Placement::Samples mPlacementSamples;   ///< Per-thread samples of sends between mailboxes, read by the manager thread.
+    ScratchArena mScratchArena;             ///< Per-thread scratch memory handed to message handlers.
+    uint32_t mObservedSequence;             ///< Handler sequence number last seen by the manager thread.
 
 private:
 
@@ -3,11 +3,18 @@
 #define THERON_DETAIL_STRINGS_STRINGHASH_H
 
 
+#include <string.h>
+
 #include <Theron/Assert.h>
 #include <Theron/BasicTypes.h>
 #include <Theron/Defines.h>
 
 
+#if THERON_SSE42
+#include <nmmintrin.h>
+#endif
+
+
 namespace Theron
 {
 namespace Detail
@@ -15,33 +22,111 @@ namespace Detail
 
 
 /**
-\brief Simple hash utility for C strings.
+\brief Hash utility for C strings.
+
+Hashes and compares whole strings, hashing eight bytes at a time into 32 bits, for use with \ref HashMap.
+The length is found first with strlen, which the C library vectorizes, so the bytes
+can then be read as whole words without reading past the end of the string. Each word
+is mixed in with the SSE4.2 CRC32 instruction where available (see \ref THERON_SSE42),
+or else with multiplies and rotates, and the result is finalized with an avalanche step
+so that similar strings, such as generated names differing in one digit, spread out.
 */
 class StringHash
 {
 public:
 
-    enum
-    {
-        RANGE = 256
-    };
-
     THERON_FORCEINLINE static uint32_t Compute(const char *const str)
     {
         THERON_ASSERT(str);
+        return Compute(str, static_cast<uint32_t>(strlen(str)));
+    }
 
-        // XOR the first n characters of the string together.
-        const char *const end(str + 64);
+    /**
+    Hashes the given number of bytes.
+    */
+    THERON_FORCEINLINE static uint32_t Compute(const char *const data, const uint32_t length)
+    {
+        const char *ch(data);
+        uint32_t remaining(length);
+        uint64_t hash(SEED ^ length);
 
-        const char *ch(str);
-        uint8_t hash(0);
+        while (remaining >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, ch, 8);
+            hash = Mix(hash, word);
 
-        while (ch != end && *ch != '\0')
+            ch += 8;
+            remaining -= 8;
+        }
+
+        if (remaining > 0)
         {
-            hash ^= static_cast<uint8_t>(*ch);
-            ++ch;
+            // Assemble the last few bytes into a word one at a time, rather than calling memcpy.
+            uint64_t word(0);
+            for (uint32_t index = 0; index < remaining; ++index)
+            {
+                word |= static_cast<uint64_t>(static_cast<uint8_t>(ch[index])) << (index * 8);
+            }
+
+            hash = Mix(hash, word);
         }
 
+        return Finalize(hash);
+    }
+
+    /**
+    Compares two strings, returning true if they're equal.
+    Pooled strings are compared by pointer first, since equal pooled strings share storage.
+    */
+    THERON_FORCEINLINE static bool Equal(const char *const a, const char *const b)
+    {
+        THERON_ASSERT(a && b);
+        return (a == b || strcmp(a, b) == 0);
+    }
+
+private:
+
+    static const uint64_t SEED = 0x9E3779B97F4A7C15ULL;
+
+    THERON_FORCEINLINE static uint64_t Rotate(const uint64_t value, const uint32_t bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    THERON_FORCEINLINE static uint64_t Mix(const uint64_t hash, uint64_t word)
+    {
+
+#if THERON_SSE42 && THERON_64BIT
+
+        return _mm_crc32_u64(hash, word);
+
+#elif THERON_SSE42
+
+        const uint32_t low(_mm_crc32_u32(static_cast<uint32_t>(hash), static_cast<uint32_t>(word)));
+        const uint32_t high(_mm_crc32_u32(static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(word >> 32)));
+        return (static_cast<uint64_t>(high) << 32) | low;
+
+#else
+
+        word *= 0x87C37B91114253D5ULL;
+        word = Rotate(word, 31);
+        word *= 0x4CF5AD432745937FULL;
+
+        return Rotate(hash ^ word, 27) * 5 + 0x52DCE729;
+
+#endif
+
+    }
+
+    THERON_FORCEINLINE static uint32_t Finalize(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 33;
+
         return static_cast<uint32_t>(hash);
     }
 };
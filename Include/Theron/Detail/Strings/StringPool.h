@@ -15,7 +15,8 @@
 #include <Theron/Defines.h>
 #include <Theron/IAllocator.h>
 
-#include <Theron/Detail/Containers/List.h>
+#include <Theron/Detail/Containers/HashMap.h>
+#include <Theron/Detail/Strings/StringHash.h>
 #include <Theron/Detail/Threading/Mutex.h>
 
 
@@ -33,6 +34,7 @@ namespace Detail
 
 /**
 Static class that manages a pool of unique strings.
+The pooled strings are held in an open-addressing hash table keyed by their contents.
 */
 class StringPool
 {
@@ -66,98 +68,21 @@ public:
 
 private:
 
-    class Entry : public List<Entry>::Node
-    {
-    public:
-
-        THERON_FORCEINLINE static uint32_t GetSize(const char *const str)
-        {
-            const uint32_t length(static_cast<uint32_t>(strlen(str)));
-            uint32_t lengthWithNull(length + 1);
-            const uint32_t roundedLength(THERON_ROUNDUP(lengthWithNull, 4));
-
-            return sizeof(Entry) + roundedLength;
-        }
-
-        THERON_FORCEINLINE static Entry *Initialize(void *const memory, const char *const str)
-        {
-            char *const buffer(reinterpret_cast<char *>(memory) + sizeof(Entry));
-            strcpy(buffer, str);
-
-            return new (memory) Entry(buffer);
-        }
-
-        THERON_FORCEINLINE explicit Entry(const char *const val) : mValue(val)
-        {
-        }
-
-        THERON_FORCEINLINE const char *Value() const
-        {
-            return mValue;
-        }
-
-    private:
-
-        const char *mValue;
-    };
-
-    class Bucket
+    /**
+    Returns the size of the storage allocated for a pooled copy of the given string.
+    */
+    THERON_FORCEINLINE static uint32_t GetSize(const char *const str)
     {
-    public:
-
-        inline Bucket()
-        {
-        }
-
-        inline ~Bucket()
-        {
-            IAllocator *const allocator(AllocatorManager::GetCache());
-
-            // Free all entries at end of day.
-            while (!mEntries.Empty())
-            {
-                Entry *const entry(mEntries.Front());
-                mEntries.Remove(entry);
-
-                const uint32_t size(Entry::GetSize(entry->Value()));
-                entry->~Entry();
-                allocator->Free(entry, size);
-            }
-        }
-
-        THERON_FORCEINLINE const char *Lookup(const char *const str)
-        {
-            IAllocator *const allocator(AllocatorManager::GetCache());
-            Entry *entry(0);
-
-            // Search the bucket for an an existing entry for this string.
-            List<Entry>::Iterator entries(mEntries.GetIterator());
-            while (entries.Next())
-            {
-                Entry *const e(entries.Get());
-                if (strcmp(e->Value(), str) == 0)
-                {
-                    entry = e;
-                    break;
-                }
-            }
-
-            if (entry == 0)
-            {
-                // Create a new entry.
-                const uint32_t size(Entry::GetSize(str));
-                void *const memory(allocator->Allocate(size));
-                entry = Entry::Initialize(memory, str);
-                mEntries.Insert(entry);
-            }
-
-            return entry->Value();
-        }
+        const uint32_t length(static_cast<uint32_t>(strlen(str)));
+        uint32_t lengthWithNull(length + 1);
 
-    private:
+        return THERON_ROUNDUP(lengthWithNull, 4);
+    }
 
-        List<Entry> mEntries;
-    };
+    /**
+    Maps each pooled string to itself.
+    */
+    typedef HashMap<const char *, const char *, StringHash> StringMap;
 
     /**
     References the string pool, creating the singleton instance if it doesn't already exist.
@@ -169,14 +94,10 @@ private:
     */
     static void Dereference();
 
-    inline static uint32_t Hash(const char *const str);
-
     static StringPool *smInstance;          ///< Pointer to the singleton instance.
     static Mutex smReferenceMutex;          ///< Synchronization object protecting reference counting.
     static uint32_t smReferenceCount;       ///< Counts the number of references to the singleton.
 
-    static const uint32_t BUCKET_COUNT = 128;
-
     StringPool();
     ~StringPool();
 
@@ -185,8 +106,8 @@ private:
     */
     const char *Lookup(const char *const str);
 
-    Mutex mMutex;
-    Bucket mBuckets[BUCKET_COUNT];
+    Mutex mMutex;                           ///< Synchronization object protecting the map.
+    StringMap mStrings;                     ///< Map of the pooled strings.
 };
 
 
@@ -199,30 +120,6 @@ THERON_FORCEINLINE const char *StringPool::Get(const char *const str)
 }
 
 
-THERON_FORCEINLINE uint32_t StringPool::Hash(const char *const str)
-{
-    THERON_ASSERT(str);
-
-    // XOR the first n characters of the string together.
-    const char *const end(str + 64);
-
-    const char *ch(str);
-    uint8_t hash(0);
-
-    while (ch != end && *ch != '\0')
-    {
-        hash ^= static_cast<uint8_t>(*ch);
-        ++ch;
-    }
-
-    // Zero the 8th bit since it's usually zero anyway in ASCII.
-    // This gives an effective range of [0, 127].
-    hash &= 127;
-
-    return static_cast<uint32_t>(hash);
-}
-
-
 } // namespace Detail
 } // namespace Theron
 
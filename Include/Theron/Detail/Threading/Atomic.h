@@ -23,7 +23,7 @@
 #elif THERON_CPP11
 
 #if THERON_GCC
-#if __GNUC__ >= 4 && __GNUC_MINOR__ > 4
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ > 4)
 #include <atomic>
 #else
 #include <cstdatomic>
@@ -64,6 +64,19 @@ namespace Atomic
 
 /**
 Atomic 32-bit unsigned integer synchronization primitive.
+
+The plain \ref Load, \ref Store, \ref Increment and \ref Decrement operations are
+sequentially consistent (full barriers). Variants with explicitly weaker memory ordering
+are provided for use where the stronger guarantees aren't needed, for example for
+statistics counters (relaxed) and for lock and flag hand-offs (acquire/release).
+The weaker variants map directly to the corresponding std::atomic and boost::atomic
+memory orderings. On weakly-ordered hardware such as ARM they avoid full fences;
+on x86 the main saving is that release stores become plain stores rather than
+locked exchanges.
+
+With the Windows implementation, acquire loads and release stores are implemented
+as volatile accesses, which have acquire and release semantics in Visual C++ by default.
+With the POSIX emulation all operations take an internal spinlock and so are fully ordered.
 */
 class UInt32
 {
@@ -209,6 +222,75 @@ public:
         pthread_spin_unlock(&mSpinLock);
         return success;
 
+#endif
+    }
+
+    /**
+    Atomic compare-and-exchange with no memory ordering constraints.
+    Suitable for statistics where only the atomicity of the update matters.
+    */
+    THERON_FORCEINLINE bool CompareExchangeRelaxed(uint32_t &currentValue, const uint32_t newValue)
+    {
+#if THERON_WINDOWS
+
+        const uint32_t expectedValue(currentValue);
+        currentValue = InterlockedCompareExchange(
+            reinterpret_cast<volatile LONG *>(&mValue),
+            static_cast<LONG>(newValue),
+            static_cast<LONG>(currentValue));
+
+        return (currentValue == expectedValue);
+
+#elif THERON_BOOST
+
+        return mValue.compare_exchange_weak(
+            currentValue,
+            newValue,
+            boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        return mValue.compare_exchange_weak(
+            currentValue,
+            newValue,
+            std::memory_order_relaxed);
+
+#elif THERON_POSIX
+
+        return CompareExchangeAcquire(currentValue, newValue);
+
+#endif
+    }
+
+    /**
+    Atomic addition with no memory ordering constraints.
+    \return The value before the addition.
+    */
+    THERON_FORCEINLINE uint32_t AddRelaxed(const uint32_t n)
+    {
+#if THERON_WINDOWS
+
+        return static_cast<uint32_t>(InterlockedExchangeAdd(
+            reinterpret_cast<volatile LONG *>(&mValue),
+            static_cast<LONG>(n)));
+
+#elif THERON_BOOST
+
+        return mValue.fetch_add(n, boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        return mValue.fetch_add(n, std::memory_order_relaxed);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        const uint32_t previousValue(mValue);
+        mValue = previousValue + n;
+        pthread_spin_unlock(&mSpinLock);
+
+        return previousValue;
+
 #endif
     }
 
@@ -285,6 +367,55 @@ public:
 
         return mValue;
 
+#endif
+    }
+
+    /**
+    Atomically get the current value, with 'acquire' memory ordering semantics.
+    Reads and writes following the load can't be reordered before it.
+    */
+    THERON_FORCEINLINE uint32_t LoadAcquire() const
+    {
+#if THERON_WINDOWS
+
+        return static_cast<uint32_t>(mValue);
+
+#elif THERON_BOOST
+
+        return mValue.load(boost::memory_order_acquire);
+
+#elif THERON_CPP11
+
+        return mValue.load(std::memory_order_acquire);
+
+#elif THERON_POSIX
+
+        return Load();
+
+#endif
+    }
+
+    /**
+    Atomically get the current value, with no memory ordering constraints.
+    */
+    THERON_FORCEINLINE uint32_t LoadRelaxed() const
+    {
+#if THERON_WINDOWS
+
+        return static_cast<uint32_t>(mValue);
+
+#elif THERON_BOOST
+
+        return mValue.load(boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        return mValue.load(std::memory_order_relaxed);
+
+#elif THERON_POSIX
+
+        return mValue;
+
 #endif
     }
 
@@ -313,6 +444,55 @@ public:
         mValue = val;
         pthread_spin_unlock(&mSpinLock);
 
+#endif
+    }
+
+    /**
+    Atomically set the current value, with 'release' memory ordering semantics.
+    Reads and writes preceding the store can't be reordered after it.
+    */
+    THERON_FORCEINLINE void StoreRelease(const uint32_t val)
+    {
+#if THERON_WINDOWS
+
+        mValue = static_cast<int32_t>(val);
+
+#elif THERON_BOOST
+
+        mValue.store(val, boost::memory_order_release);
+
+#elif THERON_CPP11
+
+        mValue.store(val, std::memory_order_release);
+
+#elif THERON_POSIX
+
+        Store(val);
+
+#endif
+    }
+
+    /**
+    Atomically set the current value, with no memory ordering constraints.
+    */
+    THERON_FORCEINLINE void StoreRelaxed(const uint32_t val)
+    {
+#if THERON_WINDOWS
+
+        mValue = static_cast<int32_t>(val);
+
+#elif THERON_BOOST
+
+        mValue.store(val, boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        mValue.store(val, std::memory_order_relaxed);
+
+#elif THERON_POSIX
+
+        Store(val);
+
 #endif
     }
 
@@ -327,11 +507,11 @@ private:
 
 #elif THERON_BOOST
 
-    volatile boost::atomic_uint32_t mValue;
+    boost::atomic_uint32_t mValue;
 
 #elif THERON_CPP11
 
-    volatile std::atomic_uint_least32_t mValue;
+    std::atomic_uint_least32_t mValue;
 
 #elif THERON_POSIX
 
@@ -344,6 +524,404 @@ private:
 };
 
 
+/**
+Atomic 64-bit unsigned integer synchronization primitive.
+
+Provides the subset of operations needed by lock-free structures that pack an index
+together with a counter into a single word, such as the tagged stacks of \ref LockFreePool,
+and by 64-bit statistics totals, which are updated with relaxed additions.
+The compare-and-exchange is a strong exchange (it never fails spuriously) with combined
+acquire and release semantics.
+
+With GCC the POSIX implementation uses the compiler's atomic builtins, so the primitive
+is lock-free on the usual 64-bit targets, and on 32-bit x86 with cmpxchg8b (i586 or later).
+With other POSIX compilers it's emulated with a spinlock, like \ref UInt32.
+*/
+class UInt64
+{
+public:
+
+    /**
+    Explicit constructor that initializes the value.
+    */
+    inline explicit UInt64(const uint64_t initialValue = 0) : mValue(initialValue)
+    {
+#if THERON_WINDOWS
+#elif THERON_BOOST
+#elif THERON_CPP11
+#elif THERON_POSIX && !THERON_GCC
+
+        pthread_spin_init(&mSpinLock, 0);
+
+#endif
+    }
+
+    /**
+    Destructor.
+    */
+    inline ~UInt64()
+    {
+#if THERON_WINDOWS
+#elif THERON_BOOST
+#elif THERON_CPP11
+#elif THERON_POSIX && !THERON_GCC
+
+        pthread_spin_destroy(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Atomically get the current value, with 'acquire' memory ordering semantics.
+    */
+    THERON_FORCEINLINE uint64_t LoadAcquire() const
+    {
+#if THERON_WINDOWS
+
+        // A plain read of a 64-bit value isn't atomic in 32-bit builds.
+        return static_cast<uint64_t>(InterlockedCompareExchange64(
+            const_cast<volatile LONGLONG *>(&mValue),
+            0,
+            0));
+
+#elif THERON_BOOST
+
+        return mValue.load(boost::memory_order_acquire);
+
+#elif THERON_CPP11
+
+        return mValue.load(std::memory_order_acquire);
+
+#elif THERON_POSIX && THERON_GCC
+
+        return __sync_fetch_and_add(const_cast<volatile uint64_t *>(&mValue), 0);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        const uint64_t value(mValue);
+        pthread_spin_unlock(&mSpinLock);
+
+        return value;
+
+#endif
+    }
+
+    /**
+    Atomic strong compare-and-exchange with 'acquire' and 'release' memory ordering semantics.
+    \return True if the value was equal to currentValue and was replaced by newValue;
+    otherwise false, in which case currentValue is updated to the actual value.
+    */
+    THERON_FORCEINLINE bool CompareExchange(uint64_t &currentValue, const uint64_t newValue)
+    {
+#if THERON_WINDOWS
+
+        const uint64_t expectedValue(currentValue);
+        currentValue = static_cast<uint64_t>(InterlockedCompareExchange64(
+            &mValue,
+            static_cast<LONGLONG>(newValue),
+            static_cast<LONGLONG>(expectedValue)));
+
+        return (currentValue == expectedValue);
+
+#elif THERON_BOOST
+
+        return mValue.compare_exchange_strong(currentValue, newValue, boost::memory_order_acq_rel);
+
+#elif THERON_CPP11
+
+        return mValue.compare_exchange_strong(currentValue, newValue, std::memory_order_acq_rel);
+
+#elif THERON_POSIX && THERON_GCC
+
+        const uint64_t expectedValue(currentValue);
+        currentValue = __sync_val_compare_and_swap(&mValue, expectedValue, newValue);
+
+        return (currentValue == expectedValue);
+
+#elif THERON_POSIX
+
+        bool success(false);
+        pthread_spin_lock(&mSpinLock);
+
+        const uint64_t actualValue(mValue);
+        if (actualValue == currentValue)
+        {
+            mValue = newValue;
+            success = true;
+        }
+
+        currentValue = actualValue;
+
+        pthread_spin_unlock(&mSpinLock);
+        return success;
+
+#endif
+    }
+
+    /**
+    Atomically add a value, with no memory ordering constraints.
+    Suitable for statistics that don't guard other data.
+    eturn The value before the addition.
+    */
+    THERON_FORCEINLINE uint64_t AddRelaxed(const uint64_t n)
+    {
+#if THERON_WINDOWS
+
+        return static_cast<uint64_t>(InterlockedExchangeAdd64(&mValue, static_cast<LONGLONG>(n)));
+
+#elif THERON_BOOST
+
+        return mValue.fetch_add(n, boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        return mValue.fetch_add(n, std::memory_order_relaxed);
+
+#elif THERON_POSIX && THERON_GCC
+
+        return __sync_fetch_and_add(&mValue, n);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        const uint64_t value(mValue);
+        mValue = value + n;
+        pthread_spin_unlock(&mSpinLock);
+
+        return value;
+
+#endif
+    }
+
+    /**
+    Atomically replace the value, with no memory ordering constraints.
+    eturn The value before the exchange.
+    */
+    THERON_FORCEINLINE uint64_t ExchangeRelaxed(const uint64_t newValue)
+    {
+#if THERON_WINDOWS
+
+        return static_cast<uint64_t>(InterlockedExchange64(&mValue, static_cast<LONGLONG>(newValue)));
+
+#elif THERON_BOOST
+
+        return mValue.exchange(newValue, boost::memory_order_relaxed);
+
+#elif THERON_CPP11
+
+        return mValue.exchange(newValue, std::memory_order_relaxed);
+
+#elif THERON_POSIX && THERON_GCC
+
+        return __sync_lock_test_and_set(&mValue, newValue);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        const uint64_t value(mValue);
+        mValue = newValue;
+        pthread_spin_unlock(&mSpinLock);
+
+        return value;
+
+#endif
+    }
+
+private:
+
+    UInt64(const UInt64 &other);
+    UInt64 &operator=(const UInt64 &other);
+
+#if THERON_WINDOWS
+
+    volatile LONGLONG mValue;
+
+#elif THERON_BOOST
+
+    boost::atomic<uint64_t> mValue;
+
+#elif THERON_CPP11
+
+    std::atomic<uint64_t> mValue;
+
+#elif THERON_POSIX && THERON_GCC
+
+    volatile uint64_t mValue;
+
+#elif THERON_POSIX
+
+    volatile uint64_t mValue;
+    mutable pthread_spinlock_t mSpinLock;
+
+#endif
+
+};
+
+
+/**
+Atomic pointer synchronization primitive.
+
+Provides the subset of operations needed by lock-free linked structures such as the
+queue nodes of \ref McsLock. The compare-and-exchange is a strong exchange (it never
+fails spuriously) with combined acquire and release semantics.
+*/
+template <class ValueType>
+class Pointer
+{
+public:
+
+    /**
+    Explicit constructor that initializes the value.
+    */
+    inline explicit Pointer(ValueType *const initialValue = 0) : mValue(initialValue)
+    {
+#if THERON_WINDOWS
+#elif THERON_BOOST
+#elif THERON_CPP11
+#elif THERON_POSIX
+
+        pthread_spin_init(&mSpinLock, 0);
+
+#endif
+    }
+
+    /**
+    Destructor.
+    */
+    inline ~Pointer()
+    {
+#if THERON_WINDOWS
+#elif THERON_BOOST
+#elif THERON_CPP11
+#elif THERON_POSIX
+
+        pthread_spin_destroy(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Atomic strong compare-and-exchange with 'acquire' and 'release' memory ordering semantics.
+    \return True if the value was equal to currentValue and was replaced by newValue.
+    */
+    THERON_FORCEINLINE bool CompareExchange(ValueType *const currentValue, ValueType *const newValue)
+    {
+#if THERON_WINDOWS
+
+        return (InterlockedCompareExchangePointer(
+            reinterpret_cast<PVOID volatile *>(&mValue),
+            newValue,
+            currentValue) == currentValue);
+
+#elif THERON_BOOST
+
+        ValueType *expectedValue(currentValue);
+        return mValue.compare_exchange_strong(expectedValue, newValue, boost::memory_order_acq_rel);
+
+#elif THERON_CPP11
+
+        ValueType *expectedValue(currentValue);
+        return mValue.compare_exchange_strong(expectedValue, newValue, std::memory_order_acq_rel);
+
+#elif THERON_POSIX
+
+        bool success(false);
+        pthread_spin_lock(&mSpinLock);
+
+        if (mValue == currentValue)
+        {
+            mValue = newValue;
+            success = true;
+        }
+
+        pthread_spin_unlock(&mSpinLock);
+        return success;
+
+#endif
+    }
+
+    /**
+    Atomically get the current value, with 'acquire' memory ordering semantics.
+    */
+    THERON_FORCEINLINE ValueType *LoadAcquire() const
+    {
+#if THERON_WINDOWS
+
+        return mValue;
+
+#elif THERON_BOOST
+
+        return mValue.load(boost::memory_order_acquire);
+
+#elif THERON_CPP11
+
+        return mValue.load(std::memory_order_acquire);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        ValueType *const value(mValue);
+        pthread_spin_unlock(&mSpinLock);
+
+        return value;
+
+#endif
+    }
+
+    /**
+    Atomically set the current value, with 'release' memory ordering semantics.
+    */
+    THERON_FORCEINLINE void StoreRelease(ValueType *const val)
+    {
+#if THERON_WINDOWS
+
+        mValue = val;
+
+#elif THERON_BOOST
+
+        mValue.store(val, boost::memory_order_release);
+
+#elif THERON_CPP11
+
+        mValue.store(val, std::memory_order_release);
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+        mValue = val;
+        pthread_spin_unlock(&mSpinLock);
+
+#endif
+    }
+
+private:
+
+    Pointer(const Pointer &other);
+    Pointer &operator=(const Pointer &other);
+
+#if THERON_WINDOWS
+
+    ValueType *volatile mValue;
+
+#elif THERON_BOOST
+
+    boost::atomic<ValueType *> mValue;
+
+#elif THERON_CPP11
+
+    std::atomic<ValueType *> mValue;
+
+#elif THERON_POSIX
+
+    ValueType *volatile mValue;
+    mutable pthread_spinlock_t mSpinLock;
+
+#endif
+
+};
+
+
 } // namespace Atomic
 } // namespace Detail
 } // namespace Theron
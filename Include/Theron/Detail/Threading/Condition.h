@@ -19,9 +19,16 @@
 
 #include <windows.h>
 
+#elif THERON_FUTEX
+
+#include <limits.h>
+
+#include <Theron/Detail/Threading/Futex.h>
+
 #elif THERON_POSIX
 
 #include <pthread.h>
+#include <time.h>
 
 #elif THERON_BOOST
 
@@ -30,6 +37,7 @@
 
 #elif THERON_CPP11
 
+#include <chrono>
 #include <thread>
 #include <condition_variable>
 
@@ -52,6 +60,13 @@ namespace Detail
 
 /**
 Portable condition variable synchronization primitive, sometimes also called a monitor.
+
+With the futex implementation (see \ref THERON_FUTEX) the condition counts its waiting
+threads, and \ref Pulse and \ref PulseAll return without making a system call when there
+are none. Waiting threads sleep on a sequence number that is advanced by every pulse.
+Each pulse removes the threads it wakes from the count itself, rather than leaving them
+to do it once they've reacquired the mutex, so that pulses issued in the meantime don't
+make system calls to wake threads that are already awake.
 */
 class Condition
 {
@@ -66,6 +81,11 @@ public:
 
         InitializeConditionVariable(&mCondition);
 
+#elif THERON_FUTEX
+
+        mSequence = 0;
+        mWaiters = 0;
+
 #elif THERON_POSIX
 
         pthread_cond_init(&mCondition, 0);
@@ -82,6 +102,7 @@ public:
     inline ~Condition()
     {
 #if THERON_WINDOWS
+#elif THERON_FUTEX
 #elif THERON_POSIX
 
         pthread_cond_destroy(&mCondition);
@@ -111,6 +132,20 @@ public:
         (void) lock;
         SleepConditionVariableCS(&mCondition, &lock.mMutex.mCriticalSection, INFINITE);
     
+#elif THERON_FUTEX
+
+        // Register as a waiter and read the sequence number while still holding the mutex.
+        // Any pulse issued after we release the mutex sees the waiter and advances the
+        // sequence number, so the futex wait returns immediately rather than missing it.
+        // The pulse that wakes us also unregisters us. If we wake for some other reason
+        // then our registration is left behind, which costs a wasted wake but is harmless.
+        Futex::Add(&mWaiters, 1);
+        const int32_t sequence(mSequence);
+
+        lock.mMutex.Unlock();
+        Futex::Wait(&mSequence, sequence);
+        lock.mMutex.Lock();
+
 #elif THERON_POSIX
 
         pthread_cond_wait(&mCondition, &lock.mMutex.mMutex);
@@ -127,6 +162,59 @@ public:
         THERON_ASSERT(lock.mLock.owns_lock());
         mCondition.wait(lock.mLock);
 
+#endif
+    }
+
+    /**
+    Suspends the calling thread until it is woken by another thread calling \ref Pulse or \ref PulseAll,
+    or until the given number of milliseconds has passed, whichever happens first.
+    \note The calling thread must hold a lock on the mutex associated with the condition.
+    The lock owned by the caller is released, and automatically regained when the thread is woken.
+    The caller can't tell whether it was pulsed or timed out, so should check the state it's waiting for.
+    */
+    inline void TimedWait(Lock &lock, const uint32_t milliseconds)
+    {
+#if THERON_WINDOWS
+
+        SleepConditionVariableCS(&mCondition, &lock.mMutex.mCriticalSection, milliseconds);
+    
+#elif THERON_FUTEX
+
+        // As in Wait. A registration left behind by a timeout costs at most one wasted wake.
+        Futex::Add(&mWaiters, 1);
+        const int32_t sequence(mSequence);
+
+        lock.mMutex.Unlock();
+        Futex::TimedWait(&mSequence, sequence, milliseconds);
+        lock.mMutex.Lock();
+
+#elif THERON_POSIX
+
+        // Condition variable timeouts are absolute times on the realtime clock.
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        deadline.tv_sec += static_cast<time_t>(milliseconds / 1000);
+        deadline.tv_nsec += static_cast<long>(milliseconds % 1000) * 1000000L;
+
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&mCondition, &lock.mMutex.mMutex, &deadline);
+
+#elif THERON_BOOST
+
+        THERON_ASSERT(lock.mLock.owns_lock());
+        mCondition.timed_wait(lock.mLock, boost::posix_time::milliseconds(milliseconds));
+
+#elif THERON_CPP11
+
+        THERON_ASSERT(lock.mLock.owns_lock());
+        mCondition.wait_for(lock.mLock, std::chrono::milliseconds(milliseconds));
+
 #endif
     }
 
@@ -139,6 +227,23 @@ public:
 
         WakeConditionVariable(&mCondition);
 
+#elif THERON_FUTEX
+
+        int32_t waiters(Futex::Load(&mWaiters));
+        while (waiters > 0)
+        {
+            // Unregister the thread we're about to wake.
+            const int32_t previous(Futex::CompareExchange(&mWaiters, waiters, waiters - 1));
+            if (previous == waiters)
+            {
+                Futex::Add(&mSequence, 1);
+                Futex::Wake(&mSequence, 1);
+                break;
+            }
+
+            waiters = previous;
+        }
+
 #elif THERON_POSIX
 
         pthread_cond_signal(&mCondition);
@@ -163,6 +268,14 @@ public:
 
          WakeAllConditionVariable(&mCondition);
 
+#elif THERON_FUTEX
+
+        if (Futex::Load(&mWaiters) != 0 && Futex::ExchangeAcquire(&mWaiters, 0) != 0)
+        {
+            Futex::Add(&mSequence, 1);
+            Futex::Wake(&mSequence, INT_MAX);
+        }
+
 #elif THERON_POSIX
 
         pthread_cond_broadcast(&mCondition);
@@ -189,6 +302,11 @@ private:
 
     CONDITION_VARIABLE mCondition;
 
+#elif THERON_FUTEX
+
+    volatile int32_t mSequence;         ///< Futex word advanced by each pulse.
+    volatile int32_t mWaiters;          ///< Number of threads in Wait that haven't been pulsed.
+
 #elif THERON_POSIX
 
     pthread_cond_t mCondition;
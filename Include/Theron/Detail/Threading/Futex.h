@@ -0,0 +1,130 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_THREADING_FUTEX_H
+#define THERON_DETAIL_THREADING_FUTEX_H
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+#if THERON_FUTEX
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#endif // THERON_FUTEX
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+#if THERON_FUTEX
+
+
+/**
+Static interface to Linux futexes, and the atomic operations on futex words that go with them.
+
+A futex is a 32-bit word in user memory. Threads manipulate the word with ordinary atomic
+instructions, and only make a system call to sleep on the word, or to wake threads sleeping
+on it, when the value of the word says that's necessary. The futexes are process-private.
+*/
+class Futex
+{
+public:
+
+    /**
+    Atomic compare-and-exchange, with full memory barrier semantics.
+    \return The value of the word before the exchange.
+    */
+    THERON_FORCEINLINE static int32_t CompareExchange(volatile int32_t *const word, const int32_t currentValue, const int32_t newValue)
+    {
+        return __sync_val_compare_and_swap(word, currentValue, newValue);
+    }
+
+    /**
+    Atomic exchange, with 'acquire' memory ordering semantics.
+    \return The value of the word before the exchange.
+    */
+    THERON_FORCEINLINE static int32_t ExchangeAcquire(volatile int32_t *const word, const int32_t newValue)
+    {
+        return __sync_lock_test_and_set(word, newValue);
+    }
+
+    /**
+    Atomic addition, with full memory barrier semantics.
+    \return The value of the word before the addition.
+    */
+    THERON_FORCEINLINE static int32_t Add(volatile int32_t *const word, const int32_t n)
+    {
+        return __sync_fetch_and_add(word, n);
+    }
+
+    /**
+    Reads the word after a full memory barrier, so the read can't be reordered before preceding writes.
+    */
+    THERON_FORCEINLINE static int32_t Load(const volatile int32_t *const word)
+    {
+        __sync_synchronize();
+        return *word;
+    }
+
+    /**
+    Sets the word to zero, with 'release' memory ordering semantics.
+    */
+    THERON_FORCEINLINE static void ClearRelease(volatile int32_t *const word)
+    {
+        __sync_lock_release(word);
+    }
+
+    /**
+    Puts the calling thread to sleep until woken, if the word still has the expected value.
+    Returns immediately if the value has already changed. May also return spuriously.
+    */
+    inline static void Wait(volatile int32_t *const word, const int32_t expectedValue)
+    {
+        syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expectedValue, 0, 0, 0);
+    }
+
+    /**
+    Puts the calling thread to sleep until woken, or until the given time has passed,
+    if the word still has the expected value. May also return spuriously.
+    */
+    inline static void TimedWait(volatile int32_t *const word, const int32_t expectedValue, const uint32_t milliseconds)
+    {
+        // Futex wait timeouts are relative.
+        timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(milliseconds / 1000);
+        timeout.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000L;
+
+        syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expectedValue, &timeout, 0, 0);
+    }
+
+    /**
+    Wakes at most the given number of threads sleeping on the word.
+    */
+    inline static void Wake(volatile int32_t *const word, const int32_t count)
+    {
+        syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, 0, 0, 0);
+    }
+
+private:
+
+    Futex();
+    Futex(const Futex &other);
+    Futex &operator=(const Futex &other);
+};
+
+
+#endif // THERON_FUTEX
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#endif // THERON_DETAIL_THREADING_FUTEX_H
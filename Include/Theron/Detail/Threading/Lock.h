@@ -58,7 +58,7 @@ public:
     THERON_FORCEINLINE explicit Lock(Mutex &mutex) :
 #if THERON_WINDOWS
       mMutex(mutex)
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
       mMutex(mutex)
 #elif THERON_BOOST
       mLock(mutex.mMutex)
@@ -70,7 +70,7 @@ public:
 
         mMutex.Lock();
 
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
 
         mMutex.Lock();
 
@@ -94,7 +94,7 @@ public:
 
         mMutex.Unlock();
 
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
 
         mMutex.Unlock();
 
@@ -119,7 +119,7 @@ public:
 
         mMutex.Unlock();
 
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
 
         mMutex.Unlock();
 
@@ -146,7 +146,7 @@ public:
 
         mMutex.Lock();
 
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
 
         mMutex.Lock();
 
@@ -172,7 +172,7 @@ private:
 
     Mutex &mMutex;
 
-#elif THERON_POSIX
+#elif THERON_FUTEX || THERON_POSIX
 
     Mutex &mMutex;
 
@@ -0,0 +1,229 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_THREADING_MCSLOCK_H
+#define THERON_DETAIL_THREADING_MCSLOCK_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+#elif THERON_POSIX
+
+#include <pthread.h>
+
+#else
+
+#error Theron requires POSIX thread support, Boost, or Windows.
+
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4127)  // Conditional expression is constant.
+#pragma warning (disable:4324)  // structure was padded due to __declspec(align())
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+A fair, scalable queued spinlock for heavily contended locks.
+
+Waiting threads form a FIFO queue of nodes, and each waiter spins on a flag in its
+own cache-line-sized node rather than on the shared lock word. Unlocking hands the
+lock directly to the next waiter by clearing its flag, so a release invalidates only
+one other cache rather than every waiter's.
+
+This is the variant of the Mellor-Crummey and Scott lock from the K42 operating system,
+which keeps the ordinary Lock and Unlock interface. Waiting threads use a node on
+their own stack, and the lock's own node stands in for the holder's once it's acquired,
+so callers don't need to provide queue nodes and the lock can replace \ref SpinLock
+at any use site.
+
+\note With the POSIX implementation, which has no native atomics, the MCS lock
+is a plain pthreads spinlock and isn't fair.
+*/
+class THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) McsLock
+{
+public:
+
+    /**
+    Default constructor.
+    */
+    THERON_FORCEINLINE McsLock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+#elif THERON_POSIX
+
+        pthread_spin_init(&mSpinLock, 0);
+
+#endif
+    }
+
+    /**
+    Destructor.
+    */
+    THERON_FORCEINLINE ~McsLock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        THERON_ASSERT(mNode.mTail.LoadAcquire() == 0);
+
+#elif THERON_POSIX
+
+        pthread_spin_destroy(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Locks the lock, waiting for all threads that queued for it earlier.
+    \note The calling thread will busy-wait and hence this method should be used with care.
+    */
+    inline void Lock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        while (true)
+        {
+            Node *const tail(mNode.mTail.LoadAcquire());
+            if (tail == 0)
+            {
+                // The lock is free. The lock's own node represents the holder in the queue.
+                if (mNode.mTail.CompareExchange(0, &mNode))
+                {
+                    return;
+                }
+            }
+            else
+            {
+                // A waiting node points to itself; its predecessor clears it to pass on the lock.
+                Node node;
+                node.mTail.StoreRelease(&node);
+
+                if (mNode.mTail.CompareExchange(tail, &node))
+                {
+                    tail->mNext.StoreRelease(&node);
+
+                    uint32_t backoff(0);
+                    while (node.mTail.LoadAcquire() != 0)
+                    {
+                        Utils::Backoff(backoff);
+                    }
+
+                    // We hold the lock, but our node is about to go out of scope.
+                    // Move our successor, if any, into the lock's node.
+                    Node *successor(node.mNext.LoadAcquire());
+                    if (successor == 0)
+                    {
+                        mNode.mNext.StoreRelease(0);
+                        if (mNode.mTail.CompareExchange(&node, &mNode))
+                        {
+                            return;
+                        }
+
+                        // Another thread queued behind us and will link to our node shortly.
+                        while ((successor = node.mNext.LoadAcquire()) == 0)
+                        {
+                            Utils::YieldToHyperthread();
+                        }
+                    }
+
+                    mNode.mNext.StoreRelease(successor);
+                    return;
+                }
+            }
+
+            Utils::YieldToHyperthread();
+        }
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Unlocks the lock, handing it directly to the next waiting thread, if any.
+    */
+    inline void Unlock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        Node *successor(mNode.mNext.LoadAcquire());
+        if (successor == 0)
+        {
+            if (mNode.mTail.CompareExchange(&mNode, 0))
+            {
+                return;
+            }
+
+            // A thread has queued but hasn't linked itself to the lock's node yet.
+            while ((successor = mNode.mNext.LoadAcquire()) == 0)
+            {
+                Utils::YieldToHyperthread();
+            }
+        }
+
+        successor->mTail.StoreRelease(0);
+
+#elif THERON_POSIX
+
+        pthread_spin_unlock(&mSpinLock);
+
+#endif
+    }
+
+private:
+
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+    /**
+    Queue node, padded to a cache line so that each waiter spins on its own line.
+    */
+    struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) Node
+    {
+        Atomic::Pointer<Node> mTail;    ///< Queue tail in the lock's node; waiting flag in a waiter's node.
+        Atomic::Pointer<Node> mNext;    ///< Next node in the queue.
+
+    } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+#endif
+
+    McsLock(const McsLock &other);
+    McsLock &operator=(const McsLock &other);
+
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+    Node mNode;                         ///< Node of the lock holder, and tail of the queue.
+
+#elif THERON_POSIX
+
+    pthread_spinlock_t mSpinLock;
+
+#endif
+
+} THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
+
+
+#endif // THERON_DETAIL_THREADING_MCSLOCK_H
@@ -3,6 +3,8 @@
 #define THERON_DETAIL_THREADING_MUTEX_H
 
 
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
 #include <Theron/Defines.h>
 
 
@@ -14,6 +16,11 @@
 
 #include <windows.h>
 
+#elif THERON_FUTEX
+
+#include <Theron/Detail/Threading/Futex.h>
+#include <Theron/Detail/Threading/Utils.h>
+
 #elif THERON_POSIX
 
 #include <pthread.h>
@@ -46,6 +53,11 @@ namespace Detail
 
 /**
 Portable mutex synchronization primitive.
+
+With the futex implementation (see \ref THERON_FUTEX) the mutex is a single futex word,
+which records whether the mutex is locked and whether any threads may be sleeping on it.
+Locking an unlocked mutex and unlocking a mutex with no waiters are single atomic
+instructions, without system calls.
 */
 class Mutex
 {
@@ -63,6 +75,10 @@ public:
 
         InitializeCriticalSection(&mCriticalSection);
 
+#elif THERON_FUTEX
+
+        mState = UNLOCKED;
+
 #elif THERON_POSIX
 
         pthread_mutex_init(&mMutex, 0);
@@ -81,6 +97,10 @@ public:
 
         DeleteCriticalSection(&mCriticalSection);
 
+#elif THERON_FUTEX
+
+        THERON_ASSERT(mState == UNLOCKED);
+
 #elif THERON_POSIX
 
         pthread_mutex_destroy(&mMutex);
@@ -100,6 +120,14 @@ public:
 
         EnterCriticalSection(&mCriticalSection);
 
+#elif THERON_FUTEX
+
+        int32_t state(Futex::CompareExchange(&mState, UNLOCKED, LOCKED));
+        if (state != UNLOCKED)
+        {
+            LockContended(state);
+        }
+
 #elif THERON_POSIX
 
         pthread_mutex_lock(&mMutex);
@@ -124,6 +152,15 @@ public:
 
         LeaveCriticalSection(&mCriticalSection);
 
+#elif THERON_FUTEX
+
+        // Only make the system call if a thread may be sleeping on the mutex.
+        if (Futex::Add(&mState, -1) != LOCKED)
+        {
+            Futex::ClearRelease(&mState);
+            Futex::Wake(&mState, 1);
+        }
+
 #elif THERON_POSIX
 
         pthread_mutex_unlock(&mMutex);
@@ -144,10 +181,27 @@ private:
     Mutex(const Mutex &other);
     Mutex &operator=(const Mutex &other);
 
+#if THERON_FUTEX && !THERON_WINDOWS
+
+    static const int32_t UNLOCKED = 0;          ///< Not locked.
+    static const int32_t LOCKED = 1;            ///< Locked, with no sleeping threads.
+    static const int32_t CONTENDED = 2;         ///< Locked, with threads possibly sleeping on the futex.
+
+    /**
+    Slow path of Lock, called when the mutex was found to be already locked.
+    */
+    inline void LockContended(int32_t state);
+
+#endif // THERON_FUTEX && !THERON_WINDOWS
+
 #if THERON_WINDOWS
 
     CRITICAL_SECTION mCriticalSection;
 
+#elif THERON_FUTEX
+
+    volatile int32_t mState;                    ///< Futex word holding the lock state.
+
 #elif THERON_POSIX
 
     pthread_mutex_t mMutex;
@@ -165,6 +219,41 @@ private:
 };
 
 
+#if THERON_FUTEX && !THERON_WINDOWS
+
+
+inline void Mutex::LockContended(int32_t state)
+{
+    // Spin briefly first, since mutexes are typically held only for a short time.
+    for (uint32_t spin = 0; spin < 100 && state == LOCKED; ++spin)
+    {
+        Utils::YieldToHyperthread();
+        state = Futex::CompareExchange(&mState, UNLOCKED, LOCKED);
+        if (state == UNLOCKED)
+        {
+            return;
+        }
+    }
+
+    // Mark the mutex as contended so that the holder wakes us when it unlocks, and sleep.
+    // Once we've marked it we have to leave it marked on acquiring it, since other
+    // threads may have gone to sleep on it in the meantime.
+    if (state != CONTENDED)
+    {
+        state = Futex::ExchangeAcquire(&mState, CONTENDED);
+    }
+
+    while (state != UNLOCKED)
+    {
+        Futex::Wait(&mState, CONTENDED);
+        state = Futex::ExchangeAcquire(&mState, CONTENDED);
+    }
+}
+
+
+#endif // THERON_FUTEX && !THERON_WINDOWS
+
+
 } // namespace Detail
 } // namespace Theron
 
@@ -50,7 +50,7 @@ public:
     {
 #if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
 
-        mValue.Store(0);
+        mValue.StoreRelaxed(UNLOCKED);
 
 #elif THERON_POSIX
 
@@ -84,8 +84,10 @@ public:
         uint32_t backoff(0);
         while (true)
         {
+            // Only attempt the exchange when the lock looks free, so waiting threads
+            // spin on a shared read-only copy of the cache line rather than stealing it.
             uint32_t currentValue(UNLOCKED);
-            if (mValue.CompareExchangeAcquire(currentValue, LOCKED))
+            if (mValue.LoadRelaxed() == UNLOCKED && mValue.CompareExchangeAcquire(currentValue, LOCKED))
             {
                 return;
             }
@@ -108,8 +110,9 @@ public:
     {
 #if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
 
-        THERON_ASSERT(mValue.Load() == LOCKED);
-        mValue.Store(UNLOCKED);
+        // The release store is enough to publish writes made while holding the lock.
+        THERON_ASSERT(mValue.LoadRelaxed() == LOCKED);
+        mValue.StoreRelease(UNLOCKED);
     
 #elif THERON_POSIX
 
@@ -0,0 +1,158 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_DETAIL_THREADING_TICKETLOCK_H
+#define THERON_DETAIL_THREADING_TICKETLOCK_H
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+#elif THERON_POSIX
+
+#include <pthread.h>
+
+#else
+
+#error Theron requires POSIX thread support, Boost, or Windows.
+
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4127)  // Conditional expression is constant.
+#pragma warning (disable:4324)  // structure was padded due to __declspec(align())
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+/**
+A fair spinlock that grants the lock to waiting threads in the order they arrived.
+
+Each thread takes a ticket by incrementing a shared counter and waits until the
+'now serving' counter reaches its ticket. Unlocking is a single store by the holder.
+Acquiring is as cheap as with \ref SpinLock when uncontended, and the FIFO ordering
+prevents starvation under contention. All waiters still spin on the same cache line,
+so the ticket lock suits short critical sections with a few contending threads;
+heavily contended locks should prefer \ref McsLock.
+
+The lock isn't cache-line aligned, so it can share a cache line with the data it protects,
+as in mailboxes. Owners that need it on a line of its own can align it themselves.
+
+\note With the POSIX implementation, which has no native atomics, the ticket lock
+is a plain pthreads spinlock and isn't fair.
+*/
+class TicketLock
+{
+public:
+
+    /**
+    Default constructor.
+    */
+    THERON_FORCEINLINE TicketLock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        mNextTicket.StoreRelaxed(0);
+        mNowServing.StoreRelaxed(0);
+
+#elif THERON_POSIX
+
+        pthread_spin_init(&mSpinLock, 0);
+
+#endif
+    }
+
+    /**
+    Destructor.
+    */
+    THERON_FORCEINLINE ~TicketLock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+#elif THERON_POSIX
+
+        pthread_spin_destroy(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Locks the ticket lock, waiting for all threads that called Lock earlier.
+    \note The calling thread will busy-wait and hence this method should be used with care.
+    */
+    THERON_FORCEINLINE void Lock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        // Taking a ticket needs no ordering; the acquire load of the serving count does.
+        const uint32_t ticket(mNextTicket.AddRelaxed(1));
+
+        uint32_t backoff(0);
+        while (mNowServing.LoadAcquire() != ticket)
+        {
+            Utils::Backoff(backoff);
+        }
+
+#elif THERON_POSIX
+
+        pthread_spin_lock(&mSpinLock);
+
+#endif
+    }
+
+    /**
+    Unlocks the ticket lock, passing it to the next waiting thread, if any.
+    */
+    THERON_FORCEINLINE void Unlock()
+    {
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+        // Only the holder writes the serving count, so it doesn't need an atomic increment.
+        THERON_ASSERT(mNextTicket.LoadRelaxed() != mNowServing.LoadRelaxed());
+        mNowServing.StoreRelease(mNowServing.LoadRelaxed() + 1);
+
+#elif THERON_POSIX
+
+        pthread_spin_unlock(&mSpinLock);
+
+#endif
+    }
+
+private:
+
+    TicketLock(const TicketLock &other);
+    TicketLock &operator=(const TicketLock &other);
+
+#if THERON_WINDOWS || THERON_BOOST || THERON_CPP11
+
+    Atomic::UInt32 mNextTicket;         ///< Ticket issued to the next thread to call Lock.
+    Atomic::UInt32 mNowServing;         ///< Ticket of the thread currently holding the lock.
+
+#elif THERON_POSIX
+
+    pthread_spinlock_t mSpinLock;
+
+#endif
+};
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
+
+
+#endif // THERON_DETAIL_THREADING_TICKETLOCK_H
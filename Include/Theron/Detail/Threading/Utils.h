@@ -49,6 +49,13 @@
 #endif
 #endif
 
+#if !THERON_WINDOWS && defined(__linux__)
+
+// Per-thread resource usage is queried with the Linux-specific RUSAGE_THREAD.
+#include <sys/resource.h>
+
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif //_MSC_VER
@@ -93,6 +100,13 @@ public:
     */
     inline static void SleepThread(const uint32_t milliseconds);
 
+    /**
+    Queries the processor time used by the calling thread, and the number of times it has been preempted.
+    The preemption count is only available on some platforms, and is zero on others.
+    \return True, if the processor time is supported and the returned values are valid.
+    */
+    inline static bool GetThreadUsage(uint64_t &microseconds, uint32_t &preemptions);
+
     /**
     Gets the number of processor nodes in a NUMA system.
 
@@ -282,6 +296,42 @@ THERON_FORCEINLINE void Utils::SleepThread(const uint32_t milliseconds)
 }
 
 
+inline bool Utils::GetThreadUsage(uint64_t &microseconds, uint32_t &preemptions)
+{
+    preemptions = 0;
+
+#if THERON_WINDOWS
+
+    // Thread times are in units of 100 nanoseconds.
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        const uint64_t kernel((static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime);
+        const uint64_t user((static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime);
+
+        microseconds = (kernel + user) / 10;
+        return true;
+    }
+
+#elif defined(__linux__) && defined(RUSAGE_THREAD)
+
+    // Involuntary context switches are those in which the thread was preempted while runnable.
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0)
+    {
+        microseconds = static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+            static_cast<uint64_t>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+        preemptions = static_cast<uint32_t>(usage.ru_nivcsw);
+        return true;
+    }
+
+#endif
+
+    microseconds = 0;
+    return false;
+}
+
+
 inline bool Utils::GetNodeCount(uint32_t &nodeCount)
 {
 
@@ -0,0 +1,92 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_FILERESULT_H
+#define THERON_FILERESULT_H
+
+
+/**
+\file FileResult.h
+Completion message of asynchronous file reads and writes.
+*/
+
+
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief Message sent to the requester when an asynchronous file read or write completes.
+
+File reads and writes requested with \ref Framework::ReadFile and \ref Framework::WriteFile
+are performed by the file I/O service of the framework, without blocking any worker
+threads. When a request completes, a FileResult message is sent to the address given with
+the request. Actors can handle it like any other message:
+
+\code
+class LineCounter : public Theron::Actor
+{
+public:
+
+    explicit LineCounter(Theron::Framework &framework) : Theron::Actor(framework)
+    {
+        RegisterHandler(this, &LineCounter::Handler);
+        GetFramework().ReadFile(GetAddress(), "log.txt");
+    }
+
+private:
+
+    void Handler(const Theron::FileResult &result, const Theron::Address from)
+    {
+        const char *const data(static_cast<const char *>(result.mBuffer));
+        for (Theron::uint32_t index = 0; index < result.mSize; ++index)
+        {
+            mLines += (data[index] == '\n');
+        }
+
+        // The buffer belongs to the recipient of the result, which must free it.
+        GetFramework().FreeFileBuffer(result.mBuffer);
+    }
+
+    Theron::uint32_t mLines;
+};
+\endcode
+
+The result carries the buffer used for the transfer, which is always a pooled file buffer
+obtained from \ref Framework::AllocateFileBuffer. Ownership of the buffer passes to the
+recipient of the result, which must return it with \ref Framework::FreeFileBuffer when done.
+The buffer is returned even when the request fails, in which case \ref mError is non-zero.
+
+\note If the message types of an application are registered (see \ref THERON_DECLARE_REGISTERED_MESSAGE)
+then FileResult must be registered too, like any other message type.
+*/
+struct FileResult
+{
+    /**
+    \brief Constructor.
+    */
+    inline FileResult(
+        const uint32_t tag = 0,
+        void *const buffer = 0,
+        const uint32_t size = 0,
+        const uint32_t error = 0) :
+      mTag(tag),
+      mBuffer(buffer),
+      mSize(size),
+      mError(error)
+    {
+    }
+
+    uint32_t mTag;          ///< User-defined value passed with the request, for identifying the result.
+    void *mBuffer;          ///< Pooled buffer holding the data read or written, owned by the recipient.
+    uint32_t mSize;         ///< Number of bytes actually read or written.
+    uint32_t mError;        ///< Zero on success, otherwise an operating system error code (an errno value).
+};
+
+
+} // namespace Theron
+
+
+#endif // THERON_FILERESULT_H
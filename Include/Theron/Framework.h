@@ -17,24 +17,36 @@ Framework that hosts and executes actors.
 #include <Theron/Assert.h>
 #include <Theron/BasicTypes.h>
 #include <Theron/Defines.h>
+#include <Theron/DescriptorReady.h>
+#include <Theron/FileResult.h>
 #include <Theron/IAllocator.h>
+#include <Theron/MessageBudgetPolicy.h>
 #include <Theron/YieldStrategy.h>
 
-#include <Theron/Detail/Allocators/CachingAllocator.h>
 #include <Theron/Detail/Debug/BuildDescriptor.h>
 #include <Theron/Detail/Directory/Directory.h>
 #include <Theron/Detail/Directory/Entry.h>
 #include <Theron/Detail/Handlers/DefaultFallbackHandler.h>
 #include <Theron/Detail/Handlers/FallbackHandlerCollection.h>
+#include <Theron/Detail/IO/FileService.h>
+#include <Theron/Detail/IO/Reactor.h>
+#include <Theron/Detail/Mailboxes/IConflater.h>
 #include <Theron/Detail/Mailboxes/Mailbox.h>
+#include <Theron/Detail/Messages/Message.h>
+#include <Theron/Detail/Messages/MessageBudget.h>
 #include <Theron/Detail/Messages/MessageCreator.h>
+#include <Theron/Detail/Messages/MessageDescriptor.h>
+#include <Theron/Detail/Messages/MessageExpiry.h>
 #include <Theron/Detail/Scheduler/Counting.h>
+#include <Theron/Detail/Scheduler/CpuShare.h>
 #include <Theron/Detail/Scheduler/MailboxContext.h>
 #include <Theron/Detail/Scheduler/IScheduler.h>
+#include <Theron/Detail/Scheduler/PerfCounters.h>
 #include <Theron/Detail/Strings/String.h>
 #include <Theron/Detail/Strings/StringPool.h>
 #include <Theron/Detail/Threading/Atomic.h>
-#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Threading/Mutex.h>
+#include <Theron/Detail/Threading/TicketLock.h>
 
 
 #ifdef _MSC_VER
@@ -113,6 +125,7 @@ public:
 
     friend class Actor;
     friend class EndPoint;
+    friend class Detail::Reactor;
 
     /**
     \brief Parameters structure that can be passed to the Framework constructor.
@@ -174,6 +187,45 @@ public:
     basis. The expectation is that the actors within a single framework will mainly message
     each other, with messages being sent between frameworks far less frequently.
 
+    Actors whose message handlers block, for example by reading files or waiting on a database,
+    stall the worker thread executing them and hence the other actors queued behind them. Such
+    actors can mark themselves as blocking with \ref Actor::SetBlocking, and are then executed by a
+    separate pool of worker threads, created on demand. The blocking pool starts with one thread
+    and grows while all of its threads are blocked, up to \ref mMaxBlockingThreads. Similarly, if
+    all of the framework's main worker threads are stuck in unmarked blocking handlers while
+    other work is waiting, up to \ref mMaxCompensationThreads extra worker threads are started
+    to compensate. Extra threads are retired once they're no longer needed.
+
+    Actors that only need to read or write files can avoid blocking altogether by using the
+    file I/O service of the framework (see \ref Framework::ReadFile). The service transfers
+    data in pooled buffers of \ref mFileBufferSize bytes, with up to \ref mFileQueueDepth
+    requests in flight at once when io_uring is used (see \ref THERON_IO_URING), or using
+    a pool of \ref mFileThreadCount threads otherwise. The service is started on first use.
+
+    Frameworks hosting actors that may be flooded with messages can be given a budget of
+    \ref mMessageBudget bytes, limiting the memory of the messages waiting in their mailboxes.
+    Messages that would exceed the budget are handled according to \ref mMessageBudgetPolicy
+    (see \ref MessageBudgetPolicy). The memory in use can be queried with
+    \ref Framework::GetMessageMemory.
+
+    Frameworks whose worker threads share processors can be given \ref mCpuShares, a relative
+    weight for dividing the processor time between them. While the threads of one such framework are
+    being kept off the processors by those of another, a framework that has used more than its share
+    of the time pauses its threads between messages until the other catches up, so each gets processor
+    time in proportion to its weight. Frameworks that are idle, or already get all the processor time
+    they can use, don't hold back the others. This allows a latency-critical
+    framework and a batch framework to be co-located on the same processors with predictable
+    throughput for each. Frameworks compete only if their node and processor masks overlap.
+    Only the main worker threads are timed, not the threads executing blocking actors.
+
+    Actors that mostly message each other are best executed by the same worker thread, so that
+    the messages they exchange stay in the caches of one processor. Setting \ref mColocateActors
+    makes the worker threads sample the messages sent between actors, and the framework periodically
+    gives pairs of actors that mostly message each other a common home thread, on which they're
+    preferably executed. Homes are only preferences: idle threads still execute actors homed on busy
+    ones, so work isn't held up. The sampling adds a small cost to each message sent by an actor,
+    so co-location is off by default. Actors marked as blocking aren't co-located.
+
     \note Support for node and processor affinity masks is currently somewhat limited.
     Supported is implemented with Windows NUMA API in windows builds, and with libnuma under linux.
     In GCC builds, NUMA support requires libnuma-dev and must be explicitly enabled via \ref THERON_NUMA
@@ -204,15 +256,37 @@ public:
           mNodeMask(nodeMask),
           mProcessorMask(processorMask),
           mYieldStrategy(yieldStrategy),
-          mThreadPriority(priority)
+          mThreadPriority(priority),
+          mMaxBlockingThreads(16),
+          mMaxCompensationThreads(4),
+          mFileThreadCount(4),
+          mFileBufferSize(65536),
+          mFileQueueDepth(64),
+          mMessageBudget(0),
+          mMessageBudgetPolicy(MESSAGE_BUDGET_FAIL),
+          mMessageBudgetCallback(0),
+          mMessageBudgetContext(0),
+          mCpuShares(0),
+          mColocateActors(false)
         {
         }
 
-        uint32_t mThreadCount;          ///< The initial number of worker threads to create within the framework.
+        uint32_t mThreadCount;          ///< The initial number of worker threads to create within the framework. Zero creates no threads (see \ref RunOnce).
         uint32_t mNodeMask;             ///< 32-bit mask specifying the NUMA processor nodes upon which the framework may execute.
         uint32_t mProcessorMask;        ///< 32-bit mask specifying the subset of the processors in each NUMA processor node upon which the framework may execute.
         YieldStrategy mYieldStrategy;   ///< Member of \ref YieldStrategy specifying how worker threads yield to other system threads when no work is available.
         float mThreadPriority;          ///< Number between -1.0 and 1.0 indicating the relative scheduling priority of the worker threads.
+        uint32_t mMaxBlockingThreads;   ///< Maximum number of worker threads executing actors marked as blocking.
+        uint32_t mMaxCompensationThreads; ///< Maximum number of extra worker threads started while all worker threads are blocked.
+        uint32_t mFileThreadCount;      ///< Number of threads performing file I/O when io_uring is unavailable.
+        uint32_t mFileBufferSize;       ///< Size in bytes of the pooled buffers used for file I/O.
+        uint32_t mFileQueueDepth;       ///< Maximum number of file requests in flight at once when io_uring is used.
+        uint32_t mMessageBudget;        ///< Limit in bytes on the memory of messages waiting in the framework. Zero, the default, disables accounting.
+        MessageBudgetPolicy mMessageBudgetPolicy;       ///< Member of \ref MessageBudgetPolicy specifying what happens to messages that would exceed the budget.
+        MessageBudgetCallback mMessageBudgetCallback;   ///< Function deciding whether to accept such messages, with \ref MESSAGE_BUDGET_CALLBACK.
+        void *mMessageBudgetContext;    ///< User-defined context pointer passed to the callback.
+        uint32_t mCpuShares;            ///< Relative weight of the framework in sharing processors with other frameworks. Zero, the default, opts out.
+        bool mColocateActors;           ///< Whether actors that mostly message each other are executed on the same worker thread. False by default.
     };
 
     /**
@@ -385,6 +459,27 @@ public:
     template <typename ValueType>
     inline bool Send(const ValueType &value, const Address &from, const Address &address);
 
+    /**
+    \brief Sends a message that expires if it isn't handled within the given time.
+
+    This method is like the other \ref Send overload, but gives the message a deadline
+    of the given number of milliseconds from now. Messages still waiting in the mailbox of an
+    actor when their deadlines pass are dropped without being handled, and passed instead to the
+    expiry handler of the actor's framework, if any. See \ref Actor::Send for details.
+
+    \tparam ValueType The message type.
+    \param value The message value.
+    \param from The address of the sending entity (typically a receiver).
+    \param address The address of the target entity (an actor or a receiver).
+    \param timeToLive Time in milliseconds within which the message should be handled.
+    Zero means the message never expires.
+    \return True, if the message was delivered to an entity, otherwise false.
+
+    \see SetExpiryHandler
+    */
+    template <typename ValueType>
+    inline bool Send(const ValueType &value, const Address &from, const Address &address, const uint32_t timeToLive);
+
     /**
     \brief Specifies a maximum limit on the number of worker threads enabled in this framework.
 
@@ -509,6 +604,83 @@ public:
     */
     inline uint32_t GetPeakThreads() const;
 
+    /**
+    \brief Gets the number of bytes of memory used by messages waiting in the framework.
+
+    Messages are counted from when they're queued in the mailbox of an actor in the framework
+    until the worker thread that processed them destroys them. Messages are only counted in
+    frameworks with a non-zero \ref Parameters::mMessageBudget; in others this returns zero.
+
+    \see GetPeakMessageMemory
+    */
+    inline uint32_t GetMessageMemory() const;
+
+    /**
+    \brief Gets the peak number of bytes of memory used by messages waiting in the framework.
+
+    Worker threads account for messages in batches, so the peak is approximate, and may miss
+    brief peaks of less than a few kilobytes.
+    */
+    inline uint32_t GetPeakMessageMemory() const;
+
+    /**
+    \brief Gets the number of messages that have expired in the framework.
+
+    Messages sent with a time-to-live expire if their deadlines pass while they're waiting
+    in the mailbox of an actor in the framework. Expired messages are dropped without being
+    handled, and counted, whether or not an expiry handler is set.
+
+    \see SetExpiryHandler
+    */
+    inline uint32_t GetNumExpiredMessages() const;
+
+    /**
+    \brief Processes up to the given number of queued messages on the calling thread.
+
+    A framework constructed with a thread count of zero has no worker threads, and no manager
+    thread. Messages sent to its actors are queued, and are only processed when the application
+    calls RunOnce or \ref RunUntilIdle, which execute the message handlers inline on the calling
+    thread. This allows an application to drive a framework from its own loop, for example once
+    per tick of a game server, with deterministic ordering and without any cross-thread wakeups.
+
+    \code
+    Theron::Framework::Parameters params;
+    params.mThreadCount = 0;
+
+    Theron::Framework framework(params);
+    MyActor actor(framework);
+
+    while (running)
+    {
+        framework.Send(Tick(), Theron::Address::Null(), actor.GetAddress());
+        framework.RunUntilIdle();
+    }
+    \endcode
+
+    Messages sent by handlers executed within the call are queued behind the messages already
+    waiting, and are processed within the same call if the limit allows.
+
+    \param maxMessages Maximum number of messages to process before returning.
+    \return The number of messages processed, which is zero if none were queued.
+
+    \note In frameworks with worker threads, messages are processed by the worker threads
+    and this method does nothing, returning zero.
+    \note RunOnce and RunUntilIdle must not be called by more than one thread at once.
+    Messages can still be sent to the framework's actors from any thread.
+    */
+    inline uint32_t RunOnce(const uint32_t maxMessages = 1);
+
+    /**
+    \brief Processes queued messages on the calling thread until none are left.
+
+    Like \ref RunOnce, but processes messages until the queue is empty, including any
+    messages sent by the handlers executed within the call. So it doesn't return while
+    actors keep messaging each other.
+
+    \return The number of messages processed.
+    */
+    inline uint32_t RunUntilIdle();
+
     /**
     \brief Returns the number of counters available for querying via GetCounterValue.
 
@@ -577,6 +749,176 @@ public:
         uint32_t *const perThreadCounts,
         const uint32_t maxCounts) const;
 
+    /**
+    \brief Gets the value of a hardware event counter accumulated over all actors of a given class.
+
+    When \ref THERON_ENABLE_PERF_COUNTERS is enabled, hardware performance events counted
+    during the execution of message handlers are accumulated per actor class, as well as per
+    framework. This method gets the accumulated total for the actor class identified by the
+    template parameter. Only the hardware event counters (cycles, instructions, cache misses
+    and branch misses) are accumulated per actor class; for other counters zero is returned.
+
+    \code
+    const Theron::uint64_t cycles(Theron::Framework::GetActorCounterValue<MyActor>(cyclesCounter));
+    \endcode
+
+    Unlike the framework counters returned by \ref GetCounterValue, which are 32-bit values
+    that wrap, the totals are 64-bit, so don't wrap however long the handlers run.
+
+    \note The totals are global to the process, not per framework: if actors of the same class
+    run in more than one framework then their handlers are counted together. To profile one
+    framework alone, reset the totals before running it and don't run the class elsewhere meanwhile.
+    \note The totals count the handlers registered by the actor class itself (not those of derived classes).
+    \note If the hardware counters can't be opened, for example because the kernel forbids
+    perf events, the totals stay zero.
+
+    \tparam ActorType The class of actor whose handler executions are queried.
+    \param counter An integer index identifying the counter to be queried.
+    \return Current total of the counter for the actor class.
+
+    \see GetCounterName
+    \see ResetActorCounters
+    */
+    template <class ActorType>
+    inline static uint64_t GetActorCounterValue(const uint32_t counter);
+
+    /**
+    \brief Resets the hardware event counters accumulated for the given class of actor.
+    \see GetActorCounterValue
+    */
+    template <class ActorType>
+    inline static void ResetActorCounters();
+
+    /**
+    \brief Reads a file asynchronously, sending the data to the given address as a \ref FileResult message.
+
+    The read is queued with the file I/O service of the framework and performed without
+    blocking any worker threads, or the calling thread. Up to \ref Parameters::mFileBufferSize
+    bytes are read, starting at the given offset, into a pooled buffer. When the read completes,
+    a \ref FileResult message carrying the buffer is sent to the client address, which is
+    typically the address of the calling actor. The recipient owns the buffer, and must return
+    it with \ref FreeFileBuffer when it has finished with the data.
+
+    \code
+    class Reader : public Theron::Actor
+    {
+    public:
+
+        explicit Reader(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &Reader::Handler);
+            GetFramework().ReadFile(GetAddress(), "input.txt");
+        }
+
+    private:
+
+        void Handler(const Theron::FileResult &result, const Theron::Address from)
+        {
+            if (result.mError == 0)
+            {
+                printf("Read %d bytes\n", result.mSize);
+            }
+
+            GetFramework().FreeFileBuffer(result.mBuffer);
+        }
+    };
+    \endcode
+
+    Files larger than a buffer can be read in chunks, by issuing reads at successive offsets.
+    Reads past the end of the file complete successfully with fewer bytes, or none.
+
+    \param client Address to which the result is sent.
+    \param fileName Name of the file to read. The name is copied, so can be destroyed after the call.
+    \param tag User-defined value returned in the result, for identifying it.
+    \param offset Offset within the file at which to start reading.
+    \return False if the request couldn't be queued, in which case no result is sent.
+
+    \note When the requests are serviced by io_uring, reads of many files are submitted to the
+    kernel in batches by a single service thread. Otherwise a small pool of threads performs
+    them with blocking system calls. See \ref THERON_IO_URING.
+    */
+    bool ReadFile(
+        const Address &client,
+        const char *const fileName,
+        const uint32_t tag = 0,
+        const uint64_t offset = 0);
+
+    /**
+    \brief Writes a buffer to a file asynchronously, sending a \ref FileResult message to the given address on completion.
+
+    The buffer must be a pooled buffer obtained from \ref AllocateFileBuffer. Ownership
+    of the buffer passes to the file I/O service, which returns it to the client address
+    with the result. The file is created if it doesn't exist; existing contents outside the
+    written range are left unchanged.
+
+    \param client Address to which the result is sent.
+    \param fileName Name of the file to write. The name is copied, so can be destroyed after the call.
+    \param buffer Pooled buffer holding the data to write.
+    \param size Number of bytes to write, at most \ref GetFileBufferSize.
+    \param tag User-defined value returned in the result, for identifying it.
+    \param offset Offset within the file at which to start writing.
+    \return False if the request couldn't be queued, in which case no result is sent and the caller still owns the buffer.
+    */
+    bool WriteFile(
+        const Address &client,
+        const char *const fileName,
+        void *const buffer,
+        const uint32_t size,
+        const uint32_t tag = 0,
+        const uint64_t offset = 0);
+
+    /**
+    \brief Allocates a pooled file buffer of \ref GetFileBufferSize bytes, for use with \ref WriteFile.
+    */
+    void *AllocateFileBuffer();
+
+    /**
+    \brief Returns a pooled file buffer, such as one received in a \ref FileResult, to the pool.
+    \note All file buffers must be freed before the framework is destroyed.
+    */
+    void FreeFileBuffer(void *const buffer);
+
+    /**
+    \brief Returns the size in bytes of the pooled file buffers, as set by \ref Parameters::mFileBufferSize.
+    */
+    inline uint32_t GetFileBufferSize() const;
+
+    /**
+    \brief Watches a file descriptor, sending a \ref DescriptorReady message to the given address when it becomes ready.
+
+    The descriptor, typically a non-blocking socket or pipe, is watched by the reactor of
+    the framework, which waits for readiness of all watched descriptors on a single thread
+    without blocking any worker threads. When the descriptor becomes ready for any of the
+    given events, a DescriptorReady message is sent to the client address, which is
+    typically the address of the calling actor.
+
+    Watches are one-shot: after a message has been sent the descriptor isn't watched again
+    until WatchDescriptor is called again, typically at the end of the handler for the
+    message once the descriptor has been read or written. Calling WatchDescriptor for a
+    descriptor that's already watched replaces the earlier watch.
+
+    \param client Address to which the readiness message is sent.
+    \param descriptor The file descriptor to watch.
+    \param events Combination of \ref DescriptorReady::Event flags to watch for.
+    \param tag User-defined value returned in the message, for identifying it.
+    \return False if the descriptor couldn't be watched, in which case no message is sent.
+
+    \note Watching descriptors requires \ref THERON_EPOLL. Where it's disabled, this method always fails.
+    \note Descriptors should be unwatched with \ref UnwatchDescriptor before they're closed.
+    */
+    bool WatchDescriptor(
+        const Address &client,
+        const int descriptor,
+        const uint32_t events,
+        const uint32_t tag = 0);
+
+    /**
+    \brief Stops watching a file descriptor watched with \ref WatchDescriptor.
+    A readiness message for the descriptor that has already been sent may still be received.
+    \return False if the descriptor wasn't watched.
+    */
+    bool UnwatchDescriptor(const int descriptor);
+
     /**
     \brief Sets the fallback message handler executed for unhandled messages.
 
@@ -696,21 +1038,51 @@ public:
         ObjectType *const actor,
         void (ObjectType::*handler)(const void *const data, const uint32_t size, const Address from));
 
-private:
+    /**
+    \brief Sets the handler executed for expired messages.
 
-    struct MessageCacheTraits
-    {
-        typedef Detail::SpinLock LockType;
+    Messages sent with a time-to-live (see \ref Actor::Send) expire if their deadlines pass
+    while they're waiting in the mailbox of an actor in this framework. Expired messages are
+    dropped without executing the actor's message handlers. Instead they're counted (see
+    \ref GetNumExpiredMessages) and passed to the expiry handler, if one is set, which is
+    passed the address from which the message was sent. By default no expiry handler is set,
+    and expired messages are simply dropped.
 
-        struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) AlignType
-        {
-        } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
+    The expiry handler is executed by the worker thread that drops the message, so it should be
+    quick, and mustn't assume it's executed by any particular thread. Passing 0 to this method
+    clears any previously set expiry handler.
 
-        static const uint32_t MAX_POOLS = 8;
-        static const uint32_t MAX_BLOCKS = 16;
-    };
+    \note There are two variants of SetExpiryHandler, accepting handlers with different
+    function signatures, like those of \ref SetFallbackHandler. Handlers set using this method
+    accept only a 'from' address. Registering either kind of expiry handler replaces any
+    previously set handler of the other kind.
 
-    typedef Detail::CachingAllocator<MessageCacheTraits> MessageCache;
+    \tparam ObjectType The type of the handler object which owns the handler function.
+    \param actor Pointer to the handler object on which the handler function is a member function.
+    \param handler Member function pointer identifying the expiry handler function.
+    */
+    template <typename ObjectType>
+    inline bool SetExpiryHandler(
+        ObjectType *const actor,
+        void (ObjectType::*handler)(const Address from));
+
+    /**
+    \brief Sets the handler executed for expired messages, which is passed them as blind data.
+
+    This method is like the other \ref SetExpiryHandler overload, but the handler is passed
+    the expired message as 'blind' data, consisting of a void pointer and a size in bytes, as
+    well as the address from which it was sent.
+
+    \tparam ObjectType The type of the handler object which owns the handler function.
+    \param actor Pointer to the handler object on which the handler function is a member function.
+    \param handler Member function pointer identifying the expiry handler function.
+    */
+    template <typename ObjectType>
+    inline bool SetExpiryHandler(
+        ObjectType *const actor,
+        void (ObjectType::*handler)(const void *const data, const uint32_t size, const Address from));
+
+private:
 
     Framework(const Framework &other);
     Framework &operator=(const Framework &other);
@@ -729,7 +1101,13 @@ private:
     /**
     Allocates and initializes an owned scheduler object.
     */
-    Detail::IScheduler *CreateScheduler();
+    Detail::IScheduler *CreateScheduler(
+        const YieldStrategy yieldStrategy,
+        Detail::MailboxContext *const sharedMailboxContext,
+        Detail::MailboxContext *const handoffMailboxContext,
+        const bool blockingPool,
+        const uint32_t maxCompensationThreads,
+        const bool colocateActors);
 
     /**
     Destroys a previously created scheduler object.
@@ -746,6 +1124,47 @@ private:
     */
     void DeregisterActor(Actor *const actor);
 
+    /**
+    Marks or unmarks a registered actor as one whose handlers may block.
+    */
+    void SetActorBlocking(Actor *const actor, const bool blocking);
+
+    /**
+    Adds a conflater to a registered actor, so that messages it accepts replace pending messages.
+    */
+    void AddActorConflater(Actor *const actor, Detail::IConflater *const conflater);
+
+    /**
+    Returns the file I/O service, creating it on first use.
+    */
+    Detail::FileService *GetFileService();
+
+    /**
+    Returns the descriptor reactor, creating it on first use.
+    */
+    Detail::Reactor *GetReactor();
+
+    /**
+    Sends a batch of messages from outside the worker threads, scheduling the receiving mailboxes together.
+    */
+    template <typename ValueType>
+    inline void SendBatch(
+        const ValueType *const values,
+        const Address *const addresses,
+        const uint32_t count);
+
+    /**
+    Helper method that replaces the value of a pending message conflated by an actor in this
+    framework with the given value, in place, so that no message needs to be allocated.
+    \return True if a pending message was replaced, otherwise false and the value should be sent as usual.
+    */
+    template <typename ValueType>
+    inline bool ConflateWithinFramework(
+        const ValueType &value,
+        const Address &from,
+        const Address &address,
+        const uint32_t timeToLive);
+
     /**
     Helper method that sends messages.
     */
@@ -754,6 +1173,15 @@ private:
         Detail::IMessage *const message,
         Address address);
 
+    /**
+    Helper method that sends messages to actors in this framework.
+    \return False if the message was refused by the message budget, in which case it's left to the caller.
+    */
+    inline bool DeliverWithinFramework(
+        Detail::MailboxContext *const mailboxContext,
+        Detail::IMessage *const message,
+        const Detail::Index &index);
+
     /**
     Helper method that sends messages to entities in the local process.
     */
@@ -778,12 +1206,22 @@ private:
     const Parameters mParams;                               ///< Copy of parameters struct provided on construction.
     uint32_t mIndex;                                        ///< Non-zero index of this framework, unique within the local process.
     Detail::String mName;                                   ///< Name of this framework.
-    Detail::Directory<Detail::Mailbox> mMailboxes;          ///< Per-framework mailbox array.
+    Detail::Directory<Detail::Mailbox, Detail::Mailbox::Cold> mMailboxes;          ///< Per-framework mailbox array.
     Detail::FallbackHandlerCollection mFallbackHandlers;    ///< Registered message handlers run for unhandled messages.
     Detail::DefaultFallbackHandler mDefaultFallbackHandler; ///< Default handler for unhandled messages.
-    MessageCache mMessageAllocator;                         ///< Thread-safe per-framework cache of message memory blocks.
+    IAllocator *const mMessageAllocator;                    ///< Thread-safe cache of message memory blocks, shared by all frameworks.
+    Detail::MessageBudget mMessageBudget;                   ///< Accounts for the memory of messages waiting in the framework.
+    Detail::MessageExpiry mMessageExpiry;                   ///< Drops and counts messages whose deadlines have passed.
+    Detail::CpuShare mCpuShare;                             ///< Weighted share of processors shared with other frameworks.
     Detail::MailboxContext mSharedMailboxContext;           ///< Shared per-framework mailbox context.
     Detail::IScheduler *mScheduler;                         ///< Pointer to owned scheduler implementation.
+    Detail::MailboxContext mBlockingMailboxContext;         ///< Shared mailbox context of the blocking scheduler.
+    Detail::IScheduler *mBlockingScheduler;                 ///< Pointer to owned scheduler for blocking actors, created on demand.
+    Detail::Mutex mBlockingSchedulerLock;                   ///< Protects creation of the blocking scheduler.
+    Detail::FileService *mFileService;                      ///< Pointer to owned file I/O service, created on demand.
+    Detail::Mutex mFileServiceLock;                         ///< Protects creation of the file I/O service.
+    Detail::Reactor *mReactor;                              ///< Pointer to owned descriptor reactor, created on demand.
+    Detail::Mutex mReactorLock;                             ///< Protects creation of the descriptor reactor.
 };
 
 
@@ -797,8 +1235,18 @@ inline Framework::Framework(const uint32_t threadCount) :
   mFallbackHandlers(),
   mDefaultFallbackHandler(),
   mMessageAllocator(AllocatorManager::GetCache()),
+  mMessageBudget(mParams.mMessageBudget, mParams.mMessageBudgetPolicy, mParams.mMessageBudgetCallback, mParams.mMessageBudgetContext),
+  mMessageExpiry(),
+  mCpuShare(mParams.mThreadCount ? mParams.mCpuShares : 0, mParams.mNodeMask, mParams.mProcessorMask),
   mSharedMailboxContext(),
-  mScheduler(0)
+  mScheduler(0),
+  mBlockingMailboxContext(),
+  mBlockingScheduler(0),
+  mBlockingSchedulerLock(),
+  mFileService(0),
+  mFileServiceLock(),
+  mReactor(0),
+  mReactorLock()
 {
     Detail::BuildDescriptor::Check();
 
@@ -816,8 +1264,18 @@ inline Framework::Framework(const Parameters &params) :
   mFallbackHandlers(),
   mDefaultFallbackHandler(),
   mMessageAllocator(AllocatorManager::GetCache()),
+  mMessageBudget(mParams.mMessageBudget, mParams.mMessageBudgetPolicy, mParams.mMessageBudgetCallback, mParams.mMessageBudgetContext),
+  mMessageExpiry(),
+  mCpuShare(mParams.mThreadCount ? mParams.mCpuShares : 0, mParams.mNodeMask, mParams.mProcessorMask),
   mSharedMailboxContext(),
-  mScheduler(0)
+  mScheduler(0),
+  mBlockingMailboxContext(),
+  mBlockingScheduler(0),
+  mBlockingSchedulerLock(),
+  mFileService(0),
+  mFileServiceLock(),
+  mReactor(0),
+  mReactorLock()
 {
     Detail::BuildDescriptor::Check();
 
@@ -835,8 +1293,18 @@ inline Framework::Framework(EndPoint &endPoint, const char *const name, const Pa
   mFallbackHandlers(),
   mDefaultFallbackHandler(),
   mMessageAllocator(AllocatorManager::GetCache()),
+  mMessageBudget(mParams.mMessageBudget, mParams.mMessageBudgetPolicy, mParams.mMessageBudgetCallback, mParams.mMessageBudgetContext),
+  mMessageExpiry(),
+  mCpuShare(mParams.mThreadCount ? mParams.mCpuShares : 0, mParams.mNodeMask, mParams.mProcessorMask),
   mSharedMailboxContext(),
-  mScheduler(0)
+  mScheduler(0),
+  mBlockingMailboxContext(),
+  mBlockingScheduler(0),
+  mBlockingSchedulerLock(),
+  mFileService(0),
+  mFileServiceLock(),
+  mReactor(0),
+  mReactorLock()
 {
     Detail::BuildDescriptor::Check();
 
@@ -853,8 +1321,25 @@ inline Framework::~Framework()
 template <typename ValueType>
 THERON_FORCEINLINE bool Framework::Send(const ValueType &value, const Address &from, const Address &address)
 {
-    // We use a thread-safe per-framework message cache to allocate messages sent from non-actor code.
-    IAllocator *const messageAllocator(&mMessageAllocator);
+    return Send(value, from, address, 0);
+}
+
+
+template <typename ValueType>
+THERON_FORCEINLINE bool Framework::Send(
+    const ValueType &value,
+    const Address &from,
+    const Address &address,
+    const uint32_t timeToLive)
+{
+    // A value superseding a pending message of an actor that conflates it just overwrites it.
+    if (ConflateWithinFramework(value, from, address, timeToLive))
+    {
+        return true;
+    }
+
+    // We use the thread-safe global message cache to allocate messages sent from non-actor code.
+    IAllocator *const messageAllocator(mMessageAllocator);
 
     // Allocate a message. It'll be deleted by the worker thread that handles it.
     Detail::IMessage *const message(Detail::MessageCreator::Create(messageAllocator, value, from));
@@ -863,6 +1348,21 @@ THERON_FORCEINLINE bool Framework::Send(const ValueType &value, const Address &f
         return false;
     }
 
+    if (timeToLive)
+    {
+        message->SetDeadline(Detail::MessageExpiry::GetDeadline(timeToLive));
+    }
+
+    // Non-actor code sending to the framework's own actors waits for room in a blocking budget.
+    // Frameworks without worker threads would never make room, so they don't wait.
+    if (mParams.mMessageBudgetPolicy == MESSAGE_BUDGET_BLOCK &&
+        mParams.mThreadCount != 0 &&
+        mSharedMailboxContext.mMessageBudget &&
+        address.mIndex.mComponents.mFramework == mIndex)
+    {
+        mMessageBudget.WaitForRoom(message->GetBlockSize());
+    }
+
     // Call the message sending implementation using the processor context of the framework.
     // When messages are sent using Framework::Send there's no obvious worker thread.
     return SendInternal(
@@ -908,6 +1408,43 @@ THERON_FORCEINLINE uint32_t Framework::GetPeakThreads() const
 }
 
 
+THERON_FORCEINLINE uint32_t Framework::GetMessageMemory() const
+{
+    return mMessageBudget.GetUsage();
+}
+
+
+THERON_FORCEINLINE uint32_t Framework::GetPeakMessageMemory() const
+{
+    return mMessageBudget.GetPeakUsage();
+}
+
+
+THERON_FORCEINLINE uint32_t Framework::GetNumExpiredMessages() const
+{
+    return mMessageExpiry.GetCount();
+}
+
+
+THERON_FORCEINLINE uint32_t Framework::RunOnce(const uint32_t maxMessages)
+{
+    return mScheduler->Process(maxMessages);
+}
+
+
+THERON_FORCEINLINE uint32_t Framework::RunUntilIdle()
+{
+    // Processing only stops early when the queue is empty.
+    return mScheduler->Process(0xFFFFFFFF);
+}
+
+
+THERON_FORCEINLINE uint32_t Framework::GetFileBufferSize() const
+{
+    return mParams.mFileBufferSize;
+}
+
+
 THERON_FORCEINLINE uint32_t Framework::GetNumCounters() const
 {
 #if THERON_ENABLE_COUNTERS
@@ -934,6 +1471,10 @@ THERON_FORCEINLINE const char *Framework::GetCounterName(const uint32_t counter)
             case Detail::COUNTER_QUEUE_LATENCY_LOCAL_MAX:   return "maximum observed latency of thread-local queue";
             case Detail::COUNTER_QUEUE_LATENCY_SHARED_MIN:  return "minimum observed latency of per-framework queue";
             case Detail::COUNTER_QUEUE_LATENCY_SHARED_MAX:  return "maximum observed latency of per-framework queue";
+            case Detail::COUNTER_HANDLER_CYCLES:            return "cpu cycles spent in message handlers";
+            case Detail::COUNTER_HANDLER_INSTRUCTIONS:      return "instructions retired in message handlers";
+            case Detail::COUNTER_HANDLER_CACHE_MISSES:      return "last-level cache misses in message handlers";
+            case Detail::COUNTER_HANDLER_BRANCH_MISSES:     return "branch mispredictions in message handlers";
             default: return "unknown";
         }
 #endif
@@ -980,6 +1521,72 @@ THERON_FORCEINLINE uint32_t Framework::GetPerThreadCounterValues(
 }
 
 
+template <class ActorType>
+inline uint64_t Framework::GetActorCounterValue(const uint32_t counter)
+{
+    if (counter >= Detail::COUNTER_HANDLER_CYCLES && counter < Detail::COUNTER_HANDLER_CYCLES + Detail::MAX_PERF_EVENTS)
+    {
+#if THERON_ENABLE_PERF_COUNTERS
+        return Detail::ActorPerfCounters<ActorType>::smTotals.Get(counter - Detail::COUNTER_HANDLER_CYCLES);
+#endif
+    }
+
+    return 0;
+}
+
+
+template <class ActorType>
+inline void Framework::ResetActorCounters()
+{
+    Detail::ActorPerfCounters<ActorType>::smTotals.Reset();
+}
+
+
+template <typename ValueType>
+THERON_FORCEINLINE bool Framework::ConflateWithinFramework(
+    const ValueType &value,
+    const Address &from,
+    const Address &address,
+    const uint32_t timeToLive)
+{
+    typedef Detail::Message<ValueType> MessageType;
+
+    // Messages addressed by name or to other frameworks take the usual path.
+    if (address.mIndex.mUInt32 == 0 || address.mIndex.mComponents.mFramework != mIndex)
+    {
+        return false;
+    }
+
+    Detail::Mailbox &mailbox(mMailboxes.GetEntry(address.mIndex.mComponents.mIndex));
+
+    // The flag is checked without the lock first, so that sends to actors that don't conflate
+    // messages don't lock the mailbox twice. If it's stale the message takes the usual path,
+    // which conflates it anyway.
+    if (!mailbox.IsConflating())
+    {
+        return false;
+    }
+
+    const uint32_t deadline(timeToLive ? Detail::MessageExpiry::GetDeadline(timeToLive) : 0);
+    const Detail::MessageDescriptor *const descriptor(&Detail::MessageTypeDescriptor<ValueType>::smDescriptor);
+
+    // The pending message isn't being processed, so can be overwritten while the mailbox is locked.
+    // It keeps its place in the queue, and its charge to the message budget, which is unchanged.
+    mailbox.Lock();
+
+    Detail::IMessage *const pending(mailbox.FindConflated(descriptor, &value));
+    if (pending)
+    {
+        static_cast<MessageType *>(pending)->Replace(value, from);
+        pending->SetDeadline(deadline);
+    }
+
+    mailbox.Unlock();
+
+    return (pending != 0);
+}
+
+
 THERON_FORCEINLINE bool Framework::SendInternal(
     Detail::MailboxContext *const mailboxContext,
     Detail::IMessage *const message,
@@ -1010,40 +1617,138 @@ THERON_FORCEINLINE bool Framework::SendInternal(
     if (address.mIndex.mComponents.mFramework == mIndex)
     {
         // Message is addressed to an actor in the sending framework.
-        // Get a reference to the destination mailbox.
+        if (DeliverWithinFramework(mailboxContext, message, address.mIndex))
+        {
+            return true;
+        }
+    }
+    else if (DeliverWithinLocalProcess(message, address.mIndex))
+    {
+        // Message is addressed to a mailbox in the local process but not in the
+        // sending Framework. In this less common case we pay the hit of an extra call.
+        return true;
+    }
+
+    // Destroy the undelivered message, which may have been refused by the message budget.
+    mFallbackHandlers.Handle(message);
+    Detail::MessageCreator::Destroy(mMessageAllocator, message);
+
+    return false;
+}
+
+
+template <typename ValueType>
+inline void Framework::SendBatch(
+    const ValueType *const values,
+    const Address *const addresses,
+    const uint32_t count)
+{
+    static const uint32_t MAX_SCHEDULED = 64;
+
+    Detail::Mailbox *scheduled[MAX_SCHEDULED];
+    uint32_t scheduledCount(0);
+
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        Detail::IMessage *const message(Detail::MessageCreator::Create(mMessageAllocator, values[index], Address::Null()));
+        if (message == 0)
+        {
+            continue;
+        }
+
+        const Address &address(addresses[index]);
+
+        // Messages addressed to other frameworks or by name take the usual path.
+        if (address.mIndex.mUInt32 == 0 || address.mIndex.mComponents.mFramework != mIndex)
+        {
+            SendInternal(&mSharedMailboxContext, message, address);
+            continue;
+        }
+
         Detail::Mailbox &mailbox(mMailboxes.GetEntry(address.mIndex.mComponents.mIndex));
 
-        // Push the message into the mailbox and schedule the mailbox for processing
-        // if it was previously empty, so won't already be scheduled.
-        // The message will be destroyed by the worker thread that does the processing,
-        // even if it turns out that no actor is registered with the mailbox.
+        // Messages from the framework's own services are charged to its budget but never refused.
+        if (Detail::MessageBudget *const messageBudget = mSharedMailboxContext.mMessageBudget)
+        {
+            messageBudget->Add(0, message->GetBlockSize());
+        }
+
+        // A mailbox that was empty isn't scheduled or being processed, and while it's non-empty
+        // no other sender will schedule it. So it's safe to defer scheduling it until later.
         mailbox.Lock();
 
         const bool schedule(mailbox.Empty());
         mailbox.Push(message);
 
+        mailbox.Unlock();
+
         if (schedule)
         {
-            mScheduler->Schedule(mailboxContext, &mailbox);
+            scheduled[scheduledCount++] = &mailbox;
+            if (scheduledCount == MAX_SCHEDULED)
+            {
+                mScheduler->ScheduleBatch(&mSharedMailboxContext, scheduled, scheduledCount);
+                scheduledCount = 0;
+            }
         }
+    }
 
-        mailbox.Unlock();
+    mScheduler->ScheduleBatch(&mSharedMailboxContext, scheduled, scheduledCount);
+}
 
-        return true;
+
+THERON_FORCEINLINE bool Framework::DeliverWithinFramework(
+    Detail::MailboxContext *const mailboxContext,
+    Detail::IMessage *const message,
+    const Detail::Index &index)
+{
+    // Charge the message to the framework's budget, if any, unless the budget refuses it.
+    if (Detail::MessageBudget *const messageBudget = mailboxContext->mMessageBudget)
+    {
+        if (!messageBudget->Charge(mailboxContext->mMessageAccount, message->GetBlockSize()))
+        {
+            return false;
+        }
     }
 
-    // Message is addressed to a mailbox in the local process but not in the
-    // sending Framework. In this less common case we pay the hit of an extra call.
-    if (DeliverWithinLocalProcess(message, address.mIndex))
+    // Get a reference to the destination mailbox.
+    Detail::Mailbox &mailbox(mMailboxes.GetEntry(index.mComponents.mIndex));
+
+    // Push the message into the mailbox and schedule the mailbox for processing
+    // if it was previously empty, so won't already be scheduled.
+    // The message will be destroyed by the worker thread that does the processing,
+    // even if it turns out that no actor is registered with the mailbox.
+    mailbox.Lock();
+
+    // Messages conflated by the actor replace any pending message they supersede, in its place.
+    // The mailbox holds a pending message so is already scheduled.
+    if (mailbox.IsConflating())
     {
-        return true;
+        if (Detail::IMessage *const replaced = mailbox.Conflate(message))
+        {
+            mailbox.Unlock();
+
+            if (Detail::MessageBudget *const messageBudget = mailboxContext->mMessageBudget)
+            {
+                messageBudget->Credit(mailboxContext->mMessageAccount, replaced->GetBlockSize());
+            }
+
+            Detail::MessageCreator::Destroy(mailboxContext->mMessageAllocator, replaced, mailboxContext->mMessageSlots);
+            return true;
+        }
     }
 
-    // Destroy the undelivered message.
-    mFallbackHandlers.Handle(message);
-    Detail::MessageCreator::Destroy(&mMessageAllocator, message);
+    const bool schedule(mailbox.Empty());
+    mailbox.Push(message);
 
-    return false;
+    if (schedule)
+    {
+        mScheduler->Schedule(mailboxContext, &mailbox);
+    }
+
+    mailbox.Unlock();
+
+    return true;
 }
 
 
@@ -1051,12 +1756,12 @@ THERON_FORCEINLINE bool Framework::FrameworkReceive(
     Detail::IMessage *const message,
     const Address &address)
 {
-    // Call the generic message sending function.
     // We use our own local context here because we're receiving the message.
-    return SendInternal(
+    // If the message is refused then it's left to the sender to treat as undelivered.
+    return DeliverWithinFramework(
         &mSharedMailboxContext,
         message,
-        address);
+        address.mIndex);
 }
 
 
@@ -1084,6 +1789,24 @@ inline bool Framework::SetFallbackHandler(
 }
 
 
+template <typename ObjectType>
+inline bool Framework::SetExpiryHandler(
+    ObjectType *const handlerObject,
+    void (ObjectType::*handler)(const Address from))
+{
+    return mMessageExpiry.SetHandler(handlerObject, handler);
+}
+
+
+template <typename ObjectType>
+inline bool Framework::SetExpiryHandler(
+    ObjectType *const handlerObject,
+    void (ObjectType::*handler)(const void *const data, const uint32_t size, const Address from))
+{
+    return mMessageExpiry.SetHandler(handlerObject, handler);
+}
+
+
 } // namespace Theron
 
 
@@ -0,0 +1,196 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_HUGEPAGEALLOCATOR_H
+#define THERON_HUGEPAGEALLOCATOR_H
+
+
+/**
+\file HugePageAllocator.h
+An optional allocator that serves allocations from large regions backed by huge pages.
+*/
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/Threading/SpinLock.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief A general purpose allocator that allocates from large regions backed by huge pages.
+
+Applications with very many actors, or very high message rates, touch a lot of memory
+scattered over many pages, and can spend a significant share of their time in misses
+of the processor's TLB, the cache of address translations. HugePageAllocator serves all
+allocations from a few large regions mapped directly from the operating system, where
+possible using huge pages (typically 2MB rather than 4KB), so that far fewer translations
+cover the same memory.
+
+On Linux, each region is mapped with explicit huge pages (MAP_HUGETLB) if the system has
+reserved any, and otherwise is aligned to a huge page boundary and marked for transparent
+huge pages (MADV_HUGEPAGE). On Windows, large pages are used if the process holds the
+privilege to lock pages in memory. In all other cases, and if huge pages turn out to be
+unavailable, regions fall back to normal pages, so the allocator always works.
+
+Within the regions, small blocks of the same size class are carved from shared 64KB spans
+and recycled via per-class free lists, so blocks of the same size, such as mailbox directory
+pages or messages of the same type, are packed densely together. Larger blocks take whole
+runs of spans. Memory is only returned to the operating system when the allocator is destroyed.
+
+To use it, set it as the allocator used by Theron at application start, before any Theron
+objects are constructed, so that directory pages, mailboxes and message memory, as well as
+all other internal allocations, come from the huge page regions:
+
+\code
+int main()
+{
+    Theron::HugePageAllocator allocator;
+    Theron::AllocatorManager::SetAllocator(&allocator);
+
+    {
+        Theron::Framework framework;
+        // ...
+    }
+
+    // Restore the default allocator before the huge page allocator is destroyed.
+    Theron::AllocatorManager::SetAllocator(0);
+    return 0;
+}
+\endcode
+
+\note The allocator is thread-safe; its state is protected by a spin-lock, which is held
+only briefly. Most allocations by Theron are absorbed by its internal caches anyway.
+
+\see AllocatorManager::SetAllocator
+*/
+class HugePageAllocator : public IAllocator
+{
+public:
+
+    /**
+    \brief Default size of each region reserved from the operating system, in bytes.
+    */
+    static const uint32_t DEFAULT_REGION_SIZE = 64 * 1024 * 1024;
+
+    /**
+    \brief Constructor.
+
+    No memory is reserved until the first allocation.
+
+    \param regionSize Size of each region reserved from the operating system, in bytes.
+    Rounded up to a multiple of the 2MB huge page size. Larger allocations get regions of their own.
+    */
+    explicit HugePageAllocator(const uint32_t regionSize = DEFAULT_REGION_SIZE);
+
+    /**
+    \brief Destructor. Returns all the regions to the operating system.
+
+    \note Any memory still allocated becomes invalid, so the allocator must outlive all
+    Theron objects, and mustn't be destroyed while it's still set as the allocator used by Theron.
+    */
+    virtual ~HugePageAllocator();
+
+    /**
+    \brief Allocates a block of contiguous memory, aligned to at least 16 bytes.
+    */
+    virtual void *Allocate(const SizeType size);
+
+    /**
+    \brief Allocates a block of contiguous memory aligned to a given power-of-two boundary of up to 64KB.
+    */
+    virtual void *AllocateAligned(const SizeType size, const SizeType alignment);
+
+    /**
+    \brief Frees a previously allocated block of contiguous memory.
+    */
+    virtual void Free(void *const memory);
+
+    /**
+    \brief Frees a previously allocated block of contiguous memory of the given size.
+    */
+    virtual void Free(void *const memory, const SizeType size);
+
+    /**
+    \brief Gets the number of bytes in blocks currently allocated, including rounding up to size classes.
+    */
+    uint64_t GetBytesAllocated() const;
+
+    /**
+    \brief Gets the total size of the regions reserved from the operating system, in bytes.
+    */
+    uint64_t GetBytesReserved() const;
+
+    /**
+    \brief Gets the total size of the reserved regions that are backed by huge pages, in bytes.
+
+    Regions marked for transparent huge pages are counted, although the operating system
+    may back parts of them with normal pages, for example when memory is fragmented.
+    */
+    uint64_t GetHugePageBytes() const;
+
+private:
+
+    static const uint32_t MAX_REGIONS = 256;        ///< Maximum number of regions.
+    static const uint32_t NUM_CLASSES = 12;         ///< Number of size classes of small blocks, from 16 bytes to 32KB.
+
+    /**
+    A region of memory reserved from the operating system.
+    The first span of each region holds a table recording the use of each span.
+    */
+    struct Region
+    {
+        char *mBase;                                ///< Start of the region.
+        uint32_t mSize;                             ///< Size of the region in bytes.
+        uint32_t mNumSpans;                         ///< Number of spans in the region.
+        bool mHugePages;                            ///< Indicates whether the region is backed by huge pages.
+    };
+
+    /**
+    A free run of whole spans, stored in the first span of the run.
+    */
+    struct FreeRun
+    {
+        FreeRun *mNext;                             ///< Next free run, if any.
+        uint32_t mNumSpans;                         ///< Number of spans in the run.
+    };
+
+    /**
+    A free small block, stored in the block.
+    */
+    struct FreeBlock
+    {
+        FreeBlock *mNext;                           ///< Next free block of the same size class, if any.
+    };
+
+    HugePageAllocator(const HugePageAllocator &other);
+    HugePageAllocator &operator=(const HugePageAllocator &other);
+
+    void *AllocateSmall(const uint32_t sizeClass);
+    char *AllocateSpans(const uint32_t numSpans, const uint16_t use);
+    bool ReserveRegion(const uint32_t numSpans);
+    Region *FindRegion(const void *const memory);
+
+    uint32_t mRegionSize;                           ///< Default size of reserved regions in bytes.
+    Detail::SpinLock mSpinLock;                     ///< Protects the allocator's state.
+    Region mRegions[MAX_REGIONS];                   ///< Reserved regions.
+    uint32_t mNumRegions;                           ///< Number of reserved regions.
+    uint32_t mNextSpan;                             ///< Index of the first unused span in the newest region.
+    FreeRun *mFreeRuns;                             ///< Freed runs of spans, and leftover spans of old regions.
+    FreeBlock *mFreeBlocks[NUM_CLASSES];            ///< Freed small blocks of each size class.
+    char *mCarveNext[NUM_CLASSES];                  ///< Next uncarved block in the current span of each size class.
+    char *mCarveEnd[NUM_CLASSES];                   ///< End of the current span of each size class.
+    uint64_t mBytesAllocated;                       ///< Bytes currently allocated.
+    uint64_t mBytesReserved;                        ///< Bytes reserved from the operating system.
+    uint64_t mHugePageBytes;                        ///< Bytes reserved with huge pages.
+};
+
+
+} // namespace Theron
+
+
+#endif // THERON_HUGEPAGEALLOCATOR_H
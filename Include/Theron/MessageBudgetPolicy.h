@@ -0,0 +1,75 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_MESSAGEBUDGETPOLICY_H
+#define THERON_MESSAGEBUDGETPOLICY_H
+
+
+/**
+\file MessageBudgetPolicy.h
+Defines the MessageBudgetPolicy enumerated type and the MessageBudgetCallback function type.
+*/
+
+
+#include <Theron/BasicTypes.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief Enumerates the things a framework can do when its message memory budget is exceeded.
+
+A framework can be given a budget limiting the memory of the messages waiting in its mailboxes,
+via the \ref Theron::Framework::Parameters::mMessageBudget "mMessageBudget" member of its
+\ref Theron::Framework::Parameters "Parameters". This keeps a framework whose actors are flooded
+with messages from exhausting the memory shared with other frameworks in the same process.
+This enum defines the available values of the
+\ref Theron::Framework::Parameters::mMessageBudgetPolicy "mMessageBudgetPolicy" member,
+which decides what happens to a message that would take the framework over its budget.
+
+With \ref MESSAGE_BUDGET_FAIL, the message is refused, and treated like an undelivered message:
+it's passed to the fallback handler of the sending framework (see \ref Framework::SetFallbackHandler)
+and destroyed, and the Send call that sent it returns false. This applies to messages sent by actors,
+by non-actor code via \ref Framework::Send, and by actors in other frameworks.
+
+With \ref MESSAGE_BUDGET_BLOCK, calls to \ref Framework::Send addressed to actors in the framework
+wait until the framework has room for the message, throttling non-actor code that sends messages
+faster than the actors can process them. Messages sent by actors are accepted even when they
+exceed the budget, because blocking the worker threads that execute the actors could stop them
+from ever processing the messages that would make room. For the same reason Framework::Send
+doesn't wait in frameworks without worker threads, and mustn't be called from within message
+handlers when this policy is used.
+
+With \ref MESSAGE_BUDGET_CALLBACK, the \ref Theron::Framework::Parameters::mMessageBudgetCallback
+"mMessageBudgetCallback" function is called for each message that would exceed the budget, and
+its return value decides whether the message is accepted anyway or refused.
+
+\note The budget is a soft limit. Worker threads account for messages in batches, so the
+framework may go over its budget by a few kilobytes per worker thread before noticing.
+*/
+enum MessageBudgetPolicy
+{
+    MESSAGE_BUDGET_FAIL = 0,            ///< Messages that would exceed the budget are refused.
+    MESSAGE_BUDGET_BLOCK,               ///< Non-actor senders wait until there's room in the budget.
+    MESSAGE_BUDGET_CALLBACK             ///< A user-defined callback decides whether to accept messages that would exceed the budget.
+};
+
+
+/**
+\brief Function called with \ref MESSAGE_BUDGET_CALLBACK when a message would exceed the budget.
+
+The function is called on the thread sending the message, which may be a worker thread of any
+framework, so it should be thread-safe and quick. It mustn't send messages to the framework.
+
+\param context The user-defined context pointer supplied with the callback.
+\param usage The number of bytes of message memory in use by the framework, excluding the message.
+\param budget The framework's message memory budget in bytes.
+\return True to accept the message anyway, false to refuse it.
+*/
+typedef bool (*MessageBudgetCallback)(void *const context, const uint32_t usage, const uint32_t budget);
+
+
+} // namespace Theron
+
+
+#endif // THERON_MESSAGEBUDGETPOLICY_H
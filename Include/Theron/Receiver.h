@@ -374,7 +374,7 @@ private:
     Address mAddress;                                   ///< Unique address of this receiver.
     MessageHandlerList mMessageHandlers;                ///< List of registered message handlers.
     mutable Detail::Condition mCondition;               ///< Signals waiting threads when messages arrive.
-    mutable Detail::Atomic::UInt32 mMessagesReceived;   ///< Counts arrived messages not yet waited on.
+    mutable Detail::Atomic::UInt32 mMessagesReceived;   ///< Counts arrived messages not yet waited on. Guarded by the condition's mutex.
 };
 
 
@@ -474,14 +474,14 @@ inline bool Receiver::DeregisterHandler(
 THERON_FORCEINLINE void Receiver::Reset()
 {
     Detail::Lock lock(mCondition.GetMutex());
-    mMessagesReceived.Store(0);
+    mMessagesReceived.StoreRelaxed(0);
 }
 
 
 THERON_FORCEINLINE uint32_t Receiver::Count() const
 {
     Detail::Lock lock(mCondition.GetMutex());
-    return static_cast<uint32_t>(mMessagesReceived.Load());
+    return static_cast<uint32_t>(mMessagesReceived.LoadRelaxed());
 }
 
 
@@ -494,7 +494,7 @@ THERON_FORCEINLINE uint32_t Receiver::Wait(const uint32_t max)
     // Wait for at least one message to arrive.
     // If messages were received since the last wait (or creation),
     // then we regard those messages as qualifying and early-exit.
-    while (mMessagesReceived.Load() == 0)
+    while (mMessagesReceived.LoadRelaxed() == 0)
     {
         // Wait to be woken by an arriving message.
         // This blocks until a message arrives!
@@ -502,7 +502,7 @@ THERON_FORCEINLINE uint32_t Receiver::Wait(const uint32_t max)
     }
 
     uint32_t numConsumed(0);
-    while (mMessagesReceived.Load() > 0 && numConsumed < max)
+    while (mMessagesReceived.LoadRelaxed() > 0 && numConsumed < max)
     {
         mMessagesReceived.Decrement();
         ++numConsumed;
@@ -520,7 +520,7 @@ THERON_FORCEINLINE uint32_t Receiver::Consume(const uint32_t max)
     Detail::Lock lock(mCondition.GetMutex());
 
     uint32_t numConsumed(0);
-    while (mMessagesReceived.Load() > 0 && numConsumed < max)
+    while (mMessagesReceived.LoadRelaxed() > 0 && numConsumed < max)
     {
         mMessagesReceived.Decrement();
         ++numConsumed;
@@ -549,7 +549,10 @@ THERON_FORCEINLINE void Receiver::Push(Detail::IMessage *const message)
     mMessagesReceived.Increment();
 
     mCondition.GetMutex().Unlock();
-    mCondition.PulseAll();
+
+    // Each message can satisfy only one waiting thread, and a thread that consumes
+    // several messages leaves none for the others, so waking one thread is enough.
+    mCondition.Pulse();
 
     // Destroy the message.
     // We use the global allocator to allocate messages sent to receivers.
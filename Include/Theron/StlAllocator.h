@@ -0,0 +1,171 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_STLALLOCATOR_H
+#define THERON_STLALLOCATOR_H
+
+
+/**
+\file StlAllocator.h
+Adapter allowing standard containers to allocate via a Theron allocator.
+*/
+
+
+#include <stddef.h>
+#include <new>
+
+#include <Theron/Align.h>
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/IAllocator.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief Standard library allocator that allocates via an \ref IAllocator.
+
+StlAllocator adapts any implementation of the \ref IAllocator interface to the allocator
+interface expected by standard library containers, such as std::vector and std::map.
+A typical use is to give containers used inside message handlers the fast scratch memory
+returned by \ref Actor::GetScratchAllocator:
+
+\code
+typedef Theron::StlAllocator<char> ScratchAllocator;
+std::vector<char, ScratchAllocator> buffer((ScratchAllocator(GetScratchAllocator())));
+\endcode
+
+Copies of an StlAllocator, including copies rebound to other value types, share the same
+underlying allocator, and compare equal if and only if they do. A default-constructed
+StlAllocator uses the allocator returned by \ref AllocatorManager::GetCache.
+
+\tparam ValueType The type of the objects allocated.
+*/
+template <class ValueType>
+class StlAllocator
+{
+public:
+
+    typedef ValueType value_type;
+    typedef ValueType *pointer;
+    typedef const ValueType *const_pointer;
+    typedef ValueType &reference;
+    typedef const ValueType &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    /**
+    Rebinds the allocator type to another value type, as required by the standard containers.
+    */
+    template <class OtherType>
+    struct rebind
+    {
+        typedef StlAllocator<OtherType> other;
+    };
+
+    /**
+    Default constructor. Allocates via the general purpose cache allocator.
+    */
+    inline StlAllocator() : mAllocator(AllocatorManager::GetCache())
+    {
+    }
+
+    /**
+    Constructs an StlAllocator that allocates via the given allocator.
+    */
+    inline explicit StlAllocator(IAllocator *const allocator) : mAllocator(allocator)
+    {
+        THERON_ASSERT(mAllocator);
+    }
+
+    /**
+    Copy constructor, from an allocator for a possibly different value type.
+    */
+    template <class OtherType>
+    inline StlAllocator(const StlAllocator<OtherType> &other) : mAllocator(other.GetAllocator())
+    {
+    }
+
+    /**
+    Returns the allocator used for allocations.
+    */
+    inline IAllocator *GetAllocator() const
+    {
+        return mAllocator;
+    }
+
+    inline pointer address(reference value) const
+    {
+        return &value;
+    }
+
+    inline const_pointer address(const_reference value) const
+    {
+        return &value;
+    }
+
+    /**
+    Allocates uninitialized memory for the given number of objects.
+    */
+    inline pointer allocate(const size_type count, const void *const /*hint*/ = 0)
+    {
+        const uint32_t size(static_cast<uint32_t>(count * sizeof(ValueType)));
+        void *const memory(mAllocator->AllocateAligned(size, static_cast<uint32_t>(THERON_ALIGNOF(ValueType))));
+
+        if (memory == 0)
+        {
+            throw std::bad_alloc();
+        }
+
+        return reinterpret_cast<pointer>(memory);
+    }
+
+    /**
+    Frees memory previously allocated for the given number of objects.
+    */
+    inline void deallocate(const pointer memory, const size_type count)
+    {
+        mAllocator->Free(memory, static_cast<uint32_t>(count * sizeof(ValueType)));
+    }
+
+    inline size_type max_size() const
+    {
+        return static_cast<size_type>(0xFFFFFFFF) / sizeof(ValueType);
+    }
+
+    inline void construct(const pointer memory, const_reference value)
+    {
+        new (memory) ValueType(value);
+    }
+
+    inline void destroy(const pointer memory)
+    {
+        memory->~ValueType();
+    }
+
+private:
+
+    IAllocator *mAllocator;         ///< Pointer to the allocator used for allocations.
+};
+
+
+template <class ValueType, class OtherType>
+inline bool operator==(const StlAllocator<ValueType> &lhs, const StlAllocator<OtherType> &rhs)
+{
+    return (lhs.GetAllocator() == rhs.GetAllocator());
+}
+
+
+template <class ValueType, class OtherType>
+inline bool operator!=(const StlAllocator<ValueType> &lhs, const StlAllocator<OtherType> &rhs)
+{
+    return (lhs.GetAllocator() != rhs.GetAllocator());
+}
+
+
+} // namespace Theron
+
+
+#endif // THERON_STLALLOCATOR_H
@@ -0,0 +1,396 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+#ifndef THERON_STREAM_H
+#define THERON_STREAM_H
+
+
+/**
+\file Stream.h
+Streams of chunks of data between two actors, paced by credit returned by the consumer.
+*/
+
+
+#include <Theron/Actor.h>
+#include <Theron/Address.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/BufferPool.h>
+#include <Theron/Defines.h>
+#include <Theron/Framework.h>
+
+
+namespace Theron
+{
+
+
+/**
+\brief Message carrying one chunk of a stream from its producer to its consumer.
+
+Chunks are sent by a \ref StreamWriter and are handled by the consumer like any other message,
+typically passing them to a \ref StreamReader once consumed, which returns credit to the producer.
+
+\note If the message types of an application are registered (see \ref THERON_DECLARE_REGISTERED_MESSAGE)
+then StreamChunk and \ref StreamCredit must be registered too, like any other message types.
+*/
+struct StreamChunk
+{
+    /**
+    \brief Constructor.
+    */
+    inline StreamChunk(
+        const uint32_t stream = 0,
+        const uint32_t sequence = 0,
+        const SharedBuffer &buffer = SharedBuffer(),
+        const bool end = false) :
+      mStream(stream),
+      mSequence(sequence),
+      mBuffer(buffer),
+      mEnd(end)
+    {
+    }
+
+    uint32_t mStream;       ///< Identifier of the stream, chosen by the producer.
+    uint32_t mSequence;     ///< Index of the chunk within the stream, counting from zero.
+    SharedBuffer mBuffer;   ///< Buffer holding the data of the chunk, which is null in the end marker.
+    bool mEnd;              ///< Indicates that the chunk marks the end of the stream, and carries no data.
+};
+
+
+/**
+\brief Message returning credit for consumed chunks from the consumer of a stream to its producer.
+
+The producer passes it to its \ref StreamWriter, which allows it to write that many more chunks.
+*/
+struct StreamCredit
+{
+    /**
+    \brief Constructor.
+    */
+    inline StreamCredit(const uint32_t stream = 0, const uint32_t chunks = 0, const bool end = false) :
+      mStream(stream),
+      mChunks(chunks),
+      mEnd(end)
+    {
+    }
+
+    uint32_t mStream;       ///< Identifier of the stream.
+    uint32_t mChunks;       ///< Number of chunks consumed since the last credit.
+    bool mEnd;              ///< Indicates that the consumer has received the end of the stream.
+};
+
+
+/**
+\brief Producer end of a stream of chunks sent from one actor to another, with flow control.
+
+Sending a large amount of data between actors as one huge message needs memory for all of it
+at once, while sending it as many independent messages lets a fast producer run arbitrarily far
+ahead of a slow consumer. A stream instead sends the data as chunks held in buffers from a
+\ref BufferPool, and limits the number of chunks in flight to a fixed window. Each chunk
+written uses up one chunk of credit, and the consumer returns the credit in \ref StreamCredit
+messages as it consumes the chunks, notifying the producer that it can write more. So the
+memory used by the stream is bounded by the window, however much data is transferred.
+
+The producer owns a StreamWriter, and passes it the credit messages it receives:
+
+\code
+class Producer : public Theron::Actor
+{
+public:
+
+    Producer(Theron::Framework &framework, Theron::BufferPool &pool, const Theron::Address consumer) :
+      Theron::Actor(framework),
+      mWriter(*this, pool, consumer, 8)
+    {
+        RegisterHandler(this, &Producer::Handler);
+        WriteChunks();
+    }
+
+private:
+
+    void Handler(const Theron::StreamCredit &credit, const Theron::Address from)
+    {
+        mWriter.Credit(credit);
+        WriteChunks();
+    }
+
+    void WriteChunks()
+    {
+        while (mWriter.GetCredit() && MoreData())
+        {
+            Theron::SharedBuffer chunk(mWriter.Acquire(CHUNK_SIZE));
+            FillChunk(chunk.GetData(), chunk.GetSize());
+            mWriter.Write(chunk);
+        }
+
+        if (!MoreData())
+        {
+            mWriter.Close();
+        }
+    }
+
+    Theron::StreamWriter mWriter;
+};
+\endcode
+
+\note The writer sends the chunks via its producer actor, just as \ref Actor::Send does, so
+they're sent via the worker thread's own context when written from a message handler.
+\note The writer isn't thread-safe, so should only be used by its producer actor.
+\see StreamReader
+*/
+class StreamWriter
+{
+public:
+
+    /**
+    \brief Constructor.
+    \param producer The actor that writes the stream, to which the consumer returns credit.
+    \param bufferPool The pool from which the buffers of the chunks are acquired.
+    \param consumer The address of the actor that reads the stream.
+    \param window The maximum number of chunks in flight, which bounds the memory used by the stream.
+    \param stream Identifier of the stream, which distinguishes it from other streams to the same consumer.
+    */
+    inline StreamWriter(
+        Actor &producer,
+        BufferPool &bufferPool,
+        const Address &consumer,
+        const uint32_t window,
+        const uint32_t stream = 0) :
+      mProducer(producer),
+      mBufferPool(bufferPool),
+      mConsumer(consumer),
+      mStream(stream),
+      mCredit(window),
+      mSequence(0),
+      mClosed(false),
+      mFinished(false)
+    {
+        THERON_ASSERT(window > 0);
+    }
+
+    /**
+    \brief Gets the number of chunks that can be written before more credit is returned.
+    */
+    inline uint32_t GetCredit() const
+    {
+        return (mClosed ? 0 : mCredit);
+    }
+
+    /**
+    \brief Acquires a buffer for the next chunk from the pool, if there's credit to write it.
+    \return A handle to the buffer, which is null if there's no credit or memory ran out.
+    */
+    inline SharedBuffer Acquire(const uint32_t size)
+    {
+        if (GetCredit() == 0)
+        {
+            return SharedBuffer();
+        }
+
+        return mBufferPool.Acquire(size);
+    }
+
+    /**
+    \brief Writes a chunk to the stream, using up one chunk of credit.
+    \param chunk Buffer holding the data of the chunk, which is shared with the consumer rather than copied.
+    \return True if the chunk was sent, or false if there was no credit or the stream is closed.
+    */
+    inline bool Write(const SharedBuffer &chunk)
+    {
+        THERON_ASSERT(!chunk.IsNull());
+
+        if (GetCredit() == 0)
+        {
+            return false;
+        }
+
+        if (!mProducer.Send(StreamChunk(mStream, mSequence, chunk), mConsumer))
+        {
+            return false;
+        }
+
+        --mCredit;
+        ++mSequence;
+        return true;
+    }
+
+    /**
+    \brief Closes the stream, sending the end marker to the consumer.
+    The end marker carries no data, so needs no credit.
+    */
+    inline bool Close()
+    {
+        if (mClosed)
+        {
+            return false;
+        }
+
+        mClosed = true;
+        return mProducer.Send(StreamChunk(mStream, mSequence, SharedBuffer(), true), mConsumer);
+    }
+
+    /**
+    \brief Returns credit received from the consumer in a \ref StreamCredit message.
+    \return True if the credit is for this stream, otherwise false and the credit is ignored.
+    */
+    inline bool Credit(const StreamCredit &credit)
+    {
+        if (credit.mStream != mStream)
+        {
+            return false;
+        }
+
+        mCredit += credit.mChunks;
+        mFinished = mFinished || credit.mEnd;
+        return true;
+    }
+
+    /**
+    \brief Returns true once the consumer has received the end of the stream, after all its chunks.
+    */
+    inline bool IsFinished() const
+    {
+        return mFinished;
+    }
+
+    /**
+    \brief Gets the number of chunks written so far.
+    */
+    inline uint32_t GetChunksWritten() const
+    {
+        return mSequence;
+    }
+
+private:
+
+    StreamWriter(const StreamWriter &other);
+    StreamWriter &operator=(const StreamWriter &other);
+
+    const Actor &mProducer;         ///< Producer via which the chunks are sent, to which credit is returned.
+    BufferPool &mBufferPool;        ///< Pool from which chunk buffers are acquired.
+    const Address mConsumer;        ///< Address of the consumer.
+    const uint32_t mStream;         ///< Identifier of the stream.
+    uint32_t mCredit;               ///< Number of chunks that can be written before more credit is returned.
+    uint32_t mSequence;             ///< Sequence number of the next chunk.
+    bool mClosed;                   ///< Indicates whether the end marker has been sent.
+    bool mFinished;                 ///< Indicates whether the consumer has received the end marker.
+};
+
+
+/**
+\brief Consumer end of a stream of chunks written by a \ref StreamWriter.
+
+The consumer passes each chunk to its StreamReader once it has consumed it, which returns
+credit to the producer so it can write more. Credit can be returned for every chunk, or
+for batches of chunks, which sends fewer credit messages but lets fewer chunks be in flight.
+
+\code
+class Consumer : public Theron::Actor
+{
+public:
+
+    explicit Consumer(Theron::Framework &framework) : Theron::Actor(framework), mReader(*this)
+    {
+        RegisterHandler(this, &Consumer::Handler);
+    }
+
+private:
+
+    void Handler(const Theron::StreamChunk &chunk, const Theron::Address from)
+    {
+        if (!chunk.mEnd)
+        {
+            Consume(chunk.mBuffer.GetData(), chunk.mBuffer.GetSize());
+        }
+
+        mReader.Consumed(chunk, from);
+    }
+
+    Theron::StreamReader mReader;
+};
+\endcode
+
+\note The chunks are consumed in the order they were written, since messages sent
+from one actor to another arrive in the order they were sent.
+\note Like the writer, the reader sends credit via its consumer actor, just as \ref Actor::Send does.
+\note The buffer of a consumed chunk is only returned to the pool once the message carrying it
+has been handled, so at most one chunk more than the window is in memory at once.
+*/
+class StreamReader
+{
+public:
+
+    /**
+    \brief Constructor.
+    \param consumer The actor that reads the stream, from which credit is returned.
+    \param batch The number of chunks consumed before credit for them is returned.
+    This should be at most the window of the stream, so that the producer doesn't stall.
+    */
+    inline explicit StreamReader(Actor &consumer, const uint32_t batch = 1) :
+      mConsumer(consumer),
+      mBatch(batch),
+      mPending(0),
+      mSequence(0),
+      mEnded(false)
+    {
+        THERON_ASSERT(batch > 0);
+    }
+
+    /**
+    \brief Records that a chunk has been consumed, returning credit to the producer if due.
+    Credit is returned for the end marker straight away, along with any credit still pending.
+    \param chunk The consumed chunk, or the end marker.
+    \param producer The address of the producer, from which the chunk was received.
+    */
+    inline void Consumed(const StreamChunk &chunk, const Address &producer)
+    {
+        THERON_ASSERT_MSG(chunk.mSequence == mSequence, "Stream chunks consumed out of order");
+
+        if (chunk.mEnd)
+        {
+            mEnded = true;
+            mConsumer.Send(StreamCredit(chunk.mStream, mPending, true), producer);
+            mPending = 0;
+            return;
+        }
+
+        ++mSequence;
+
+        if (++mPending >= mBatch)
+        {
+            mConsumer.Send(StreamCredit(chunk.mStream, mPending), producer);
+            mPending = 0;
+        }
+    }
+
+    /**
+    \brief Returns true once the end marker of the stream has been consumed.
+    */
+    inline bool IsEnded() const
+    {
+        return mEnded;
+    }
+
+    /**
+    \brief Gets the number of chunks consumed so far.
+    */
+    inline uint32_t GetChunksConsumed() const
+    {
+        return mSequence;
+    }
+
+private:
+
+    StreamReader(const StreamReader &other);
+    StreamReader &operator=(const StreamReader &other);
+
+    const Actor &mConsumer;         ///< Consumer via which credit is returned.
+    const uint32_t mBatch;          ///< Number of chunks consumed before credit is returned.
+    uint32_t mPending;              ///< Number of chunks consumed since credit was last returned.
+    uint32_t mSequence;             ///< Sequence number of the next chunk expected.
+    bool mEnded;                    ///< Indicates whether the end marker has been consumed.
+};
+
+
+} // namespace Theron
+
+
+#endif // THERON_STREAM_H
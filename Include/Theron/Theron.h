@@ -15,14 +15,21 @@ All-inclusive wrapper header that includes all public headers.
 #include <Theron/AllocatorManager.h>
 #include <Theron/Assert.h>
 #include <Theron/BasicTypes.h>
+#include <Theron/BufferPool.h>
 #include <Theron/Catcher.h>
 #include <Theron/DefaultAllocator.h>
 #include <Theron/Defines.h>
+#include <Theron/DescriptorReady.h>
 #include <Theron/EndPoint.h>
+#include <Theron/FileResult.h>
 #include <Theron/Framework.h>
+#include <Theron/HugePageAllocator.h>
 #include <Theron/IAllocator.h>
+#include <Theron/MessageBudgetPolicy.h>
 #include <Theron/Receiver.h>
 #include <Theron/Register.h>
+#include <Theron/StlAllocator.h>
+#include <Theron/Stream.h>
 #include <Theron/YieldStrategy.h>
 
 
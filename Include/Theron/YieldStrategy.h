@@ -62,6 +62,14 @@ in combination with processor affinity masks, like YIELD_STRATEGY_SPIN. It's adv
 YIELD_STRATEGY_SPIN is that any other threads running on the same cores are less likely to
 be starved.
 
+YIELD_STRATEGY_ADAPTIVE aims to combine the low latency of spinning with the low CPU usage of
+condition variables, for applications whose load varies over time. Each worker thread learns the
+typical length of the gaps between arriving work, as a moving average of the times it has spent
+waiting. An idle thread spins for a little longer than the typical gap, and then yields to other
+threads if the gap is typically short, before finally waiting on a condition variable. Threads
+that see work arriving in quick succession pick it up without system calls, while threads that
+see long idle periods stop spinning almost immediately and consume no CPU until woken.
+
 When choosing a yield strategy it pays to consider how important low-latency responses are to your
 application. In most applications latencies of a few milliseconds are not significant, and the
 default strategy is a reasonable choice.
@@ -71,6 +79,7 @@ enum YieldStrategy
     YIELD_STRATEGY_CONDITION = 0,       ///< Threads wait on condition variables when no work is available.
     YIELD_STRATEGY_HYBRID,              ///< Threads spin for a while, then yield to other threads, when no work is available.
     YIELD_STRATEGY_SPIN,                ///< Threads busy-wait, without yielding, when no work is available.
+    YIELD_STRATEGY_ADAPTIVE,            ///< Threads spin, yield, or wait on condition variables according to their observed idle times.
 
     // Legacy section
     YIELD_STRATEGY_BLOCKING = 0,        ///< Deprecated - use YIELD_STRATEGY_CONDITION.
@@ -3,6 +3,7 @@
 #define THERON_TESTS_TESTSUITES_FEATURETESTSUITE_H
 
 
+#include <stdio.h>
 #include <string.h>
 #include <vector>
 #include <string>
@@ -10,11 +11,25 @@
 
 #include <Theron/Theron.h>
 
+#include <Theron/Detail/Allocators/LockFreeCachingAllocator.h>
+#include <Theron/Detail/Allocators/LockFreePool.h>
+#include <Theron/Detail/Allocators/ScratchArena.h>
+
+#include <Theron/Detail/Threading/Atomic.h>
+#include <Theron/Detail/Threading/McsLock.h>
+#include <Theron/Detail/Threading/SpinLock.h>
+#include <Theron/Detail/Threading/Thread.h>
+#include <Theron/Detail/Threading/TicketLock.h>
 #include <Theron/Detail/Threading/Utils.h>
 
 #include "TestFramework/TestSuite.h"
 
 
+#if THERON_EPOLL
+#include <unistd.h>
+#endif // THERON_EPOLL
+
+
 namespace Tests
 {
 
@@ -45,6 +60,7 @@ public:
         TESTFRAMEWORK_REGISTER_TEST(RegisterHandler);
         TESTFRAMEWORK_REGISTER_TEST(SendHandledMessageInBlockingFramework);
         TESTFRAMEWORK_REGISTER_TEST(SendHandledMessageInNonBlockingFramework);
+        TESTFRAMEWORK_REGISTER_TEST(SendHandledMessageInAdaptiveFramework);
         TESTFRAMEWORK_REGISTER_TEST(CreateActorInFunction);
         TESTFRAMEWORK_REGISTER_TEST(SendMessageToReceiverInFunction);
         TESTFRAMEWORK_REGISTER_TEST(SendMessageFromNullAddressInFunction);
@@ -90,6 +106,29 @@ public:
         TESTFRAMEWORK_REGISTER_TEST(ConstructFrameworkWithParameters);
         TESTFRAMEWORK_REGISTER_TEST(ThreadCountApi);
         TESTFRAMEWORK_REGISTER_TEST(EventCounterApi);
+        TESTFRAMEWORK_REGISTER_TEST(HardwareCounterApi);
+        TESTFRAMEWORK_REGISTER_TEST(ContendedSpinLocks);
+        TESTFRAMEWORK_REGISTER_TEST(BlockingActorDoesNotStallWorkers);
+        TESTFRAMEWORK_REGISTER_TEST(BlockedWorkersAreCompensated);
+        TESTFRAMEWORK_REGISTER_TEST(WriteAndReadFileAsynchronously);
+        TESTFRAMEWORK_REGISTER_TEST(ReadMissingFileAsynchronously);
+        TESTFRAMEWORK_REGISTER_TEST(WatchDescriptor);
+        TESTFRAMEWORK_REGISTER_TEST(RunFrameworkWithoutThreads);
+        TESTFRAMEWORK_REGISTER_TEST(LimitMessageMemory);
+        TESTFRAMEWORK_REGISTER_TEST(BlockOnMessageBudget);
+        TESTFRAMEWORK_REGISTER_TEST(ShareProcessorsByWeight);
+        TESTFRAMEWORK_REGISTER_TEST(DropExpiredMessages);
+        TESTFRAMEWORK_REGISTER_TEST(ConflateMessagesByKey);
+        TESTFRAMEWORK_REGISTER_TEST(ConflateMessagesInPlace);
+        TESTFRAMEWORK_REGISTER_TEST(ColocateChattyActors);
+        TESTFRAMEWORK_REGISTER_TEST(UseScratchMemoryInHandler);
+        TESTFRAMEWORK_REGISTER_TEST(AllocateFromHugePages);
+        TESTFRAMEWORK_REGISTER_TEST(CacheBlocksWithoutLocking);
+        TESTFRAMEWORK_REGISTER_TEST(ReplyAndForwardInHandledMessage);
+        TESTFRAMEWORK_REGISTER_TEST(DestructMessageValuesByDescriptor);
+        TESTFRAMEWORK_REGISTER_TEST(AllocateSmallMessagesInSlots);
+        TESTFRAMEWORK_REGISTER_TEST(ShareBuffersFromPool);
+        TESTFRAMEWORK_REGISTER_TEST(StreamChunksWithCredit);
         TESTFRAMEWORK_REGISTER_TEST(ConstructEndPoint);
         TESTFRAMEWORK_REGISTER_TEST(TieFrameworkToEndPoint);
         TESTFRAMEWORK_REGISTER_TEST(TieActorsToEndPoint);
@@ -99,6 +138,7 @@ public:
         TESTFRAMEWORK_REGISTER_TEST(NameReceiverOnConstruction);
         TESTFRAMEWORK_REGISTER_TEST(SendMessageToLocalActorByName);
         TESTFRAMEWORK_REGISTER_TEST(SendMessagesBetweenLocalFrameworksByName);
+        TESTFRAMEWORK_REGISTER_TEST(SendMessagesToManyLocalActorsByName);
     }
 
     inline static void ConstructFramework()
@@ -255,6 +295,30 @@ public:
         receiver.Wait();
     }
 
+    inline static void SendHandledMessageInAdaptiveFramework()
+    {
+        Theron::Framework::Parameters params;
+        params.mYieldStrategy = Theron::YIELD_STRATEGY_ADAPTIVE;
+
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+        Replier<int> actor(framework);
+
+        // Send in bursts separated by idle periods, so the workers both spin and park.
+        for (int burst = 0; burst < 3; ++burst)
+        {
+            framework.Send(int(0), receiver.GetAddress(), actor.GetAddress());
+            framework.Send(int(1), receiver.GetAddress(), actor.GetAddress());
+            framework.Send(int(2), receiver.GetAddress(), actor.GetAddress());
+
+            receiver.Wait();
+            receiver.Wait();
+            receiver.Wait();
+
+            Theron::Detail::Utils::SleepThread(10);
+        }
+    }
+
     inline static void CreateActorInFunction()
     {
         Theron::Framework framework;
@@ -1233,785 +1297,2289 @@ public:
 #endif
     }
 
-    inline static void ConstructEndPoint()
+    inline static void HardwareCounterApi()
     {
-        // Should be able to use endpoints even if networking is disabled.
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-    }
+        typedef Catcher<int> CountCatcher;
 
-    inline static void TieFrameworkToEndPoint()
-    {
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework framework(endPoint);
-    }
+        // Find out whether hardware counters can be opened in this process at all.
+        bool available(false);
 
-    inline static void TieActorsToEndPoint()
-    {
-        typedef Replier<int> IntReplier;
+#if THERON_ENABLE_PERF_COUNTERS
+        Theron::Detail::PerfCounters probe;
+        Theron::uint64_t deltas[Theron::Detail::MAX_PERF_EVENTS];
 
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework framework(endPoint);
+        probe.Start();
+        available = probe.Stop(deltas);
+#endif // THERON_ENABLE_PERF_COUNTERS
 
-        // Create two actors and let them register and deregister themselves with the endPoint.
-        {
-            IntReplier replierOne(framework);
-            IntReplier replierTwo(framework);
-        }
+        Theron::uint64_t cycles[2] = { 0, 0 };
+        Theron::uint64_t instructions[2] = { 0, 0 };
+
+        Theron::Framework::ResetActorCounters<Counter>();
 
-        // And again.
         {
-            IntReplier replierOne(framework);
-            IntReplier replierTwo(framework);
+            Theron::Framework framework;
+            Counter actor(framework);
+
+            Theron::Receiver receiver;
+            CountCatcher catcher;
+            receiver.RegisterHandler(&catcher, &CountCatcher::Catch);
+
+            for (uint32_t counter = 0; counter < framework.GetNumCounters(); ++counter)
+            {
+                Check(strcmp(framework.GetCounterName(counter), "unknown") != 0, "GetCounterName failed");
+            }
+
+            // Sample the totals after each of two rounds of messages.
+            // All the handlers of the first round have finished before those of the second start.
+            for (int round = 0; round < 2; ++round)
+            {
+                for (int count = 0; count < 100; ++count)
+                {
+                    framework.Send(1, receiver.GetAddress(), actor.GetAddress());
+                }
+
+                framework.Send(true, receiver.GetAddress(), actor.GetAddress());
+                receiver.Wait();
+
+                cycles[round] = Theron::Framework::GetActorCounterValue<Counter>(Theron::Detail::COUNTER_HANDLER_CYCLES);
+                instructions[round] = Theron::Framework::GetActorCounterValue<Counter>(Theron::Detail::COUNTER_HANDLER_INSTRUCTIONS);
+            }
         }
-    }
 
-    inline static void TieReceiverstoEndPoint()
-    {
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        // Only the hardware event counters are accumulated per actor class.
+        Check(Theron::Framework::GetActorCounterValue<Counter>(0) == 0, "GetActorCounterValue failed");
 
-        // Create two receivers and let them register and deregister themselves with the endPoint.
+        if (available)
         {
-            Theron::Receiver receiverOne(endPoint);
-            Theron::Receiver receiverTwo(endPoint);
+            Check(cycles[0] > 0 && instructions[0] > 0, "Hardware counters not counted");
+            Check(cycles[1] > cycles[0] && instructions[1] > instructions[0], "Hardware counters not increasing");
         }
-
-        // And again.
+        else
         {
-            Theron::Receiver receiverOne(endPoint);
-            Theron::Receiver receiverTwo(endPoint);
+            // Without hardware counters the totals stay zero.
+            Check(cycles[1] == 0 && instructions[1] == 0, "Unavailable hardware counters not zero");
         }
+
+        // The framework has been destroyed, so no handlers can add to the totals after the reset.
+        Theron::Framework::ResetActorCounters<Counter>();
+        Check(Theron::Framework::GetActorCounterValue<Counter>(Theron::Detail::COUNTER_HANDLER_CYCLES) == 0, "ResetActorCounters failed");
     }
 
-    inline static void NameFrameworkOnConstruction()
+    inline static void ContendedSpinLocks()
     {
-        typedef Replier<int> IntReplier;
-
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-
-        Theron::Framework::Parameters frameworkParams;
-        Theron::Framework framework(endPoint, "framework", frameworkParams);
+        // Each lock type must provide mutual exclusion between contending threads.
+        Check(ContendLock<Theron::Detail::SpinLock>(), "SpinLock failed");
+        Check(ContendLock<Theron::Detail::TicketLock>(), "TicketLock failed");
+        Check(ContendLock<Theron::Detail::McsLock>(), "McsLock failed");
+    }
 
-        // Register an actor and a receiver to test the name can be used.
-        IntReplier replier(framework);
-        Theron::Receiver receiver(endPoint);
+    inline static void BlockingActorDoesNotStallWorkers()
+    {
+        // With a single worker thread the flag can only be set while the waiter
+        // is blocked if the waiter is executed by the pool of blocking threads.
+        Check(WaitForFlagSetter(true), "Blocking actor stalled the worker threads");
+    }
 
-        framework.Send(int(0), receiver.GetAddress(), replier.GetAddress());
-        receiver.Wait();
+    inline static void BlockedWorkersAreCompensated()
+    {
+        // The flag can only be set while the unmarked waiter blocks the only
+        // worker thread if an extra worker thread is started to compensate.
+        Check(WaitForFlagSetter(false), "Blocked worker thread wasn't compensated");
     }
 
-    inline static void NameActorOnConstruction()
+    inline static void WriteAndReadFileAsynchronously()
     {
-        typedef Replier<int> IntReplier;
+        typedef Theron::Catcher<Theron::FileResult> ResultCatcher;
 
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework framework(endPoint);
+        const char *const fileName("TheronFileServiceTest.tmp");
+        const char *const contents("The quick brown fox");
 
-        // Register a named actor and a receiver to test the name can be used.
-        IntReplier replier(framework, "replier");
-        Theron::Receiver receiver(endPoint);
+        Theron::Framework framework(2);
+        Theron::Receiver receiver;
+        ResultCatcher catcher;
+        receiver.RegisterHandler(&catcher, &ResultCatcher::Push);
 
-        framework.Send(int(0), receiver.GetAddress(), Theron::Address("replier"));
-        receiver.Wait();
-    }
+        void *const buffer(framework.AllocateFileBuffer());
+        Check(buffer != 0, "Failed to allocate file buffer");
+        memcpy(buffer, contents, strlen(contents));
 
-    inline static void NameReceiverOnConstruction()
-    {
-        typedef Replier<int> IntReplier;
+        Check(framework.WriteFile(receiver.GetAddress(), fileName, buffer, static_cast<Theron::uint32_t>(strlen(contents)), 1), "WriteFile failed");
+        receiver.Wait();
 
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework framework(endPoint);
+        Theron::FileResult result;
+        Theron::Address from;
 
-        // Register a named actor and a named receiver.
-        IntReplier replier(framework, "replier");
-        Theron::Receiver receiver(endPoint, "receiver");
+        catcher.Pop(result, from);
+        Check(result.mTag == 1, "Write result has wrong tag");
+        Check(result.mError == 0, "Write failed");
+        Check(result.mSize == strlen(contents), "Write result has wrong size");
+        Check(result.mBuffer == buffer, "Write result doesn't return buffer");
+        framework.FreeFileBuffer(result.mBuffer);
 
-        framework.Send(int(0), Theron::Address("receiver"), Theron::Address("replier"));
+        // Read back the last word.
+        Check(framework.ReadFile(receiver.GetAddress(), fileName, 2, 16), "ReadFile failed");
         receiver.Wait();
+
+        catcher.Pop(result, from);
+        Check(result.mTag == 2, "Read result has wrong tag");
+        Check(result.mError == 0, "Read failed");
+        Check(result.mSize == 3, "Read result has wrong size");
+        Check(memcmp(result.mBuffer, "fox", 3) == 0, "Read result has wrong contents");
+        framework.FreeFileBuffer(result.mBuffer);
+
+        remove(fileName);
     }
 
-    inline static void SendMessageToLocalActorByName()
+    inline static void ReadMissingFileAsynchronously()
     {
-        typedef Replier<std::string> StringReplier;
-
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework framework(endPoint);
+        typedef Theron::Catcher<Theron::FileResult> ResultCatcher;
 
-        StringReplier replier(framework, "replier");
-        Theron::Receiver receiver(endPoint, "receiver");
+        Theron::Framework framework(2);
+        Theron::Receiver receiver;
+        ResultCatcher catcher;
+        receiver.RegisterHandler(&catcher, &ResultCatcher::Push);
 
-        // This tests we can send any copyable message to actors on the same endpoint
-        // by name, even if the message type hasn't been registered.
-        const std::string message("hello world");
+        Check(framework.ReadFile(receiver.GetAddress(), "TheronMissingFile.tmp", 3), "ReadFile failed");
+        receiver.Wait();
 
-        // Send the replier a message by name, and pass the receiver address by name.
-        framework.Send(message, Theron::Address("receiver"), Theron::Address("replier"));
+        Theron::FileResult result;
+        Theron::Address from;
 
-        // Wait for the reply.
-        receiver.Wait();
+        catcher.Pop(result, from);
+        Check(result.mTag == 3, "Read result has wrong tag");
+        Check(result.mError != 0, "Read of missing file didn't fail");
+        Check(result.mSize == 0, "Read of missing file returned data");
+        Check(result.mBuffer != 0, "Read of missing file didn't return buffer");
+        framework.FreeFileBuffer(result.mBuffer);
     }
 
-    inline static void SendMessagesBetweenLocalFrameworksByName()
+    inline static void WatchDescriptor()
     {
-        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
-        Theron::Framework frameworkOne(endPoint);
-        Theron::Framework frameworkTwo(endPoint);
+        typedef Theron::Catcher<Theron::DescriptorReady> ReadyCatcher;
 
-        Signaller signallerOne(frameworkOne, "signaller_one");
-        Signaller signallerTwo(frameworkTwo, "signaller_two");
-        Theron::Receiver receiver(endPoint, "receiver");
-
-        // Send one a message telling it to signal two.
-        // One sends the receiver address to two as the signal,
-        // causing two to send one's address to the receiver.
-        Check(frameworkTwo.Send(
-            Theron::Address("signaller_two"),
-            Theron::Address("receiver"),
-            Theron::Address("signaller_one")), "Failed to send message");
+        Theron::Framework framework(2);
+        Theron::Receiver receiver;
+        ReadyCatcher catcher;
+        receiver.RegisterHandler(&catcher, &ReadyCatcher::Push);
 
-        receiver.Wait();
-    }
+#if THERON_EPOLL
 
-private:
+        int descriptors[2];
+        Check(pipe(descriptors) == 0, "Failed to create pipe");
 
-    class TrivialActor : public Theron::Actor
-    {
-    public:
+        // An actor reads the pipe as it becomes readable, re-watching it after each read.
+        PipeReader reader(framework, descriptors[0], receiver.GetAddress());
+        Check(framework.WatchDescriptor(reader.GetAddress(), descriptors[0], Theron::DescriptorReady::READABLE, 7), "WatchDescriptor failed");
 
-        TrivialActor(Theron::Framework &framework) : Theron::Actor(framework)
+        for (int index = 0; index < 3; ++index)
         {
+            const char byte('a');
+            Check(write(descriptors[1], &byte, 1) == 1, "Failed to write pipe");
+            receiver.Wait();
         }
-    };
 
-    template <class MessageType>
-    class Registrar : public Theron::Actor
-    {
-    public:
+        Theron::DescriptorReady ready;
+        Theron::Address from;
 
-        Registrar(Theron::Framework &framework) : Theron::Actor(framework)
+        int count(0);
+        while (!catcher.Empty())
         {
-            RegisterHandler(this, &Registrar::Handler);
-            IsHandlerRegistered(this, &Registrar::Handler);
-            DeregisterHandler(this, &Registrar::Handler);
-            IsHandlerRegistered(this, &Registrar::Handler);
+            catcher.Pop(ready, from);
+            Check(ready.mDescriptor == descriptors[0], "Readiness message has wrong descriptor");
+            Check((ready.mEvents & Theron::DescriptorReady::READABLE) != 0, "Readiness message isn't readable");
+            Check(ready.mTag == 7, "Readiness message has wrong tag");
+            ++count;
         }
 
-    private:
+        Check(count == 3, "Wrong number of readiness messages");
 
-        inline void Handler(const MessageType &/*message*/, const Theron::Address /*from*/)
-        {
-        }
-    };
+        Check(framework.UnwatchDescriptor(descriptors[0]), "UnwatchDescriptor failed");
+        Check(!framework.UnwatchDescriptor(descriptors[0]), "UnwatchDescriptor of unwatched descriptor succeeded");
 
-    template <class MessageType>
-    class Replier : public Theron::Actor
-    {
-    public:
+        close(descriptors[0]);
+        close(descriptors[1]);
 
-        inline explicit Replier(Theron::Framework &framework, const char *const name = 0) : Theron::Actor(framework, name)
-        {
-            RegisterHandler(this, &Replier::Handler);
-        }
+#else
 
-    private:
+        Check(!framework.WatchDescriptor(receiver.GetAddress(), 0, Theron::DescriptorReady::READABLE), "WatchDescriptor succeeded without support");
 
-        inline void Handler(const MessageType &message, const Theron::Address from)
-        {
-            Send(message, from);
-        }
-    };
+#endif // THERON_EPOLL
 
-    template <class MessageType>
-    class DefaultReplier : public Theron::Actor
+    }
+
+    inline static void RunFrameworkWithoutThreads()
     {
-    public:
+        typedef Replier<int> IntReplier;
 
-        inline DefaultReplier(Theron::Framework &framework) : Theron::Actor(framework)
-        {
-            RegisterHandler(this, &DefaultReplier::Handler);
-            SetDefaultHandler(this, &DefaultReplier::DefaultHandler);
-        }
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
 
-    private:
+        Theron::Framework framework(params);
+        Check(framework.GetNumThreads() == 0, "Framework without threads has threads");
 
-        inline void Handler(const MessageType &message, const Theron::Address from)
-        {
-            Send(message, from);
-        }
+        Theron::Receiver receiver;
+        IntReplier replier(framework);
 
-        inline void DefaultHandler(const Theron::Address from)
+        // Nothing is processed until the framework is run.
+        for (int index = 0; index < 3; ++index)
         {
-            std::string hello("hello");
-            Send(hello, from);
+            framework.Send(index, receiver.GetAddress(), replier.GetAddress());
         }
-    };
 
-    class StringReplier : public Replier<const char *>
-    {
-    public:
+        Check(receiver.Count() == 0, "Messages processed without running the framework");
 
-        typedef Replier<const char *> Base;
+        Check(framework.RunOnce() == 1, "RunOnce processed wrong number of messages");
+        Check(receiver.Count() == 1, "RunOnce didn't deliver reply");
 
-        inline StringReplier(Theron::Framework &framework) : Base(framework)
-        {
-        }
-    };
+        Check(framework.RunUntilIdle() == 2, "RunUntilIdle processed wrong number of messages");
+        Check(receiver.Count() == 3, "RunUntilIdle didn't deliver replies");
+        Check(framework.RunUntilIdle() == 0, "RunUntilIdle processed messages when idle");
 
-    class Signaller : public Theron::Actor
+        // Messages sent by handlers are processed within the same call.
+        Forwarder forwarderC(framework, receiver.GetAddress());
+        Forwarder forwarderB(framework, forwarderC.GetAddress());
+        Forwarder forwarderA(framework, forwarderB.GetAddress());
+
+        framework.Send(3, receiver.GetAddress(), forwarderA.GetAddress());
+        Check(framework.RunUntilIdle() == 3, "RunUntilIdle didn't process sent messages");
+        Check(receiver.Count() == 4, "RunUntilIdle didn't deliver forwarded message");
+    }
+
+    inline static void LimitMessageMemory()
     {
-    public:
+        typedef Replier<int> IntReplier;
+
+        // Without worker threads, sent messages wait until the framework is run.
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
+        params.mMessageBudget = 1024;
+        params.mMessageBudgetPolicy = Theron::MESSAGE_BUDGET_FAIL;
 
-        inline Signaller(Theron::Framework &framework, const char *const name = 0) : Theron::Actor(framework, name)
         {
-            RegisterHandler(this, &Signaller::Signal);
+            Theron::Framework framework(params);
+            FallbackHandler fallbackHandler;
+            framework.SetFallbackHandler(&fallbackHandler, &FallbackHandler::Handle);
+
+            Theron::Receiver receiver;
+            IntReplier replier(framework);
+
+            // Send messages until the budget is full and refuses one.
+            Theron::uint32_t sent(0);
+            while (sent < 1024 && framework.Send(0, receiver.GetAddress(), replier.GetAddress()))
+            {
+                ++sent;
+            }
+
+            Check(sent > 0 && sent < 1024, "Budget didn't limit waiting messages");
+            Check(fallbackHandler.mAddress == receiver.GetAddress(), "Refused message not passed to fallback handler");
+            Check(framework.GetMessageMemory() > 0, "Waiting messages not counted");
+            Check(framework.GetMessageMemory() <= 1024, "Waiting messages exceed budget");
+            Check(framework.GetPeakMessageMemory() >= framework.GetMessageMemory(), "Peak below current usage");
+
+            // Processing the messages makes room for more.
+            Check(framework.RunUntilIdle() == sent, "Framework didn't process accepted messages");
+            Check(receiver.Count() == sent, "Framework didn't deliver accepted messages");
+            Check(framework.GetMessageMemory() == 0, "Processed messages still counted");
+            Check(framework.Send(0, receiver.GetAddress(), replier.GetAddress()), "Budget refused message after making room");
+
+            framework.RunUntilIdle();
         }
 
-    private:
+        // With a callback the application decides whether to accept messages over the budget.
+        params.mMessageBudgetPolicy = Theron::MESSAGE_BUDGET_CALLBACK;
+        params.mMessageBudgetCallback = &AcceptOverBudget;
+
+        Theron::uint32_t callbackCount(0);
+        params.mMessageBudgetContext = &callbackCount;
 
-        inline void Signal(const Theron::Address &address, const Theron::Address from)
         {
-            // Send the 'from' address to the address received in the message.
-            Send(from, address);
+            Theron::Framework framework(params);
+            Theron::Receiver receiver;
+            IntReplier replier(framework);
+
+            for (int index = 0; index < 100; ++index)
+            {
+                Check(framework.Send(0, receiver.GetAddress(), replier.GetAddress()), "Callback didn't accept message");
+            }
+
+            Check(callbackCount > 0, "Callback not called for messages over budget");
+            Check(framework.GetMessageMemory() > 1024, "Accepted messages not counted");
+
+            framework.RunUntilIdle();
+            Check(receiver.Count() == 100, "Framework didn't deliver messages accepted over budget");
         }
-    };
+    }
 
-    class Switcher : public Theron::Actor
+    inline static void BlockOnMessageBudget()
     {
-    public:
+        typedef Replier<int> IntReplier;
 
-        inline Switcher(Theron::Framework &framework) : Theron::Actor(framework)
-        {
-            RegisterHandler(this, &Switcher::SayHello);
-        }
+        Theron::Framework::Parameters params(2);
+        params.mMessageBudget = 1024;
+        params.mMessageBudgetPolicy = Theron::MESSAGE_BUDGET_BLOCK;
 
-    private:
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+        IntReplier replier(framework);
 
-        inline void SayHello(const std::string &/*message*/, const Theron::Address from)
+        // Sends wait for room rather than failing, so all the messages are delivered.
+        const Theron::uint32_t count(1000);
+        for (Theron::uint32_t index = 0; index < count; ++index)
         {
-            DeregisterHandler(this, &Switcher::SayHello);
-            RegisterHandler(this, &Switcher::SayGoodbye);
-            Send(std::string("hello"), from);
+            Check(framework.Send(0, receiver.GetAddress(), replier.GetAddress()), "Blocking budget refused message");
         }
 
-        inline void SayGoodbye(const std::string &/*message*/, const Theron::Address from)
+        Theron::uint32_t received(0);
+        while (received < count)
         {
-            DeregisterHandler(this, &Switcher::SayGoodbye);
-            RegisterHandler(this, &Switcher::SayHello);
-            Send(std::string("goodbye"), from);
+            received += receiver.Wait(count - received);
         }
-    };
 
-    template <class MessageType>
-    class Catcher
+        // Worker threads count in batches, so the peak can exceed the budget by a few kilobytes per thread.
+        Check(framework.GetPeakMessageMemory() < 1024 + 16384, "Blocked senders didn't wait for room");
+    }
+
+    inline static void ShareProcessorsByWeight()
     {
-    public:
+        typedef Catcher<Theron::uint32_t> CountCatcher;
 
-        inline Catcher() : mMessage(), mFrom(Theron::Address::Null())
+        Theron::Framework::Parameters heavyParams(2);
+        heavyParams.mCpuShares = 3;
+
+        Theron::Framework::Parameters lightParams(2);
+        lightParams.mCpuShares = 1;
+
+        Theron::Framework heavyFramework(heavyParams);
+        Theron::Framework lightFramework(lightParams);
+        Theron::Receiver receiver;
+        CountCatcher catcher;
+        receiver.RegisterHandler(&catcher, &CountCatcher::Catch);
+
+        Spinner heavySpinner(heavyFramework);
+        Spinner lightSpinner(lightFramework);
+
+        // Both frameworks compete for the processors, but the smaller share still gets its turn.
+        heavyFramework.Send(Theron::uint32_t(2000), receiver.GetAddress(), heavySpinner.GetAddress());
+        lightFramework.Send(Theron::uint32_t(2000), receiver.GetAddress(), lightSpinner.GetAddress());
+
+        Theron::uint32_t received(0);
+        while (received < 2)
+        {
+            received += receiver.Wait(2 - received);
+        }
+
+        Check(catcher.mMessage == 0, "Spinner didn't finish its work");
+    }
+
+    inline static void DropExpiredMessages()
+    {
+        typedef Replier<Theron::uint32_t> UIntReplier;
+
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
+
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+        UIntReplier replier(framework);
+
+        BlindFallbackHandler handler;
+        framework.SetExpiryHandler(&handler, &BlindFallbackHandler::Handle);
+
+        // Messages wait in the mailbox until the framework is run, by which time the first has expired.
+        framework.Send(Theron::uint32_t(7), receiver.GetAddress(), replier.GetAddress(), 1);
+        framework.Send(Theron::uint32_t(8), receiver.GetAddress(), replier.GetAddress(), 60000);
+        framework.Send(Theron::uint32_t(9), receiver.GetAddress(), replier.GetAddress());
+
+        Theron::Detail::Utils::SleepThread(20);
+
+        Check(framework.RunUntilIdle() == 3, "RunUntilIdle processed wrong number of messages");
+        Check(receiver.Count() == 2, "Expired message was handled, or unexpired message wasn't");
+        Check(framework.GetNumExpiredMessages() == 1, "Expired message wasn't counted");
+        Check(handler.mValue == 7, "Expiry handler wasn't passed the expired message");
+        Check(handler.mAddress == receiver.GetAddress(), "Expiry handler was passed wrong from address");
+    }
+
+    inline static void ConflateMessagesByKey()
+    {
+        typedef Catcher<Theron::uint32_t> UIntCatcher;
+
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
+
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+        UIntCatcher catcher;
+        receiver.RegisterHandler(&catcher, &UIntCatcher::Catch);
+
+        QuoteBoard board(framework);
+
+        // Later quotes replace pending quotes with the same key, keeping their places in the queue.
+        const Quote quotes[] = { { 1, 10 }, { 2, 20 }, { 1, 11 }, { 1, 12 }, { 2, 21 } };
+        for (Theron::uint32_t index = 0; index < 5; ++index)
+        {
+            framework.Send(quotes[index], receiver.GetAddress(), board.GetAddress());
+        }
+
+        Check(board.GetNumQueuedMessages() == 2, "Conflated messages were queued");
+
+        Check(framework.RunOnce() == 1, "RunOnce processed wrong number of messages");
+        Check(catcher.mMessage == 12, "Handler didn't see the latest value of the first key");
+
+        // A quote with a key that has no pending quote is queued as usual.
+        framework.Send(quotes[0], receiver.GetAddress(), board.GetAddress());
+        Check(framework.RunUntilIdle() == 2, "RunUntilIdle processed wrong number of messages");
+        Check(catcher.mMessage == 10, "Handler didn't see the latest value of the second key");
+        Check(receiver.Count() == 3, "Conflated messages were handled");
+    }
+
+    inline static void ConflateMessagesInPlace()
+    {
+        typedef Catcher<Theron::uint32_t> UIntCatcher;
+
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
+
+        {
+            Theron::Framework framework(params);
+            Theron::Receiver receiver;
+            Theron::Receiver otherReceiver;
+            UIntCatcher catcher;
+            receiver.RegisterHandler(&catcher, &UIntCatcher::Catch);
+            otherReceiver.RegisterHandler(&catcher, &UIntCatcher::Catch);
+
+            LiveQuoteBoard board(framework);
+
+            framework.Send(LiveQuote(1, 10), receiver.GetAddress(), board.GetAddress());
+            const void *const pending(LiveQuote::LastCopy());
+
+            // The pending message is still allocated, so a newly allocated message couldn't share its memory.
+            framework.Send(LiveQuote(1, 11), otherReceiver.GetAddress(), board.GetAddress());
+            Check(LiveQuote::LastCopy() == pending, "Conflated message was allocated rather than replaced in place");
+            Check(LiveQuote::Count() == 1, "Replaced message value wasn't destructed");
+            Check(board.GetNumQueuedMessages() == 1, "Conflated message was queued");
+
+            Check(framework.RunUntilIdle() == 1, "RunUntilIdle processed wrong number of messages");
+            Check(board.mValue == pending, "Handler wasn't passed the replaced message");
+            Check(catcher.mMessage == 11, "Handler didn't see the latest value");
+            Check(catcher.mFrom == board.GetAddress() && otherReceiver.Count() == 1, "Replaced message has wrong sender");
+
+            // Once the message has been handled, a message with the same key is queued as usual.
+            framework.Send(LiveQuote(1, 12), receiver.GetAddress(), board.GetAddress());
+            Check(board.GetNumQueuedMessages() == 1, "Message with handled key wasn't queued");
+            Check(framework.RunUntilIdle() == 1, "RunUntilIdle processed wrong number of messages");
+            Check(catcher.mMessage == 12 && receiver.Count() == 1, "Message with handled key wasn't handled");
+
+            // Messages sent from other frameworks are allocated as usual, but still replace pending messages.
+            Theron::Framework otherFramework(params);
+            otherFramework.Send(LiveQuote(2, 20), receiver.GetAddress(), board.GetAddress());
+            otherFramework.Send(LiveQuote(2, 21), receiver.GetAddress(), board.GetAddress());
+            Check(board.GetNumQueuedMessages() == 1, "Conflated message from other framework was queued");
+
+            Check(framework.RunUntilIdle() == 1, "RunUntilIdle processed wrong number of messages");
+            Check(catcher.mMessage == 21, "Handler didn't see the latest value from other framework");
+        }
+
+        Check(LiveQuote::Count() == 0, "Conflated message values not destructed");
+    }
+
+    inline static void ColocateChattyActors()
+    {
+        Theron::Framework::Parameters params(2);
+        params.mColocateActors = true;
+
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+
+        Volleyer *volleyers[16];
+        for (Theron::uint32_t index = 0; index < 16; ++index)
+        {
+            volleyers[index] = new Volleyer(framework, receiver.GetAddress());
+        }
+
+        for (Theron::uint32_t index = 0; index < 16; index += 2)
+        {
+            volleyers[index]->SetPartner(volleyers[index + 1]->GetAddress());
+            volleyers[index + 1]->SetPartner(volleyers[index]->GetAddress());
+        }
+
+        // The first round teaches the framework which actors talk to each other. By the second the
+        // manager thread has had time to give each pair a home, and the volleys must still all finish.
+        for (Theron::uint32_t round = 0; round < 2; ++round)
+        {
+            for (Theron::uint32_t index = 0; index < 16; ++index)
+            {
+                for (Theron::uint32_t ball = 0; ball < 4; ++ball)
+                {
+                    framework.Send(Theron::uint32_t(1000), receiver.GetAddress(), volleyers[index]->GetAddress());
+                }
+            }
+
+            Theron::uint32_t received(0);
+            while (received < 64)
+            {
+                received += receiver.Wait(64 - received);
+            }
+
+            Theron::Detail::Utils::SleepThread(250);
+        }
+
+        for (Theron::uint32_t index = 0; index < 16; ++index)
+        {
+            delete volleyers[index];
+        }
+    }
+
+    inline static void UseScratchMemoryInHandler()
+    {
+        Theron::Framework::Parameters params;
+        params.mThreadCount = 0;
+
+        Theron::Framework framework(params);
+        ScratchSummer summer(framework);
+
+        Check(summer.mOutsideAllocator == Theron::AllocatorManager::GetCache(), "Scratch allocator used outside handler");
+
+        // Each message is handled with fresh scratch memory, reusing the memory of the last.
+        // The last needs more than the first chunk, so the arena grows to fit it.
+        framework.Send(Theron::uint32_t(100), Theron::Address(), summer.GetAddress());
+        framework.Send(Theron::uint32_t(100), Theron::Address(), summer.GetAddress());
+        framework.Send(Theron::uint32_t(10000), Theron::Address(), summer.GetAddress());
+
+        Check(framework.RunUntilIdle() == 3, "RunUntilIdle processed wrong number of messages");
+        Check(summer.mSums[0] == 4950 && summer.mSums[1] == 4950 && summer.mSums[2] == 49995000, "Scratch vector contents wrong");
+        Check(summer.mBlocks[0] == summer.mBlocks[1], "Scratch memory wasn't reset after handler");
+        Check(summer.mBlocks[0] != 0, "Scratch memory wasn't allocated");
+
+        // Allocations too large for any chunk fail rather than growing the chunk size forever.
+        Theron::Detail::ScratchArena arena;
+        Check(arena.Allocate(100) != 0, "Scratch allocation failed");
+        Check(arena.Allocate(0xFFFFFFF0) == 0, "Oversized scratch allocation succeeded");
+        Check(arena.Allocate(100) != 0, "Scratch allocation failed after oversized allocation");
+    }
+
+    inline static void AllocateFromHugePages()
+    {
+        // Use the smallest regions, so a large block needs a region of its own.
+        Theron::HugePageAllocator allocator(2 * 1024 * 1024);
+
+        const Theron::uint32_t sizes[] = { 4, 16, 24, 100, 4096, 30000, 100000, 5 * 1024 * 1024 };
+        void *blocks[8];
+
+        for (Theron::uint32_t index = 0; index < 8; ++index)
+        {
+            blocks[index] = allocator.AllocateAligned(sizes[index], 64);
+            Check(blocks[index] != 0, "Allocation failed");
+            Check(THERON_ALIGNED(blocks[index], 64), "Allocation not aligned");
+
+            memset(blocks[index], static_cast<int>(index), sizes[index]);
+        }
+
+        for (Theron::uint32_t index = 0; index < 8; ++index)
+        {
+            const unsigned char *const bytes(static_cast<const unsigned char *>(blocks[index]));
+            Check(bytes[0] == index && bytes[sizes[index] - 1] == index, "Allocations overlap");
+        }
+
+        Check(allocator.GetBytesReserved() >= 7 * 1024 * 1024, "Large block didn't get its own region");
+
+        // Freed blocks are reused by later allocations of the same size class.
+        allocator.Free(blocks[3]);
+        Check(allocator.AllocateAligned(sizes[3], 64) == blocks[3], "Freed block wasn't reused");
+
+        allocator.Free(blocks[6], sizes[6]);
+        Check(allocator.Allocate(sizes[6]) == blocks[6], "Freed large block wasn't reused");
+
+        for (Theron::uint32_t index = 0; index < 8; ++index)
+        {
+            allocator.Free(blocks[index]);
+        }
+
+        Check(allocator.GetBytesAllocated() == 0, "Freed memory still counted as allocated");
+    }
+
+    inline static void CacheBlocksWithoutLocking()
+    {
+        Theron::IAllocator *const allocator(Theron::AllocatorManager::GetAllocator());
+
+        // Blocks are carved from slabs owned by the pool, which are only freed once all their blocks are.
+        {
+            Theron::Detail::LockFreePool<1024> pool;
+            pool.Initialize(48);
+
+            Check(pool.GetBlockAlignment() == 16, "Wrong block alignment");
+
+            // The first slab holds 21 blocks, so the rest are carved from a second slab.
+            void *blocks[30];
+            for (Theron::uint32_t index = 0; index < 30; ++index)
+            {
+                blocks[index] = pool.Allocate(allocator);
+                Check(blocks[index] != 0, "Allocation failed");
+                Check(THERON_ALIGNED(blocks[index], 16), "Block not aligned");
+
+                memset(blocks[index], static_cast<int>(index), 48);
+            }
+
+            for (Theron::uint32_t index = 0; index < 30; ++index)
+            {
+                const unsigned char *const bytes(static_cast<const unsigned char *>(blocks[index]));
+                Check(bytes[0] == index && bytes[47] == index, "Blocks overlap");
+            }
+
+            void *const foreign(allocator->Allocate(48));
+            Check(!pool.Free(foreign), "Freed block not from the pool");
+            allocator->Free(foreign, 48);
+
+            // Freed blocks are reused, most recently freed first.
+            Check(pool.Free(blocks[3]) && pool.Free(blocks[25]), "Failed to free blocks");
+            Check(pool.Allocate(allocator) == blocks[25], "Freed block wasn't reused");
+            Check(pool.Allocate(allocator) == blocks[3], "Freed block wasn't reused");
+
+            for (Theron::uint32_t index = 1; index < 30; ++index)
+            {
+                pool.Free(blocks[index]);
+            }
+
+            Check(!pool.Clear(allocator), "Cleared pool with a block still allocated");
+
+            pool.Free(blocks[0]);
+            Check(pool.Clear(allocator), "Failed to clear pool");
+        }
+
+        // Blocks freed without their size are found in the slabs of their size class.
+        {
+            CacheUser::CacheType cache(allocator);
+
+            void *const block(cache.Allocate(100));
+            cache.Free(block);
+            Check(cache.Allocate(100) == block, "Block freed without its size wasn't reused");
+
+            cache.Free(block, 100);
+        }
+
+        // Threads allocating and freeing concurrently never get the same block.
+        {
+            static const Theron::uint32_t NUM_THREADS = 8;
+
+            CacheUser users[NUM_THREADS];
+            CacheUser::CacheType cache(allocator);
+
+            Theron::Detail::Thread threads[NUM_THREADS];
+            for (Theron::uint32_t index = 0; index < NUM_THREADS; ++index)
+            {
+                users[index].mCache = &cache;
+                users[index].mId = static_cast<unsigned char>(index + 1);
+                users[index].mCorrupted = false;
+
+                threads[index].Start(CacheUser::EntryPoint, &users[index]);
+            }
+
+            for (Theron::uint32_t index = 0; index < NUM_THREADS; ++index)
+            {
+                threads[index].Join();
+                Check(!users[index].mCorrupted, "Block used by two threads at once");
+            }
+        }
+    }
+
+    inline static void ReplyAndForwardInHandledMessage()
+    {
+        Theron::Framework framework;
+        Theron::Receiver receiver;
+
+        BlockRecorder recorder;
+        receiver.RegisterHandler(&recorder, &BlockRecorder::Record);
+
+        // The first reply is built in the block of the request, and sent after the second,
+        // which can't reuse it so is sent as usual.
+        Recycler replier(framework, false);
+        framework.Send(1, receiver.GetAddress(), replier.GetAddress());
+
+        receiver.Wait();
+        receiver.Wait();
+
+        Check(recorder.mValues[0] == 3 && recorder.mValues[1] == 2, "Replies received incorrectly");
+        Check(recorder.mFroms[0] == replier.GetAddress() && recorder.mFroms[1] == replier.GetAddress(), "Replies from wrong address");
+        Check(recorder.mBlocks[1] == replier.mBlock, "Reply didn't reuse request block");
+        Check(replier.mResults[0] && replier.mResults[1], "Reply failed");
+
+        // The forwarded message is the original, from the original sender, and can't be forwarded twice.
+        Recycler forwarder(framework, true);
+        framework.Send(7, receiver.GetAddress(), forwarder.GetAddress());
+
+        receiver.Wait();
+
+        Check(recorder.mValues[2] == 7, "Forwarded message received incorrectly");
+        Check(recorder.mFroms[2] == receiver.GetAddress(), "Forwarded message not from original sender");
+        Check(recorder.mBlocks[2] == forwarder.mBlock, "Forwarded message was copied");
+        Check(forwarder.mResults[0] && !forwarder.mResults[1], "Forwarded message twice");
+    }
+
+    inline static void DestructMessageValuesByDescriptor()
+    {
+        typedef Theron::Detail::MessageTypeDescriptor<int> IntDescriptor;
+        typedef Theron::Detail::MessageTypeDescriptor<LiveValue> LiveValueDescriptor;
+
+        Check(IntDescriptor::smDescriptor.mSize == sizeof(int), "Descriptor has wrong size");
+        Check(LiveValueDescriptor::smDescriptor.mDestroy != 0, "Descriptor has no destructor");
+
+#if THERON_MSVC || THERON_GCC
+        Check(IntDescriptor::smDescriptor.mDestroy == 0, "Trivially destructible type has destructor");
+#endif
+
+        {
+            LiveValue value;
+
+            Theron::Framework framework;
+            Theron::Receiver receiver;
+            Replier<LiveValue> replier(framework);
+
+            receiver.RegisterHandler(&value, &LiveValue::Handle);
+
+            framework.Send(value, receiver.GetAddress(), replier.GetAddress());
+            framework.Send(value, receiver.GetAddress(), replier.GetAddress());
+
+            receiver.Wait();
+            receiver.Wait();
+        }
+
+        Check(LiveValue::Count() == 0, "Message values not destructed");
+    }
+
+    inline static void AllocateSmallMessagesInSlots()
+    {
+        Check(!Theron::Detail::MessageSlot<LargeValue>::FITS, "Large message fits in slot");
+
+#if THERON_MESSAGE_SLOT_SIZE
+        Check(Theron::Detail::MessageSlot<int>::FITS, "Small message doesn't fit in slot");
+
+        // With one worker thread, the third message is allocated in the slot freed by the first.
+        Theron::Framework::Parameters params(1);
+        Theron::Framework framework(params);
+        Theron::Receiver receiver;
+        SlotUser user(framework);
+
+        framework.Send(0, receiver.GetAddress(), user.GetAddress());
+        receiver.Wait();
+
+        for (Theron::uint32_t index = 0; index < 3; ++index)
+        {
+            Check(THERON_ALIGNED(user.mBlocks[index], THERON_CACHELINE_ALIGNMENT), "Slot not aligned");
+        }
+
+        Check(user.mBlocks[2] == user.mBlocks[0], "Slot not reused");
+#endif // THERON_MESSAGE_SLOT_SIZE
+    }
+
+    inline static void ShareBuffersFromPool()
+    {
+        Theron::BufferPool bufferPool;
+
+        Check(bufferPool.Acquire(Theron::BufferPool::MAX_BUFFER_SIZE + 1).IsNull(), "Acquired oversized buffer");
+
+        Theron::SharedBuffer buffer(bufferPool.Acquire(100000));
+        Check(!buffer.IsNull() && buffer.GetSize() == 100000, "Acquired buffer has wrong size");
+        Check(THERON_ALIGNED(buffer.GetData(), THERON_CACHELINE_ALIGNMENT), "Acquired buffer not aligned");
+        Check(buffer.IsUnique(), "Acquired buffer shared");
+
+        buffer.GetData()[0] = 7;
+        const Theron::uint64_t bytesReserved(bufferPool.GetBytesReserved());
+
+        {
+            // Sending the buffer shares it, and the handled copies release it.
+            Theron::Framework framework;
+            Theron::Receiver receiver;
+            Replier<Theron::SharedBuffer> replier(framework);
+
+            typedef Theron::Catcher<Theron::SharedBuffer> BufferCatcher;
+            BufferCatcher catcher;
+            receiver.RegisterHandler(&catcher, &BufferCatcher::Push);
+
+            framework.Send(buffer, receiver.GetAddress(), replier.GetAddress());
+            receiver.Wait();
+
+            Theron::SharedBuffer reply;
+            Theron::Address from;
+            catcher.Pop(reply, from);
+
+            Check(reply.GetData() == buffer.GetData() && reply.GetData()[0] == 7, "Buffer copied");
+            Check(!buffer.IsUnique(), "Shared buffer is unique");
+        }
+
+        Check(buffer.IsUnique(), "Buffer not released by messages");
+        Check(bufferPool.GetBuffersAcquired() == 1, "Buffer count wrong");
+
+        // Released buffers are reused.
+        buffer.Release();
+        Check(buffer.IsNull(), "Released buffer not null");
+        Check(bufferPool.GetBuffersAcquired() == 0, "Buffer not returned to pool");
+
+        Theron::SharedBuffer other(bufferPool.Acquire(70000));
+        Check(bufferPool.GetBytesReserved() == bytesReserved, "Buffer not reused");
+    }
+
+    inline static void StreamChunksWithCredit()
+    {
+        Theron::BufferPool bufferPool;
+        Theron::Framework framework;
+        Theron::Receiver receiver;
+
+        typedef Theron::Catcher<Theron::uint32_t> CountCatcher;
+        CountCatcher catcher;
+        receiver.RegisterHandler(&catcher, &CountCatcher::Push);
+
+        StreamConsumer consumer(framework);
+        StreamProducer producer(framework, bufferPool, consumer.GetAddress(), receiver.GetAddress(), 20, 3);
+
+        framework.Send(Theron::uint32_t(0), receiver.GetAddress(), producer.GetAddress());
+        receiver.Wait();
+
+        Theron::uint32_t chunksWritten(0);
+        Theron::Address from;
+        catcher.Pop(chunksWritten, from);
+
+        Check(chunksWritten == 20, "Wrong number of chunks written");
+        Check(consumer.mChunks == 20 && consumer.mEnded, "Stream not consumed");
+        Check(consumer.mErrors == 0, "Chunks corrupted or out of order");
+        Check(producer.mRefused, "Buffer acquired without credit");
+        Check(producer.mMaxBuffers <= 4, "More chunks in flight than the window allows");
+        Check(bufferPool.GetBuffersAcquired() == 0, "Chunk buffers not released");
+    }
+
+    inline static void ConstructEndPoint()
+    {
+        // Should be able to use endpoints even if networking is disabled.
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+    }
+
+    inline static void TieFrameworkToEndPoint()
+    {
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+    }
+
+    inline static void TieActorsToEndPoint()
+    {
+        typedef Replier<int> IntReplier;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+
+        // Create two actors and let them register and deregister themselves with the endPoint.
+        {
+            IntReplier replierOne(framework);
+            IntReplier replierTwo(framework);
+        }
+
+        // And again.
+        {
+            IntReplier replierOne(framework);
+            IntReplier replierTwo(framework);
+        }
+    }
+
+    inline static void TieReceiverstoEndPoint()
+    {
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+
+        // Create two receivers and let them register and deregister themselves with the endPoint.
+        {
+            Theron::Receiver receiverOne(endPoint);
+            Theron::Receiver receiverTwo(endPoint);
+        }
+
+        // And again.
+        {
+            Theron::Receiver receiverOne(endPoint);
+            Theron::Receiver receiverTwo(endPoint);
+        }
+    }
+
+    inline static void NameFrameworkOnConstruction()
+    {
+        typedef Replier<int> IntReplier;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+
+        Theron::Framework::Parameters frameworkParams;
+        Theron::Framework framework(endPoint, "framework", frameworkParams);
+
+        // Register an actor and a receiver to test the name can be used.
+        IntReplier replier(framework);
+        Theron::Receiver receiver(endPoint);
+
+        framework.Send(int(0), receiver.GetAddress(), replier.GetAddress());
+        receiver.Wait();
+    }
+
+    inline static void NameActorOnConstruction()
+    {
+        typedef Replier<int> IntReplier;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+
+        // Register a named actor and a receiver to test the name can be used.
+        IntReplier replier(framework, "replier");
+        Theron::Receiver receiver(endPoint);
+
+        framework.Send(int(0), receiver.GetAddress(), Theron::Address("replier"));
+        receiver.Wait();
+    }
+
+    inline static void NameReceiverOnConstruction()
+    {
+        typedef Replier<int> IntReplier;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+
+        // Register a named actor and a named receiver.
+        IntReplier replier(framework, "replier");
+        Theron::Receiver receiver(endPoint, "receiver");
+
+        framework.Send(int(0), Theron::Address("receiver"), Theron::Address("replier"));
+        receiver.Wait();
+    }
+
+    inline static void SendMessageToLocalActorByName()
+    {
+        typedef Replier<std::string> StringReplier;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+
+        StringReplier replier(framework, "replier");
+        Theron::Receiver receiver(endPoint, "receiver");
+
+        // This tests we can send any copyable message to actors on the same endpoint
+        // by name, even if the message type hasn't been registered.
+        const std::string message("hello world");
+
+        // Send the replier a message by name, and pass the receiver address by name.
+        framework.Send(message, Theron::Address("receiver"), Theron::Address("replier"));
+
+        // Wait for the reply.
+        receiver.Wait();
+    }
+
+    inline static void SendMessagesBetweenLocalFrameworksByName()
+    {
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework frameworkOne(endPoint);
+        Theron::Framework frameworkTwo(endPoint);
+
+        Signaller signallerOne(frameworkOne, "signaller_one");
+        Signaller signallerTwo(frameworkTwo, "signaller_two");
+        Theron::Receiver receiver(endPoint, "receiver");
+
+        // Send one a message telling it to signal two.
+        // One sends the receiver address to two as the signal,
+        // causing two to send one's address to the receiver.
+        Check(frameworkTwo.Send(
+            Theron::Address("signaller_two"),
+            Theron::Address("receiver"),
+            Theron::Address("signaller_one")), "Failed to send message");
+
+        receiver.Wait();
+    }
+
+    inline static void SendMessagesToManyLocalActorsByName()
+    {
+        typedef Replier<int> IntReplier;
+
+        static const int ACTOR_COUNT = 1000;
+
+        Theron::EndPoint endPoint("endpoint", "inproc://endpoint");
+        Theron::Framework framework(endPoint);
+        Theron::Receiver receiver(endPoint, "receiver");
+
+        // Register many similarly named actors, enough to grow the endpoint's name table several times.
+        IntReplier *repliers[ACTOR_COUNT];
+        char name[32];
+
+        for (int index = 0; index < ACTOR_COUNT; ++index)
+        {
+            sprintf(name, "replier.%d", index);
+            repliers[index] = new IntReplier(framework, name);
+        }
+
+        // Destroy every other actor, deregistering its name, and re-register half of them.
+        for (int index = 0; index < ACTOR_COUNT; index += 2)
+        {
+            delete repliers[index];
+            repliers[index] = 0;
+        }
+
+        for (int index = 0; index < ACTOR_COUNT; index += 4)
+        {
+            sprintf(name, "replier.%d", index);
+            repliers[index] = new IntReplier(framework, name);
+        }
+
+        // Every registered actor should still be reachable by name.
+        int expected(0);
+        for (int index = 0; index < ACTOR_COUNT; ++index)
+        {
+            if (repliers[index])
+            {
+                sprintf(name, "replier.%d", index);
+                Check(framework.Send(index, Theron::Address("receiver"), Theron::Address(name)), "Failed to send message");
+                ++expected;
+            }
+        }
+
+        Check(expected == ACTOR_COUNT * 3 / 4, "Unexpected actor count");
+
+        int received(0);
+        while (received < expected)
+        {
+            received += static_cast<int>(receiver.Wait(static_cast<Theron::uint32_t>(expected - received)));
+        }
+
+        for (int index = 0; index < ACTOR_COUNT; ++index)
+        {
+            delete repliers[index];
+        }
+    }
+
+private:
+
+    class TrivialActor : public Theron::Actor
+    {
+    public:
+
+        TrivialActor(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+        }
+    };
+
+    template <class MessageType>
+    class Registrar : public Theron::Actor
+    {
+    public:
+
+        Registrar(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &Registrar::Handler);
+            IsHandlerRegistered(this, &Registrar::Handler);
+            DeregisterHandler(this, &Registrar::Handler);
+            IsHandlerRegistered(this, &Registrar::Handler);
+        }
+
+    private:
+
+        inline void Handler(const MessageType &/*message*/, const Theron::Address /*from*/)
+        {
+        }
+    };
+
+    template <class MessageType>
+    class Replier : public Theron::Actor
+    {
+    public:
+
+        inline explicit Replier(Theron::Framework &framework, const char *const name = 0) : Theron::Actor(framework, name)
+        {
+            RegisterHandler(this, &Replier::Handler);
+        }
+
+    private:
+
+        inline void Handler(const MessageType &message, const Theron::Address from)
+        {
+            Send(message, from);
+        }
+    };
+
+    template <class MessageType>
+    class DefaultReplier : public Theron::Actor
+    {
+    public:
+
+        inline DefaultReplier(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &DefaultReplier::Handler);
+            SetDefaultHandler(this, &DefaultReplier::DefaultHandler);
+        }
+
+    private:
+
+        inline void Handler(const MessageType &message, const Theron::Address from)
+        {
+            Send(message, from);
+        }
+
+        inline void DefaultHandler(const Theron::Address from)
+        {
+            std::string hello("hello");
+            Send(hello, from);
+        }
+    };
+
+    class StringReplier : public Replier<const char *>
+    {
+    public:
+
+        typedef Replier<const char *> Base;
+
+        inline StringReplier(Theron::Framework &framework) : Base(framework)
+        {
+        }
+    };
+
+    class Signaller : public Theron::Actor
+    {
+    public:
+
+        inline Signaller(Theron::Framework &framework, const char *const name = 0) : Theron::Actor(framework, name)
+        {
+            RegisterHandler(this, &Signaller::Signal);
+        }
+
+    private:
+
+        inline void Signal(const Theron::Address &address, const Theron::Address from)
+        {
+            // Send the 'from' address to the address received in the message.
+            Send(from, address);
+        }
+    };
+
+    class Switcher : public Theron::Actor
+    {
+    public:
+
+        inline Switcher(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &Switcher::SayHello);
+        }
+
+    private:
+
+        inline void SayHello(const std::string &/*message*/, const Theron::Address from)
+        {
+            DeregisterHandler(this, &Switcher::SayHello);
+            RegisterHandler(this, &Switcher::SayGoodbye);
+            Send(std::string("hello"), from);
+        }
+
+        inline void SayGoodbye(const std::string &/*message*/, const Theron::Address from)
+        {
+            DeregisterHandler(this, &Switcher::SayGoodbye);
+            RegisterHandler(this, &Switcher::SayHello);
+            Send(std::string("goodbye"), from);
+        }
+    };
+
+    template <class MessageType>
+    class Catcher
+    {
+    public:
+
+        inline Catcher() : mMessage(), mFrom(Theron::Address::Null())
+        {
+        }
+
+        inline void Catch(const MessageType &message, const Theron::Address from)
+        {
+            mMessage = message;
+            mFrom = from;
+        }
+
+        MessageType mMessage;
+        Theron::Address mFrom;
+    };
+
+    class Counter : public Theron::Actor
+    {
+    public:
+
+        inline Counter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
+        {
+            RegisterHandler(this, &Counter::Increment);
+            RegisterHandler(this, &Counter::GetValue);
+        }
+
+    private:
+
+        inline void Increment(const int &message, const Theron::Address /*from*/)
+        {
+            mCount += message;
+        }
+
+        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        {
+            Send(mCount, from);
+        }
+
+        int mCount;
+    };
+
+    class Spinner : public Theron::Actor
+    {
+    public:
+
+        inline Spinner(Theron::Framework &framework) : Theron::Actor(framework), mClient()
+        {
+            RegisterHandler(this, &Spinner::Spin);
+        }
+
+    private:
+
+        inline void Spin(const Theron::uint32_t &count, const Theron::Address from)
+        {
+            // Remember who to tell when the work is done.
+            if (from != GetAddress())
+            {
+                mClient = from;
+            }
+
+            // Burn some processor time, then send the rest of the work back to ourselves.
+            volatile Theron::uint32_t work(0);
+            for (Theron::uint32_t index = 0; index < 10000; ++index)
+            {
+                work = work + index;
+            }
+
+            if (count > 0)
+            {
+                Send(count - 1, GetAddress());
+            }
+            else
+            {
+                Send(count, mClient);
+            }
+        }
+
+        Theron::Address mClient;
+    };
+
+    class TwoHandlerCounter : public Theron::Actor
+    {
+    public:
+
+        inline TwoHandlerCounter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
+        {
+            RegisterHandler(this, &TwoHandlerCounter::IncrementOne);
+            RegisterHandler(this, &TwoHandlerCounter::IncrementTwo);
+            RegisterHandler(this, &TwoHandlerCounter::GetValue);
+        }
+
+    private:
+
+        inline void IncrementOne(const int &message, const Theron::Address /*from*/)
+        {
+            mCount += message;
+        }
+
+        inline void IncrementTwo(const float &/*message*/, const Theron::Address /*from*/)
+        {
+            ++mCount;
+        }
+
+        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        {
+            Send(mCount, from);
+        }
+
+        int mCount;
+    };
+
+    class MultipleHandlerCounter : public Theron::Actor
+    {
+    public:
+
+        inline MultipleHandlerCounter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
+        {
+            RegisterHandler(this, &MultipleHandlerCounter::IncrementOne);
+            RegisterHandler(this, &MultipleHandlerCounter::IncrementTwo);
+            RegisterHandler(this, &MultipleHandlerCounter::GetValue);
+        }
+
+    private:
+
+        inline void IncrementOne(const int &message, const Theron::Address /*from*/)
+        {
+            mCount += message;
+        }
+
+        inline void IncrementTwo(const int &/*message*/, const Theron::Address /*from*/)
+        {
+            ++mCount;
+        }
+
+        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        {
+            Send(mCount, from);
+        }
+
+        int mCount;
+    };
+
+    template <class CountType>
+    class Sequencer : public Theron::Actor
+    {
+    public:
+
+        static const char *GOOD;
+        static const char *BAD;
+
+        inline Sequencer(Theron::Framework &framework) : Theron::Actor(framework), mNextValue(0), mStatus(GOOD)
+        {
+            RegisterHandler(this, &Sequencer::Receive);
+            RegisterHandler(this, &Sequencer::GetValue);
+        }
+
+    private:
+
+        inline void Receive(const CountType &message, const Theron::Address /*from*/)
+        {
+            if (message != mNextValue++)
+            {
+                mStatus = BAD;
+            }
+        }
+
+        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        {
+            Send(mStatus, from);
+        }
+
+        CountType mNextValue;
+        const char *mStatus;
+    };
+
+    class Recursor : public Theron::Actor
+    {
+    public:
+
+        struct Parameters
+        {
+            int mCount;
+        };
+
+        inline Recursor(Theron::Framework &framework, const Parameters &params) : Theron::Actor(framework)
+        {
+            // Recursively create a child actor within the constructor.
+            if (params.mCount > 0)
+            {
+                Parameters childParams;
+                childParams.mCount = params.mCount - 1;
+
+                Theron::Framework &framework(GetFramework());
+                Recursor child(framework, childParams);
+            }
+        }
+    };
+
+    class TailRecursor : public Theron::Actor
+    {
+    public:
+
+        struct Parameters
+        {
+            int mCount;
+        };
+
+        inline TailRecursor(Theron::Framework &framework, const Parameters &params) : Theron::Actor(framework), mCount(params.mCount)
+        {
+        }
+
+        inline ~TailRecursor()
+        {
+            // Recursively create a child actor within the destructor.
+            if (mCount > 0)
+            {
+                Parameters childParams;
+                childParams.mCount = mCount - 1;
+
+                Theron::Framework &framework(GetFramework());
+                TailRecursor child(framework, childParams);
+            }
+        }
+
+    private:
+
+        int mCount;
+    };
+
+    class AutoSender : public Theron::Actor
+    {
+    public:
+
+        typedef Theron::Address Parameters;
+
+        inline AutoSender(Theron::Framework &framework, const Parameters &address) : Theron::Actor(framework)
+        {
+            // Send a message in the actor constructor.
+            Send(0, address);
+
+            // Send using TailSend to check that works too.
+            TailSend(1, address);
+        }
+    };
+
+    class TailSender : public Theron::Actor
+    {
+    public:
+
+        typedef Theron::Address Parameters;
+
+        inline TailSender(Theron::Framework &framework, const Parameters &address) : Theron::Actor(framework), mStoredAddress(address)
+        {
+        }
+
+        inline ~TailSender()
+        {
+            // Send a message in the actor destructor.
+            Send(0, mStoredAddress);
+
+            // Send using TailSend to check that works too.
+            TailSend(1, mStoredAddress);
+        }
+
+        Theron::Address mStoredAddress;
+    };
+
+    class AutoDeregistrar : public Theron::Actor
+    {
+    public:
+
+        inline AutoDeregistrar(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &AutoDeregistrar::HandlerOne);
+            RegisterHandler(this, &AutoDeregistrar::HandlerTwo);
+            DeregisterHandler(this, &AutoDeregistrar::HandlerOne);
+        }
+
+        inline void HandlerOne(const int &/*message*/, const Theron::Address from)
+        {
+            Send(1, from);
+        }
+
+        inline void HandlerTwo(const int &/*message*/, const Theron::Address from)
+        {
+            Send(2, from);
+        }
+    };
+
+    class TailDeregistrar : public Theron::Actor
+    {
+    public:
+
+        inline TailDeregistrar(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &TailDeregistrar::Handler);
+        }
+
+        inline ~TailDeregistrar()
+        {
+            DeregisterHandler(this, &TailDeregistrar::Handler);
+        }
+
+        inline void Handler(const int &/*message*/, const Theron::Address from)
+        {
+            Send(0, from);
+        }
+    };
+
+    class MessageQueueCounter : public Theron::Actor
+    {
+    public:
+
+        inline explicit MessageQueueCounter(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            RegisterHandler(this, &MessageQueueCounter::Handler);
+        }
+
+        inline void Handler(const int &/*message*/, const Theron::Address from)
+        {
+            Send(GetNumQueuedMessages(), from);
+        }
+    };
+
+    class BlindActor : public Theron::Actor
+    {
+    public:
+
+        inline BlindActor(Theron::Framework &framework) : Theron::Actor(framework)
+        {
+            SetDefaultHandler(this, &BlindActor::BlindDefaultHandler);
+        }
+
+    private:
+
+        inline void BlindDefaultHandler(const void *const data, const Theron::uint32_t size, const Theron::Address from)
+        {
+            // We know the message is a uint32_t.
+            const Theron::uint32_t *const p(reinterpret_cast<const Theron::uint32_t *>(data));
+            const Theron::uint32_t value(*p);
+
+            Send(value, from);
+            Send(size, from);
+        }
+    };
+
+    template <class MessageType>
+    class Accumulator
+    {
+    public:
+
+        inline Accumulator() : mMessages()
+        {
+        }
+
+        inline void Catch(const MessageType &message, const Theron::Address /*from*/)
+        {
+            mMessages.push(message);
+        }
+
+        int Size()
+        {
+            return mMessages.size();
+        }
+
+        MessageType Pop()
+        {
+            THERON_ASSERT(mMessages.empty() == false);
+            MessageType message(mMessages.front());
+            mMessages.pop();
+            return message;
+        }
+
+    private:
+
+        std::queue<MessageType> mMessages;
+    };
+
+    class HandlerChecker : public Theron::Actor
+    {
+    public:
+
+        inline HandlerChecker(Theron::Framework &framework) : Theron::Actor(framework)
         {
+            RegisterHandler(this, &HandlerChecker::Check);
         }
 
-        inline void Catch(const MessageType &message, const Theron::Address from)
-        {
-            mMessage = message;
-            mFrom = from;
-        }
+    private:
+
+        inline void Check(const int & /*message*/, const Theron::Address from)
+        {
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+
+            RegisterHandler(this, &HandlerChecker::Dummy);
+
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+
+            DeregisterHandler(this, &HandlerChecker::Dummy);
+
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+
+            DeregisterHandler(this, &HandlerChecker::Check);
+
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+
+            RegisterHandler(this, &HandlerChecker::Dummy);
+            RegisterHandler(this, &HandlerChecker::Check);
+            RegisterHandler(this, &HandlerChecker::Check);
 
-        MessageType mMessage;
-        Theron::Address mFrom;
-    };
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+        
+            DeregisterHandler(this, &HandlerChecker::Check);
 
-    class Counter : public Theron::Actor
-    {
-    public:
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
 
-        inline Counter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
-        {
-            RegisterHandler(this, &Counter::Increment);
-            RegisterHandler(this, &Counter::GetValue);
-        }
+            DeregisterHandler(this, &HandlerChecker::Check);
 
-    private:
+            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
+            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+        }
 
-        inline void Increment(const int &message, const Theron::Address /*from*/)
+        inline void Dummy(const int & message, const Theron::Address from)
         {
-            mCount += message;
+            // We do this just so that Dummy and Unregistered differ, so the compiler won't merge them!
+            Send(message, from);
         }
 
-        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        inline void Unregistered(const int & /*message*/, const Theron::Address /*from*/)
         {
-            Send(mCount, from);
         }
-
-        int mCount;
     };
 
-    class TwoHandlerCounter : public Theron::Actor
+    class Nestor : public Theron::Actor
     {
     public:
 
-        inline TwoHandlerCounter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
+        struct CreateMessage { };
+        struct DestroyMessage { };
+
+        inline Nestor(Theron::Framework &framework) : Theron::Actor(framework)
         {
-            RegisterHandler(this, &TwoHandlerCounter::IncrementOne);
-            RegisterHandler(this, &TwoHandlerCounter::IncrementTwo);
-            RegisterHandler(this, &TwoHandlerCounter::GetValue);
+            RegisterHandler(this, &Nestor::Create);
+            RegisterHandler(this, &Nestor::Destroy);
+            RegisterHandler(this, &Nestor::Receive);
         }
 
     private:
 
-        inline void IncrementOne(const int &message, const Theron::Address /*from*/)
+        typedef Replier<int> ChildActor;
+
+        inline void Create(const CreateMessage & /*message*/, const Theron::Address /*from*/)
         {
-            mCount += message;
+            mChildren.push_back(new ChildActor(GetFramework()));
+            mChildren.push_back(new ChildActor(GetFramework()));
+            mChildren.push_back(new ChildActor(GetFramework()));
+
+            mReplies.push_back(false);
+            mReplies.push_back(false);
+            mReplies.push_back(false);
+
+            Send(0, mChildren[0]->GetAddress());
+            Send(1, mChildren[1]->GetAddress());
+            Send(2, mChildren[2]->GetAddress());
         }
 
-        inline void IncrementTwo(const float &/*message*/, const Theron::Address /*from*/)
+        inline void Destroy(const DestroyMessage & /*message*/, const Theron::Address from)
         {
-            ++mCount;
+            mCaller = from;
+            if (mReplies[0] && mReplies[1] && mReplies[2])
+            {
+                delete mChildren[0];
+                delete mChildren[1];
+                delete mChildren[2];
+
+                mChildren.clear();
+                Send(true, mCaller);
+            }
         }
 
-        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        inline void Receive(const int & message, const Theron::Address /*from*/)
         {
-            Send(mCount, from);
+            mReplies[message] = true;
+
+            if (mCaller != Theron::Address::Null() && mReplies[0] && mReplies[1] && mReplies[2])
+            {
+                delete mChildren[0];
+                delete mChildren[1];
+                delete mChildren[2];
+
+                mChildren.clear();
+                Send(true, mCaller);
+            }
         }
 
-        int mCount;
+        std::vector<Theron::Actor *> mChildren;
+        std::vector<bool> mReplies;
+        Theron::Address mCaller;
     };
 
-    class MultipleHandlerCounter : public Theron::Actor
+    inline static bool AcceptOverBudget(void *const context, const Theron::uint32_t /*usage*/, const Theron::uint32_t /*budget*/)
+    {
+        ++*static_cast<Theron::uint32_t *>(context);
+        return true;
+    }
+
+    class FallbackHandler
     {
     public:
 
-        inline MultipleHandlerCounter(Theron::Framework &framework) : Theron::Actor(framework), mCount(0)
+        inline void Handle(const Theron::Address from)
         {
-            RegisterHandler(this, &MultipleHandlerCounter::IncrementOne);
-            RegisterHandler(this, &MultipleHandlerCounter::IncrementTwo);
-            RegisterHandler(this, &MultipleHandlerCounter::GetValue);
+            mAddress = from;
         }
 
-    private:
+        Theron::Address mAddress;
+    };
 
-        inline void IncrementOne(const int &message, const Theron::Address /*from*/)
-        {
-            mCount += message;
-        }
+    class BlindFallbackHandler
+    {
+    public:
 
-        inline void IncrementTwo(const int &/*message*/, const Theron::Address /*from*/)
+        BlindFallbackHandler() : mData(0), mValue(0), mSize(0)
         {
-            ++mCount;
         }
 
-        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        inline void Handle(const void *const data, const Theron::uint32_t size, const Theron::Address from)
         {
-            Send(mCount, from);
+            mData = data;
+            mValue = *reinterpret_cast<const Theron::uint32_t *>(data);
+            mSize = size;
+            mAddress = from;
         }
 
-        int mCount;
+        const void *mData;
+        Theron::uint32_t mValue;
+        Theron::uint32_t mSize;
+        Theron::Address mAddress;
     };
 
-    template <class CountType>
-    class Sequencer : public Theron::Actor
+    struct Quote
     {
-    public:
+        Theron::uint32_t mKey;
+        Theron::uint32_t mValue;
+    };
 
-        static const char *GOOD;
-        static const char *BAD;
+    class QuoteBoard : public Theron::Actor
+    {
+    public:
 
-        inline Sequencer(Theron::Framework &framework) : Theron::Actor(framework), mNextValue(0), mStatus(GOOD)
+        inline QuoteBoard(Theron::Framework &framework) : Theron::Actor(framework)
         {
-            RegisterHandler(this, &Sequencer::Receive);
-            RegisterHandler(this, &Sequencer::GetValue);
+            ConflateMessages(&Quote::mKey);
+            RegisterHandler(this, &QuoteBoard::Update);
         }
 
     private:
 
-        inline void Receive(const CountType &message, const Theron::Address /*from*/)
-        {
-            if (message != mNextValue++)
-            {
-                mStatus = BAD;
-            }
-        }
-
-        inline void GetValue(const bool &/*message*/, const Theron::Address from)
+        inline void Update(const Quote &quote, const Theron::Address from)
         {
-            Send(mStatus, from);
+            Send(quote.mValue, from);
         }
-
-        CountType mNextValue;
-        const char *mStatus;
     };
 
-    class Recursor : public Theron::Actor
+    struct LiveQuote
     {
-    public:
-
-        struct Parameters
+        inline static int &Count()
         {
-            int mCount;
-        };
+            static int count(0);
+            return count;
+        }
 
-        inline Recursor(Theron::Framework &framework, const Parameters &params) : Theron::Actor(framework)
+        inline static const void *&LastCopy()
         {
-            // Recursively create a child actor within the constructor.
-            if (params.mCount > 0)
-            {
-                Parameters childParams;
-                childParams.mCount = params.mCount - 1;
-
-                Theron::Framework &framework(GetFramework());
-                Recursor child(framework, childParams);
-            }
+            static const void *lastCopy(0);
+            return lastCopy;
         }
-    };
-
-    class TailRecursor : public Theron::Actor
-    {
-    public:
 
-        struct Parameters
+        inline LiveQuote(const Theron::uint32_t key, const Theron::uint32_t value) : mKey(key), mValue(value)
         {
-            int mCount;
-        };
+            ++Count();
+        }
 
-        inline TailRecursor(Theron::Framework &framework, const Parameters &params) : Theron::Actor(framework), mCount(params.mCount)
+        inline LiveQuote(const LiveQuote &other) : mKey(other.mKey), mValue(other.mValue)
         {
+            ++Count();
+            LastCopy() = this;
         }
 
-        inline ~TailRecursor()
+        inline ~LiveQuote()
         {
-            // Recursively create a child actor within the destructor.
-            if (mCount > 0)
-            {
-                Parameters childParams;
-                childParams.mCount = mCount - 1;
-
-                Theron::Framework &framework(GetFramework());
-                TailRecursor child(framework, childParams);
-            }
+            --Count();
         }
 
+        Theron::uint32_t mKey;
+        Theron::uint32_t mValue;
+
     private:
 
-        int mCount;
+        LiveQuote &operator=(const LiveQuote &other);
     };
 
-    class AutoSender : public Theron::Actor
+    class LiveQuoteBoard : public Theron::Actor
     {
     public:
 
-        typedef Theron::Address Parameters;
-
-        inline AutoSender(Theron::Framework &framework, const Parameters &address) : Theron::Actor(framework)
+        inline LiveQuoteBoard(Theron::Framework &framework) : Theron::Actor(framework), mValue(0)
         {
-            // Send a message in the actor constructor.
-            Send(0, address);
-
-            // Send using TailSend to check that works too.
-            TailSend(1, address);
+            ConflateMessages(&LiveQuote::mKey);
+            RegisterHandler(this, &LiveQuoteBoard::Update);
         }
-    };
-
-    class TailSender : public Theron::Actor
-    {
-    public:
 
-        typedef Theron::Address Parameters;
+        const void *mValue;
 
-        inline TailSender(Theron::Framework &framework, const Parameters &address) : Theron::Actor(framework), mStoredAddress(address)
-        {
-        }
+    private:
 
-        inline ~TailSender()
+        inline void Update(const LiveQuote &quote, const Theron::Address from)
         {
-            // Send a message in the actor destructor.
-            Send(0, mStoredAddress);
-
-            // Send using TailSend to check that works too.
-            TailSend(1, mStoredAddress);
+            mValue = &quote;
+            Send(quote.mValue, from);
         }
-
-        Theron::Address mStoredAddress;
     };
 
-    class AutoDeregistrar : public Theron::Actor
+    class Volleyer : public Theron::Actor
     {
     public:
 
-        inline AutoDeregistrar(Theron::Framework &framework) : Theron::Actor(framework)
+        inline Volleyer(Theron::Framework &framework, const Theron::Address client) :
+          Theron::Actor(framework),
+          mClient(client),
+          mPartner()
         {
-            RegisterHandler(this, &AutoDeregistrar::HandlerOne);
-            RegisterHandler(this, &AutoDeregistrar::HandlerTwo);
-            DeregisterHandler(this, &AutoDeregistrar::HandlerOne);
+            RegisterHandler(this, &Volleyer::Volley);
         }
 
-        inline void HandlerOne(const int &/*message*/, const Theron::Address from)
+        inline void SetPartner(const Theron::Address partner)
         {
-            Send(1, from);
+            mPartner = partner;
         }
 
-        inline void HandlerTwo(const int &/*message*/, const Theron::Address from)
+    private:
+
+        inline void Volley(const Theron::uint32_t &count, const Theron::Address /*from*/)
         {
-            Send(2, from);
+            if (count > 0)
+            {
+                Send(count - 1, mPartner);
+            }
+            else
+            {
+                Send(count, mClient);
+            }
         }
+
+        const Theron::Address mClient;
+        Theron::Address mPartner;
     };
 
-    class TailDeregistrar : public Theron::Actor
+    class ScratchSummer : public Theron::Actor
     {
     public:
 
-        inline TailDeregistrar(Theron::Framework &framework) : Theron::Actor(framework)
+        inline ScratchSummer(Theron::Framework &framework) :
+          Theron::Actor(framework),
+          mOutsideAllocator(GetScratchAllocator()),
+          mCount(0)
         {
-            RegisterHandler(this, &TailDeregistrar::Handler);
+            RegisterHandler(this, &ScratchSummer::Sum);
         }
 
-        inline ~TailDeregistrar()
-        {
-            DeregisterHandler(this, &TailDeregistrar::Handler);
-        }
+        Theron::IAllocator *mOutsideAllocator;
+        void *mBlocks[3];
+        Theron::uint32_t mSums[3];
+
+    private:
 
-        inline void Handler(const int &/*message*/, const Theron::Address from)
+        typedef Theron::StlAllocator<Theron::uint32_t> ScratchAllocator;
+        typedef std::vector<Theron::uint32_t, ScratchAllocator> ScratchVector;
+
+        inline void Sum(const Theron::uint32_t &count, const Theron::Address /*from*/)
         {
-            Send(0, from);
+            Theron::IAllocator *const allocator(GetScratchAllocator());
+            mBlocks[mCount] = allocator->Allocate(16);
+
+            // The vector grows through several scratch allocations, which are never freed individually.
+            ScratchVector values((ScratchAllocator(allocator)));
+            for (Theron::uint32_t value = 0; value < count; ++value)
+            {
+                values.push_back(value);
+            }
+
+            Theron::uint32_t sum(0);
+            for (ScratchVector::const_iterator it(values.begin()); it != values.end(); ++it)
+            {
+                sum += *it;
+            }
+
+            mSums[mCount++] = sum;
         }
+
+        Theron::uint32_t mCount;
     };
 
-    class MessageQueueCounter : public Theron::Actor
+    class Recycler : public Theron::Actor
     {
     public:
 
-        inline explicit MessageQueueCounter(Theron::Framework &framework) : Theron::Actor(framework)
+        inline Recycler(Theron::Framework &framework, const bool forward) :
+          Theron::Actor(framework),
+          mForward(forward),
+          mBlock(0)
         {
-            RegisterHandler(this, &MessageQueueCounter::Handler);
+            RegisterHandler(this, &Recycler::Handle);
         }
 
-        inline void Handler(const int &/*message*/, const Theron::Address from)
+        const bool mForward;
+        const void *mBlock;
+        bool mResults[2];
+
+    private:
+
+        inline void Handle(const int &value, const Theron::Address from)
         {
-            Send(GetNumQueuedMessages(), from);
+            mBlock = &value;
+
+            if (mForward)
+            {
+                mResults[0] = Forward(from);
+                mResults[1] = Forward(from);
+            }
+            else
+            {
+                mResults[0] = Reply(value + 1);
+                mResults[1] = Reply(value + 2);
+            }
         }
     };
 
-    class BlindActor : public Theron::Actor
+    struct LargeValue
+    {
+        char mData[THERON_MESSAGE_SLOT_SIZE + 1];
+    };
+
+    class SlotUser : public Theron::Actor
     {
     public:
 
-        inline BlindActor(Theron::Framework &framework) : Theron::Actor(framework)
+        inline SlotUser(Theron::Framework &framework) : Theron::Actor(framework)
         {
-            SetDefaultHandler(this, &BlindActor::BlindDefaultHandler);
+            RegisterHandler(this, &SlotUser::Handle);
         }
 
+        const void *mBlocks[3];
+
     private:
 
-        inline void BlindDefaultHandler(const void *const data, const Theron::uint32_t size, const Theron::Address from)
+        inline void Handle(const int &value, const Theron::Address from)
         {
-            // We know the message is a uint32_t.
-            const Theron::uint32_t *const p(reinterpret_cast<const Theron::uint32_t *>(data));
-            const Theron::uint32_t value(*p);
+            mBlocks[value] = &value;
 
-            Send(value, from);
-            Send(size, from);
+            if (value == 0)
+            {
+                mCaller = from;
+            }
+
+            if (value < 2)
+            {
+                Send(value + 1, GetAddress());
+            }
+            else
+            {
+                Send(value, mCaller);
+            }
         }
+
+        Theron::Address mCaller;
     };
 
-    template <class MessageType>
-    class Accumulator
+    struct LiveValue
     {
-    public:
-
-        inline Accumulator() : mMessages()
+        inline static int &Count()
         {
+            static int count(0);
+            return count;
         }
 
-        inline void Catch(const MessageType &message, const Theron::Address /*from*/)
+        inline void Handle(const LiveValue &/*value*/, const Theron::Address /*from*/)
         {
-            mMessages.push(message);
         }
 
-        int Size()
+        inline LiveValue()
         {
-            return mMessages.size();
+            ++Count();
         }
 
-        MessageType Pop()
+        inline LiveValue(const LiveValue &/*other*/)
         {
-            THERON_ASSERT(mMessages.empty() == false);
-            MessageType message(mMessages.front());
-            mMessages.pop();
-            return message;
+            ++Count();
         }
 
-    private:
-
-        std::queue<MessageType> mMessages;
+        inline ~LiveValue()
+        {
+            --Count();
+        }
     };
 
-    class HandlerChecker : public Theron::Actor
+    class StreamProducer : public Theron::Actor
     {
     public:
 
-        inline HandlerChecker(Theron::Framework &framework) : Theron::Actor(framework)
+        inline StreamProducer(
+            Theron::Framework &framework,
+            Theron::BufferPool &bufferPool,
+            const Theron::Address &consumer,
+            const Theron::Address &caller,
+            const Theron::uint32_t numChunks,
+            const Theron::uint32_t window) :
+          Theron::Actor(framework),
+          mRefused(false),
+          mMaxBuffers(0),
+          mBufferPool(bufferPool),
+          mWriter(*this, bufferPool, consumer, window),
+          mCaller(caller),
+          mNumChunks(numChunks)
         {
-            RegisterHandler(this, &HandlerChecker::Check);
+            RegisterHandler(this, &StreamProducer::Start);
+            RegisterHandler(this, &StreamProducer::Credit);
         }
 
+        bool mRefused;
+        Theron::uint32_t mMaxBuffers;
+
     private:
 
-        inline void Check(const int & /*message*/, const Theron::Address from)
+        inline void Start(const Theron::uint32_t &/*message*/, const Theron::Address /*from*/)
         {
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+            Write();
+        }
 
-            RegisterHandler(this, &HandlerChecker::Dummy);
+        inline void Credit(const Theron::StreamCredit &credit, const Theron::Address /*from*/)
+        {
+            mWriter.Credit(credit);
+            Write();
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+            if (mWriter.IsFinished())
+            {
+                Send(mWriter.GetChunksWritten(), mCaller);
+            }
+        }
 
-            DeregisterHandler(this, &HandlerChecker::Dummy);
+        inline void Write()
+        {
+            while (mWriter.GetChunksWritten() < mNumChunks)
+            {
+                Theron::SharedBuffer chunk(mWriter.Acquire(4096));
+                if (chunk.IsNull())
+                {
+                    mRefused = true;
+                    return;
+                }
+
+                chunk.GetData()[0] = static_cast<char>(mWriter.GetChunksWritten());
+                mWriter.Write(chunk);
+
+                const Theron::uint32_t buffers(mBufferPool.GetBuffersAcquired());
+                mMaxBuffers = buffers > mMaxBuffers ? buffers : mMaxBuffers;
+            }
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+            mWriter.Close();
+        }
 
-            DeregisterHandler(this, &HandlerChecker::Check);
+        Theron::BufferPool &mBufferPool;
+        Theron::StreamWriter mWriter;
+        const Theron::Address mCaller;
+        const Theron::uint32_t mNumChunks;
+    };
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+    class StreamConsumer : public Theron::Actor
+    {
+    public:
 
-            RegisterHandler(this, &HandlerChecker::Dummy);
-            RegisterHandler(this, &HandlerChecker::Check);
-            RegisterHandler(this, &HandlerChecker::Check);
+        inline explicit StreamConsumer(Theron::Framework &framework) :
+          Theron::Actor(framework),
+          mChunks(0),
+          mErrors(0),
+          mEnded(false),
+          mReader(*this, 2)
+        {
+            RegisterHandler(this, &StreamConsumer::Consume);
+        }
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
-        
-            DeregisterHandler(this, &HandlerChecker::Check);
+        Theron::uint32_t mChunks;
+        Theron::uint32_t mErrors;
+        bool mEnded;
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+    private:
 
-            DeregisterHandler(this, &HandlerChecker::Check);
+        inline void Consume(const Theron::StreamChunk &chunk, const Theron::Address from)
+        {
+            if (!chunk.mEnd)
+            {
+                mErrors += (chunk.mBuffer.GetData()[0] != static_cast<char>(mChunks)) ? 1 : 0;
+                ++mChunks;
+            }
 
-            Send(IsHandlerRegistered(this, &HandlerChecker::Check), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Dummy), from);
-            Send(IsHandlerRegistered(this, &HandlerChecker::Unregistered), from);
+            mReader.Consumed(chunk, from);
+            mEnded = mReader.IsEnded();
         }
 
-        inline void Dummy(const int & message, const Theron::Address from)
+        Theron::StreamReader mReader;
+    };
+
+    struct BlockRecorder
+    {
+        inline BlockRecorder() : mCount(0)
         {
-            // We do this just so that Dummy and Unregistered differ, so the compiler won't merge them!
-            Send(message, from);
         }
 
-        inline void Unregistered(const int & /*message*/, const Theron::Address /*from*/)
+        inline void Record(const int &value, const Theron::Address from)
         {
+            mValues[mCount] = value;
+            mFroms[mCount] = from;
+            mBlocks[mCount++] = &value;
         }
+
+        Theron::uint32_t mCount;
+        int mValues[3];
+        Theron::Address mFroms[3];
+        const void *mBlocks[3];
     };
 
-    class Nestor : public Theron::Actor
+    struct CacheUser
     {
-    public:
+        struct CacheTraits
+        {
+            struct THERON_PREALIGN(THERON_CACHELINE_ALIGNMENT) AlignType
+            {
+            } THERON_POSTALIGN(THERON_CACHELINE_ALIGNMENT);
 
-        struct CreateMessage { };
-        struct DestroyMessage { };
+            static const Theron::uint32_t SLAB_SIZE = 1024;
+        };
 
-        inline Nestor(Theron::Framework &framework) : Theron::Actor(framework)
+        typedef Theron::Detail::LockFreeCachingAllocator<CacheTraits> CacheType;
+
+        inline static void EntryPoint(void *const context)
         {
-            RegisterHandler(this, &Nestor::Create);
-            RegisterHandler(this, &Nestor::Destroy);
-            RegisterHandler(this, &Nestor::Receive);
+            static const Theron::uint32_t SIZES[4] = { 8, 40, 200, 3000 };
+
+            CacheUser *const user(reinterpret_cast<CacheUser *>(context));
+            for (Theron::uint32_t index = 0; index < 4000; ++index)
+            {
+                const Theron::uint32_t size(SIZES[index % 4]);
+                unsigned char *const block(static_cast<unsigned char *>(user->mCache->AllocateAligned(size, 8)));
+
+                // Widen the window in which another thread could be handed the same block.
+                memset(block, user->mId, size);
+                Theron::Detail::Utils::YieldToHyperthread();
+
+                if (block[0] != user->mId || block[size - 1] != user->mId)
+                {
+                    user->mCorrupted = true;
+                }
+
+                user->mCache->Free(block, size);
+            }
         }
 
-    private:
+        CacheType *mCache;
+        unsigned char mId;
+        bool mCorrupted;
+    };
 
-        typedef Replier<int> ChildActor;
+    template <class LockType>
+    struct LockedCounter
+    {
+        LockType mLock;
+        Theron::uint32_t mValue;
+    };
 
-        inline void Create(const CreateMessage & /*message*/, const Theron::Address /*from*/)
+    template <class LockType>
+    inline static void LockedCounterEntryPoint(void *const context)
+    {
+        LockedCounter<LockType> *const counter(reinterpret_cast<LockedCounter<LockType> *>(context));
+        for (Theron::uint32_t index = 0; index < 10000; ++index)
         {
-            mChildren.push_back(new ChildActor(GetFramework()));
-            mChildren.push_back(new ChildActor(GetFramework()));
-            mChildren.push_back(new ChildActor(GetFramework()));
+            counter->mLock.Lock();
 
-            mReplies.push_back(false);
-            mReplies.push_back(false);
-            mReplies.push_back(false);
+            // Widen the window between the read and the write to expose any overlap.
+            const Theron::uint32_t value(counter->mValue);
+            Theron::Detail::Utils::YieldToHyperthread();
+            counter->mValue = value + 1;
 
-            Send(0, mChildren[0]->GetAddress());
-            Send(1, mChildren[1]->GetAddress());
-            Send(2, mChildren[2]->GetAddress());
+            counter->mLock.Unlock();
         }
+    }
 
-        inline void Destroy(const DestroyMessage & /*message*/, const Theron::Address from)
-        {
-            mCaller = from;
-            if (mReplies[0] && mReplies[1] && mReplies[2])
-            {
-                delete mChildren[0];
-                delete mChildren[1];
-                delete mChildren[2];
+    template <class LockType>
+    inline static bool ContendLock()
+    {
+        static const Theron::uint32_t NUM_THREADS = 4;
 
-                mChildren.clear();
-                Send(true, mCaller);
-            }
-        }
+        LockedCounter<LockType> counter;
+        counter.mValue = 0;
 
-        inline void Receive(const int & message, const Theron::Address /*from*/)
+        Theron::Detail::Thread threads[NUM_THREADS];
+        for (Theron::uint32_t index = 0; index < NUM_THREADS; ++index)
         {
-            mReplies[message] = true;
-
-            if (mCaller != Theron::Address::Null() && mReplies[0] && mReplies[1] && mReplies[2])
-            {
-                delete mChildren[0];
-                delete mChildren[1];
-                delete mChildren[2];
+            threads[index].Start(LockedCounterEntryPoint<LockType>, &counter);
+        }
 
-                mChildren.clear();
-                Send(true, mCaller);
-            }
+        for (Theron::uint32_t index = 0; index < NUM_THREADS; ++index)
+        {
+            threads[index].Join();
         }
 
-        std::vector<Theron::Actor *> mChildren;
-        std::vector<bool> mReplies;
-        Theron::Address mCaller;
-    };
+        return (counter.mValue == NUM_THREADS * 10000);
+    }
 
-    class FallbackHandler
+    typedef Theron::Detail::Atomic::UInt32 *FlagMessage;
+
+    class FlagWaiter : public Theron::Actor
     {
     public:
 
-        inline void Handle(const Theron::Address from)
+        inline FlagWaiter(Theron::Framework &framework, const bool blocking) : Theron::Actor(framework)
         {
-            mAddress = from;
+            if (blocking)
+            {
+                SetBlocking();
+            }
+
+            RegisterHandler(this, &FlagWaiter::Wait);
         }
 
-        Theron::Address mAddress;
+    private:
+
+        inline void Wait(const FlagMessage &flag, const Theron::Address from)
+        {
+            // Block for up to about two seconds waiting for another actor to set the flag.
+            for (Theron::uint32_t count = 0; count < 200 && flag->Load() == 0; ++count)
+            {
+                Theron::Detail::Utils::SleepThread(10);
+            }
+
+            Send(flag->Load(), from);
+        }
     };
 
-    class BlindFallbackHandler
+    class FlagSetter : public Theron::Actor
     {
     public:
 
-        BlindFallbackHandler() : mData(0), mValue(0), mSize(0)
+        inline explicit FlagSetter(Theron::Framework &framework) : Theron::Actor(framework)
         {
+            RegisterHandler(this, &FlagSetter::Set);
         }
 
-        inline void Handle(const void *const data, const Theron::uint32_t size, const Theron::Address from)
+    private:
+
+        inline void Set(const FlagMessage &flag, const Theron::Address /*from*/)
         {
-            mData = data;
-            mValue = *reinterpret_cast<const Theron::uint32_t *>(data);
-            mSize = size;
-            mAddress = from;
+            flag->Store(1);
         }
-
-        const void *mData;
-        Theron::uint32_t mValue;
-        Theron::uint32_t mSize;
-        Theron::Address mAddress;
     };
 
+    inline static bool WaitForFlagSetter(const bool blocking)
+    {
+        typedef Catcher<Theron::uint32_t> FlagCatcher;
+
+        Theron::Detail::Atomic::UInt32 flag(0);
+
+        Theron::Framework::Parameters params(1);
+        Theron::Framework framework(params);
+        FlagWaiter waiter(framework, blocking);
+        FlagSetter setter(framework);
+
+        Theron::Receiver receiver;
+        FlagCatcher catcher;
+        receiver.RegisterHandler(&catcher, &FlagCatcher::Catch);
+
+        framework.Send(FlagMessage(&flag), receiver.GetAddress(), waiter.GetAddress());
+        framework.Send(FlagMessage(&flag), receiver.GetAddress(), setter.GetAddress());
+
+        receiver.Wait();
+        return (catcher.mMessage == 1);
+    }
+
+public:
+
     typedef std::vector<Theron::uint32_t> IntVectorMessage;
 
+private:
+
     class SomeOtherBaseclass
     {
     public:
@@ -2104,6 +3672,40 @@ private:
 
         const Theron::Address mNext;
     };
+
+#if THERON_EPOLL
+
+    class PipeReader : public Theron::Actor
+    {
+    public:
+
+        inline PipeReader(Theron::Framework &framework, const int descriptor, const Theron::Address client) :
+          Theron::Actor(framework),
+          mDescriptor(descriptor),
+          mClient(client)
+        {
+            RegisterHandler(this, &PipeReader::Handler);
+        }
+
+    private:
+
+        inline void Handler(const Theron::DescriptorReady &ready, const Theron::Address /*from*/)
+        {
+            char byte(0);
+            if (read(mDescriptor, &byte, 1) == 1)
+            {
+                Send(ready, mClient);
+            }
+
+            GetFramework().WatchDescriptor(GetAddress(), mDescriptor, Theron::DescriptorReady::READABLE, ready.mTag);
+        }
+
+        const int mDescriptor;
+        const Theron::Address mClient;
+    };
+
+#endif // THERON_EPOLL
+
 };
 
 
@@ -15,6 +15,7 @@ Actor::Actor(Framework &framework, const char *const name) :
   mMessageHandlers(),
   mDefaultHandlers(),
   mMailboxContext(0),
+  mConflaters(),
   mMemory(0)
 {
     // Claim an available directory index and mailbox for this actor.
@@ -25,6 +26,22 @@ Actor::Actor(Framework &framework, const char *const name) :
 Actor::~Actor()
 {
     mFramework->DeregisterActor(this);
+
+    // The mailbox no longer refers to the conflaters, so they can be freed.
+    IAllocator *const allocator(AllocatorManager::GetCache());
+    while (Detail::IConflater *const conflater = mConflaters.Front())
+    {
+        mConflaters.Remove(conflater);
+
+        conflater->~IConflater();
+        allocator->Free(conflater);
+    }
+}
+
+
+void Actor::SetBlocking(const bool blocking)
+{
+    mFramework->SetActorBlocking(this, blocking);
 }
 
 
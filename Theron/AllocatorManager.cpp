@@ -17,7 +17,10 @@ void AllocatorManager::SetAllocator(IAllocator *const allocator)
     // This method should only be called once, at start of day.
     THERON_ASSERT_MSG(smDefaultAllocator.GetBytesAllocated() == 0, "SetAllocator can't be called while Theron objects are alive");
 
+    // Return any cached blocks to the allocator they came from, before it's replaced.
     // We don't bother to make this thread-safe because it should only be called at start-of-day.
+    smCache.Clear();
+
     if (allocator)
     {
         smCache.SetAllocator(allocator);
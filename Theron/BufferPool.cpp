@@ -0,0 +1,187 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <new>
+
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/BufferPool.h>
+#include <Theron/Defines.h>
+
+
+namespace Theron
+{
+
+
+BufferPool::BufferPool(IAllocator *const allocator) :
+  mAllocator(allocator ? allocator : AllocatorManager::GetAllocator()),
+  mSpinLock(),
+  mSlabs(0),
+  mBuffersAcquired(0),
+  mBytesReserved(0)
+{
+    for (uint32_t sizeClass = 0; sizeClass < NUM_CLASSES; ++sizeClass)
+    {
+        mFreeBlocks[sizeClass] = 0;
+    }
+}
+
+
+BufferPool::~BufferPool()
+{
+    THERON_ASSERT_MSG(mBuffersAcquired == 0, "BufferPool destroyed while buffers are still acquired");
+
+    while (Slab *const slab = mSlabs)
+    {
+        mSlabs = slab->mNext;
+
+        Block *const blocks(reinterpret_cast<Block *>(slab + 1));
+        for (uint32_t index = 0; index < slab->mNumBlocks; ++index)
+        {
+            blocks[index].~Block();
+        }
+
+        mAllocator->Free(slab->mData, slab->mDataSize);
+        mAllocator->Free(slab, static_cast<uint32_t>(sizeof(Slab) + slab->mNumBlocks * sizeof(Block)));
+    }
+}
+
+
+SharedBuffer BufferPool::Acquire(const uint32_t size)
+{
+    if (size > MAX_BUFFER_SIZE)
+    {
+        return SharedBuffer();
+    }
+
+    uint32_t sizeClass(0);
+    while ((MIN_BUFFER_SIZE << sizeClass) < size)
+    {
+        ++sizeClass;
+    }
+
+    mSpinLock.Lock();
+
+    Block *block(mFreeBlocks[sizeClass]);
+    if (block)
+    {
+        mFreeBlocks[sizeClass] = block->mNext;
+        ++mBuffersAcquired;
+    }
+
+    mSpinLock.Unlock();
+
+    // Allocate a new slab, outside the lock, if there are no free buffers of the size class.
+    if (block == 0)
+    {
+        block = AllocateSlab(sizeClass);
+        if (block == 0)
+        {
+            return SharedBuffer();
+        }
+    }
+
+    block->mNext = 0;
+    block->mSize = size;
+    block->mRefCount.Store(1);
+
+    return SharedBuffer(block);
+}
+
+
+uint32_t BufferPool::GetBuffersAcquired() const
+{
+    mSpinLock.Lock();
+    const uint32_t buffersAcquired(mBuffersAcquired);
+    mSpinLock.Unlock();
+
+    return buffersAcquired;
+}
+
+
+uint64_t BufferPool::GetBytesReserved() const
+{
+    mSpinLock.Lock();
+    const uint64_t bytesReserved(mBytesReserved);
+    mSpinLock.Unlock();
+
+    return bytesReserved;
+}
+
+
+BufferPool::Block *BufferPool::AllocateSlab(const uint32_t sizeClass)
+{
+    // Buffers up to the slab size are carved from a shared slab, and larger ones get a slab of their own.
+    const uint32_t bufferSize(MIN_BUFFER_SIZE << sizeClass);
+    const uint32_t dataSize(bufferSize > SLAB_SIZE ? bufferSize : SLAB_SIZE);
+    const uint32_t numBlocks(dataSize / bufferSize);
+
+    char *const data(reinterpret_cast<char *>(mAllocator->AllocateAligned(dataSize, THERON_CACHELINE_ALIGNMENT)));
+    if (data == 0)
+    {
+        return 0;
+    }
+
+    const uint32_t slabSize(static_cast<uint32_t>(sizeof(Slab) + numBlocks * sizeof(Block)));
+    Slab *const slab(reinterpret_cast<Slab *>(mAllocator->AllocateAligned(slabSize, THERON_CACHELINE_ALIGNMENT)));
+    if (slab == 0)
+    {
+        mAllocator->Free(data, dataSize);
+        return 0;
+    }
+
+    slab->mData = data;
+    slab->mDataSize = dataSize;
+    slab->mNumBlocks = numBlocks;
+
+    // The control blocks follow the slab header.
+    Block *const blocks(reinterpret_cast<Block *>(slab + 1));
+    for (uint32_t index = 0; index < numBlocks; ++index)
+    {
+        new (blocks + index) Block(this, data + index * bufferSize, sizeClass);
+    }
+
+    // Keep the first buffer for the caller and make the rest available.
+    for (uint32_t index = 1; index < numBlocks; ++index)
+    {
+        blocks[index].mNext = (index + 1 < numBlocks) ? blocks + index + 1 : 0;
+    }
+
+    mSpinLock.Lock();
+
+    slab->mNext = mSlabs;
+    mSlabs = slab;
+    mBytesReserved += dataSize;
+    ++mBuffersAcquired;
+
+    if (numBlocks > 1)
+    {
+        blocks[numBlocks - 1].mNext = mFreeBlocks[sizeClass];
+        mFreeBlocks[sizeClass] = blocks + 1;
+    }
+
+    mSpinLock.Unlock();
+
+    return blocks;
+}
+
+
+void BufferPool::Return(Block *const block)
+{
+    THERON_ASSERT(block->mPool == this);
+    THERON_ASSERT(block->mSizeClass < NUM_CLASSES);
+
+    mSpinLock.Lock();
+
+    block->mNext = mFreeBlocks[block->mSizeClass];
+    mFreeBlocks[block->mSizeClass] = block;
+
+    THERON_ASSERT(mBuffersAcquired > 0);
+    --mBuffersAcquired;
+
+    mSpinLock.Unlock();
+}
+
+
+} // namespace Theron
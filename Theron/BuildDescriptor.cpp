@@ -73,6 +73,11 @@ THERON_NOINLINE void BuildDescriptor::GenerateInLibrary(char *const identifier)
         strcat(identifier, ".posix");
     }
 
+    if (THERON_FUTEX)
+    {
+        strcat(identifier, ".futex");
+    }
+
     if (THERON_NUMA)
     {
         strcat(identifier, ".numa");
@@ -102,6 +107,11 @@ THERON_NOINLINE void BuildDescriptor::GenerateInLibrary(char *const identifier)
     {
         strcat(identifier, ".build");
     }
+
+    if (THERON_ENABLE_PERF_COUNTERS)
+    {
+        strcat(identifier, ".perf");
+    }
 }
 
 
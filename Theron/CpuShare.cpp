@@ -0,0 +1,250 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Scheduler/CpuShare.h>
+#include <Theron/Detail/Threading/Lock.h>
+#include <Theron/Detail/Threading/Utils.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+CpuShare::Registry *CpuShare::smRegistry = 0;
+Mutex CpuShare::smReferenceMutex;
+uint32_t CpuShare::smReferenceCount = 0;
+
+
+CpuShare::CpuShare(const uint32_t weight, const uint32_t nodeMask, const uint32_t processorMask) :
+  mWeight(weight),
+  mNodeMask(nodeMask),
+  mProcessorMask(processorMask),
+  mChargeTicks(Clock::GetFrequency() * CHARGE_MICROSECONDS / 1000000),
+  mCheckTicks(Clock::GetFrequency() * CHECK_MICROSECONDS / 1000000),
+  mUsage(0),
+  mHeldUp(0),
+  mLastUsage(0),
+  mLastHeldUp(0),
+  mRegistered(false)
+{
+}
+
+
+void CpuShare::Register()
+{
+    THERON_ASSERT(mWeight != 0);
+    THERON_ASSERT(!mRegistered);
+
+    Reference();
+
+    Lock lock(smRegistry->mLock);
+
+    UpdateWindow(GetWindow(Clock::GetTicks()));
+
+    smRegistry->mShares.Insert(this);
+    mRegistered = true;
+}
+
+
+void CpuShare::Deregister()
+{
+    if (mRegistered)
+    {
+        {
+            Lock lock(smRegistry->mLock);
+
+            smRegistry->mShares.Remove(this);
+            mRegistered = false;
+        }
+
+        Dereference();
+    }
+}
+
+
+void CpuShare::Charge(Slice *const slice, const uint64_t now)
+{
+    const uint64_t handlerTime(slice->mPending * 1000000 / Clock::GetFrequency());
+    slice->mPending = 0;
+
+    uint64_t threadTime(0);
+    uint32_t preemptions(0);
+    const bool known(Utils::GetThreadUsage(threadTime, preemptions));
+
+    // Prefer the processor time used by the thread, which excludes time it was kept off the
+    // processor. The thread's time is unknown on its first charge, and restarts if it's restarted.
+    uint64_t usage(handlerTime);
+    uint64_t heldUp(0);
+
+    if (known && slice->mThreadTime != 0 && threadTime > slice->mThreadTime)
+    {
+        usage = threadTime - slice->mThreadTime;
+
+        // Handler time in which the thread wasn't running counts as held up, provided it was
+        // preempted, where that's known, rather than say descheduled by a hypervisor.
+        if (handlerTime > usage && (preemptions != slice->mPreemptions || preemptions == 0))
+        {
+            heldUp = handlerTime - usage;
+        }
+    }
+
+    slice->mThreadTime = threadTime;
+    slice->mPreemptions = preemptions;
+
+    mUsage.AddRelaxed(static_cast<uint32_t>(usage));
+    mHeldUp.AddRelaxed(static_cast<uint32_t>(heldUp));
+
+    // Usage is compared at most once a millisecond per thread, to keep the registry lock uncontended.
+    const uint32_t window(GetWindow(now));
+    if (now < slice->mCheck && window == smRegistry->mWindow.LoadRelaxed())
+    {
+        return;
+    }
+
+    slice->mCheck = now + mCheckTicks;
+
+    Lock lock(smRegistry->mLock);
+    UpdateWindow(window);
+
+    while (OverShare())
+    {
+        // Give up the processor so the framework being held up can catch up.
+        lock.Unlock();
+
+        Utils::SleepThread(THROTTLE_MILLISECONDS);
+
+        lock.Relock();
+        UpdateWindow(GetWindow(Clock::GetTicks()));
+    }
+}
+
+
+bool CpuShare::OverShare() const
+{
+    const uint64_t usage(GetWeightedUsage());
+    const uint64_t margin(static_cast<uint64_t>(MARGIN_MICROSECONDS) * 1024 / mWeight);
+
+    List<CpuShare>::Iterator shares(smRegistry->mShares.GetIterator());
+    while (shares.Next())
+    {
+        const CpuShare *const share(shares.Get());
+        if (share == this)
+        {
+            continue;
+        }
+
+        // Only frameworks whose worker threads can run on the same processors compete.
+        if ((share->mNodeMask & mNodeMask) == 0 || (share->mProcessorMask & mProcessorMask) == 0)
+        {
+            continue;
+        }
+
+        // Only frameworks whose threads spend a significant part of their time held up compete.
+        // Others are idle, or get all the processor time they can use.
+        const uint64_t shareUsage(static_cast<uint64_t>(share->mLastUsage) + share->mUsage.LoadRelaxed());
+        const uint64_t shareHeldUp(static_cast<uint64_t>(share->mLastHeldUp) + share->mHeldUp.LoadRelaxed());
+
+        if (shareHeldUp * 100 < (shareUsage + shareHeldUp) * HELD_UP_PERCENT)
+        {
+            continue;
+        }
+
+        if (usage > share->GetWeightedUsage() + margin)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+uint64_t CpuShare::GetWeightedUsage() const
+{
+    const uint64_t usage(static_cast<uint64_t>(mLastUsage) + mUsage.LoadRelaxed());
+    return usage * 1024 / mWeight;
+}
+
+
+void CpuShare::UpdateWindow(const uint32_t window)
+{
+    const uint32_t previous(smRegistry->mWindow.LoadRelaxed());
+    if (window == previous)
+    {
+        return;
+    }
+
+    // Move the counts of the ended window to the previous window, unless it ended long ago.
+    List<CpuShare>::Iterator shares(smRegistry->mShares.GetIterator());
+    while (shares.Next())
+    {
+        CpuShare *const share(shares.Get());
+
+        const uint32_t usage(Take(share->mUsage));
+        const uint32_t heldUp(Take(share->mHeldUp));
+
+        share->mLastUsage = (window - previous == 1) ? usage : 0;
+        share->mLastHeldUp = (window - previous == 1) ? heldUp : 0;
+    }
+
+    smRegistry->mWindow.StoreRelaxed(window);
+}
+
+
+void CpuShare::Reference()
+{
+    Lock lock(smReferenceMutex);
+
+    // Create the registry on first use, rather than relying on the order of static initialization.
+    if (smReferenceCount++ == 0)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+        void *const memory(allocator->AllocateAligned(sizeof(Registry), THERON_CACHELINE_ALIGNMENT));
+        smRegistry = new (memory) Registry();
+    }
+}
+
+
+void CpuShare::Dereference()
+{
+    Lock lock(smReferenceMutex);
+
+    // Destroy the registry once the last share has been deregistered.
+    if (--smReferenceCount == 0)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+        smRegistry->~Registry();
+        allocator->Free(smRegistry, sizeof(Registry));
+        smRegistry = 0;
+    }
+}
+
+
+uint32_t CpuShare::Take(Atomic::UInt32 &count)
+{
+    uint32_t value(count.LoadRelaxed());
+    while (!count.CompareExchangeRelaxed(value, 0))
+    {
+    }
+
+    return value;
+}
+
+
+uint32_t CpuShare::GetWindow(const uint64_t ticks)
+{
+    const uint64_t ticksPerWindow(Clock::GetFrequency() * WINDOW_MILLISECONDS / 1000);
+    return static_cast<uint32_t>(ticks / ticksPerWindow);
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
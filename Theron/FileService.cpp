@@ -0,0 +1,703 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <new>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/Defines.h>
+#include <Theron/EndPoint.h>
+#include <Theron/FileResult.h>
+#include <Theron/Framework.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/IO/FileService.h>
+#include <Theron/Detail/Threading/Lock.h>
+
+
+#if THERON_WINDOWS
+
+#include <share.h>
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if THERON_IO_URING
+#include <sys/eventfd.h>
+#endif // THERON_IO_URING
+
+#endif
+
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning (disable:4996)  // function or variable may be unsafe.
+#endif //_MSC_VER
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+FileService::FileService(
+    Framework *const framework,
+    const uint32_t threadCount,
+    const uint32_t bufferSize,
+    const uint32_t queueDepth) :
+  mFramework(framework),
+  mThreadCount(threadCount == 0 ? 1 : (threadCount > MAX_THREADS ? MAX_THREADS : threadCount)),
+  mBufferSize(bufferSize),
+  mQueueDepth(queueDepth < 2 ? 2 : queueDepth),
+  mUsingIoUring(false),
+  mCondition(),
+  mPending(),
+  mStopping(false),
+  mBufferLock(),
+  mFreeBuffers(0),
+  mStartedThreads(0)
+#if THERON_IO_URING
+  , mRing(),
+  mWakeDescriptor(-1),
+  mWakeValue(0),
+  mWakePending(false),
+  mActive(0)
+#endif // THERON_IO_URING
+{
+}
+
+
+FileService::~FileService()
+{
+    THERON_ASSERT(mStartedThreads == 0);
+    THERON_ASSERT(mFreeBuffers == 0);
+}
+
+
+void FileService::Initialize()
+{
+    mStopping = false;
+
+#if THERON_IO_URING
+
+    // Prefer io_uring, falling back to the thread pool if the kernel doesn't support it.
+    if (StartRing())
+    {
+        mUsingIoUring = true;
+        return;
+    }
+
+#endif // THERON_IO_URING
+
+    mUsingIoUring = false;
+
+    while (mStartedThreads < mThreadCount)
+    {
+        if (!mThreads[mStartedThreads].Start(PoolThreadEntryPoint, this))
+        {
+            break;
+        }
+
+        ++mStartedThreads;
+    }
+
+    THERON_ASSERT_MSG(mStartedThreads > 0, "Failed to start file service threads");
+}
+
+
+void FileService::Release()
+{
+    {
+        Lock lock(mCondition.GetMutex());
+        mStopping = true;
+    }
+
+    // The threads complete all of the outstanding requests before exiting.
+#if THERON_IO_URING
+
+    if (mUsingIoUring)
+    {
+        WakeRing();
+    }
+
+#endif // THERON_IO_URING
+
+    mCondition.PulseAll();
+
+    while (mStartedThreads)
+    {
+        mThreads[--mStartedThreads].Join();
+    }
+
+#if THERON_IO_URING
+
+    if (mUsingIoUring)
+    {
+        // Closing the ring cancels the read from the eventfd that's still in flight.
+        mRing.Release();
+        close(mWakeDescriptor);
+        mWakeDescriptor = -1;
+    }
+
+#endif // THERON_IO_URING
+
+    // Free the pooled buffers. Any still held by actors should have been freed by now.
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    Lock lock(mBufferLock);
+
+    while (mFreeBuffers)
+    {
+        void *const buffer(mFreeBuffers);
+        mFreeBuffers = *reinterpret_cast<void **>(buffer);
+        allocator->Free(buffer, mBufferSize);
+    }
+}
+
+
+bool FileService::Read(
+    const Address &client,
+    const char *const fileName,
+    const uint32_t tag,
+    const uint64_t offset)
+{
+    void *const buffer(AllocateBuffer());
+    if (buffer == 0)
+    {
+        return false;
+    }
+
+    Request *const request(CreateRequest(client, fileName));
+    if (request == 0)
+    {
+        FreeBuffer(buffer);
+        return false;
+    }
+
+    request->mOperation = Request::OPERATION_READ;
+    request->mOffset = offset;
+    request->mBuffer = buffer;
+    request->mSize = mBufferSize;
+    request->mTag = tag;
+
+    Enqueue(request);
+    return true;
+}
+
+
+bool FileService::Write(
+    const Address &client,
+    const char *const fileName,
+    void *const buffer,
+    const uint32_t size,
+    const uint32_t tag,
+    const uint64_t offset)
+{
+    THERON_ASSERT(buffer);
+    THERON_ASSERT(size <= mBufferSize);
+
+    Request *const request(CreateRequest(client, fileName));
+    if (request == 0)
+    {
+        return false;
+    }
+
+    request->mOperation = Request::OPERATION_WRITE;
+    request->mOffset = offset;
+    request->mBuffer = buffer;
+    request->mSize = size;
+    request->mTag = tag;
+
+    Enqueue(request);
+    return true;
+}
+
+
+void *FileService::AllocateBuffer()
+{
+    {
+        Lock lock(mBufferLock);
+
+        if (void *const buffer = mFreeBuffers)
+        {
+            mFreeBuffers = *reinterpret_cast<void **>(buffer);
+            return buffer;
+        }
+    }
+
+    IAllocator *const allocator(AllocatorManager::GetCache());
+    return allocator->AllocateAligned(mBufferSize, THERON_CACHELINE_ALIGNMENT);
+}
+
+
+void FileService::FreeBuffer(void *const buffer)
+{
+    THERON_ASSERT(buffer);
+
+    Lock lock(mBufferLock);
+
+    *reinterpret_cast<void **>(buffer) = mFreeBuffers;
+    mFreeBuffers = buffer;
+}
+
+
+void FileService::PoolThreadEntryPoint(void *const context)
+{
+    static_cast<FileService *>(context)->RunPool();
+}
+
+
+FileService::Request *FileService::CreateRequest(const Address &client, const char *const fileName)
+{
+    THERON_ASSERT(fileName);
+
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    // The file name is copied, so the caller's copy needn't outlive the request.
+    // Allocations are rounded up to a multiple of four bytes.
+    const uint32_t nameLength(static_cast<uint32_t>(strlen(fileName)) + 1);
+    const uint32_t nameSize((nameLength + 3) & ~3U);
+    char *const name(static_cast<char *>(allocator->Allocate(nameSize)));
+    if (name == 0)
+    {
+        return 0;
+    }
+
+    void *const memory(allocator->Allocate(sizeof(Request)));
+    if (memory == 0)
+    {
+        allocator->Free(name, nameSize);
+        return 0;
+    }
+
+    memcpy(name, fileName, nameLength);
+
+    Request *const request(new (memory) Request());
+    request->mClient = client;
+    request->mFileName = name;
+
+    return request;
+}
+
+
+void FileService::DestroyRequest(Request *const request)
+{
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    const uint32_t nameLength(static_cast<uint32_t>(strlen(request->mFileName)) + 1);
+    allocator->Free(request->mFileName, (nameLength + 3) & ~3U);
+
+    request->~Request();
+    allocator->Free(request, sizeof(Request));
+}
+
+
+void FileService::Enqueue(Request *const request)
+{
+    bool wakeRing(false);
+
+    {
+        Lock lock(mCondition.GetMutex());
+        mPending.Push(request);
+
+#if THERON_IO_URING
+
+        // Only signal the ring thread once until it has seen the signal.
+        if (mUsingIoUring && !mWakePending)
+        {
+            mWakePending = true;
+            wakeRing = true;
+        }
+
+#endif // THERON_IO_URING
+
+    }
+
+#if THERON_IO_URING
+
+    if (mUsingIoUring)
+    {
+        if (wakeRing)
+        {
+            WakeRing();
+        }
+
+        return;
+    }
+
+#endif // THERON_IO_URING
+
+    (void) wakeRing;
+    mCondition.Pulse();
+}
+
+
+void FileService::Complete(Request *const request)
+{
+    const FileResult result(
+        request->mTag,
+        request->mBuffer,
+        request->mTransferred,
+        request->mError);
+
+    // Ownership of the buffer passes to the recipient, unless it no longer exists.
+    if (!mFramework->Send(result, Address::Null(), request->mClient))
+    {
+        FreeBuffer(request->mBuffer);
+    }
+
+    request->mBuffer = 0;
+}
+
+
+void FileService::RunPool()
+{
+    Lock lock(mCondition.GetMutex());
+
+    while (true)
+    {
+        while (mPending.Empty() && !mStopping)
+        {
+            mCondition.Wait(lock);
+        }
+
+        if (mPending.Empty())
+        {
+            break;
+        }
+
+        Request *const request(mPending.Pop());
+
+        lock.Unlock();
+
+        Transfer(request);
+        Complete(request);
+        DestroyRequest(request);
+
+        lock.Relock();
+    }
+}
+
+
+void FileService::Transfer(Request *const request)
+{
+    request->mTransferred = 0;
+    request->mError = 0;
+
+#if THERON_WINDOWS
+
+    // The standard library file functions are the most portable choice.
+    const bool reading(request->mOperation == Request::OPERATION_READ);
+    FILE *handle(fopen(request->mFileName, reading ? "rb" : "r+b"));
+
+    if (handle == 0 && !reading)
+    {
+        handle = fopen(request->mFileName, "wb");
+    }
+
+    if (handle == 0)
+    {
+        request->mError = static_cast<uint32_t>(errno);
+        return;
+    }
+
+    if (_fseeki64(handle, static_cast<__int64>(request->mOffset), SEEK_SET) != 0)
+    {
+        request->mError = static_cast<uint32_t>(errno);
+    }
+    else if (reading)
+    {
+        request->mTransferred = static_cast<uint32_t>(fread(request->mBuffer, 1, request->mSize, handle));
+    }
+    else
+    {
+        request->mTransferred = static_cast<uint32_t>(fwrite(request->mBuffer, 1, request->mSize, handle));
+        if (request->mTransferred < request->mSize)
+        {
+            request->mError = static_cast<uint32_t>(errno);
+        }
+    }
+
+    fclose(handle);
+
+#else
+
+    const bool reading(request->mOperation == Request::OPERATION_READ);
+    const int flags(reading ? O_RDONLY : (O_WRONLY | O_CREAT));
+
+    const int fileDescriptor(open(request->mFileName, flags, 0644));
+    if (fileDescriptor < 0)
+    {
+        request->mError = static_cast<uint32_t>(errno);
+        return;
+    }
+
+    const off_t offset(static_cast<off_t>(request->mOffset));
+    const ssize_t transferred(reading ?
+        pread(fileDescriptor, request->mBuffer, request->mSize, offset) :
+        pwrite(fileDescriptor, request->mBuffer, request->mSize, offset));
+
+    if (transferred < 0)
+    {
+        request->mError = static_cast<uint32_t>(errno);
+    }
+    else
+    {
+        request->mTransferred = static_cast<uint32_t>(transferred);
+    }
+
+    close(fileDescriptor);
+
+#endif
+}
+
+
+#if THERON_IO_URING
+
+
+void FileService::RingThreadEntryPoint(void *const context)
+{
+    static_cast<FileService *>(context)->RunRing();
+}
+
+
+bool FileService::StartRing()
+{
+    const uint8_t opcodes[] =
+    {
+        IORING_OP_OPENAT,
+        IORING_OP_READ,
+        IORING_OP_WRITE,
+        IORING_OP_CLOSE
+    };
+
+    mWakeDescriptor = eventfd(0, EFD_CLOEXEC);
+    if (mWakeDescriptor < 0)
+    {
+        return false;
+    }
+
+    // Each request has at most two operations in flight, and the read from the eventfd takes one more.
+    if (mRing.Initialize(mQueueDepth * 2 + 1, opcodes, sizeof(opcodes) / sizeof(opcodes[0])))
+    {
+        mActive = 0;
+        mWakePending = false;
+
+        if (mThreads[0].Start(RingThreadEntryPoint, this))
+        {
+            mStartedThreads = 1;
+            return true;
+        }
+
+        mRing.Release();
+    }
+
+    close(mWakeDescriptor);
+    mWakeDescriptor = -1;
+
+    return false;
+}
+
+
+void FileService::RunRing()
+{
+    RequestQueue starting;
+
+    ArmWake();
+
+    while (true)
+    {
+        bool stopped(false);
+
+        {
+            Lock lock(mCondition.GetMutex());
+
+            // Take as many new requests as there's room for in the ring.
+            while (mActive < mQueueDepth && !mPending.Empty())
+            {
+                starting.Push(mPending.Pop());
+                ++mActive;
+            }
+
+            stopped = (mStopping && mActive == 0 && mPending.Empty());
+        }
+
+        if (stopped)
+        {
+            break;
+        }
+
+        while (!starting.Empty())
+        {
+            StartOperation(starting.Pop());
+        }
+
+        // Submit the new operations and wait for at least one to complete.
+        const bool submitted(mRing.Submit(true));
+        THERON_ASSERT_MSG(submitted, "io_uring_enter failed");
+        (void) submitted;
+
+        while (io_uring_cqe *const completion = mRing.PeekCompletion())
+        {
+            // The low bit of the user data distinguishes the close of a request from its other operations.
+            const uintptr_t userData(static_cast<uintptr_t>(completion->user_data));
+            Request *const request(reinterpret_cast<Request *>(userData & ~static_cast<uintptr_t>(1)));
+            const bool closed((userData & 1) != 0);
+            const int32_t result(completion->res);
+
+            mRing.ConsumeCompletion();
+
+            if (request == 0)
+            {
+                // New requests were signalled; listen for the next signal.
+                {
+                    Lock lock(mCondition.GetMutex());
+                    mWakePending = false;
+                }
+
+                ArmWake();
+                continue;
+            }
+
+            if (closed)
+            {
+                // The close is cancelled if the linked transfer fails, so close the file ourselves.
+                if (result == -ECANCELED)
+                {
+                    close(request->mFileDescriptor);
+                }
+
+                DestroyRequest(request);
+                --mActive;
+                continue;
+            }
+
+            switch (request->mState)
+            {
+                case Request::STATE_OPEN:
+                {
+                    if (result < 0)
+                    {
+                        request->mError = static_cast<uint32_t>(-result);
+                        Complete(request);
+                        DestroyRequest(request);
+                        --mActive;
+                    }
+                    else
+                    {
+                        request->mFileDescriptor = result;
+                        request->mState = Request::STATE_TRANSFER;
+                        StartOperation(request);
+                    }
+
+                    break;
+                }
+
+                case Request::STATE_TRANSFER:
+                {
+                    if (result < 0)
+                    {
+                        request->mError = static_cast<uint32_t>(-result);
+                    }
+                    else
+                    {
+                        request->mTransferred = static_cast<uint32_t>(result);
+                    }
+
+                    // Send the result without waiting for the linked close to complete.
+                    Complete(request);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+void FileService::WakeRing()
+{
+    const uint64_t value(1);
+    const ssize_t written(write(mWakeDescriptor, &value, sizeof(value)));
+    (void) written;
+}
+
+
+void FileService::ArmWake()
+{
+    io_uring_sqe *const entry(mRing.GetEntry());
+    THERON_ASSERT(entry);
+
+    entry->opcode = IORING_OP_READ;
+    entry->fd = mWakeDescriptor;
+    entry->addr = reinterpret_cast<uintptr_t>(&mWakeValue);
+    entry->len = sizeof(mWakeValue);
+    entry->user_data = 0;
+}
+
+
+void FileService::StartOperation(Request *const request)
+{
+    // The number of requests in flight is limited so the ring always has room.
+    io_uring_sqe *const entry(mRing.GetEntry());
+    THERON_ASSERT(entry);
+
+    entry->user_data = reinterpret_cast<uintptr_t>(request);
+
+    switch (request->mState)
+    {
+        case Request::STATE_OPEN:
+        {
+            const bool reading(request->mOperation == Request::OPERATION_READ);
+
+            entry->opcode = IORING_OP_OPENAT;
+            entry->fd = AT_FDCWD;
+            entry->addr = reinterpret_cast<uintptr_t>(request->mFileName);
+            entry->open_flags = O_CLOEXEC | (reading ? O_RDONLY : (O_WRONLY | O_CREAT));
+            entry->len = 0644;
+            break;
+        }
+
+        case Request::STATE_TRANSFER:
+        {
+            const bool reading(request->mOperation == Request::OPERATION_READ);
+
+            // The close is linked to the transfer so that both are submitted together,
+            // saving a round trip through the service thread.
+            entry->opcode = static_cast<uint8_t>(reading ? IORING_OP_READ : IORING_OP_WRITE);
+            entry->flags = IOSQE_IO_LINK;
+            entry->fd = request->mFileDescriptor;
+            entry->addr = reinterpret_cast<uintptr_t>(request->mBuffer);
+            entry->len = request->mSize;
+            entry->off = request->mOffset;
+
+            io_uring_sqe *const closeEntry(mRing.GetEntry());
+            THERON_ASSERT(closeEntry);
+
+            closeEntry->opcode = IORING_OP_CLOSE;
+            closeEntry->fd = request->mFileDescriptor;
+            closeEntry->user_data = reinterpret_cast<uintptr_t>(request) | 1;
+            break;
+        }
+    }
+}
+
+
+#endif // THERON_IO_URING
+
+
+} // namespace Detail
+} // namespace Theron
+
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif //_MSC_VER
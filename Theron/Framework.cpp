@@ -13,13 +13,16 @@
 #include <Theron/Receiver.h>
 
 #include <Theron/Detail/Directory/StaticDirectory.h>
+#include <Theron/Detail/Scheduler/AdaptiveMonitor.h>
 #include <Theron/Detail/Scheduler/BlockingMonitor.h>
 #include <Theron/Detail/Scheduler/MailboxQueue.h>
 #include <Theron/Detail/Scheduler/NonBlockingMonitor.h>
 #include <Theron/Detail/Scheduler/Scheduler.h>
+#include <Theron/Detail/Scheduler/SynchronousScheduler.h>
 #include <Theron/Detail/Network/Index.h>
 #include <Theron/Detail/Network/NameGenerator.h>
 #include <Theron/Detail/Strings/String.h>
+#include <Theron/Detail/Threading/Lock.h>
 #include <Theron/Detail/Threading/Utils.h>
 
 
@@ -35,7 +38,31 @@ namespace Theron
 
 void Framework::Initialize()
 {
-    mScheduler = CreateScheduler();
+    // The worker threads of both schedulers account for message memory, if there's a budget.
+    if (mMessageBudget.Enabled())
+    {
+        mSharedMailboxContext.mMessageBudget = &mMessageBudget;
+        mBlockingMailboxContext.mMessageBudget = &mMessageBudget;
+    }
+
+    // Worker threads of both schedulers drop messages whose deadlines have passed.
+    mSharedMailboxContext.mMessageExpiry = &mMessageExpiry;
+    mBlockingMailboxContext.mMessageExpiry = &mMessageExpiry;
+
+    // Only the main worker threads compete for processors by weight, if the framework has a share.
+    if (mCpuShare.Enabled())
+    {
+        mCpuShare.Register();
+        mSharedMailboxContext.mCpuShare = &mCpuShare;
+    }
+
+    mScheduler = CreateScheduler(
+        mParams.mYieldStrategy,
+        &mSharedMailboxContext,
+        &mBlockingMailboxContext,
+        false,
+        mParams.mMaxCompensationThreads,
+        mParams.mColocateActors);
 
     // Set up the scheduler.
     mScheduler->Initialize(mParams.mThreadCount);
@@ -62,29 +89,105 @@ void Framework::Release()
     // Deregister the framework.
     Detail::StaticDirectory<Framework>::Deregister(mIndex);
 
+    // Release the file I/O service while the schedulers still exist to deliver its last results.
+    mFileServiceLock.Lock();
+
+    if (mFileService)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+
+        mFileService->Release();
+        mFileService->~FileService();
+        allocator->Free(mFileService, sizeof(Detail::FileService));
+        mFileService = 0;
+    }
+
+    mFileServiceLock.Unlock();
+
+    // Likewise stop the descriptor reactor, so that it sends no more messages.
+    mReactorLock.Lock();
+
+    if (mReactor)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+
+        mReactor->Release();
+        mReactor->~Reactor();
+        allocator->Free(mReactor, sizeof(Detail::Reactor));
+        mReactor = 0;
+    }
+
+    mReactorLock.Unlock();
+
+    // Release the blocking scheduler first, since its threads hand mailboxes to the main scheduler.
+    // Once all the actors are deregistered no mailboxes are blocking, so none are handed back.
+    mBlockingSchedulerLock.Lock();
+
+    if (mBlockingScheduler)
+    {
+        mBlockingScheduler->Release();
+        DestroyScheduler(mBlockingScheduler);
+        mBlockingScheduler = 0;
+        mBlockingMailboxContext.mScheduler = 0;
+    }
+
+    mBlockingSchedulerLock.Unlock();
+
     mScheduler->Release();
     DestroyScheduler(mScheduler);
     mScheduler = 0;
+
+    mCpuShare.Deregister();
 }
 
 
-Detail::IScheduler *Framework::CreateScheduler()
+Detail::IScheduler *Framework::CreateScheduler(
+    const YieldStrategy yieldStrategy,
+    Detail::MailboxContext *const sharedMailboxContext,
+    Detail::MailboxContext *const handoffMailboxContext,
+    const bool blockingPool,
+    const uint32_t maxCompensationThreads,
+    const bool colocateActors)
 {
     typedef Detail::MailboxQueue<Detail::BlockingMonitor> BlockingQueue;
     typedef Detail::MailboxQueue<Detail::NonBlockingMonitor> NonBlockingQueue;
+    typedef Detail::MailboxQueue<Detail::AdaptiveMonitor> AdaptiveQueue;
 
     typedef Detail::Scheduler<BlockingQueue> BlockingScheduler;
     typedef Detail::Scheduler<NonBlockingQueue> NonBlockingScheduler;
+    typedef Detail::Scheduler<AdaptiveQueue> AdaptiveScheduler;
 
     IAllocator *const allocator(AllocatorManager::GetCache());
     void *schedulerMemory(0);
 
-    if (mParams.mYieldStrategy == YIELD_STRATEGY_CONDITION)
+    // A framework created with no worker threads is pumped by the application instead.
+    if (!blockingPool && mParams.mThreadCount == 0)
+    {
+        schedulerMemory = allocator->AllocateAligned(
+            sizeof(Detail::SynchronousScheduler),
+            THERON_CACHELINE_ALIGNMENT);
+
+        THERON_ASSERT_MSG(schedulerMemory, "Failed to allocate scheduler");
+
+        return new (schedulerMemory) Detail::SynchronousScheduler(
+            &mFallbackHandlers,
+            mMessageAllocator,
+            sharedMailboxContext,
+            handoffMailboxContext);
+    }
+
+    if (yieldStrategy == YIELD_STRATEGY_CONDITION)
     {
         schedulerMemory = allocator->AllocateAligned(
             sizeof(BlockingScheduler),
             THERON_CACHELINE_ALIGNMENT);
     }
+    else if (yieldStrategy == YIELD_STRATEGY_ADAPTIVE)
+    {
+        schedulerMemory = allocator->AllocateAligned(
+            sizeof(AdaptiveScheduler),
+            THERON_CACHELINE_ALIGNMENT);
+    }
     else
     {
         schedulerMemory = allocator->AllocateAligned(
@@ -94,29 +197,53 @@ Detail::IScheduler *Framework::CreateScheduler()
 
     THERON_ASSERT_MSG(schedulerMemory, "Failed to allocate scheduler");
 
-    if (mParams.mYieldStrategy == YIELD_STRATEGY_CONDITION)
+    if (yieldStrategy == YIELD_STRATEGY_CONDITION)
     {
         return new (schedulerMemory) BlockingScheduler(
             &mMailboxes,
             &mFallbackHandlers,
-            &mMessageAllocator,
-            &mSharedMailboxContext,
+            mMessageAllocator,
+            sharedMailboxContext,
+            mParams.mNodeMask,
+            mParams.mProcessorMask,
+            mParams.mThreadPriority,
+            yieldStrategy,
+            handoffMailboxContext,
+            blockingPool,
+            maxCompensationThreads,
+            colocateActors);
+    }
+    else if (yieldStrategy == YIELD_STRATEGY_ADAPTIVE)
+    {
+        return new (schedulerMemory) AdaptiveScheduler(
+            &mMailboxes,
+            &mFallbackHandlers,
+            mMessageAllocator,
+            sharedMailboxContext,
             mParams.mNodeMask,
             mParams.mProcessorMask,
             mParams.mThreadPriority,
-            mParams.mYieldStrategy);
+            yieldStrategy,
+            handoffMailboxContext,
+            blockingPool,
+            maxCompensationThreads,
+            colocateActors);
     }
     else
     {
         return new (schedulerMemory) NonBlockingScheduler(
             &mMailboxes,
             &mFallbackHandlers,
-            &mMessageAllocator,
-            &mSharedMailboxContext,
+            mMessageAllocator,
+            sharedMailboxContext,
             mParams.mNodeMask,
             mParams.mProcessorMask,
             mParams.mThreadPriority,
-            mParams.mYieldStrategy);
+            yieldStrategy,
+            handoffMailboxContext,
+            blockingPool,
+            maxCompensationThreads,
+            colocateActors);
     }
 }
 
@@ -229,6 +356,168 @@ void Framework::DeregisterActor(Actor *const actor)
 }
 
 
+void Framework::SetActorBlocking(Actor *const actor, const bool blocking)
+{
+    // Create the scheduler for blocking actors when the first one is marked.
+    // It's created before the mailbox is marked, so it exists before any thread can see the mark.
+    if (blocking)
+    {
+        mBlockingSchedulerLock.Lock();
+
+        if (mBlockingScheduler == 0)
+        {
+            // The blocking threads spend most of their time blocked, so they wait on conditions when idle.
+            // The pool starts with a single thread and grows while all of its threads are blocked.
+            const uint32_t maxThreads(mParams.mMaxBlockingThreads > 0 ? mParams.mMaxBlockingThreads : 1);
+
+            mBlockingScheduler = CreateScheduler(
+                YIELD_STRATEGY_CONDITION,
+                &mBlockingMailboxContext,
+                &mSharedMailboxContext,
+                true,
+                maxThreads - 1,
+                false);
+
+            mBlockingScheduler->Initialize(1);
+        }
+
+        mBlockingSchedulerLock.Unlock();
+    }
+
+    const uint32_t mailboxIndex(actor->GetAddress().AsInteger());
+    Detail::Mailbox &mailbox(mMailboxes.GetEntry(mailboxIndex));
+
+    // A mailbox that is already scheduled is handed to the right pool when it's next processed.
+    mailbox.Lock();
+    mailbox.SetBlocking(blocking);
+    mailbox.Unlock();
+}
+
+
+void Framework::AddActorConflater(Actor *const actor, Detail::IConflater *const conflater)
+{
+    const uint32_t mailboxIndex(actor->GetAddress().AsInteger());
+    Detail::Mailbox &mailbox(mMailboxes.GetEntry(mailboxIndex));
+
+    // Senders read the conflaters while holding the mailbox lock.
+    mailbox.Lock();
+    actor->mConflaters.Insert(conflater);
+    mailbox.SetConflaters(&actor->mConflaters);
+    mailbox.Unlock();
+}
+
+
+bool Framework::ReadFile(
+    const Address &client,
+    const char *const fileName,
+    const uint32_t tag,
+    const uint64_t offset)
+{
+    Detail::FileService *const fileService(GetFileService());
+    return fileService && fileService->Read(client, fileName, tag, offset);
+}
+
+
+bool Framework::WriteFile(
+    const Address &client,
+    const char *const fileName,
+    void *const buffer,
+    const uint32_t size,
+    const uint32_t tag,
+    const uint64_t offset)
+{
+    Detail::FileService *const fileService(GetFileService());
+    return fileService && fileService->Write(client, fileName, buffer, size, tag, offset);
+}
+
+
+void *Framework::AllocateFileBuffer()
+{
+    Detail::FileService *const fileService(GetFileService());
+    return fileService ? fileService->AllocateBuffer() : 0;
+}
+
+
+void Framework::FreeFileBuffer(void *const buffer)
+{
+    // Buffers only exist once the service has been created.
+    Detail::FileService *const fileService(GetFileService());
+    THERON_ASSERT(fileService);
+
+    fileService->FreeBuffer(buffer);
+}
+
+
+Detail::FileService *Framework::GetFileService()
+{
+    Detail::Lock lock(mFileServiceLock);
+
+    if (mFileService == 0)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+        void *const memory(allocator->AllocateAligned(sizeof(Detail::FileService), THERON_CACHELINE_ALIGNMENT));
+
+        if (memory)
+        {
+            mFileService = new (memory) Detail::FileService(
+                this,
+                mParams.mFileThreadCount,
+                mParams.mFileBufferSize,
+                mParams.mFileQueueDepth);
+
+            mFileService->Initialize();
+        }
+    }
+
+    return mFileService;
+}
+
+
+bool Framework::WatchDescriptor(
+    const Address &client,
+    const int descriptor,
+    const uint32_t events,
+    const uint32_t tag)
+{
+    Detail::Reactor *const reactor(GetReactor());
+    return reactor && reactor->Watch(client, descriptor, events, tag);
+}
+
+
+bool Framework::UnwatchDescriptor(const int descriptor)
+{
+    Detail::Reactor *const reactor(GetReactor());
+    return reactor && reactor->Unwatch(descriptor);
+}
+
+
+Detail::Reactor *Framework::GetReactor()
+{
+    Detail::Lock lock(mReactorLock);
+
+    if (mReactor == 0)
+    {
+        IAllocator *const allocator(AllocatorManager::GetCache());
+        void *const memory(allocator->AllocateAligned(sizeof(Detail::Reactor), THERON_CACHELINE_ALIGNMENT));
+
+        if (memory)
+        {
+            mReactor = new (memory) Detail::Reactor(this);
+
+            // Where watching descriptors isn't supported the reactor is never created.
+            if (!mReactor->Initialize())
+            {
+                mReactor->~Reactor();
+                allocator->Free(mReactor, sizeof(Detail::Reactor));
+                mReactor = 0;
+            }
+        }
+    }
+
+    return mReactor;
+}
+
+
 bool Framework::DeliverWithinLocalProcess(Detail::IMessage *const message, const Detail::Index &index)
 {
     const uint32_t targetFrameworkIndex(index.mComponents.mFramework);
@@ -0,0 +1,465 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <Theron/Align.h>
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/HugePageAllocator.h>
+
+
+#if THERON_WINDOWS
+
+#include <windows.h>
+
+#else
+
+#include <sys/mman.h>
+
+#endif // THERON_WINDOWS
+
+
+namespace Theron
+{
+
+
+namespace
+{
+
+
+const uint32_t SPAN_SHIFT = 16;                         ///< Spans are 64KB, and aligned to their size.
+const uint32_t SPAN_SIZE = 1U << SPAN_SHIFT;
+const uint32_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;        ///< Regions are multiples of the common 2MB huge page size.
+const uint32_t MIN_BLOCK_SIZE = 16;                     ///< Size of the smallest size class.
+const uint32_t MAX_REGION_SPANS = SPAN_SIZE / 2;        ///< The table of spans in the first span has two bytes per span.
+
+// Uses of spans recorded in the span table at the start of each region.
+// Spans used for small blocks record the size class plus one.
+const uint16_t SPAN_UNUSED = 0;                         ///< Unused or free span.
+const uint16_t SPAN_HEADER = 0x7FFF;                    ///< First span of a region, holding the span table.
+const uint16_t SPAN_LARGE = 0x8000;                     ///< First span of a large block, combined with its number of spans.
+
+
+THERON_FORCEINLINE uint16_t *GetSpanTable(char *const regionBase)
+{
+    return reinterpret_cast<uint16_t *>(regionBase);
+}
+
+
+/**
+Maps a region of the given size, a multiple of the huge page size, using huge pages if possible.
+Returns null on failure. Freshly mapped memory is zero-filled.
+*/
+char *MapRegion(const uint32_t size, bool &hugePages)
+{
+    hugePages = false;
+
+#if THERON_WINDOWS
+
+    // Large pages must be committed up front, and need the privilege to lock pages in memory.
+    const SIZE_T largePageSize(GetLargePageMinimum());
+    if (largePageSize != 0 && (size % largePageSize) == 0)
+    {
+        void *const memory(VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+        if (memory)
+        {
+            hugePages = true;
+            return static_cast<char *>(memory);
+        }
+    }
+
+    // Normal allocations are aligned to the 64KB allocation granularity, which is enough for spans.
+    return static_cast<char *>(VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+#else
+
+#if defined(MAP_HUGETLB)
+
+    // Explicit huge pages only succeed if the administrator has reserved enough of them.
+    void *const hugeMemory(mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0));
+    if (hugeMemory != MAP_FAILED)
+    {
+        hugePages = true;
+        return static_cast<char *>(hugeMemory);
+    }
+
+#endif // MAP_HUGETLB
+
+    // Otherwise map a little more than needed and trim it so that the region starts on a huge
+    // page boundary, allowing the kernel to back it with transparent huge pages.
+    const size_t mappedSize(static_cast<size_t>(size) + HUGE_PAGE_SIZE);
+    void *const mapped(mmap(0, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (mapped == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    char *const mappedStart(static_cast<char *>(mapped));
+    char *const mappedEnd(mappedStart + mappedSize);
+
+    char *base(mappedStart);
+    THERON_ALIGN(base, HUGE_PAGE_SIZE);
+
+    if (base > mappedStart)
+    {
+        munmap(mappedStart, static_cast<size_t>(base - mappedStart));
+    }
+
+    if (mappedEnd > base + size)
+    {
+        munmap(base + size, static_cast<size_t>(mappedEnd - (base + size)));
+    }
+
+#if defined(MADV_HUGEPAGE)
+
+    // Fails if the kernel doesn't support transparent huge pages, leaving normal pages.
+    if (madvise(base, size, MADV_HUGEPAGE) == 0)
+    {
+        hugePages = true;
+    }
+
+#endif // MADV_HUGEPAGE
+
+    return base;
+
+#endif // THERON_WINDOWS
+}
+
+
+void UnmapRegion(char *const base, const uint32_t size)
+{
+#if THERON_WINDOWS
+
+    (void) size;
+    VirtualFree(base, 0, MEM_RELEASE);
+
+#else
+
+    munmap(base, size);
+
+#endif // THERON_WINDOWS
+}
+
+
+} // anonymous namespace
+
+
+HugePageAllocator::HugePageAllocator(const uint32_t regionSize) :
+  mRegionSize(0),
+  mSpinLock(),
+  mNumRegions(0),
+  mNextSpan(0),
+  mFreeRuns(0),
+  mBytesAllocated(0),
+  mBytesReserved(0),
+  mHugePageBytes(0)
+{
+    uint32_t roundedSize(regionSize > HUGE_PAGE_SIZE ? regionSize : HUGE_PAGE_SIZE);
+    mRegionSize = THERON_ROUNDUP(roundedSize, HUGE_PAGE_SIZE);
+
+    if (mRegionSize > MAX_REGION_SPANS * SPAN_SIZE)
+    {
+        mRegionSize = MAX_REGION_SPANS * SPAN_SIZE;
+    }
+
+    for (uint32_t sizeClass = 0; sizeClass < NUM_CLASSES; ++sizeClass)
+    {
+        mFreeBlocks[sizeClass] = 0;
+        mCarveNext[sizeClass] = 0;
+        mCarveEnd[sizeClass] = 0;
+    }
+}
+
+
+HugePageAllocator::~HugePageAllocator()
+{
+    for (uint32_t index = 0; index < mNumRegions; ++index)
+    {
+        UnmapRegion(mRegions[index].mBase, mRegions[index].mSize);
+    }
+}
+
+
+void *HugePageAllocator::Allocate(const SizeType size)
+{
+    return AllocateAligned(size, MIN_BLOCK_SIZE);
+}
+
+
+void *HugePageAllocator::AllocateAligned(const SizeType size, const SizeType alignment)
+{
+    THERON_ASSERT_MSG((alignment & (alignment - 1)) == 0, "Alignment values must be powers of two");
+    THERON_ASSERT_MSG(alignment <= SPAN_SIZE, "HugePageAllocator doesn't support alignments above 64KB");
+
+    if (alignment > SPAN_SIZE)
+    {
+        return 0;
+    }
+
+    // Blocks are aligned to their size, up to the size of a span.
+    const uint32_t blockSize(size > alignment ? size : alignment);
+    void *block(0);
+
+    mSpinLock.Lock();
+
+    if (blockSize <= (MIN_BLOCK_SIZE << (NUM_CLASSES - 1)))
+    {
+        uint32_t sizeClass(0);
+        while ((MIN_BLOCK_SIZE << sizeClass) < blockSize)
+        {
+            ++sizeClass;
+        }
+
+        block = AllocateSmall(sizeClass);
+        if (block)
+        {
+            mBytesAllocated += MIN_BLOCK_SIZE << sizeClass;
+        }
+    }
+    else
+    {
+        const uint32_t numSpans(static_cast<uint32_t>((static_cast<uint64_t>(blockSize) + SPAN_SIZE - 1) >> SPAN_SHIFT));
+
+        block = AllocateSpans(numSpans, static_cast<uint16_t>(SPAN_LARGE | numSpans));
+        if (block)
+        {
+            mBytesAllocated += static_cast<uint64_t>(numSpans) << SPAN_SHIFT;
+        }
+    }
+
+    mSpinLock.Unlock();
+
+    return block;
+}
+
+
+void HugePageAllocator::Free(void *const memory)
+{
+    if (memory == 0)
+    {
+        return;
+    }
+
+    mSpinLock.Lock();
+
+    Region *const region(FindRegion(memory));
+    THERON_ASSERT_MSG(region, "Freed memory wasn't allocated by this HugePageAllocator");
+
+    const uint32_t spanIndex(static_cast<uint32_t>((static_cast<char *>(memory) - region->mBase) >> SPAN_SHIFT));
+    uint16_t &use(GetSpanTable(region->mBase)[spanIndex]);
+
+    THERON_ASSERT(use != SPAN_UNUSED && use != SPAN_HEADER);
+
+    if (use & SPAN_LARGE)
+    {
+        // Large blocks are returned to the free runs as whole spans.
+        FreeRun *const run(static_cast<FreeRun *>(memory));
+        run->mNumSpans = use & ~SPAN_LARGE;
+        run->mNext = mFreeRuns;
+        mFreeRuns = run;
+
+        mBytesAllocated -= static_cast<uint64_t>(run->mNumSpans) << SPAN_SHIFT;
+        use = SPAN_UNUSED;
+    }
+    else
+    {
+        // Small blocks are recycled within their size class, so their spans are never returned.
+        const uint32_t sizeClass(static_cast<uint32_t>(use - 1));
+        THERON_ASSERT(sizeClass < NUM_CLASSES);
+
+        FreeBlock *const freeBlock(static_cast<FreeBlock *>(memory));
+        freeBlock->mNext = mFreeBlocks[sizeClass];
+        mFreeBlocks[sizeClass] = freeBlock;
+
+        mBytesAllocated -= MIN_BLOCK_SIZE << sizeClass;
+    }
+
+    mSpinLock.Unlock();
+}
+
+
+void HugePageAllocator::Free(void *const memory, const SizeType /*size*/)
+{
+    // The size is recorded in the span table, which also accounts for any alignment.
+    Free(memory);
+}
+
+
+uint64_t HugePageAllocator::GetBytesAllocated() const
+{
+    return mBytesAllocated;
+}
+
+
+uint64_t HugePageAllocator::GetBytesReserved() const
+{
+    return mBytesReserved;
+}
+
+
+uint64_t HugePageAllocator::GetHugePageBytes() const
+{
+    return mHugePageBytes;
+}
+
+
+void *HugePageAllocator::AllocateSmall(const uint32_t sizeClass)
+{
+    if (FreeBlock *const freeBlock = mFreeBlocks[sizeClass])
+    {
+        mFreeBlocks[sizeClass] = freeBlock->mNext;
+        return freeBlock;
+    }
+
+    // Carve a new block from the current span of the size class, taking a new span when it's used up.
+    if (mCarveNext[sizeClass] == mCarveEnd[sizeClass])
+    {
+        char *const span(AllocateSpans(1, static_cast<uint16_t>(sizeClass + 1)));
+        if (span == 0)
+        {
+            return 0;
+        }
+
+        mCarveNext[sizeClass] = span;
+        mCarveEnd[sizeClass] = span + SPAN_SIZE;
+    }
+
+    char *const block(mCarveNext[sizeClass]);
+    mCarveNext[sizeClass] += MIN_BLOCK_SIZE << sizeClass;
+
+    return block;
+}
+
+
+char *HugePageAllocator::AllocateSpans(const uint32_t numSpans, const uint16_t use)
+{
+    // Reuse the first free run that's big enough, splitting off any remainder.
+    // Free runs aren't coalesced, since large blocks are few and mostly long-lived.
+    FreeRun **link(&mFreeRuns);
+    while (FreeRun *const run = *link)
+    {
+        if (run->mNumSpans >= numSpans)
+        {
+            char *const spans(reinterpret_cast<char *>(run));
+
+            if (run->mNumSpans == numSpans)
+            {
+                *link = run->mNext;
+            }
+            else
+            {
+                FreeRun *const remainder(reinterpret_cast<FreeRun *>(spans + (numSpans << SPAN_SHIFT)));
+                remainder->mNext = run->mNext;
+                remainder->mNumSpans = run->mNumSpans - numSpans;
+                *link = remainder;
+            }
+
+            Region *const region(FindRegion(spans));
+            THERON_ASSERT(region);
+
+            GetSpanTable(region->mBase)[(spans - region->mBase) >> SPAN_SHIFT] = use;
+            return spans;
+        }
+
+        link = &run->mNext;
+    }
+
+    // Otherwise take the next unused spans of the newest region, reserving a new one if needed.
+    if (mNumRegions == 0 || mNextSpan + numSpans > mRegions[mNumRegions - 1].mNumSpans)
+    {
+        if (!ReserveRegion(numSpans))
+        {
+            return 0;
+        }
+    }
+
+    Region &region(mRegions[mNumRegions - 1]);
+    char *const spans(region.mBase + (static_cast<size_t>(mNextSpan) << SPAN_SHIFT));
+
+    GetSpanTable(region.mBase)[mNextSpan] = use;
+    mNextSpan += numSpans;
+
+    return spans;
+}
+
+
+bool HugePageAllocator::ReserveRegion(const uint32_t numSpans)
+{
+    if (mNumRegions == MAX_REGIONS)
+    {
+        return false;
+    }
+
+    // Each region starts with its span table, so needs a span more than requested.
+    uint64_t size(mRegionSize);
+    const uint64_t requiredSize((static_cast<uint64_t>(numSpans) + 1) << SPAN_SHIFT);
+
+    if (requiredSize > size)
+    {
+        size = (requiredSize + HUGE_PAGE_SIZE - 1) & ~static_cast<uint64_t>(HUGE_PAGE_SIZE - 1);
+        if (size > static_cast<uint64_t>(MAX_REGION_SPANS) * SPAN_SIZE)
+        {
+            return false;
+        }
+    }
+
+    bool hugePages(false);
+    char *const base(MapRegion(static_cast<uint32_t>(size), hugePages));
+    if (base == 0)
+    {
+        return false;
+    }
+
+    // Keep any unused spans at the end of the previous region as a free run.
+    if (mNumRegions > 0)
+    {
+        const Region &previous(mRegions[mNumRegions - 1]);
+        if (mNextSpan < previous.mNumSpans)
+        {
+            FreeRun *const run(reinterpret_cast<FreeRun *>(previous.mBase + (static_cast<size_t>(mNextSpan) << SPAN_SHIFT)));
+            run->mNumSpans = previous.mNumSpans - mNextSpan;
+            run->mNext = mFreeRuns;
+            mFreeRuns = run;
+        }
+    }
+
+    Region &region(mRegions[mNumRegions++]);
+    region.mBase = base;
+    region.mSize = static_cast<uint32_t>(size);
+    region.mNumSpans = static_cast<uint32_t>(size >> SPAN_SHIFT);
+    region.mHugePages = hugePages;
+
+    // The rest of the span table is already zero, marking the spans unused.
+    GetSpanTable(base)[0] = SPAN_HEADER;
+    mNextSpan = 1;
+
+    mBytesReserved += size;
+    if (hugePages)
+    {
+        mHugePageBytes += size;
+    }
+
+    return true;
+}
+
+
+HugePageAllocator::Region *HugePageAllocator::FindRegion(const void *const memory)
+{
+    const char *const address(static_cast<const char *>(memory));
+
+    // Search the newest regions first, since they hold most of the recent allocations.
+    uint32_t index(mNumRegions);
+    while (index > 0)
+    {
+        Region &region(mRegions[--index]);
+        if (address >= region.mBase && address < region.mBase + region.mSize)
+        {
+            return &region;
+        }
+    }
+
+    return 0;
+}
+
+
+} // namespace Theron
@@ -0,0 +1,182 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+#include <Theron/MessageBudgetPolicy.h>
+
+#include <Theron/Detail/Messages/MessageBudget.h>
+#include <Theron/Detail/Threading/Lock.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+MessageBudget::MessageBudget(
+    const uint32_t budget,
+    const MessageBudgetPolicy policy,
+    const MessageBudgetCallback callback,
+    void *const callbackContext) :
+  mBudget(budget > 0x7FFFFFFF ? 0x7FFFFFFF : static_cast<int32_t>(budget)),
+  mPolicy(policy),
+  mCallback(callback),
+  mCallbackContext(callbackContext),
+  mTotal(0),
+  mPeak(0),
+  mWaiters(0),
+  mCondition(),
+  mAccounts()
+{
+}
+
+
+void MessageBudget::Register(Account *const account)
+{
+    Lock lock(mCondition.GetMutex());
+    mAccounts.Insert(account);
+}
+
+
+void MessageBudget::Deregister(Account *const account)
+{
+    Lock lock(mCondition.GetMutex());
+
+    mAccounts.Remove(account);
+    Flush(account);
+}
+
+
+void MessageBudget::WaitForRoom(const uint32_t bytes)
+{
+    Lock lock(mCondition.GetMutex());
+
+    mWaiters.Increment();
+
+    // Idle worker threads may be holding credits they haven't passed on, so the exact
+    // usage is checked periodically as well as whenever credits are passed on.
+    int32_t usage(ComputeUsage());
+    while (usage > 0 && usage + static_cast<int32_t>(bytes) > mBudget)
+    {
+        mCondition.TimedWait(lock, WAIT_PERIOD);
+        usage = ComputeUsage();
+    }
+
+    mWaiters.Decrement();
+}
+
+
+uint32_t MessageBudget::GetUsage() const
+{
+    Lock lock(mCondition.GetMutex());
+
+    const int32_t usage(ComputeUsage());
+    return usage > 0 ? static_cast<uint32_t>(usage) : 0;
+}
+
+
+uint32_t MessageBudget::GetPeakUsage() const
+{
+    return mPeak.LoadRelaxed();
+}
+
+
+bool MessageBudget::Admit(const uint32_t bytes)
+{
+    int32_t usage(0);
+
+    {
+        Lock lock(mCondition.GetMutex());
+        usage = ComputeUsage();
+    }
+
+    if (usage < 0)
+    {
+        usage = 0;
+    }
+
+    if (usage + static_cast<int32_t>(bytes) <= mBudget)
+    {
+        return true;
+    }
+
+    switch (mPolicy)
+    {
+        case MESSAGE_BUDGET_FAIL:
+        {
+            return false;
+        }
+
+        case MESSAGE_BUDGET_CALLBACK:
+        {
+            if (mCallback)
+            {
+                return mCallback(mCallbackContext, static_cast<uint32_t>(usage), static_cast<uint32_t>(mBudget));
+            }
+
+            return true;
+        }
+
+        default:
+        {
+            // Blocking senders wait for room before sending, and other senders are never refused.
+            return true;
+        }
+    }
+}
+
+
+void MessageBudget::Flush(Account *const account)
+{
+    // The count is cleared before it's added so that concurrent readers may miss it,
+    // but never count it twice, and so never see the framework as fuller than it is.
+    const int32_t count(account->mBytes);
+    account->mBytes = 0;
+
+    Update(count);
+}
+
+
+void MessageBudget::Update(const int32_t bytes)
+{
+    const int32_t total(static_cast<int32_t>(mTotal.AddRelaxed(static_cast<uint32_t>(bytes))) + bytes);
+
+    if (bytes < 0)
+    {
+        if (mWaiters.LoadRelaxed() != 0)
+        {
+            mCondition.PulseAll();
+        }
+
+        return;
+    }
+
+    // Raise the peak to the new total, unless another thread raised it further first.
+    uint32_t peak(mPeak.LoadRelaxed());
+    while (total > static_cast<int32_t>(peak) && !mPeak.CompareExchangeRelaxed(peak, static_cast<uint32_t>(total)))
+    {
+    }
+}
+
+
+int32_t MessageBudget::ComputeUsage() const
+{
+    int32_t usage(static_cast<int32_t>(mTotal.LoadRelaxed()));
+
+    List<Account>::Iterator accounts(mAccounts.GetIterator());
+    while (accounts.Next())
+    {
+        usage += accounts.Get()->mBytes;
+    }
+
+    return usage;
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
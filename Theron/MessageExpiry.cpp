@@ -0,0 +1,36 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Messages/MessageExpiry.h>
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+MessageExpiry::MessageExpiry() :
+  mHandlers(),
+  mCount(0)
+{
+}
+
+
+void MessageExpiry::Expire(const IMessage *const message)
+{
+    THERON_ASSERT(message);
+
+    mCount.Increment();
+    mHandlers.Handle(message);
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
@@ -0,0 +1,187 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <string.h>
+
+#include <Theron/Assert.h>
+#include <Theron/BasicTypes.h>
+#include <Theron/Defines.h>
+
+#include <Theron/Detail/Scheduler/PerfCounters.h>
+
+
+#if THERON_ENABLE_PERF_COUNTERS && defined(__linux__)
+#define THERON_PERF_EVENTS_AVAILABLE 1
+#else
+#define THERON_PERF_EVENTS_AVAILABLE 0
+#endif
+
+
+#if THERON_PERF_EVENTS_AVAILABLE
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+#if THERON_PERF_EVENTS_AVAILABLE
+
+
+namespace
+{
+
+
+/**
+Opens a single user-mode hardware counter for the calling thread, in the given group.
+*/
+int OpenCounter(const uint64_t config, const int groupLeader)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (groupLeader == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // Measure the calling thread on any CPU.
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupLeader, 0));
+}
+
+
+} // anonymous namespace
+
+
+#endif // THERON_PERF_EVENTS_AVAILABLE
+
+
+PerfCounters::PerfCounters() : mState(STATE_CLOSED), mGroupLeader(-1)
+{
+    for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+    {
+        mDescriptors[event] = -1;
+        mStartValues[event] = 0;
+    }
+}
+
+
+PerfCounters::~PerfCounters()
+{
+    Close();
+}
+
+
+void PerfCounters::Close()
+{
+#if THERON_PERF_EVENTS_AVAILABLE
+
+    for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+    {
+        if (mDescriptors[event] != -1)
+        {
+            close(mDescriptors[event]);
+            mDescriptors[event] = -1;
+        }
+    }
+
+#endif // THERON_PERF_EVENTS_AVAILABLE
+
+    mGroupLeader = -1;
+
+    // Disabled counters stay disabled, since the kernel will just refuse them again.
+    if (mState == STATE_OPEN)
+    {
+        mState = STATE_CLOSED;
+    }
+}
+
+
+void PerfCounters::Open()
+{
+    THERON_ASSERT(mState == STATE_CLOSED);
+
+#if THERON_PERF_EVENTS_AVAILABLE
+
+    const uint64_t configs[MAX_PERF_EVENTS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // The first counter leads the group, so all the counters are scheduled together
+    // and can be read with a single system call.
+    for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+    {
+        mDescriptors[event] = OpenCounter(configs[event], mGroupLeader);
+        if (mDescriptors[event] == -1)
+        {
+            // Typically the kernel forbids perf events, or the hardware doesn't support them.
+            Close();
+            mState = STATE_DISABLED;
+            return;
+        }
+
+        if (event == 0)
+        {
+            mGroupLeader = mDescriptors[event];
+        }
+    }
+
+    ioctl(mGroupLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(mGroupLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    mState = STATE_OPEN;
+
+#else
+
+    mState = STATE_DISABLED;
+
+#endif // THERON_PERF_EVENTS_AVAILABLE
+}
+
+
+bool PerfCounters::Read(uint64_t *const values)
+{
+#if THERON_PERF_EVENTS_AVAILABLE
+
+    // With PERF_FORMAT_GROUP the leader returns the number of counters followed by their values.
+    uint64_t buffer[1 + MAX_PERF_EVENTS];
+    const ssize_t expectedSize(static_cast<ssize_t>(sizeof(buffer)));
+
+    if (read(mGroupLeader, buffer, sizeof(buffer)) != expectedSize || buffer[0] != MAX_PERF_EVENTS)
+    {
+        return false;
+    }
+
+    for (uint32_t event = 0; event < MAX_PERF_EVENTS; ++event)
+    {
+        values[event] = buffer[1 + event];
+    }
+
+    return true;
+
+#else
+
+    (void) values;
+    return false;
+
+#endif // THERON_PERF_EVENTS_AVAILABLE
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
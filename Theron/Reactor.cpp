@@ -0,0 +1,348 @@
+// Copyright (C) by Ashton Mason. See LICENSE.txt for licensing information.
+
+
+#include <new>
+
+#include <errno.h>
+
+#include <Theron/AllocatorManager.h>
+#include <Theron/Assert.h>
+#include <Theron/Defines.h>
+#include <Theron/DescriptorReady.h>
+#include <Theron/EndPoint.h>
+#include <Theron/Framework.h>
+#include <Theron/IAllocator.h>
+
+#include <Theron/Detail/IO/Reactor.h>
+#include <Theron/Detail/Threading/Lock.h>
+
+
+#if THERON_EPOLL
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#endif // THERON_EPOLL
+
+
+namespace Theron
+{
+namespace Detail
+{
+
+
+Reactor::Reactor(Framework *const framework) :
+  mFramework(framework),
+  mLock(),
+  mRegistrations(),
+  mEpollDescriptor(-1),
+  mWakeDescriptor(-1),
+  mThread(),
+  mStarted(false)
+{
+}
+
+
+Reactor::~Reactor()
+{
+    THERON_ASSERT(mStarted == false);
+    THERON_ASSERT(mRegistrations.Front() == 0);
+}
+
+
+bool Reactor::Initialize()
+{
+
+#if THERON_EPOLL
+
+    mEpollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollDescriptor < 0)
+    {
+        return false;
+    }
+
+    mWakeDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mWakeDescriptor >= 0)
+    {
+        // The eventfd is watched level-triggered, so once signalled it stays ready.
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = mWakeDescriptor;
+
+        if (epoll_ctl(mEpollDescriptor, EPOLL_CTL_ADD, mWakeDescriptor, &event) == 0 &&
+            mThread.Start(ThreadEntryPoint, this))
+        {
+            mStarted = true;
+            return true;
+        }
+
+        close(mWakeDescriptor);
+        mWakeDescriptor = -1;
+    }
+
+    close(mEpollDescriptor);
+    mEpollDescriptor = -1;
+
+#endif // THERON_EPOLL
+
+    return false;
+}
+
+
+void Reactor::Release()
+{
+
+#if THERON_EPOLL
+
+    if (mStarted)
+    {
+        const uint64_t value(1);
+        const ssize_t written(write(mWakeDescriptor, &value, sizeof(value)));
+        THERON_ASSERT(written == sizeof(value));
+        (void) written;
+
+        mThread.Join();
+        mStarted = false;
+
+        close(mWakeDescriptor);
+        mWakeDescriptor = -1;
+
+        close(mEpollDescriptor);
+        mEpollDescriptor = -1;
+    }
+
+#endif // THERON_EPOLL
+
+    // Free any registrations left by clients that didn't unwatch their descriptors.
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    Lock lock(mLock);
+
+    while (RegistrationMap::Node *const node = mRegistrations.Front())
+    {
+        mRegistrations.Remove(node);
+        node->~Node();
+        allocator->Free(node, sizeof(RegistrationMap::Node));
+    }
+}
+
+
+bool Reactor::Watch(
+    const Address &client,
+    const int descriptor,
+    const uint32_t events,
+    const uint32_t tag)
+{
+
+#if THERON_EPOLL
+
+    THERON_ASSERT(mStarted);
+
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    bool added(false);
+
+    {
+        Lock lock(mLock);
+
+        // Replace the recipient of an existing registration, or add a new one.
+        RegistrationMap::Node *node(Find(descriptor));
+        if (node)
+        {
+            node->mValue = Registration(client, tag);
+        }
+        else
+        {
+            IAllocator *const allocator(AllocatorManager::GetCache());
+            void *const memory(allocator->Allocate(sizeof(RegistrationMap::Node)));
+            if (memory == 0)
+            {
+                return false;
+            }
+
+            node = new (memory) RegistrationMap::Node(descriptor, Registration(client, tag));
+            mRegistrations.Insert(node);
+            added = true;
+        }
+    }
+
+    // Hangups and errors are always reported by epoll, whether asked for or not.
+    epoll_event event;
+    event.events = EPOLLONESHOT | EPOLLRDHUP;
+    event.data.fd = descriptor;
+
+    if (events & DescriptorReady::READABLE)
+    {
+        event.events |= EPOLLIN;
+    }
+
+    if (events & DescriptorReady::WRITABLE)
+    {
+        event.events |= EPOLLOUT;
+    }
+
+    // A registration can outlive its descriptor in the epoll set, if the descriptor was closed
+    // without being unwatched and its number was then reused. So if modifying fails, try adding.
+    int operation(added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+    int result(epoll_ctl(mEpollDescriptor, operation, descriptor, &event));
+
+    if (result < 0 && operation == EPOLL_CTL_MOD && errno == ENOENT)
+    {
+        operation = EPOLL_CTL_ADD;
+        result = epoll_ctl(mEpollDescriptor, operation, descriptor, &event);
+    }
+    else if (result < 0 && operation == EPOLL_CTL_ADD && errno == EEXIST)
+    {
+        operation = EPOLL_CTL_MOD;
+        result = epoll_ctl(mEpollDescriptor, operation, descriptor, &event);
+    }
+
+    if (result < 0)
+    {
+        Unwatch(descriptor);
+        return false;
+    }
+
+    return true;
+
+#else
+
+    (void) client;
+    (void) descriptor;
+    (void) events;
+    (void) tag;
+
+    return false;
+
+#endif // THERON_EPOLL
+
+}
+
+
+bool Reactor::Unwatch(const int descriptor)
+{
+    RegistrationMap::Node *node(0);
+
+    {
+        Lock lock(mLock);
+
+        node = Find(descriptor);
+        if (node == 0)
+        {
+            return false;
+        }
+
+        mRegistrations.Remove(node);
+    }
+
+#if THERON_EPOLL
+
+    // The descriptor may already have been closed, which removes it from the set.
+    epoll_event event;
+    event.events = 0;
+    event.data.fd = descriptor;
+    epoll_ctl(mEpollDescriptor, EPOLL_CTL_DEL, descriptor, &event);
+
+#endif // THERON_EPOLL
+
+    IAllocator *const allocator(AllocatorManager::GetCache());
+    node->~Node();
+    allocator->Free(node, sizeof(RegistrationMap::Node));
+
+    return true;
+}
+
+
+void Reactor::ThreadEntryPoint(void *const context)
+{
+    Reactor *const reactor(static_cast<Reactor *>(context));
+    reactor->Run();
+}
+
+
+Reactor::RegistrationMap::Node *Reactor::Find(const int descriptor) const
+{
+    RegistrationMap::KeyNodeIterator nodes(mRegistrations.GetKeyNodeIterator(descriptor));
+    if (nodes.Next())
+    {
+        return nodes.Get();
+    }
+
+    return 0;
+}
+
+
+void Reactor::Run()
+{
+
+#if THERON_EPOLL
+
+    epoll_event events[MAX_EVENTS];
+    DescriptorReady messages[MAX_EVENTS];
+    Address clients[MAX_EVENTS];
+
+    bool stopped(false);
+    while (!stopped)
+    {
+        const int eventCount(epoll_wait(mEpollDescriptor, events, static_cast<int>(MAX_EVENTS), -1));
+        if (eventCount < 0)
+        {
+            THERON_ASSERT_MSG(errno == EINTR, "epoll_wait failed");
+            continue;
+        }
+
+        uint32_t messageCount(0);
+
+        {
+            Lock lock(mLock);
+
+            for (int index = 0; index < eventCount; ++index)
+            {
+                const epoll_event &event(events[index]);
+                const int descriptor(event.data.fd);
+
+                if (descriptor == mWakeDescriptor)
+                {
+                    stopped = true;
+                    continue;
+                }
+
+                // Events for descriptors unwatched since the wait returned are dropped.
+                const RegistrationMap::Node *const node(Find(descriptor));
+                if (node == 0)
+                {
+                    continue;
+                }
+
+                uint32_t flags(0);
+                flags |= (event.events & EPOLLIN) ? static_cast<uint32_t>(DescriptorReady::READABLE) : 0;
+                flags |= (event.events & EPOLLOUT) ? static_cast<uint32_t>(DescriptorReady::WRITABLE) : 0;
+                flags |= (event.events & (EPOLLHUP | EPOLLRDHUP)) ? static_cast<uint32_t>(DescriptorReady::HANGUP) : 0;
+                flags |= (event.events & EPOLLERR) ? static_cast<uint32_t>(DescriptorReady::FAILURE) : 0;
+
+                messages[messageCount] = DescriptorReady(descriptor, flags, node->mValue.mTag);
+                clients[messageCount] = node->mValue.mClient;
+                ++messageCount;
+            }
+        }
+
+        // Deliver the whole batch at once, waking the worker threads once.
+        if (messageCount)
+        {
+            mFramework->SendBatch(messages, clients, messageCount);
+        }
+    }
+
+#endif // THERON_EPOLL
+
+}
+
+
+} // namespace Detail
+} // namespace Theron
+
+
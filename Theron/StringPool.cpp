@@ -53,26 +53,54 @@ void StringPool::Dereference()
 }
 
 
-StringPool::StringPool()
+StringPool::StringPool() : mMutex(), mStrings()
 {
 }
 
 
 StringPool::~StringPool()
 {
+    IAllocator *const allocator(AllocatorManager::GetCache());
+
+    // Free all the pooled strings at end of day.
+    StringMap::Iterator strings(mStrings.GetIterator());
+    while (strings.Next())
+    {
+        char *const pooled(const_cast<char *>(strings.GetValue()));
+        allocator->Free(pooled, GetSize(pooled));
+    }
 }
 
 
 const char *StringPool::Lookup(const char *const str)
 {
-    // Hash the string value to a bucket index.
-    const uint32_t index(Hash(str));
-    THERON_ASSERT(index < BUCKET_COUNT);
-    Bucket &bucket(mBuckets[index]);
-
-    // Lock the mutex after computing the hash.
     Lock lock(mMutex);
-    return bucket.Lookup(str);
+
+    // Search the map for an existing copy of this string.
+    if (const char *const *const pooled = mStrings.Find(str))
+    {
+        return *pooled;
+    }
+
+    // Create a new copy.
+    IAllocator *const allocator(AllocatorManager::GetCache());
+    const uint32_t size(GetSize(str));
+
+    char *const copy(reinterpret_cast<char *>(allocator->Allocate(size)));
+    if (copy == 0)
+    {
+        return 0;
+    }
+
+    strcpy(copy, str);
+
+    if (!mStrings.Insert(copy, copy))
+    {
+        allocator->Free(copy, size);
+        return 0;
+    }
+
+    return copy;
 }
 
 
@@ -3,173 +3,105 @@
 
 #include <stdio.h>
 #include <vector>
-#include <queue>
 
 #include <Theron/Theron.h>
 
 
-#ifdef _MSC_VER
-#pragma warning(disable:4996) // 'fopen': This function or variable may be unsafe.
-#endif // _MSC_VER
-
-
 static const int MAX_FILES = 16;
-static const int MAX_FILE_SIZE = 16384;
 
 
-// A file read request: read the contents of a disk file into a memory buffer.
+// A file read request: read the contents of a disk file.
 struct ReadRequest
 {
 public:
 
-    explicit ReadRequest(
-        const Theron::Address client = Theron::Address(),
-        const char *const fileName = 0,
-        unsigned char *const buffer = 0,
-        const unsigned int bufferSize = 0) :
+    explicit ReadRequest(const Theron::Address client = Theron::Address(), const char *const fileName = 0) :
       mClient(client),
-      mFileName(fileName),
-      mProcessed(false),
-      mBuffer(buffer),
-      mBufferSize(bufferSize),
-      mFileSize(0)
-    {
-    }
-
-    void Process()
+      mFileName(fileName)
     {
-        mProcessed = true;
-        mFileSize = 0;
-
-        // Try to open the file.
-        FILE *const handle = fopen(mFileName, "rb");
-        if (handle != 0)
-        {
-            // Read the file data, setting the actual size.
-            mFileSize = (uint32_t) fread(
-                mBuffer,
-                sizeof(unsigned char),
-                mBufferSize,
-                handle);
-
-            fclose(handle);
-        }
     }
 
     Theron::Address mClient;            // Address of the requesting client.
     const char *mFileName;              // Name of the requested file.
-    bool mProcessed;                    // Whether the file has been read.
-    unsigned char *mBuffer;             // Buffer for file contents.
-    unsigned int mBufferSize;           // Size of the buffer.
-    unsigned int mFileSize;             // Size of the file in bytes.
 };
 
 
-// A stateless worker actor that processes work messages.
-// Each worker can only process one work item at a time.
-template <class WorkMessage>
-class Worker : public Theron::Actor
+// The response to a file read request.
+struct ReadResponse
 {
 public:
 
-    // Constructor.
-    Worker(Theron::Framework &framework) : Theron::Actor(framework)
+    explicit ReadResponse(const char *const fileName = 0, const unsigned int fileSize = 0, const unsigned int error = 0) :
+      mFileName(fileName),
+      mFileSize(fileSize),
+      mError(error)
     {
-        RegisterHandler(this, &Worker::Handler);
     }
 
-private:
-
-    // Message handler for WorkMessage messages.
-    void Handler(const WorkMessage &message, const Theron::Address from)
-    {
-        // The message parameter is const so we need to copy it to change it.
-        WorkMessage result(message);
-        result.Process();
-
-        // Forward the processed message back to the sender.
-        Send(result, from);
-    }
+    const char *mFileName;              // Name of the requested file.
+    unsigned int mFileSize;             // Number of bytes read from the file.
+    unsigned int mError;                // Non-zero if the file couldn't be read.
 };
 
 
-// A dispatcher actor that processes work items.
-// Internally the dispatcher creates and controls a pool of workers.
-// It coordinates the workers to process the work items in parallel.
-template <class WorkMessage>
-class Dispatcher : public Theron::Actor
+// An actor that reads files on behalf of its clients.
+// Reading a file from disk blocks, so rather than reading the files itself, the reader
+// asks the file I/O service of the framework to read them. The service reads the files
+// asynchronously, without blocking any of the framework's worker threads, and sends the
+// contents back to the reader in FileResult messages. Since the reader never blocks, a
+// single reader can have any number of reads in progress at once.
+class FileReader : public Theron::Actor
 {
 public:
 
-    Dispatcher(Theron::Framework &framework, const int workerCount) : Theron::Actor(framework)
-    {
-        // Create the workers and add them to the free list.
-        for (int i = 0; i < workerCount; ++i)
-        {
-            mWorkers.push_back(new WorkerType(framework));
-            mFreeQueue.push(mWorkers.back()->GetAddress());
-        }
-
-        RegisterHandler(this, &Dispatcher::Handler);
-    }
-
-    ~Dispatcher()
+    // Constructor.
+    FileReader(Theron::Framework &framework) : Theron::Actor(framework)
     {
-        // Destroy the workers.
-        const int workerCount(static_cast<int>(mWorkers.size()));
-        for (int i = 0; i < workerCount; ++i)
-        {
-            delete mWorkers[i];
-        }
+        RegisterHandler(this, &FileReader::HandleRequest);
+        RegisterHandler(this, &FileReader::HandleResult);
     }
 
 private:
 
-    typedef Worker<WorkMessage> WorkerType;
-
-    // Handles work requests from clients.
-    void Handler(const WorkMessage &message, const Theron::Address from)
+    // Handles read requests from clients.
+    void HandleRequest(const ReadRequest &request, const Theron::Address /*from*/)
     {
-        // Has this work item been processed?
-        if (message.mProcessed)
-        {
-            // Send the result back to the caller that requested it.
-            Send(message, message.mClient);
+        // Remember the request, and use its index as the tag of the read.
+        // The tag is returned in the result, so we can tell which request it belongs to.
+        const Theron::uint32_t tag(static_cast<Theron::uint32_t>(mRequests.size()));
+        mRequests.push_back(request);
 
-            // Add the worker that sent the result to the free list.
-            mFreeQueue.push(from);
-        }
-        else
+        // Ask the framework to read the file, sending the result to us.
+        if (!GetFramework().ReadFile(GetAddress(), request.mFileName, tag))
         {
-            // Add the unprocessed work message to the work list.
-            mWorkQueue.push(message);
+            Send(ReadResponse(request.mFileName, 0, 1), request.mClient);
         }
+    }
 
-        // Service the work queue.
-        while (!mWorkQueue.empty() && !mFreeQueue.empty())
-        {
-            Send(mWorkQueue.front(), mFreeQueue.front());
+    // Handles the results of file reads from the file I/O service.
+    void HandleResult(const Theron::FileResult &result, const Theron::Address /*from*/)
+    {
+        const ReadRequest &request(mRequests[result.mTag]);
 
-            mFreeQueue.pop();
-            mWorkQueue.pop();
-        }
+        // A real application would process the file contents here; we just report the size.
+        Send(ReadResponse(request.mFileName, result.mSize, result.mError), request.mClient);
+
+        // The buffer holding the file contents belongs to us, and must be returned when we're done.
+        GetFramework().FreeFileBuffer(result.mBuffer);
     }
 
-    std::vector<WorkerType *> mWorkers;         // Pointers to the owned workers.
-    std::queue<Theron::Address> mFreeQueue;     // Queue of available workers.
-    std::queue<WorkMessage> mWorkQueue;         // Queue of unprocessed work messages.
+    std::vector<ReadRequest> mRequests;         // Requests received so far, indexed by tag.
 };
 
 
 int main(int argc, char *argv[])
 {
-    // Theron::Framework objects can be constructed with parameters.
-    // We create a framework with n worker threads, where n is the number of
-    // files we wish to be able to read concurrently. We also restrict the
-    // worker threads (arbitrarily) to the first two processor cores.
+    // The worker threads never block reading files, so a couple of threads are plenty.
+    // The contents of each file are read into a pooled buffer of mFileBufferSize bytes,
+    // which limits the size of a single read. Larger files can be read in chunks.
     Theron::Framework::Parameters frameworkParams;
-    frameworkParams.mThreadCount = MAX_FILES;
-    frameworkParams.mProcessorMask = (1UL << 0) | (1UL << 1);
+    frameworkParams.mThreadCount = 2;
+    frameworkParams.mFileBufferSize = 16384;
     Theron::Framework framework(frameworkParams);
 
     if (argc < 2)
@@ -177,47 +109,42 @@ int main(int argc, char *argv[])
         printf("Expected up to 16 file name arguments.\n");
     }
 
-    // Register a handler with a receiver to catch the result messages.
+    // Register a handler with a receiver to catch the responses.
     Theron::Receiver receiver;
-    Theron::Catcher<ReadRequest> resultCatcher;
-    receiver.RegisterHandler(&resultCatcher, &Theron::Catcher<ReadRequest>::Push);
+    Theron::Catcher<ReadResponse> responseCatcher;
+    receiver.RegisterHandler(&responseCatcher, &Theron::Catcher<ReadResponse>::Push);
 
-    // Create a dispatcher to process the work, with MAX_FILES workers.
-    Dispatcher<ReadRequest> dispatcher(framework, MAX_FILES);
+    // Create a reader to read the files.
+    FileReader reader(framework);
 
-    // Send the work requests, one for each file name on the command line.
+    // Send the read requests, one for each file name on the command line.
+    int requestCount(0);
     for (int i = 0; i < MAX_FILES && i + 1 < argc; ++i)
     {
-        unsigned char *const buffer = new unsigned char[MAX_FILE_SIZE];
-        const ReadRequest message(
-            receiver.GetAddress(),
-            argv[i + 1],
-            buffer,
-            MAX_FILE_SIZE);
-
-        framework.Send(message, receiver.GetAddress(), dispatcher.GetAddress());
+        framework.Send(ReadRequest(receiver.GetAddress(), argv[i + 1]), receiver.GetAddress(), reader.GetAddress());
+        ++requestCount;
     }
 
-    // Wait for all results.
-    for (int i = 1; i < argc; ++i)
+    // Wait for all the responses.
+    for (int i = 0; i < requestCount; ++i)
     {
         receiver.Wait();
     }
 
-    // Handle the results; we just print the sizes of the files.
-    ReadRequest result;
+    // Handle the responses; we just print the sizes of the files.
+    ReadResponse response;
     Theron::Address from;
-    while (!resultCatcher.Empty())
+    while (!responseCatcher.Empty())
     {
-        resultCatcher.Pop(result, from);
-        printf("Read %d bytes from file '%s'\n", result.mFileSize, result.mFileName);
+        responseCatcher.Pop(response, from);
 
-        // Free the allocated buffer.
-        delete [] result.mBuffer;
+        if (response.mError)
+        {
+            printf("Failed to read file '%s'\n", response.mFileName);
+        }
+        else
+        {
+            printf("Read %d bytes from file '%s'\n", response.mFileSize, response.mFileName);
+        }
     }
 }
-
-
-
-
-